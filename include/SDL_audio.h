@@ -392,6 +392,63 @@ extern DECLSPEC void SDLCALL SDL_PauseAudioDevice(SDL_AudioDeviceID dev,
                                                   int pause_on);
 /* @} *//* Pause audio functions */
 
+/**
+ *  Timing of the thread that feeds an audio device, to find out why audio
+ *  glitches. All times are in microseconds.
+ *
+ *  The callback time is everything the callback took to fill one device
+ *  buffer, and the conversion time is what SDL took to convert it to the
+ *  device's format and rate. If both together take longer than buffer_us,
+ *  the device is likely to run dry.
+ *
+ *  \sa SDL_GetAudioDeviceStats
+ */
+typedef struct SDL_AudioDeviceStats
+{
+    Uint32 buffers;         /**< Device buffers filled while not paused */
+    Uint32 buffer_us;       /**< How long one device buffer plays for */
+    Uint32 callback_min_us;
+    Uint32 callback_avg_us;
+    Uint32 callback_max_us;
+    Uint32 callback_p99_us; /**< 99% of the buffers took at most this long, within about 10% */
+    Uint32 convert_avg_us;
+    Uint32 convert_max_us;
+    Uint32 wait_avg_us;     /**< Time spent handing a buffer to the device and waiting for it to want more */
+    Uint32 wait_max_us;
+    Uint32 late_buffers;    /**< Buffers that took longer than buffer_us to fill */
+    Uint32 dropped_buffers; /**< Buffers thrown away because the device wasn't ready or was lost */
+    Uint32 underruns;       /**< Times the driver reported that the device ran out of audio */
+    Uint32 latency_us;      /**< Estimated time from the callback until its audio is heard */
+} SDL_AudioDeviceStats;
+
+/**
+ *  Get the timing of an audio device's thread since it was opened, or
+ *  since SDL_ResetAudioDeviceStats().
+ *
+ *  Devices whose driver runs the callback on its own thread only report
+ *  underruns, and only some drivers detect those.
+ *
+ *  To have the stats logged with SDL_Log() as the device plays, set
+ *  ::SDL_HINT_AUDIO_DEVICE_STATS before opening it.
+ *
+ *  \param dev The device ID to query.
+ *  \param stats Filled in with the device's stats.
+ *  \return 0 on success, -1 if the device isn't open.
+ *
+ *  \sa SDL_ResetAudioDeviceStats
+ */
+extern DECLSPEC int SDLCALL SDL_GetAudioDeviceStats(SDL_AudioDeviceID dev,
+                                                    SDL_AudioDeviceStats *stats);
+
+/**
+ *  Start counting an audio device's stats from zero again.
+ *
+ *  \param dev The device ID to reset.
+ *
+ *  \sa SDL_GetAudioDeviceStats
+ */
+extern DECLSPEC void SDLCALL SDL_ResetAudioDeviceStats(SDL_AudioDeviceID dev);
+
 /**
  *  This function loads a WAVE from the data source, automatically freeing
  *  that source if \c freesrc is non-zero.  For example, to load a WAVE file,
@@ -429,6 +486,65 @@ extern DECLSPEC SDL_AudioSpec *SDLCALL SDL_LoadWAV_RW(SDL_RWops * src,
  */
 extern DECLSPEC void SDLCALL SDL_FreeWAV(Uint8 * audio_buf);
 
+/**
+ *  A WAVE stream decodes a WAVE file a block at a time as it is read, so
+ *  long pieces of music can be played without loading them into memory.
+ *  A stream must only be used by one thread at a time.
+ */
+struct SDL_WaveStream;
+typedef struct SDL_WaveStream SDL_WaveStream;
+
+/**
+ *  Open a WAVE stream on a data source, automatically freeing that source
+ *  when the stream is closed if \c freesrc is non-zero.
+ *
+ *  \c spec is filled in with the format of the audio the stream reads,
+ *  which is the same that SDL_LoadWAV_RW() would load. The data source is
+ *  left at the start of the audio data, and is read from as the stream is.
+ *
+ *  \return The new stream, or NULL on error. If this fails and \c freesrc
+ *          is non-zero, the data source is freed.
+ *
+ *  \sa SDL_WaveStreamRead
+ *  \sa SDL_CloseWaveStream
+ */
+extern DECLSPEC SDL_WaveStream * SDLCALL SDL_OpenWaveStream(SDL_RWops * src,
+                                                           int freesrc,
+                                                           SDL_AudioSpec * spec);
+
+/**
+ *  Read up to \c len bytes of audio from the stream, rounded down to a
+ *  whole number of sample frames.
+ *
+ *  \return The number of bytes read, 0 at the end of the audio, or -1 on
+ *          error.
+ */
+extern DECLSPEC int SDLCALL SDL_WaveStreamRead(SDL_WaveStream * stream, void *buf, int len);
+
+/**
+ *  Move the stream to a sample frame, counting from the start of the audio.
+ *  This needs a data source that can seek, unless it's within the block
+ *  being read.
+ *
+ *  \return 0 on success, or -1 on error.
+ */
+extern DECLSPEC int SDLCALL SDL_WaveStreamSeek(SDL_WaveStream * stream, Uint32 frame);
+
+/**
+ *  Get the sample frame that the next SDL_WaveStreamRead() starts at.
+ */
+extern DECLSPEC Uint32 SDLCALL SDL_WaveStreamTell(SDL_WaveStream * stream);
+
+/**
+ *  Get the length of the stream's audio, in sample frames.
+ */
+extern DECLSPEC Uint32 SDLCALL SDL_WaveStreamLength(SDL_WaveStream * stream);
+
+/**
+ *  Close a stream opened with SDL_OpenWaveStream().
+ */
+extern DECLSPEC void SDLCALL SDL_CloseWaveStream(SDL_WaveStream * stream);
+
 /**
  *  This function takes a source format and rate and a destination format
  *  and rate, and initializes the \c cvt structure with information needed
@@ -458,6 +574,74 @@ extern DECLSPEC int SDLCALL SDL_BuildAudioCVT(SDL_AudioCVT * cvt,
  */
 extern DECLSPEC int SDLCALL SDL_ConvertAudio(SDL_AudioCVT * cvt);
 
+/**
+ *  An audio stream converts audio as it is written into it, keeping what
+ *  it needs between writes, so chunks of any size can go in and come out
+ *  as if the audio had been converted all at once.
+ */
+struct SDL_AudioStream;
+typedef struct SDL_AudioStream SDL_AudioStream;
+
+/**
+ *  Create a stream that converts audio from one format, channel count and
+ *  rate to another.
+ *
+ *  \return The new stream, or NULL on error.
+ *
+ *  \sa SDL_AudioStreamPut
+ *  \sa SDL_AudioStreamGet
+ *  \sa SDL_FreeAudioStream
+ */
+extern DECLSPEC SDL_AudioStream * SDLCALL SDL_NewAudioStream(SDL_AudioFormat src_format,
+                                                            Uint8 src_channels,
+                                                            int src_rate,
+                                                            SDL_AudioFormat dst_format,
+                                                            Uint8 dst_channels,
+                                                            int dst_rate);
+
+/**
+ *  Write \c len bytes of audio in the source format to the stream.
+ *  \c len has to be a whole number of sample frames.
+ *
+ *  \return 0 on success, or -1 on error.
+ */
+extern DECLSPEC int SDLCALL SDL_AudioStreamPut(SDL_AudioStream * stream, const void *buf, int len);
+
+/**
+ *  Read up to \c len bytes of converted audio from the stream.
+ *  \c len has to be a whole number of sample frames.
+ *
+ *  \return The number of bytes read, or -1 on error.
+ */
+extern DECLSPEC int SDLCALL SDL_AudioStreamGet(SDL_AudioStream * stream, void *buf, int len);
+
+/**
+ *  Get the number of converted bytes that SDL_AudioStreamGet() can read.
+ *
+ *  When the rate changes, the last few frames written stay in the stream
+ *  until more audio comes after them, or until SDL_AudioStreamFlush().
+ */
+extern DECLSPEC int SDLCALL SDL_AudioStreamAvailable(SDL_AudioStream * stream);
+
+/**
+ *  Convert everything that has been written to the stream, as if silence
+ *  followed it, so that it can all be read. Use this at the end of the
+ *  audio; what is written next starts over as a new piece of audio.
+ *
+ *  \return 0 on success, or -1 on error.
+ */
+extern DECLSPEC int SDLCALL SDL_AudioStreamFlush(SDL_AudioStream * stream);
+
+/**
+ *  Drop all audio in the stream, converted or not.
+ */
+extern DECLSPEC void SDLCALL SDL_AudioStreamClear(SDL_AudioStream * stream);
+
+/**
+ *  Free a stream created with SDL_NewAudioStream().
+ */
+extern DECLSPEC void SDLCALL SDL_FreeAudioStream(SDL_AudioStream * stream);
+
 #define SDL_MIX_MAXVOLUME 128
 /**
  *  This takes two audio buffers of the playing audio format and mixes
@@ -497,7 +681,8 @@ extern DECLSPEC void SDLCALL SDL_MixAudioFormat(Uint8 * dst,
  *  This function copies the supplied data, so you are safe to free it when
  *  the function returns. This function is thread-safe, but queueing to the
  *  same device from two threads at once does not promise which buffer will
- *  be queued first.
+ *  be queued first. The device never waits on a thread that is queueing,
+ *  so it's fine to queue from a thread that decodes audio as it plays.
  *
  *  You may not queue audio on a device that is using an application-supplied
  *  callback; doing so returns an error. You have to use the audio callback
@@ -572,6 +757,106 @@ extern DECLSPEC Uint32 SDLCALL SDL_GetQueuedAudioSize(SDL_AudioDeviceID dev);
  */
 extern DECLSPEC void SDLCALL SDL_ClearQueuedAudio(SDL_AudioDeviceID dev);
 
+/**
+ *  Attach a voice mixer to an output device. The mixer takes over the
+ *  device's callback and plays the voices started with SDL_PlayMixerVoice()
+ *  instead, until SDL_DetachAudioMixer() gives the callback back or the
+ *  device is closed. Devices opened without a callback, to use
+ *  SDL_QueueAudio(), can't take a mixer.
+ *
+ *  Voices are mixed in float and clamped once at the end, so many loud
+ *  voices don't clip each other. Voices whose rate or pitch differs from
+ *  the device go through the same resampler as SDL_AudioStream.
+ *
+ *  The mixer functions are thread-safe. Don't call them from the callback
+ *  of another device that holds this device's lock.
+ *
+ *  \param dev The device ID to attach the mixer to.
+ *  \param max_voices How many voices can play at once, up to 65535.
+ *  \return 0 on success, or -1 on error.
+ *
+ *  \sa SDL_AddMixerSource
+ *  \sa SDL_PlayMixerVoice
+ */
+extern DECLSPEC int SDLCALL SDL_AttachAudioMixer(SDL_AudioDeviceID dev, int max_voices);
+
+/**
+ *  Stop all of a device's voices, free its mixer and sources, and give the
+ *  device back the callback it had before SDL_AttachAudioMixer().
+ */
+extern DECLSPEC void SDLCALL SDL_DetachAudioMixer(SDL_AudioDeviceID dev);
+
+/**
+ *  Add a sound that voices can play. The audio is copied and converted to
+ *  float once, so \c buf can be freed when this returns. Sounds with more
+ *  than two channels are mixed down to stereo.
+ *
+ *  \param dev The device ID with the mixer.
+ *  \param spec The format, channels and rate of the audio in \c buf.
+ *  \param buf The audio.
+ *  \param len The number of bytes of audio, a whole number of sample frames.
+ *  \return A source ID greater than 0, or -1 on error.
+ *
+ *  \sa SDL_RemoveMixerSource
+ */
+extern DECLSPEC int SDLCALL SDL_AddMixerSource(SDL_AudioDeviceID dev,
+                                               const SDL_AudioSpec * spec,
+                                               const Uint8 * buf, Uint32 len);
+
+/**
+ *  Stop the voices playing a source and free it.
+ */
+extern DECLSPEC void SDLCALL SDL_RemoveMixerSource(SDL_AudioDeviceID dev, int source);
+
+/**
+ *  Start a voice playing a source from the beginning.
+ *
+ *  A stereo source's channels are panned like a balance control; a mono
+ *  source is played at the same level in both channels when centered.
+ *
+ *  \param dev The device ID with the mixer.
+ *  \param source The source ID from SDL_AddMixerSource().
+ *  \param loop Non-zero to start over at the end of the source.
+ *  \param gain The voice's volume, 1.0f to play the source as it is.
+ *  \param pan From -1.0f for the left channel only to 1.0f for the right.
+ *  \return A voice ID greater than 0, or -1 on error or if all voices
+ *          are playing.
+ *
+ *  \sa SDL_StopMixerVoice
+ */
+extern DECLSPEC int SDLCALL SDL_PlayMixerVoice(SDL_AudioDeviceID dev, int source,
+                                               int loop, float gain, float pan);
+
+/**
+ *  Stop a voice. Stopping a voice that has already finished does nothing.
+ *
+ *  \return 0 on success, or -1 if \c voice isn't a voice of this mixer.
+ */
+extern DECLSPEC int SDLCALL SDL_StopMixerVoice(SDL_AudioDeviceID dev, int voice);
+
+/**
+ *  Find out whether a voice is still playing. Voices that don't loop stop
+ *  by themselves at the end of their source.
+ */
+extern DECLSPEC SDL_bool SDLCALL SDL_IsMixerVoicePlaying(SDL_AudioDeviceID dev, int voice);
+
+/**
+ *  \name Voice settings
+ *
+ *  Change a voice as it plays. The change is heard from the next buffer the
+ *  device asks for. Pitch is a playback speed up to 16.0f, 2.0f plays an
+ *  octave higher and twice as fast.
+ *
+ *  These return 0 on success, or -1 if \c voice isn't a voice of this mixer
+ *  or the value is out of range.
+ */
+/* @{ */
+extern DECLSPEC int SDLCALL SDL_SetMixerVoiceLoop(SDL_AudioDeviceID dev, int voice, int loop);
+extern DECLSPEC int SDLCALL SDL_SetMixerVoiceGain(SDL_AudioDeviceID dev, int voice, float gain);
+extern DECLSPEC int SDLCALL SDL_SetMixerVoicePan(SDL_AudioDeviceID dev, int voice, float pan);
+extern DECLSPEC int SDLCALL SDL_SetMixerVoicePitch(SDL_AudioDeviceID dev, int voice, float pitch);
+/* @} *//* Voice settings */
+
 
 /**
  *  \name Audio lock functions
@@ -549,6 +549,9 @@ typedef union SDL_Event
        within the union, which is 8 bytes.
 
        So... we'll add padding to force the size to be 56 bytes for both.
+
+       SDL keeps the time the input was acquired in the last 4 bytes, past
+       the end of the largest event structure, see SDL_GetEventTimestampNS().
     */
     Uint8 padding[56];
 } SDL_Event;
@@ -611,6 +614,16 @@ extern DECLSPEC SDL_bool SDLCALL SDL_HasEvents(Uint32 minType, Uint32 maxType);
 extern DECLSPEC void SDLCALL SDL_FlushEvent(Uint32 type);
 extern DECLSPEC void SDLCALL SDL_FlushEvents(Uint32 minType, Uint32 maxType);
 
+/**
+ *  Returns the number of events of the given type that were merged into an
+ *  earlier queued event since the event system was started.
+ *
+ *  Only ::SDL_MOUSEMOTION, ::SDL_JOYAXISMOTION, ::SDL_CONTROLLERAXISMOTION
+ *  and ::SDL_FINGERMOTION events are merged, and only while the
+ *  ::SDL_HINT_EVENT_COALESCING hint is enabled.
+ */
+extern DECLSPEC Uint32 SDLCALL SDL_GetCoalescedEventCount(Uint32 type);
+
 /**
  *  \brief Polls for currently pending events.
  *
@@ -652,6 +665,36 @@ extern DECLSPEC int SDLCALL SDL_WaitEventTimeout(SDL_Event * event,
  */
 extern DECLSPEC int SDLCALL SDL_PushEvent(SDL_Event * event);
 
+/**
+ *  \brief Add several events to the event queue at once.
+ *
+ *  The events all get the same timestamp and are queued in order. The event
+ *  filter sees each of them and the event watchers are called for the whole
+ *  batch before it is queued, at a fraction of the cost of calling
+ *  SDL_PushEvent() for each event.
+ *
+ *  \return The number of events queued, which is less than \c numevents if
+ *          some were filtered or the event queue filled up, or -1 if there
+ *          was some other error.
+ */
+extern DECLSPEC int SDLCALL SDL_PushEvents(SDL_Event * events, int numevents);
+
+/**
+ *  \brief Get the time the input behind an event was acquired, in nanoseconds.
+ *
+ *  Where the platform reports it, this is the time the device or the window
+ *  system saw the input, rather than the time the event was queued, which
+ *  is what the millisecond \c timestamp field of the event holds. Otherwise
+ *  it is the time the event was pushed, at the resolution of
+ *  SDL_GetPerformanceCounter().
+ *
+ *  \return Nanoseconds since the SDL library was initialized, on the same
+ *          scale as SDL_GetTicks(). The result is only meaningful for
+ *          events that went through SDL_PushEvent() or SDL_PushEvents()
+ *          less than a few seconds before they were queued.
+ */
+extern DECLSPEC Uint64 SDLCALL SDL_GetEventTimestampNS(const SDL_Event * event);
+
 typedef int (SDLCALL * SDL_EventFilter) (void *userdata, SDL_Event * event);
 
 /**
@@ -118,6 +118,44 @@ extern "C" {
  */
 #define SDL_HINT_RENDER_DIRECT3D11_DEBUG    "SDL_RENDER_DIRECT3D11_DEBUG"
 
+/**
+ *  \brief  A variable controlling whether the 3DS renderer compresses static textures at load time.
+ *
+ *  This variable can be set to the following values:
+ *    "0"       - Textures are stored as given
+ *    "1"       - Static ABGR8888 and BGR565 textures are stored as ETC1A4 and ETC1
+ *
+ *  ETC1 takes 4 bits per pixel and ETC1A4 8, so compressed textures use an
+ *  eighth (ETC1) or a quarter (ETC1A4) of the memory of their 32-bit
+ *  counterparts. Applications can also create SDL_PIXELFORMAT_ETC1 and
+ *  SDL_PIXELFORMAT_ETC1A4 textures directly from pre-compressed data.
+ *
+ *  When SDL_UpdateTexture() is given pre-compressed data, the pixels are
+ *  rows of 4x4 blocks, left to right and top to bottom, and the pitch is the
+ *  number of bytes from one row of blocks to the next. The rectangle has to
+ *  start on a block boundary, and its width and height have to be multiples
+ *  of 4 unless it reaches the right or bottom edge of the texture.
+ *
+ *  By default textures are not compressed.
+ */
+#define SDL_HINT_RENDER_3DS_ETC1            "SDL_RENDER_3DS_ETC1"
+
+/**
+ *  \brief  A variable controlling whether the 3DS top screen renderer draws in stereoscopic 3D.
+ *
+ *  This variable can be set to the following values:
+ *    "0"       - Both eyes see the same image
+ *    "1"       - Each draw is offset per eye by the parallax set with SDL_RenderSet3DSParallax()
+ *
+ *  The draw calls of a frame are recorded once and rendered for each eye, so
+ *  later draws always cover earlier ones regardless of their parallax. The
+ *  separation follows the 3D slider; with the slider down the second pass is
+ *  skipped.
+ *
+ *  This variable is checked when the renderer is created. By default it is off.
+ */
+#define SDL_HINT_RENDER_3DS_STEREO          "SDL_RENDER_3DS_STEREO"
+
 /**
  *  \brief  A variable controlling the scaling quality
  *
@@ -574,6 +612,91 @@ extern "C" {
  */
 #define SDL_HINT_NO_SIGNAL_HANDLERS   "SDL_NO_SIGNAL_HANDLERS"
 
+/**
+ *  \brief  A variable controlling whether motion events are merged in the event queue.
+ *
+ *  This variable can be set to the following values:
+ *    "0"       - Every motion event is queued (the default)
+ *    "1"       - A motion event is merged into a queued one from the same device
+ *
+ *  When enabled, an ::SDL_MOUSEMOTION, ::SDL_JOYAXISMOTION,
+ *  ::SDL_CONTROLLERAXISMOTION or ::SDL_FINGERMOTION event that is queued
+ *  right behind motion of the same mouse, axis or finger updates that event
+ *  instead of adding a new one. Positions and axis values take the latest
+ *  value and relative motion accumulates. Event watchers still see every
+ *  event. SDL_GetCoalescedEventCount() reports how many events were merged.
+ */
+#define SDL_HINT_EVENT_COALESCING   "SDL_EVENT_COALESCING"
+
+/**
+ *  \brief  A variable controlling whether $1 gestures are recognized on a separate thread.
+ *
+ *  This variable can be set to the following values:
+ *    "0"       - Gestures are recognized while the finger up event is processed (the default)
+ *    "1"       - Gestures are recognized on a background thread
+ *
+ *  With many templates loaded, recognition can take long enough to delay
+ *  the events behind the finger up. When enabled, the ::SDL_DOLLARGESTURE
+ *  event is pushed from the background thread once a match is found, so it
+ *  may arrive after events that were queued later.
+ */
+#define SDL_HINT_GESTURE_ASYNC   "SDL_GESTURE_ASYNC"
+
+/**
+ *  \brief  A variable controlling the quality of the resampler used when an audio device runs at a different rate than the application asked for.
+ *
+ *  This variable can be set to the following values:
+ *    "0" or "fast"     - Short filter, the least CPU
+ *    "1" or "medium"   - Longer filter, no audible aliasing (the default)
+ *    "2" or "best"     - Longest filter, for offline processing
+ *
+ *  The value is read when the audio device is opened.
+ */
+#define SDL_HINT_AUDIO_RESAMPLING_MODE   "SDL_AUDIO_RESAMPLING_MODE"
+
+/**
+ *  \brief  A variable controlling how often audio devices log their timing stats with SDL_Log().
+ *
+ *  This variable can be set to the following values:
+ *    "0"       - Don't log the stats (the default)
+ *    "N"       - Log the stats every N seconds
+ *
+ *  The value is read when the audio device is opened. The stats logged are
+ *  the ones SDL_GetAudioDeviceStats() returns.
+ */
+#define SDL_HINT_AUDIO_DEVICE_STATS   "SDL_AUDIO_DEVICE_STATS"
+
+/**
+ *  \brief  A variable controlling whether the disk audio driver renders faster than realtime.
+ *
+ *  This variable can be set to the following values:
+ *    "0"       - Write the audio about as fast as it would play (the default)
+ *    "1"       - Run the callback again as soon as a buffer is written
+ *
+ *  This is meant for rendering audio to a file offline, and for measuring
+ *  how fast the app and SDL can mix. While the device is paused nothing is
+ *  written. When the device closes, or after ::SDL_HINT_AUDIO_DISK_FRAMES,
+ *  it logs how many times realtime it ran.
+ *
+ *  The value is read when the audio device is opened.
+ */
+#define SDL_HINT_AUDIO_DISK_OFFLINE   "SDL_AUDIO_DISK_OFFLINE"
+
+/**
+ *  \brief  A variable setting how many sample frames the disk audio driver writes before it stops.
+ *
+ *  This variable can be set to the following values:
+ *    "0"       - Keep writing until the device is closed (the default)
+ *    "N"       - Write N sample frames
+ *
+ *  Once the frames are written, the device stops as if it was unplugged, so
+ *  an ::SDL_AUDIODEVICEREMOVED event is posted for it and
+ *  SDL_GetAudioDeviceStatus() returns ::SDL_AUDIO_STOPPED.
+ *
+ *  The value is read when the audio device is opened.
+ */
+#define SDL_HINT_AUDIO_DISK_FRAMES   "SDL_AUDIO_DISK_FRAMES"
+
 /**
  *  \brief  An enumeration of hint priorities
  */
@@ -76,6 +76,21 @@ extern DECLSPEC SDL_Window * SDLCALL SDL_GetKeyboardFocus(void);
  */
 extern DECLSPEC const Uint8 *SDLCALL SDL_GetKeyboardState(int *numkeys);
 
+/**
+ *  \brief Copy the state of the keyboard and the key modifiers as of a single moment.
+ *
+ *  \param keystate if non-NULL, receives up to \c numkeys key states, indexed like the array returned by SDL_GetKeyboardState().
+ *  \param numkeys the number of key states \c keystate has room for.
+ *  \param modstate if non-NULL, receives the key modifier state.
+ *
+ *  \return The number of key states copied, or -1 on error.
+ *
+ *  The array returned by SDL_GetKeyboardState() can change while it's read
+ *  if another thread is sending keyboard events. The copy made here never
+ *  mixes states from before and after a key event, without taking a lock.
+ */
+extern DECLSPEC int SDLCALL SDL_GetKeyboardSnapshot(Uint8 *keystate, int numkeys, SDL_Keymod *modstate);
+
 /**
  *  \brief Get the current key modifier state for the keyboard.
  */
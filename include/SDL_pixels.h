@@ -252,7 +252,11 @@ enum
     SDL_PIXELFORMAT_NV12 =      /**< Planar mode: Y + U/V interleaved  (2 planes) */
         SDL_DEFINE_PIXELFOURCC('N', 'V', '1', '2'),
     SDL_PIXELFORMAT_NV21 =      /**< Planar mode: Y + V/U interleaved  (2 planes) */
-        SDL_DEFINE_PIXELFOURCC('N', 'V', '2', '1')
+        SDL_DEFINE_PIXELFOURCC('N', 'V', '2', '1'),
+    SDL_PIXELFORMAT_ETC1 =      /**< Compressed: 8 byte ETC1 blocks of 4x4 pixels */
+        SDL_DEFINE_PIXELFOURCC('E', 'T', 'C', '1'),
+    SDL_PIXELFORMAT_ETC1A4 =    /**< Compressed: 8 bytes of 4 bit alpha + ETC1 block */
+        SDL_DEFINE_PIXELFOURCC('E', 'T', 'A', '4')
 };
 
 typedef struct SDL_Color
@@ -205,6 +205,26 @@ extern DECLSPEC const char * SDLCALL SDL_WinRTGetFSPathUTF8(SDL_WinRT_Path pathT
 
 #endif /* __WINRT__ */
 
+
+/* Platform specific functions for the Nintendo 3DS */
+#if defined(__3DS__) && __3DS__
+
+/**
+   \brief Sets the stereoscopic depth of the following draw calls.
+
+   Only the top screen renderer created with SDL_HINT_RENDER_3DS_STEREO set
+   draws in 3D, for any other renderer this does nothing.
+
+   \param parallax The horizontal separation, in pixels, of the left and right
+                   eye images with the 3D slider all the way up. Positive values
+                   appear behind the screen, negative values in front of it.
+
+   \return 0 on success, or -1 if the renderer is not a 3DS renderer.
+ */
+extern DECLSPEC int SDLCALL SDL_RenderSet3DSParallax(SDL_Renderer * renderer, float parallax);
+
+#endif /* __3DS__ */
+
 /* Ends C function definitions when using C++ */
 #ifdef __cplusplus
 }
@@ -158,6 +158,12 @@ get_audio_device(SDL_AudioDeviceID id)
     return open_devices[id];
 }
 
+SDL_AudioDevice *
+SDL_GetOpenAudioDevice(SDL_AudioDeviceID id)
+{
+    return get_audio_device(id);
+}
+
 
 /* stubs for audio drivers that don't need a specific entry point... */
 static void
@@ -418,56 +424,116 @@ SDL_RemoveAudioDevice(const int iscapture, void *handle)
 
 /* buffer queueing support... */
 
+/*
+ * SDL_QueueAudio() writes into a ring and the device thread reads out of
+ *  it without a lock, so an app streaming from another thread can never
+ *  hold up the device. Queueing threads only take queue_lock among
+ *  themselves. When a ring fills, writes move on to a bigger one and the
+ *  device thread follows once it has played what was left in the old one.
+ */
+
 /* this expects that you managed thread safety elsewhere. */
 static void
-free_audio_queue(SDL_AudioBufferQueue *buffer)
+free_audio_queue(SDL_AudioQueueRing *ring)
 {
-    while (buffer) {
-        SDL_AudioBufferQueue *next = buffer->next;
-        SDL_free(buffer);
-        buffer = next;
+    while (ring) {
+        SDL_AudioQueueRing *next = (SDL_AudioQueueRing *) ring->next;
+        SDL_free(ring);
+        ring = next;
+    }
+}
+
+static SDL_AudioQueueRing *
+new_audio_queue_ring(Uint32 size, Uint32 start)
+{
+    SDL_AudioQueueRing *ring = (SDL_AudioQueueRing *) SDL_malloc(sizeof (SDL_AudioQueueRing) + size);
+    if (ring == NULL) {
+        SDL_OutOfMemory();
+        return NULL;
     }
+    ring->data = (Uint8 *) (ring + 1);
+    ring->size = size;
+    ring->start = start;
+    ring->next = NULL;
+    return ring;
+}
+
+/* Where the queue really starts: ahead of what was played if the queue was
+   cleared since. Positions wrap, so they're compared by their difference. */
+static Uint32
+audio_queue_start(Uint32 readpos, Uint32 discardpos)
+{
+    return ((Sint32) (discardpos - readpos) > 0) ? discardpos : readpos;
 }
 
 static void SDLCALL
 SDL_BufferQueueDrainCallback(void *userdata, Uint8 *stream, int _len)
 {
-    /* this function always holds the mixer lock before being called. */
+    /* this function runs on the device thread and never blocks. */
     Uint32 len = (Uint32) _len;
     SDL_AudioDevice *device = (SDL_AudioDevice *) userdata;
-    SDL_AudioBufferQueue *buffer;
+    SDL_AudioQueueRing *ring;
+    Uint32 readpos, discardpos, skip;
 
     SDL_assert(device != NULL);  /* this shouldn't ever happen, right?! */
     SDL_assert(_len >= 0);  /* this shouldn't ever happen, right?! */
 
-    while ((len > 0) && ((buffer = device->buffer_queue_head) != NULL)) {
-        const Uint32 avail = buffer->datalen - buffer->startpos;
-        const Uint32 cpy = SDL_min(len, avail);
-        SDL_assert(device->queued_bytes >= avail);
+    ring = (SDL_AudioQueueRing *) SDL_AtomicGetPtr(&device->queue_read_ring);
+    readpos = (Uint32) SDL_AtomicGet(&device->queue_read);
+    discardpos = (Uint32) SDL_AtomicGet(&device->queue_discard);
+    skip = audio_queue_start(readpos, discardpos) - readpos;
+
+    while (ring) {
+        /* Read the write position before the next ring: if there's no next
+           ring yet, everything up to the write position is in this one. */
+        const Uint32 writepos = (Uint32) SDL_AtomicGet(&device->queue_write);
+        SDL_AudioQueueRing *next = (SDL_AudioQueueRing *) SDL_AtomicGetPtr(&ring->next);
+        const Uint32 avail = (next ? next->start : writepos) - readpos;
+        Uint32 cpy, offset, first;
+
+        if (avail == 0) {
+            if (next == NULL) {
+                break;  /* queue is empty. */
+            }
+            /* done with this ring, the queueing thread will free it. */
+            ring = next;
+            SDL_AtomicSetPtr(&device->queue_read_ring, ring);
+            continue;
+        }
 
-        SDL_memcpy(stream, buffer->data + buffer->startpos, cpy);
-        buffer->startpos += cpy;
-        stream += cpy;
-        device->queued_bytes -= cpy;
-        len -= cpy;
+        if (skip > 0) {  /* cleared, just drop it. */
+            cpy = SDL_min(skip, avail);
+            readpos += cpy;
+            skip -= cpy;
+            continue;
+        }
 
-        if (buffer->startpos == buffer->datalen) {  /* packet is done, put it in the pool. */
-            device->buffer_queue_head = buffer->next;
-            SDL_assert((buffer->next != NULL) || (buffer == device->buffer_queue_tail));
-            buffer->next = device->buffer_queue_pool;
-            device->buffer_queue_pool = buffer;
+        if (len == 0) {
+            break;
         }
+
+        cpy = SDL_min(len, avail);
+        offset = readpos & (ring->size - 1);
+        first = SDL_min(cpy, ring->size - offset);
+        SDL_memcpy(stream, ring->data + offset, first);
+        SDL_memcpy(stream + first, ring->data, cpy - first);
+        readpos += cpy;
+        stream += cpy;
+        len -= cpy;
     }
 
-    SDL_assert((device->buffer_queue_head != NULL) == (device->queued_bytes != 0));
+    /* Done reading: hand the space back to the queueing thread. */
+    SDL_MemoryBarrierRelease();
+    SDL_AtomicSet(&device->queue_read, (int) readpos);
 
-    if (len > 0) {  /* fill any remaining space in the stream with silence. */
-        SDL_assert(device->buffer_queue_head == NULL);
-        SDL_memset(stream, device->spec.silence, len);
+    /* Keep the clear position from looking ahead again once positions wrap
+       around. If the app just cleared again, this leaves that alone. */
+    if (discardpos != readpos && (Sint32) (discardpos - readpos) <= 0) {
+        SDL_AtomicCAS(&device->queue_discard, (int) discardpos, (int) readpos);
     }
 
-    if (device->buffer_queue_head == NULL) {
-        device->buffer_queue_tail = NULL;  /* in case we drained the queue entirely. */
+    if (len > 0) {  /* fill any remaining space in the stream with silence. */
+        SDL_memset(stream, device->spec.silence, len);
     }
 }
 
@@ -476,10 +542,8 @@ SDL_QueueAudio(SDL_AudioDeviceID devid, const void *_data, Uint32 len)
 {
     SDL_AudioDevice *device = get_audio_device(devid);
     const Uint8 *data = (const Uint8 *) _data;
-    SDL_AudioBufferQueue *orighead;
-    SDL_AudioBufferQueue *origtail;
-    Uint32 origlen;
-    Uint32 datalen;
+    SDL_AudioQueueRing *ring;
+    Uint32 readpos, writepos, used, offset, first;
 
     if (!device) {
         return -1;  /* get_audio_device() will have set the error state */
@@ -489,66 +553,48 @@ SDL_QueueAudio(SDL_AudioDeviceID devid, const void *_data, Uint32 len)
         return SDL_SetError("Audio device has a callback, queueing not allowed");
     }
 
-    current_audio.impl.LockDevice(device);
+    SDL_LockMutex(device->queue_lock);
 
-    orighead = device->buffer_queue_head;
-    origtail = device->buffer_queue_tail;
-    origlen = origtail ? origtail->datalen : 0;
-
-    while (len > 0) {
-        SDL_AudioBufferQueue *packet = device->buffer_queue_tail;
-        SDL_assert(!packet || (packet->datalen <= SDL_AUDIOBUFFERQUEUE_PACKETLEN));
-        if (!packet || (packet->datalen >= SDL_AUDIOBUFFERQUEUE_PACKETLEN)) {
-            /* tail packet missing or completely full; we need a new packet. */
-            packet = device->buffer_queue_pool;
-            if (packet != NULL) {
-                /* we have one available in the pool. */
-                device->buffer_queue_pool = packet->next;
-            } else {
-                /* Have to allocate a new one! */
-                packet = (SDL_AudioBufferQueue *) SDL_malloc(sizeof (SDL_AudioBufferQueue));
-                if (packet == NULL) {
-                    /* uhoh, reset so we've queued nothing new, free what we can. */
-                    if (!origtail) {
-                        packet = device->buffer_queue_head;  /* whole queue. */
-                    } else {
-                        packet = origtail->next;  /* what we added to existing queue. */
-                        origtail->next = NULL;
-                        origtail->datalen = origlen;
-                    }
-                    device->buffer_queue_head = orighead;
-                    device->buffer_queue_tail = origtail;
-                    device->buffer_queue_pool = NULL;
-
-                    current_audio.impl.UnlockDevice(device);
-
-                    free_audio_queue(packet);  /* give back what we can. */
-
-                    return SDL_OutOfMemory();
-                }
-            }
-            packet->datalen = 0;
-            packet->startpos = 0;
-            packet->next = NULL;
+    /* Free the rings the device thread has moved past. */
+    ring = (SDL_AudioQueueRing *) SDL_AtomicGetPtr(&device->queue_read_ring);
+    while (device->queue_oldest_ring != ring) {
+        SDL_AudioQueueRing *next = (SDL_AudioQueueRing *) device->queue_oldest_ring->next;
+        SDL_free(device->queue_oldest_ring);
+        device->queue_oldest_ring = next;
+    }
 
-            SDL_assert((device->buffer_queue_head != NULL) == (device->queued_bytes != 0));
-            if (device->buffer_queue_tail == NULL) {
-                device->buffer_queue_head = packet;
-            } else {
-                device->buffer_queue_tail->next = packet;
-            }
-            device->buffer_queue_tail = packet;
-        }
+    /* Space isn't free until the device has played it, even if it was
+       cleared, since the device might be reading it right now. */
+    ring = device->queue_write_ring;
+    readpos = (Uint32) SDL_AtomicGet(&device->queue_read);
+    writepos = (Uint32) SDL_AtomicGet(&device->queue_write);
+    used = writepos - audio_queue_start(readpos, ring->start);
 
-        datalen = SDL_min(len, SDL_AUDIOBUFFERQUEUE_PACKETLEN - packet->datalen);
-        SDL_memcpy(packet->data + packet->datalen, data, datalen);
-        data += datalen;
-        len -= datalen;
-        packet->datalen += datalen;
-        device->queued_bytes += datalen;
+    if (len > ring->size - used) {
+        /* Move on to a bigger ring, the device will finish this one first.
+           Rings stop at 1GB, so positions can still be compared. */
+        Uint32 size = SDL_min(ring->size * 2, 0x40000000);
+        while (size < len && size < 0x40000000) {
+            size *= 2;
+        }
+        if (size < len || (ring = new_audio_queue_ring(size, writepos)) == NULL) {
+            SDL_UnlockMutex(device->queue_lock);
+            return SDL_OutOfMemory();
+        }
+        SDL_MemoryBarrierRelease();
+        SDL_AtomicSetPtr(&device->queue_write_ring->next, ring);
+        device->queue_write_ring = ring;
     }
 
-    current_audio.impl.UnlockDevice(device);
+    offset = writepos & (ring->size - 1);
+    first = SDL_min(len, ring->size - offset);
+    SDL_memcpy(ring->data + offset, data, first);
+    SDL_memcpy(ring->data, data + first, len - first);
+
+    /* Only now can the device see the new data. */
+    SDL_AtomicAdd(&device->queue_write, (int) len);
+
+    SDL_UnlockMutex(device->queue_lock);
 
     return 0;
 }
@@ -561,9 +607,12 @@ SDL_GetQueuedAudioSize(SDL_AudioDeviceID devid)
 
     /* Nothing to do unless we're set up for queueing. */
     if (device && (device->spec.callback == SDL_BufferQueueDrainCallback)) {
-        current_audio.impl.LockDevice(device);
-        retval = device->queued_bytes + current_audio.impl.GetPendingBytes(device);
-        current_audio.impl.UnlockDevice(device);
+        /* Read the write position last, so it's never behind the others. */
+        const Uint32 readpos = (Uint32) SDL_AtomicGet(&device->queue_read);
+        const Uint32 discardpos = (Uint32) SDL_AtomicGet(&device->queue_discard);
+        const Uint32 writepos = (Uint32) SDL_AtomicGet(&device->queue_write);
+        retval = writepos - audio_queue_start(readpos, discardpos);
+        retval += current_audio.impl.GetPendingBytes(device);
     }
 
     return retval;
@@ -573,22 +622,240 @@ void
 SDL_ClearQueuedAudio(SDL_AudioDeviceID devid)
 {
     SDL_AudioDevice *device = get_audio_device(devid);
-    SDL_AudioBufferQueue *buffer = NULL;
-    if (!device) {
+    if (!device || (device->spec.callback != SDL_BufferQueueDrainCallback)) {
         return;  /* nothing to do. */
     }
 
-    /* Blank out the device and release the mutex. Free it afterwards. */
-    current_audio.impl.LockDevice(device);
-    buffer = device->buffer_queue_head;
-    device->buffer_queue_tail = NULL;
-    device->buffer_queue_head = NULL;
-    device->queued_bytes = 0;
-    current_audio.impl.UnlockDevice(device);
+    /* The device thread skips what's queued so far the next time it reads.
+       The space is reused once it has. */
+    SDL_LockMutex(device->queue_lock);
+    SDL_AtomicSet(&device->queue_discard, SDL_AtomicGet(&device->queue_write));
+    SDL_UnlockMutex(device->queue_lock);
+}
+
+
+/* Timing stats... */
+
+/* Buckets are 1/8 of a power of two wide: below 16 there's one for every
+   microsecond, then 16-17, 18-19, ... 30-31, 32-35, and so on. */
+static int
+audio_stats_bucket(Uint32 us)
+{
+    int shift = 0;
+    while ((us >> shift) >= 16) {
+        ++shift;
+    }
+    return (shift * 8) + (int) (us >> shift);
+}
 
-    free_audio_queue(buffer);
+static Uint32
+audio_stats_bucket_max(int bucket)
+{
+    const int shift = (bucket < 16) ? 0 : ((bucket / 8) - 1);
+    return ((((Uint32) (bucket - (shift * 8))) + 1) << shift) - 1;
 }
 
+static Uint32
+audio_ticks_to_us(Uint64 ticks, Uint64 frequency)
+{
+    const double us = ((double) ticks * 1000000.0) / (double) frequency;
+    return (us < 4294967295.0) ? (Uint32) us : 0xFFFFFFFF;
+}
+
+static void
+record_audio_buffer(SDL_AudioDevice *device, Uint32 callback_us, Uint32 convert_us)
+{
+    SDL_AudioTimingStats *stats = &device->stats;
+    const Uint32 buffer_us = (Uint32) ((device->spec.samples * (Uint64) 1000000) / device->spec.freq);
+
+    SDL_AtomicLock(&device->stats_lock);
+    if (stats->buffers == 0 || callback_us < stats->callback_min) {
+        stats->callback_min = callback_us;
+    }
+    stats->callback_max = SDL_max(stats->callback_max, callback_us);
+    stats->callback_total += callback_us;
+    stats->convert_max = SDL_max(stats->convert_max, convert_us);
+    stats->convert_total += convert_us;
+    stats->histogram[audio_stats_bucket(callback_us)]++;
+    if (callback_us + convert_us > buffer_us) {
+        stats->late_buffers++;
+    }
+    stats->buffers++;
+    SDL_AtomicUnlock(&device->stats_lock);
+}
+
+static void
+record_audio_wait(SDL_AudioDevice *device, Uint32 wait_us, SDL_bool dropped)
+{
+    SDL_AudioTimingStats *stats = &device->stats;
+    Uint32 pending = current_audio.impl.GetPendingBytes(device);
+    const Uint32 frame_size = (SDL_AUDIO_BITSIZE(device->spec.format) / 8) * device->spec.channels;
+    Uint32 frames;
+
+    if (device->stream) {
+        pending += SDL_AudioStreamAvailable(device->stream);
+    }
+    frames = device->spec.samples + (pending / frame_size);
+
+    SDL_AtomicLock(&device->stats_lock);
+    if (dropped) {
+        stats->dropped_buffers++;
+    } else {
+        stats->wait_max = SDL_max(stats->wait_max, wait_us);
+        stats->wait_total += wait_us;
+        stats->waits++;
+    }
+    stats->latency = (Uint32) ((frames * (Uint64) 1000000) / device->spec.freq);
+    SDL_AtomicUnlock(&device->stats_lock);
+}
+
+void
+SDL_AudioDeviceUnderrun(SDL_AudioDevice *device)
+{
+    SDL_AtomicLock(&device->stats_lock);
+    device->stats.underruns++;
+    SDL_AtomicUnlock(&device->stats_lock);
+}
+
+static void
+log_audio_stats(SDL_AudioDevice *device)
+{
+    SDL_AudioDeviceStats stats;
+
+    if (SDL_GetAudioDeviceStats(device->id, &stats) < 0) {
+        return;
+    }
+    SDL_Log("Audio device %u: %u buffers of %u us, "
+            "callback min/avg/max/p99 %u/%u/%u/%u us, "
+            "convert avg/max %u/%u us, wait avg/max %u/%u us, "
+            "%u late, %u dropped, %u underruns, "
+            "latency %u us",
+            (unsigned int) device->id, stats.buffers, stats.buffer_us,
+            stats.callback_min_us, stats.callback_avg_us,
+            stats.callback_max_us, stats.callback_p99_us,
+            stats.convert_avg_us, stats.convert_max_us,
+            stats.wait_avg_us, stats.wait_max_us,
+            stats.late_buffers, stats.dropped_buffers,
+            stats.underruns, stats.latency_us);
+}
+
+int
+SDL_GetAudioDeviceStats(SDL_AudioDeviceID devid, SDL_AudioDeviceStats *stats)
+{
+    SDL_AudioDevice *device = get_audio_device(devid);
+    SDL_AudioTimingStats *timing;
+    Uint32 rank, count;
+    int i;
+
+    if (!device) {
+        return -1;  /* get_audio_device() will have set the error state */
+    }
+    if (!stats) {
+        return SDL_InvalidParamError("stats");
+    }
+
+    timing = (SDL_AudioTimingStats *) SDL_malloc(sizeof (*timing));
+    if (!timing) {
+        return SDL_OutOfMemory();
+    }
+    SDL_AtomicLock(&device->stats_lock);
+    SDL_memcpy(timing, &device->stats, sizeof (*timing));
+    SDL_AtomicUnlock(&device->stats_lock);
+
+    SDL_zerop(stats);
+    stats->buffers = timing->buffers;
+    stats->buffer_us = (Uint32) ((device->spec.samples * (Uint64) 1000000) / device->spec.freq);
+    if (timing->buffers > 0) {
+        stats->callback_min_us = timing->callback_min;
+        stats->callback_avg_us = (Uint32) (timing->callback_total / timing->buffers);
+        stats->callback_max_us = timing->callback_max;
+        stats->convert_avg_us = (Uint32) (timing->convert_total / timing->buffers);
+        stats->convert_max_us = timing->convert_max;
+
+        /* the bucket holding the 99th percentile, but never above the max */
+        rank = (Uint32) (((Uint64) timing->buffers * 99 + 99) / 100);
+        count = 0;
+        for (i = 0; i < SDL_AUDIOSTATS_BUCKETS; i++) {
+            count += timing->histogram[i];
+            if (count >= rank) {
+                break;
+            }
+        }
+        stats->callback_p99_us = SDL_min(audio_stats_bucket_max(i), timing->callback_max);
+    }
+    if (timing->waits > 0) {
+        stats->wait_avg_us = (Uint32) (timing->wait_total / timing->waits);
+        stats->wait_max_us = timing->wait_max;
+    }
+    stats->late_buffers = timing->late_buffers;
+    stats->dropped_buffers = timing->dropped_buffers;
+    stats->underruns = timing->underruns;
+    stats->latency_us = timing->latency;
+
+    SDL_free(timing);
+    return 0;
+}
+
+void
+SDL_ResetAudioDeviceStats(SDL_AudioDeviceID devid)
+{
+    SDL_AudioDevice *device = get_audio_device(devid);
+    if (device) {
+        SDL_AtomicLock(&device->stats_lock);
+        SDL_zero(device->stats);
+        SDL_AtomicUnlock(&device->stats_lock);
+    }
+}
+
+
+/* Fill the device's buffer from what the stream has queued, then run the
+   callback straight into the stream's work buffer until the buffer is full.
+   Converted audio goes right into the device's buffer while there's room,
+   only what's left over is queued for next time. */
+static Uint8 *
+SDL_FillStreamBuffer(SDL_AudioDevice * device, int stream_len, Uint64 *callback_ticks)
+{
+    const int silence = (device->convert.src_format == AUDIO_U8) ? 0x80 : 0;
+    const int device_len = device->spec.size;
+    Uint8 *stream;
+    int got;
+
+    stream = device->enabled ? current_audio.impl.GetDeviceBuf(device) : NULL;
+    if (stream == NULL) {
+        stream = device->fake_stream;
+    }
+
+    got = SDL_AudioStreamGet(device->stream, stream, device_len);
+    while (got < device_len) {
+        Uint8 *buf = SDL_GetAudioStreamWork(device->stream, stream_len);
+        int direct;
+
+        if (buf == NULL) {
+            break;  /* out of memory, play what there is */
+        }
+
+        /* !!! FIXME: this should be LockDevice. */
+        SDL_LockMutex(device->mixer_lock);
+        if (device->paused) {
+            SDL_memset(buf, silence, stream_len);
+        } else {
+            const Uint64 start = SDL_GetPerformanceCounter();
+            (*device->spec.callback) (device->spec.userdata, buf, stream_len);
+            *callback_ticks += SDL_GetPerformanceCounter() - start;
+        }
+        SDL_UnlockMutex(device->mixer_lock);
+
+        direct = SDL_AudioStreamPutWork(device->stream, stream_len, stream + got, device_len - got);
+        if (direct < 0) {
+            break;
+        }
+        got += direct;
+    }
+    if (got < device_len) {
+        SDL_memset(stream + got, device->spec.silence, device_len - got);
+    }
+    return stream;
+}
 
 /* The general mixing thread function */
 int SDLCALL
@@ -598,9 +865,9 @@ SDL_RunAudio(void *devicep)
     const int silence = (int) device->spec.silence;
     const Uint32 delay = ((device->spec.samples * 1000) / device->spec.freq);
     const int stream_len = (device->convert.needed) ? device->convert.len : device->spec.size;
+    const Uint64 frequency = SDL_GetPerformanceFrequency();
+    Uint64 last_log = SDL_GetPerformanceCounter();
     Uint8 *stream;
-    void *udata = device->spec.userdata;
-    void (SDLCALL *fill) (void *, Uint8 *, int) = device->spec.callback;
 
     /* The audio mixing is always a high priority thread */
     SDL_SetThreadPriority(SDL_THREAD_PRIORITY_HIGH);
@@ -611,51 +878,78 @@ SDL_RunAudio(void *devicep)
 
     /* Loop, filling the audio buffers */
     while (!device->shutdown) {
-        /* Fill the current buffer with sound */
-        if (device->convert.needed) {
-            stream = device->convert.buf;
-        } else if (device->enabled) {
-            stream = current_audio.impl.GetDeviceBuf(device);
-        } else {
-            /* if the device isn't enabled, we still write to the
-               fake_stream, so the app's callback will fire with
-               a regular frequency, in case they depend on that
-               for timing or progress. They can use hotplug
-               now to know if the device failed. */
-            stream = NULL;
-        }
+        const SDL_bool playing = !device->paused;
+        const Uint64 start = SDL_GetPerformanceCounter();
+        Uint64 callback_ticks = 0;
+        Uint64 now;
 
-        if (stream == NULL) {
-            stream = device->fake_stream;
-        }
-
-        /* !!! FIXME: this should be LockDevice. */
-        SDL_LockMutex(device->mixer_lock);
-        if (device->paused) {
-            SDL_memset(stream, silence, stream_len);
+        if (device->stream) {
+            stream = SDL_FillStreamBuffer(device, stream_len, &callback_ticks);
         } else {
-            (*fill) (udata, stream, stream_len);
-        }
-        SDL_UnlockMutex(device->mixer_lock);
+            /* Fill the current buffer with sound */
+            if (device->convert.needed) {
+                stream = device->convert.buf;
+            } else if (device->enabled) {
+                stream = current_audio.impl.GetDeviceBuf(device);
+            } else {
+                /* if the device isn't enabled, we still write to the
+                   fake_stream, so the app's callback will fire with
+                   a regular frequency, in case they depend on that
+                   for timing or progress. They can use hotplug
+                   now to know if the device failed. */
+                stream = NULL;
+            }
 
-        /* Convert the audio if necessary */
-        if (device->enabled && device->convert.needed) {
-            SDL_ConvertAudio(&device->convert);
-            stream = current_audio.impl.GetDeviceBuf(device);
             if (stream == NULL) {
                 stream = device->fake_stream;
+            }
+
+            /* !!! FIXME: this should be LockDevice. */
+            SDL_LockMutex(device->mixer_lock);
+            if (device->paused) {
+                SDL_memset(stream, silence, stream_len);
             } else {
-                SDL_memcpy(stream, device->convert.buf,
-                           device->convert.len_cvt);
+                const Uint64 callback_start = SDL_GetPerformanceCounter();
+                /* Read under the lock, a voice mixer can take it over */
+                (*device->spec.callback) (device->spec.userdata, stream, stream_len);
+                callback_ticks = SDL_GetPerformanceCounter() - callback_start;
+            }
+            SDL_UnlockMutex(device->mixer_lock);
+
+            /* Convert the audio if necessary */
+            if (device->enabled && device->convert.needed) {
+                SDL_ConvertAudio(&device->convert);
+                stream = current_audio.impl.GetDeviceBuf(device);
+                if (stream == NULL) {
+                    stream = device->fake_stream;
+                } else {
+                    SDL_memcpy(stream, device->convert.buf,
+                               device->convert.len_cvt);
+                }
             }
         }
 
+        /* Everything but the callback went to locking and converting */
+        now = SDL_GetPerformanceCounter();
+        if (playing) {
+            record_audio_buffer(device, audio_ticks_to_us(callback_ticks, frequency),
+                                audio_ticks_to_us(now - start - callback_ticks, frequency));
+        }
+
         /* Ready current buffer for play and change current buffer */
         if (stream == device->fake_stream) {
             SDL_Delay(delay);
+            record_audio_wait(device, 0, SDL_TRUE);
         } else {
             current_audio.impl.PlayDevice(device);
             current_audio.impl.WaitDevice(device);
+            record_audio_wait(device, audio_ticks_to_us(SDL_GetPerformanceCounter() - now, frequency), SDL_FALSE);
+        }
+
+        if (device->stats_log_interval &&
+            (SDL_GetPerformanceCounter() - last_log) * 1000 >= device->stats_log_interval * frequency) {
+            log_audio_stats(device);
+            last_log = SDL_GetPerformanceCounter();
         }
     }
 
@@ -884,18 +1178,45 @@ close_audio_device(SDL_AudioDevice * device)
     if (device->convert.needed) {
         SDL_FreeAudioMem(device->convert.buf);
     }
+    SDL_FreeAudioStream(device->stream);
+    SDL_FreeAudioMixer(device->mixer);
     if (device->opened) {
         current_audio.impl.CloseDevice(device);
         device->opened = 0;
     }
 
-    free_audio_queue(device->buffer_queue_head);
-    free_audio_queue(device->buffer_queue_pool);
+    if (device->queue_lock != NULL) {
+        SDL_DestroyMutex(device->queue_lock);
+    }
+    free_audio_queue(device->queue_oldest_ring);
 
     SDL_FreeAudioMem(device);
 }
 
 
+/*
+ * Set up the conversion through an audio stream. (convert) only holds the
+ *  callback's buffer and format, the stream does the rest.
+ */
+static int
+open_audio_stream(SDL_AudioDevice * device, const SDL_AudioSpec * obtained)
+{
+    device->stream = SDL_NewAudioStream(obtained->format, obtained->channels,
+                                        obtained->freq, device->spec.format,
+                                        device->spec.channels, device->spec.freq);
+    if (device->stream == NULL) {
+        return -1;
+    }
+
+    /* The callback writes into the stream, so there's no convert.buf */
+    device->convert.needed = 1;
+    device->convert.src_format = obtained->format;
+    device->convert.dst_format = device->spec.format;
+    device->convert.len = obtained->size;
+    return 0;
+}
+
+
 /*
  * Sanity check desired AudioSpec for SDL_OpenAudio() in (orig).
  *  Fills in a sanitized copy in (prepared).
@@ -968,6 +1289,7 @@ open_audio_device(const char *devname, int iscapture,
     SDL_AudioDevice *device;
     SDL_bool build_cvt;
     void *handle = NULL;
+    const char *hint;
     Uint32 stream_len;
     int i = 0;
 
@@ -1079,6 +1401,11 @@ open_audio_device(const char *devname, int iscapture,
     device->paused = 1;
     device->iscapture = iscapture;
 
+    hint = SDL_GetHint(SDL_HINT_AUDIO_DEVICE_STATS);
+    if (hint && SDL_atoi(hint) > 0) {
+        device->stats_log_interval = (Uint32) SDL_atoi(hint) * 1000;
+    }
+
     /* Create a mutex for locking the sound buffers */
     if (!current_audio.impl.SkipMixerLock) {
         device->mixer_lock = SDL_CreateMutex();
@@ -1128,7 +1455,12 @@ open_audio_device(const char *devname, int iscapture,
         SDL_CalculateAudioSpec(obtained);
     }
 
-    if (build_cvt) {
+    if (build_cvt && !iscapture && !current_audio.impl.ProvidesOwnCallbackThread) {
+        if (open_audio_stream(device, obtained) < 0) {
+            close_audio_device(device);
+            return 0;
+        }
+    } else if (build_cvt) {
         /* Build an audio conversion block */
         if (SDL_BuildAudioCVT(&device->convert,
                               obtained->format, obtained->channels,
@@ -1166,20 +1498,23 @@ open_audio_device(const char *devname, int iscapture,
         return 0;
     }
 
+    device->callbackspec = *obtained;
+
     if (device->spec.callback == NULL) {  /* use buffer queueing? */
-        /* pool a few packets to start. Enough for two callbacks. */
-        const int packetlen = SDL_AUDIOBUFFERQUEUE_PACKETLEN;
-        const int wantbytes = ((device->convert.needed) ? device->convert.len : device->spec.size) * 2;
-        const int wantpackets = (wantbytes / packetlen) + ((wantbytes % packetlen) ? packetlen : 0);
-        for (i = 0; i < wantpackets; i++) {
-            SDL_AudioBufferQueue *packet = (SDL_AudioBufferQueue *) SDL_malloc(sizeof (SDL_AudioBufferQueue));
-            if (packet) { /* don't care if this fails, we'll deal later. */
-                packet->datalen = 0;
-                packet->startpos = 0;
-                packet->next = device->buffer_queue_pool;
-                device->buffer_queue_pool = packet;
-            }
+        /* start with a ring big enough for two callbacks. */
+        const Uint32 wantbytes = ((device->convert.needed) ? device->convert.len : device->spec.size) * 2;
+        Uint32 size = SDL_AUDIOQUEUE_MINRING;
+        while (size < wantbytes) {
+            size *= 2;
+        }
+        device->queue_lock = SDL_CreateMutex();
+        device->queue_oldest_ring = new_audio_queue_ring(size, 0);
+        if (device->queue_lock == NULL || device->queue_oldest_ring == NULL) {
+            close_audio_device(device);
+            return 0;
         }
+        device->queue_write_ring = device->queue_oldest_ring;
+        device->queue_read_ring = device->queue_oldest_ring;
 
         device->spec.callback = SDL_BufferQueueDrainCallback;
         device->spec.userdata = device;
@@ -22,6 +22,32 @@
 
 /* Functions and variables exported from SDL_audio.c for SDL_sysaudio.c */
 
+#ifndef _SDL_audio_c_intrinsics_h
+#define _SDL_audio_c_intrinsics_h
+
+#include "SDL_endian.h"
+
+/* Vector instructions the audio code has paths for. The AVX2 functions are
+   compiled for that target on their own and only called if SDL_HasAVX2()
+   says so, SSE2 and NEON are used whenever the compiler targets them. */
+#if (defined(__GNUC__) && ((__GNUC__ > 4) || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)) || defined(__clang__)) && \
+    (defined(__i386__) || defined(__x86_64__))
+#define HAVE_AVX2_INTRINSICS 1
+#define SDL_TARGETING_AVX2 __attribute__((target("avx2")))
+#include <immintrin.h>
+#endif
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#if (defined(__ARM_NEON__) || defined(__ARM_NEON)) && SDL_BYTEORDER == SDL_LIL_ENDIAN
+#define HAVE_NEON_INTRINSICS 1
+#include <arm_neon.h>
+#endif
+
+#endif /* _SDL_audio_c_intrinsics_h */
+
 /* Functions to get a list of "close" audio formats */
 extern SDL_AudioFormat SDL_FirstAudioFormat(SDL_AudioFormat format);
 extern SDL_AudioFormat SDL_NextAudioFormat(void);
@@ -52,4 +78,37 @@ typedef struct
 } SDL_AudioRateFilters;
 extern const SDL_AudioRateFilters sdl_audio_rate_filters[];
 
+/* Stateful resampler for any pair of rates, on interleaved float samples */
+typedef enum
+{
+    SDL_RESAMPLER_FAST,
+    SDL_RESAMPLER_MEDIUM,
+    SDL_RESAMPLER_BEST
+} SDL_ResamplerQuality;
+
+typedef struct SDL_AudioResampler SDL_AudioResampler;
+
+extern SDL_ResamplerQuality SDL_GetResamplerQuality(void);
+extern SDL_AudioResampler *SDL_NewAudioResampler(int channels, int src_rate, int dst_rate, SDL_ResamplerQuality quality);
+/* Returns the number of frames written to out, up to outframes. All of the
+   input is kept, output that didn't fit comes out on the next call. */
+extern int SDL_ResampleAudio(SDL_AudioResampler *resampler, const float *in, int inframes, float *out, int outframes);
+/* How many frames the next call would write if given this much input */
+extern int SDL_GetResamplerOutputFrames(const SDL_AudioResampler *resampler, int inframes);
+extern void SDL_ResetAudioResampler(SDL_AudioResampler *resampler);
+/* Make room for this many more input frames, so a call with no more than
+   that doesn't have to allocate */
+extern int SDL_ReserveResamplerInput(SDL_AudioResampler *resampler, int frames);
+/* Start from where another resampler with the same channels is, keeping
+   its input, so the rate can change without a gap in the output */
+extern int SDL_CarryResamplerInput(SDL_AudioResampler *resampler, const SDL_AudioResampler *from);
+extern void SDL_FreeAudioResampler(SDL_AudioResampler *resampler);
+
+/* For the device thread, which runs the callback straight into a stream's
+   work buffer: get room there for len bytes of input, then convert them
+   in place. Converted audio goes to out, up to outlen bytes, if nothing is
+   queued ahead of it and the rest is queued. Returns how much went to out. */
+extern Uint8 *SDL_GetAudioStreamWork(SDL_AudioStream *stream, int len);
+extern int SDL_AudioStreamPutWork(SDL_AudioStream *stream, int len, Uint8 *out, int outlen);
+
 /* vi: set ts=4 sw=4 expandtab: */
@@ -26,6 +26,8 @@
 #include "SDL_audio_c.h"
 
 #include "SDL_assert.h"
+#include "SDL_cpuinfo.h"
+#include "SDL_hints.h"
 
 /* #define DEBUG_CONVERT */
 
@@ -834,6 +836,499 @@ SDL_ConvertAudio(SDL_AudioCVT * cvt)
 }
 
 
+/*
+ * Vectorized versions of the most used type converters. They have to give
+ *  exactly the same results as the generated ones in SDL_audiotypecvt.c,
+ *  so they use the same constants and the same float or double math.
+ */
+#define DIVBY32767 3.05185094759972e-05f
+#define DIVBY2147483647 4.6566128752458e-10f
+
+/* The expanding converters work from the end of the buffer, like the
+   generated ones, so they don't overwrite samples they haven't read. */
+#define SDL_CONVERT_PROLOGUE(srctype, dsttype) \
+    const srctype *src = (const srctype *) cvt->buf; \
+    dsttype *dst = (dsttype *) cvt->buf; \
+    int num = cvt->len_cvt / sizeof (srctype); \
+    int i
+
+#define SDL_CONVERT_EPILOGUE(fmt) \
+    if (cvt->filters[++cvt->filter_index]) { \
+        cvt->filters[cvt->filter_index] (cvt, fmt); \
+    }
+
+/* Scalar versions of each conversion, for what's left over */
+#define SDL_S16_TO_F32(x) (((float) (x)) * DIVBY32767)
+#define SDL_F32_TO_S16(x) ((Sint16) ((x) * 32767.0f))
+#define SDL_S32_TO_F32(x) (((float) (x)) * DIVBY2147483647)
+#define SDL_F32_TO_S32(x) ((Sint32) ((x) * 2147483647.0))
+#define SDL_S8_TO_S16(x) ((Sint16) ((x) << 8))
+#define SDL_SWAP_F32(x) SDL_Swap32(x)
+
+#ifdef __SSE2__
+static void SDLCALL
+SDL_Convert_S16LSB_to_F32LSB_SSE2(SDL_AudioCVT * cvt, SDL_AudioFormat format)
+{
+    const __m128 divby32767 = _mm_set1_ps(DIVBY32767);
+    SDL_CONVERT_PROLOGUE(Sint16, float);
+
+    for (i = num; i >= 8; ) {
+        __m128i x;
+        i -= 8;
+        x = _mm_loadu_si128((const __m128i *) &src[i]);
+        _mm_storeu_ps(&dst[i], _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16)), divby32767));
+        _mm_storeu_ps(&dst[i + 4], _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16)), divby32767));
+    }
+    while (i--) {
+        dst[i] = SDL_S16_TO_F32(src[i]);
+    }
+
+    cvt->len_cvt *= 2;
+    SDL_CONVERT_EPILOGUE(AUDIO_F32LSB);
+}
+
+static void SDLCALL
+SDL_Convert_F32LSB_to_S16LSB_SSE2(SDL_AudioCVT * cvt, SDL_AudioFormat format)
+{
+    const __m128 mul32767 = _mm_set1_ps(32767.0f);
+    SDL_CONVERT_PROLOGUE(float, Sint16);
+
+    for (i = 0; i + 8 <= num; i += 8) {
+        /* Keep the low 16 bits of each value rather than saturating */
+        __m128i a = _mm_cvttps_epi32(_mm_mul_ps(_mm_loadu_ps(&src[i]), mul32767));
+        __m128i b = _mm_cvttps_epi32(_mm_mul_ps(_mm_loadu_ps(&src[i + 4]), mul32767));
+        a = _mm_srai_epi32(_mm_slli_epi32(a, 16), 16);
+        b = _mm_srai_epi32(_mm_slli_epi32(b, 16), 16);
+        _mm_storeu_si128((__m128i *) &dst[i], _mm_packs_epi32(a, b));
+    }
+    for (; i < num; ++i) {
+        dst[i] = SDL_F32_TO_S16(src[i]);
+    }
+
+    cvt->len_cvt /= 2;
+    SDL_CONVERT_EPILOGUE(AUDIO_S16LSB);
+}
+
+static void SDLCALL
+SDL_Convert_S32LSB_to_F32LSB_SSE2(SDL_AudioCVT * cvt, SDL_AudioFormat format)
+{
+    const __m128 divby2147483647 = _mm_set1_ps(DIVBY2147483647);
+    SDL_CONVERT_PROLOGUE(Sint32, float);
+
+    for (i = 0; i + 4 <= num; i += 4) {
+        __m128i x = _mm_loadu_si128((const __m128i *) &src[i]);
+        _mm_storeu_ps(&dst[i], _mm_mul_ps(_mm_cvtepi32_ps(x), divby2147483647));
+    }
+    for (; i < num; ++i) {
+        dst[i] = SDL_S32_TO_F32(src[i]);
+    }
+
+    SDL_CONVERT_EPILOGUE(AUDIO_F32LSB);
+}
+
+static void SDLCALL
+SDL_Convert_F32LSB_to_S32LSB_SSE2(SDL_AudioCVT * cvt, SDL_AudioFormat format)
+{
+    const __m128d mul2147483647 = _mm_set1_pd(2147483647.0);
+    SDL_CONVERT_PROLOGUE(float, Sint32);
+
+    for (i = 0; i + 4 <= num; i += 4) {
+        __m128 x = _mm_loadu_ps(&src[i]);
+        __m128i a = _mm_cvttpd_epi32(_mm_mul_pd(_mm_cvtps_pd(x), mul2147483647));
+        __m128i b = _mm_cvttpd_epi32(_mm_mul_pd(_mm_cvtps_pd(_mm_movehl_ps(x, x)), mul2147483647));
+        _mm_storeu_si128((__m128i *) &dst[i], _mm_unpacklo_epi64(a, b));
+    }
+    for (; i < num; ++i) {
+        dst[i] = SDL_F32_TO_S32(src[i]);
+    }
+
+    SDL_CONVERT_EPILOGUE(AUDIO_S32LSB);
+}
+
+static SDL_INLINE void
+SDL_Convert8_to_S16LSB_SSE2(SDL_AudioCVT * cvt, const __m128i flip)
+{
+    const Uint8 flipbits = (Uint8) _mm_cvtsi128_si32(flip);
+    SDL_CONVERT_PROLOGUE(Uint8, Sint16);
+
+    for (i = num; i >= 16; ) {
+        __m128i x;
+        i -= 16;
+        x = _mm_xor_si128(_mm_loadu_si128((const __m128i *) &src[i]), flip);
+        _mm_storeu_si128((__m128i *) &dst[i], _mm_unpacklo_epi8(_mm_setzero_si128(), x));
+        _mm_storeu_si128((__m128i *) &dst[i + 8], _mm_unpackhi_epi8(_mm_setzero_si128(), x));
+    }
+    while (i--) {
+        dst[i] = SDL_S8_TO_S16(src[i] ^ flipbits);
+    }
+
+    cvt->len_cvt *= 2;
+}
+
+static void SDLCALL
+SDL_Convert_U8_to_S16LSB_SSE2(SDL_AudioCVT * cvt, SDL_AudioFormat format)
+{
+    SDL_Convert8_to_S16LSB_SSE2(cvt, _mm_set1_epi8((char) 0x80));
+    SDL_CONVERT_EPILOGUE(AUDIO_S16LSB);
+}
+
+static void SDLCALL
+SDL_Convert_S8_to_S16LSB_SSE2(SDL_AudioCVT * cvt, SDL_AudioFormat format)
+{
+    SDL_Convert8_to_S16LSB_SSE2(cvt, _mm_setzero_si128());
+    SDL_CONVERT_EPILOGUE(AUDIO_S16LSB);
+}
+
+static SDL_INLINE void
+SDL_SwapF32_SSE2(SDL_AudioCVT * cvt)
+{
+    SDL_CONVERT_PROLOGUE(Uint32, Uint32);
+
+    for (i = 0; i + 4 <= num; i += 4) {
+        __m128i x = _mm_loadu_si128((const __m128i *) &src[i]);
+        x = _mm_shufflehi_epi16(_mm_shufflelo_epi16(x, 0xB1), 0xB1);
+        x = _mm_or_si128(_mm_slli_epi16(x, 8), _mm_srli_epi16(x, 8));
+        _mm_storeu_si128((__m128i *) &dst[i], x);
+    }
+    for (; i < num; ++i) {
+        dst[i] = SDL_SWAP_F32(src[i]);
+    }
+}
+
+static void SDLCALL
+SDL_Convert_F32LSB_to_F32MSB_SSE2(SDL_AudioCVT * cvt, SDL_AudioFormat format)
+{
+    SDL_SwapF32_SSE2(cvt);
+    SDL_CONVERT_EPILOGUE(AUDIO_F32MSB);
+}
+
+static void SDLCALL
+SDL_Convert_F32MSB_to_F32LSB_SSE2(SDL_AudioCVT * cvt, SDL_AudioFormat format)
+{
+    SDL_SwapF32_SSE2(cvt);
+    SDL_CONVERT_EPILOGUE(AUDIO_F32LSB);
+}
+
+static const SDL_AudioTypeFilters sdl_audio_type_filters_sse2[] =
+{
+    { AUDIO_S16LSB, AUDIO_F32LSB, SDL_Convert_S16LSB_to_F32LSB_SSE2 },
+    { AUDIO_F32LSB, AUDIO_S16LSB, SDL_Convert_F32LSB_to_S16LSB_SSE2 },
+    { AUDIO_S32LSB, AUDIO_F32LSB, SDL_Convert_S32LSB_to_F32LSB_SSE2 },
+    { AUDIO_F32LSB, AUDIO_S32LSB, SDL_Convert_F32LSB_to_S32LSB_SSE2 },
+    { AUDIO_U8, AUDIO_S16LSB, SDL_Convert_U8_to_S16LSB_SSE2 },
+    { AUDIO_S8, AUDIO_S16LSB, SDL_Convert_S8_to_S16LSB_SSE2 },
+    { AUDIO_F32LSB, AUDIO_F32MSB, SDL_Convert_F32LSB_to_F32MSB_SSE2 },
+    { AUDIO_F32MSB, AUDIO_F32LSB, SDL_Convert_F32MSB_to_F32LSB_SSE2 },
+    { 0, 0, NULL }
+};
+#endif /* __SSE2__ */
+
+#if HAVE_AVX2_INTRINSICS
+static void SDLCALL SDL_TARGETING_AVX2
+SDL_Convert_S16LSB_to_F32LSB_AVX2(SDL_AudioCVT * cvt, SDL_AudioFormat format)
+{
+    const __m256 divby32767 = _mm256_set1_ps(DIVBY32767);
+    SDL_CONVERT_PROLOGUE(Sint16, float);
+
+    for (i = num; i >= 16; ) {
+        __m256i a, b;
+        i -= 16;
+        a = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *) &src[i]));
+        b = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *) &src[i + 8]));
+        _mm256_storeu_ps(&dst[i], _mm256_mul_ps(_mm256_cvtepi32_ps(a), divby32767));
+        _mm256_storeu_ps(&dst[i + 8], _mm256_mul_ps(_mm256_cvtepi32_ps(b), divby32767));
+    }
+    while (i--) {
+        dst[i] = SDL_S16_TO_F32(src[i]);
+    }
+
+    cvt->len_cvt *= 2;
+    SDL_CONVERT_EPILOGUE(AUDIO_F32LSB);
+}
+
+static void SDLCALL SDL_TARGETING_AVX2
+SDL_Convert_F32LSB_to_S16LSB_AVX2(SDL_AudioCVT * cvt, SDL_AudioFormat format)
+{
+    const __m256 mul32767 = _mm256_set1_ps(32767.0f);
+    SDL_CONVERT_PROLOGUE(float, Sint16);
+
+    for (i = 0; i + 16 <= num; i += 16) {
+        /* Keep the low 16 bits of each value rather than saturating */
+        __m256i a = _mm256_cvttps_epi32(_mm256_mul_ps(_mm256_loadu_ps(&src[i]), mul32767));
+        __m256i b = _mm256_cvttps_epi32(_mm256_mul_ps(_mm256_loadu_ps(&src[i + 8]), mul32767));
+        a = _mm256_srai_epi32(_mm256_slli_epi32(a, 16), 16);
+        b = _mm256_srai_epi32(_mm256_slli_epi32(b, 16), 16);
+        /* Packing works within 128-bit lanes, put them back in order */
+        a = _mm256_permute4x64_epi64(_mm256_packs_epi32(a, b), 0xD8);
+        _mm256_storeu_si256((__m256i *) &dst[i], a);
+    }
+    for (; i < num; ++i) {
+        dst[i] = SDL_F32_TO_S16(src[i]);
+    }
+
+    cvt->len_cvt /= 2;
+    SDL_CONVERT_EPILOGUE(AUDIO_S16LSB);
+}
+
+static void SDLCALL SDL_TARGETING_AVX2
+SDL_Convert_S32LSB_to_F32LSB_AVX2(SDL_AudioCVT * cvt, SDL_AudioFormat format)
+{
+    const __m256 divby2147483647 = _mm256_set1_ps(DIVBY2147483647);
+    SDL_CONVERT_PROLOGUE(Sint32, float);
+
+    for (i = 0; i + 8 <= num; i += 8) {
+        __m256i x = _mm256_loadu_si256((const __m256i *) &src[i]);
+        _mm256_storeu_ps(&dst[i], _mm256_mul_ps(_mm256_cvtepi32_ps(x), divby2147483647));
+    }
+    for (; i < num; ++i) {
+        dst[i] = SDL_S32_TO_F32(src[i]);
+    }
+
+    SDL_CONVERT_EPILOGUE(AUDIO_F32LSB);
+}
+
+static void SDLCALL SDL_TARGETING_AVX2
+SDL_Convert_F32LSB_to_S32LSB_AVX2(SDL_AudioCVT * cvt, SDL_AudioFormat format)
+{
+    const __m256d mul2147483647 = _mm256_set1_pd(2147483647.0);
+    SDL_CONVERT_PROLOGUE(float, Sint32);
+
+    for (i = 0; i + 8 <= num; i += 8) {
+        __m128i a = _mm256_cvttpd_epi32(_mm256_mul_pd(_mm256_cvtps_pd(_mm_loadu_ps(&src[i])), mul2147483647));
+        __m128i b = _mm256_cvttpd_epi32(_mm256_mul_pd(_mm256_cvtps_pd(_mm_loadu_ps(&src[i + 4])), mul2147483647));
+        _mm_storeu_si128((__m128i *) &dst[i], a);
+        _mm_storeu_si128((__m128i *) &dst[i + 4], b);
+    }
+    for (; i < num; ++i) {
+        dst[i] = SDL_F32_TO_S32(src[i]);
+    }
+
+    SDL_CONVERT_EPILOGUE(AUDIO_S32LSB);
+}
+
+static SDL_INLINE void SDL_TARGETING_AVX2
+SDL_Convert8_to_S16LSB_AVX2(SDL_AudioCVT * cvt, Sint16 flip)
+{
+    const __m256i flipbits = _mm256_set1_epi16(flip);
+    SDL_CONVERT_PROLOGUE(Uint8, Sint16);
+
+    for (i = num; i >= 32; ) {
+        __m256i a, b;
+        i -= 32;
+        a = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *) &src[i]));
+        b = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *) &src[i + 16]));
+        _mm256_storeu_si256((__m256i *) &dst[i], _mm256_xor_si256(_mm256_slli_epi16(a, 8), flipbits));
+        _mm256_storeu_si256((__m256i *) &dst[i + 16], _mm256_xor_si256(_mm256_slli_epi16(b, 8), flipbits));
+    }
+    while (i--) {
+        dst[i] = SDL_S8_TO_S16(src[i]) ^ flip;
+    }
+
+    cvt->len_cvt *= 2;
+}
+
+static void SDLCALL
+SDL_Convert_U8_to_S16LSB_AVX2(SDL_AudioCVT * cvt, SDL_AudioFormat format)
+{
+    SDL_Convert8_to_S16LSB_AVX2(cvt, (Sint16) 0x8000);
+    SDL_CONVERT_EPILOGUE(AUDIO_S16LSB);
+}
+
+static void SDLCALL
+SDL_Convert_S8_to_S16LSB_AVX2(SDL_AudioCVT * cvt, SDL_AudioFormat format)
+{
+    SDL_Convert8_to_S16LSB_AVX2(cvt, 0);
+    SDL_CONVERT_EPILOGUE(AUDIO_S16LSB);
+}
+
+static SDL_INLINE void SDL_TARGETING_AVX2
+SDL_SwapF32_AVX2(SDL_AudioCVT * cvt)
+{
+    const __m256i order = _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+                                           3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+    SDL_CONVERT_PROLOGUE(Uint32, Uint32);
+
+    for (i = 0; i + 8 <= num; i += 8) {
+        __m256i x = _mm256_loadu_si256((const __m256i *) &src[i]);
+        _mm256_storeu_si256((__m256i *) &dst[i], _mm256_shuffle_epi8(x, order));
+    }
+    for (; i < num; ++i) {
+        dst[i] = SDL_SWAP_F32(src[i]);
+    }
+}
+
+static void SDLCALL
+SDL_Convert_F32LSB_to_F32MSB_AVX2(SDL_AudioCVT * cvt, SDL_AudioFormat format)
+{
+    SDL_SwapF32_AVX2(cvt);
+    SDL_CONVERT_EPILOGUE(AUDIO_F32MSB);
+}
+
+static void SDLCALL
+SDL_Convert_F32MSB_to_F32LSB_AVX2(SDL_AudioCVT * cvt, SDL_AudioFormat format)
+{
+    SDL_SwapF32_AVX2(cvt);
+    SDL_CONVERT_EPILOGUE(AUDIO_F32LSB);
+}
+
+static const SDL_AudioTypeFilters sdl_audio_type_filters_avx2[] =
+{
+    { AUDIO_S16LSB, AUDIO_F32LSB, SDL_Convert_S16LSB_to_F32LSB_AVX2 },
+    { AUDIO_F32LSB, AUDIO_S16LSB, SDL_Convert_F32LSB_to_S16LSB_AVX2 },
+    { AUDIO_S32LSB, AUDIO_F32LSB, SDL_Convert_S32LSB_to_F32LSB_AVX2 },
+    { AUDIO_F32LSB, AUDIO_S32LSB, SDL_Convert_F32LSB_to_S32LSB_AVX2 },
+    { AUDIO_U8, AUDIO_S16LSB, SDL_Convert_U8_to_S16LSB_AVX2 },
+    { AUDIO_S8, AUDIO_S16LSB, SDL_Convert_S8_to_S16LSB_AVX2 },
+    { AUDIO_F32LSB, AUDIO_F32MSB, SDL_Convert_F32LSB_to_F32MSB_AVX2 },
+    { AUDIO_F32MSB, AUDIO_F32LSB, SDL_Convert_F32MSB_to_F32LSB_AVX2 },
+    { 0, 0, NULL }
+};
+#endif /* HAVE_AVX2_INTRINSICS */
+
+#if HAVE_NEON_INTRINSICS
+static void SDLCALL
+SDL_Convert_S16LSB_to_F32LSB_NEON(SDL_AudioCVT * cvt, SDL_AudioFormat format)
+{
+    SDL_CONVERT_PROLOGUE(Sint16, float);
+
+    for (i = num; i >= 8; ) {
+        int16x8_t x;
+        i -= 8;
+        x = vld1q_s16(&src[i]);
+        vst1q_f32(&dst[i], vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(x))), DIVBY32767));
+        vst1q_f32(&dst[i + 4], vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(x))), DIVBY32767));
+    }
+    while (i--) {
+        dst[i] = SDL_S16_TO_F32(src[i]);
+    }
+
+    cvt->len_cvt *= 2;
+    SDL_CONVERT_EPILOGUE(AUDIO_F32LSB);
+}
+
+static void SDLCALL
+SDL_Convert_F32LSB_to_S16LSB_NEON(SDL_AudioCVT * cvt, SDL_AudioFormat format)
+{
+    SDL_CONVERT_PROLOGUE(float, Sint16);
+
+    for (i = 0; i + 8 <= num; i += 8) {
+        /* vmovn keeps the low 16 bits like the scalar cast does */
+        int32x4_t a = vcvtq_s32_f32(vmulq_n_f32(vld1q_f32(&src[i]), 32767.0f));
+        int32x4_t b = vcvtq_s32_f32(vmulq_n_f32(vld1q_f32(&src[i + 4]), 32767.0f));
+        vst1q_s16(&dst[i], vcombine_s16(vmovn_s32(a), vmovn_s32(b)));
+    }
+    for (; i < num; ++i) {
+        dst[i] = SDL_F32_TO_S16(src[i]);
+    }
+
+    cvt->len_cvt /= 2;
+    SDL_CONVERT_EPILOGUE(AUDIO_S16LSB);
+}
+
+static void SDLCALL
+SDL_Convert_S32LSB_to_F32LSB_NEON(SDL_AudioCVT * cvt, SDL_AudioFormat format)
+{
+    SDL_CONVERT_PROLOGUE(Sint32, float);
+
+    for (i = 0; i + 4 <= num; i += 4) {
+        vst1q_f32(&dst[i], vmulq_n_f32(vcvtq_f32_s32(vld1q_s32(&src[i])), DIVBY2147483647));
+    }
+    for (; i < num; ++i) {
+        dst[i] = SDL_S32_TO_F32(src[i]);
+    }
+
+    SDL_CONVERT_EPILOGUE(AUDIO_F32LSB);
+}
+
+static SDL_INLINE void
+SDL_Convert8_to_S16LSB_NEON(SDL_AudioCVT * cvt, Uint8 flip)
+{
+    const uint8x16_t flipbits = vdupq_n_u8(flip);
+    SDL_CONVERT_PROLOGUE(Uint8, Sint16);
+
+    for (i = num; i >= 16; ) {
+        uint8x16_t x;
+        i -= 16;
+        x = veorq_u8(vld1q_u8(&src[i]), flipbits);
+        vst1q_s16(&dst[i], vreinterpretq_s16_u16(vshll_n_u8(vget_low_u8(x), 8)));
+        vst1q_s16(&dst[i + 8], vreinterpretq_s16_u16(vshll_n_u8(vget_high_u8(x), 8)));
+    }
+    while (i--) {
+        dst[i] = SDL_S8_TO_S16(src[i] ^ flip);
+    }
+
+    cvt->len_cvt *= 2;
+}
+
+static void SDLCALL
+SDL_Convert_U8_to_S16LSB_NEON(SDL_AudioCVT * cvt, SDL_AudioFormat format)
+{
+    SDL_Convert8_to_S16LSB_NEON(cvt, 0x80);
+    SDL_CONVERT_EPILOGUE(AUDIO_S16LSB);
+}
+
+static void SDLCALL
+SDL_Convert_S8_to_S16LSB_NEON(SDL_AudioCVT * cvt, SDL_AudioFormat format)
+{
+    SDL_Convert8_to_S16LSB_NEON(cvt, 0);
+    SDL_CONVERT_EPILOGUE(AUDIO_S16LSB);
+}
+
+static SDL_INLINE void
+SDL_SwapF32_NEON(SDL_AudioCVT * cvt)
+{
+    SDL_CONVERT_PROLOGUE(Uint32, Uint32);
+
+    for (i = 0; i + 4 <= num; i += 4) {
+        uint8x16_t x = vreinterpretq_u8_u32(vld1q_u32(&src[i]));
+        vst1q_u32(&dst[i], vreinterpretq_u32_u8(vrev32q_u8(x)));
+    }
+    for (; i < num; ++i) {
+        dst[i] = SDL_SWAP_F32(src[i]);
+    }
+}
+
+static void SDLCALL
+SDL_Convert_F32LSB_to_F32MSB_NEON(SDL_AudioCVT * cvt, SDL_AudioFormat format)
+{
+    SDL_SwapF32_NEON(cvt);
+    SDL_CONVERT_EPILOGUE(AUDIO_F32MSB);
+}
+
+static void SDLCALL
+SDL_Convert_F32MSB_to_F32LSB_NEON(SDL_AudioCVT * cvt, SDL_AudioFormat format)
+{
+    SDL_SwapF32_NEON(cvt);
+    SDL_CONVERT_EPILOGUE(AUDIO_F32LSB);
+}
+
+/* F32 to S32 needs double precision math, which 32-bit NEON doesn't have */
+static const SDL_AudioTypeFilters sdl_audio_type_filters_neon[] =
+{
+    { AUDIO_S16LSB, AUDIO_F32LSB, SDL_Convert_S16LSB_to_F32LSB_NEON },
+    { AUDIO_F32LSB, AUDIO_S16LSB, SDL_Convert_F32LSB_to_S16LSB_NEON },
+    { AUDIO_S32LSB, AUDIO_F32LSB, SDL_Convert_S32LSB_to_F32LSB_NEON },
+    { AUDIO_U8, AUDIO_S16LSB, SDL_Convert_U8_to_S16LSB_NEON },
+    { AUDIO_S8, AUDIO_S16LSB, SDL_Convert_S8_to_S16LSB_NEON },
+    { AUDIO_F32LSB, AUDIO_F32MSB, SDL_Convert_F32LSB_to_F32MSB_NEON },
+    { AUDIO_F32MSB, AUDIO_F32LSB, SDL_Convert_F32MSB_to_F32LSB_NEON },
+    { 0, 0, NULL }
+};
+#endif /* HAVE_NEON_INTRINSICS */
+
+static SDL_AudioFilter
+SDL_FindTypeCVT(const SDL_AudioTypeFilters *filters,
+                SDL_AudioFormat src_fmt, SDL_AudioFormat dst_fmt)
+{
+    int i;
+    for (i = 0; filters[i].filter != NULL; i++) {
+        if ((filters[i].src_fmt == src_fmt) && (filters[i].dst_fmt == dst_fmt)) {
+            return filters[i].filter;
+        }
+    }
+    return NULL;
+}
+
 static SDL_AudioFilter
 SDL_HandTunedTypeCVT(SDL_AudioFormat src_fmt, SDL_AudioFormat dst_fmt)
 {
@@ -841,10 +1336,323 @@ SDL_HandTunedTypeCVT(SDL_AudioFormat src_fmt, SDL_AudioFormat dst_fmt)
      * Fill in any future conversions that are specialized to a
      *  processor, platform, compiler, or library here.
      */
+    SDL_AudioFilter filter = NULL;
+
+#if HAVE_AVX2_INTRINSICS
+    if (!filter && SDL_HasAVX2()) {
+        filter = SDL_FindTypeCVT(sdl_audio_type_filters_avx2, src_fmt, dst_fmt);
+    }
+#endif
+#ifdef __SSE2__
+    if (!filter && SDL_HasSSE2()) {
+        filter = SDL_FindTypeCVT(sdl_audio_type_filters_sse2, src_fmt, dst_fmt);
+    }
+#endif
+#if HAVE_NEON_INTRINSICS
+    if (!filter) {
+        filter = SDL_FindTypeCVT(sdl_audio_type_filters_neon, src_fmt, dst_fmt);
+    }
+#endif
+
+    return filter;              /* NULL if no specialized converter code available. */
+}
+
+
+/*
+ * Type conversion and channel conversion fused into one pass, so the
+ *  buffer is only swept once. SDL_BuildAudioCVT() swaps these in when the
+ *  chain would be exactly the type converter followed by SDL_ConvertStereo()
+ *  or SDL_ConvertMono(). The results are the same as running the two.
+ */
+typedef struct
+{
+    SDL_AudioFormat src_fmt;
+    SDL_AudioFormat dst_fmt;
+    SDL_AudioFilter channel_filter;
+    SDL_AudioFilter filter;
+} SDL_AudioFusedFilters;
+
+#define SDL_MIX_MONO_F32(a, b) ((float) ((((double) (a)) + ((double) (b))) * 0.5))
+#define SDL_MIX_MONO_S16(a, b) ((Sint16) ((((Sint32) (a)) + ((Sint32) (b))) / 2))
+
+static void SDLCALL
+SDL_Convert_S16LSB_to_F32LSB_Stereo(SDL_AudioCVT * cvt, SDL_AudioFormat format)
+{
+    SDL_CONVERT_PROLOGUE(Sint16, float);
+
+    for (i = num; i--; ) {
+        const float x = SDL_SwapFloatLE(SDL_S16_TO_F32((Sint16) SDL_SwapLE16(src[i])));
+        dst[i * 2] = dst[i * 2 + 1] = x;
+    }
+
+    cvt->len_cvt *= 4;
+    SDL_CONVERT_EPILOGUE(AUDIO_F32LSB);
+}
+
+static SDL_INLINE void
+SDL_Convert8_to_S16LSB_Stereo(SDL_AudioCVT * cvt, Uint8 flip)
+{
+    SDL_CONVERT_PROLOGUE(Uint8, Sint16);
+
+    for (i = num; i--; ) {
+        dst[i * 2] = dst[i * 2 + 1] = SDL_SwapLE16(SDL_S8_TO_S16(src[i] ^ flip));
+    }
+
+    cvt->len_cvt *= 4;
+}
+
+static void SDLCALL
+SDL_Convert_U8_to_S16LSB_Stereo(SDL_AudioCVT * cvt, SDL_AudioFormat format)
+{
+    SDL_Convert8_to_S16LSB_Stereo(cvt, 0x80);
+    SDL_CONVERT_EPILOGUE(AUDIO_S16LSB);
+}
+
+static void SDLCALL
+SDL_Convert_S8_to_S16LSB_Stereo(SDL_AudioCVT * cvt, SDL_AudioFormat format)
+{
+    SDL_Convert8_to_S16LSB_Stereo(cvt, 0);
+    SDL_CONVERT_EPILOGUE(AUDIO_S16LSB);
+}
+
+static void SDLCALL
+SDL_Convert_F32LSB_to_S16LSB_Stereo(SDL_AudioCVT * cvt, SDL_AudioFormat format)
+{
+    SDL_CONVERT_PROLOGUE(float, Sint16);
+
+    for (i = 0; i < num; ++i) {
+        const Sint16 x = SDL_SwapLE16(SDL_F32_TO_S16(SDL_SwapFloatLE(src[i])));
+        dst[i * 2] = dst[i * 2 + 1] = x;
+    }
+
+    SDL_CONVERT_EPILOGUE(AUDIO_S16LSB);
+}
+
+static void SDLCALL
+SDL_Convert_S16LSB_to_F32LSB_Mono(SDL_AudioCVT * cvt, SDL_AudioFormat format)
+{
+    SDL_CONVERT_PROLOGUE(Sint16, float);
+
+    for (i = 0; i < num / 2; ++i) {
+        const float a = SDL_S16_TO_F32((Sint16) SDL_SwapLE16(src[i * 2]));
+        const float b = SDL_S16_TO_F32((Sint16) SDL_SwapLE16(src[i * 2 + 1]));
+        dst[i] = SDL_SwapFloatLE(SDL_MIX_MONO_F32(a, b));
+    }
+
+    SDL_CONVERT_EPILOGUE(AUDIO_F32LSB);
+}
+
+static void SDLCALL
+SDL_Convert_F32LSB_to_S16LSB_Mono(SDL_AudioCVT * cvt, SDL_AudioFormat format)
+{
+    SDL_CONVERT_PROLOGUE(float, Sint16);
+
+    for (i = 0; i < num / 2; ++i) {
+        const Sint16 a = SDL_F32_TO_S16(SDL_SwapFloatLE(src[i * 2]));
+        const Sint16 b = SDL_F32_TO_S16(SDL_SwapFloatLE(src[i * 2 + 1]));
+        dst[i] = SDL_SwapLE16(SDL_MIX_MONO_S16(a, b));
+    }
+
+    cvt->len_cvt /= 4;
+    SDL_CONVERT_EPILOGUE(AUDIO_S16LSB);
+}
+
+#ifdef __SSE2__
+static void SDLCALL
+SDL_Convert_S16LSB_to_F32LSB_Stereo_SSE2(SDL_AudioCVT * cvt, SDL_AudioFormat format)
+{
+    const __m128 divby32767 = _mm_set1_ps(DIVBY32767);
+    SDL_CONVERT_PROLOGUE(Sint16, float);
+
+    for (i = num; i >= 8; ) {
+        __m128i x;
+        __m128 a, b;
+        i -= 8;
+        x = _mm_loadu_si128((const __m128i *) &src[i]);
+        a = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16)), divby32767);
+        b = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16)), divby32767);
+        _mm_storeu_ps(&dst[i * 2], _mm_unpacklo_ps(a, a));
+        _mm_storeu_ps(&dst[i * 2 + 4], _mm_unpackhi_ps(a, a));
+        _mm_storeu_ps(&dst[i * 2 + 8], _mm_unpacklo_ps(b, b));
+        _mm_storeu_ps(&dst[i * 2 + 12], _mm_unpackhi_ps(b, b));
+    }
+    while (i--) {
+        dst[i * 2] = dst[i * 2 + 1] = SDL_S16_TO_F32(src[i]);
+    }
+
+    cvt->len_cvt *= 4;
+    SDL_CONVERT_EPILOGUE(AUDIO_F32LSB);
+}
+
+static SDL_INLINE void
+SDL_Convert8_to_S16LSB_Stereo_SSE2(SDL_AudioCVT * cvt, const __m128i flip)
+{
+    const Uint8 flipbits = (Uint8) _mm_cvtsi128_si32(flip);
+    SDL_CONVERT_PROLOGUE(Uint8, Sint16);
+
+    for (i = num; i >= 16; ) {
+        __m128i x, lo, hi;
+        i -= 16;
+        x = _mm_xor_si128(_mm_loadu_si128((const __m128i *) &src[i]), flip);
+        lo = _mm_unpacklo_epi8(_mm_setzero_si128(), x);
+        hi = _mm_unpackhi_epi8(_mm_setzero_si128(), x);
+        _mm_storeu_si128((__m128i *) &dst[i * 2], _mm_unpacklo_epi16(lo, lo));
+        _mm_storeu_si128((__m128i *) &dst[i * 2 + 8], _mm_unpackhi_epi16(lo, lo));
+        _mm_storeu_si128((__m128i *) &dst[i * 2 + 16], _mm_unpacklo_epi16(hi, hi));
+        _mm_storeu_si128((__m128i *) &dst[i * 2 + 24], _mm_unpackhi_epi16(hi, hi));
+    }
+    while (i--) {
+        dst[i * 2] = dst[i * 2 + 1] = SDL_S8_TO_S16(src[i] ^ flipbits);
+    }
+
+    cvt->len_cvt *= 4;
+}
+
+static void SDLCALL
+SDL_Convert_U8_to_S16LSB_Stereo_SSE2(SDL_AudioCVT * cvt, SDL_AudioFormat format)
+{
+    SDL_Convert8_to_S16LSB_Stereo_SSE2(cvt, _mm_set1_epi8((char) 0x80));
+    SDL_CONVERT_EPILOGUE(AUDIO_S16LSB);
+}
+
+static void SDLCALL
+SDL_Convert_S8_to_S16LSB_Stereo_SSE2(SDL_AudioCVT * cvt, SDL_AudioFormat format)
+{
+    SDL_Convert8_to_S16LSB_Stereo_SSE2(cvt, _mm_setzero_si128());
+    SDL_CONVERT_EPILOGUE(AUDIO_S16LSB);
+}
+
+static void SDLCALL
+SDL_Convert_F32LSB_to_S16LSB_Stereo_SSE2(SDL_AudioCVT * cvt, SDL_AudioFormat format)
+{
+    const __m128 mul32767 = _mm_set1_ps(32767.0f);
+    SDL_CONVERT_PROLOGUE(float, Sint16);
+
+    for (i = 0; i + 4 <= num; i += 4) {
+        __m128i x = _mm_cvttps_epi32(_mm_mul_ps(_mm_loadu_ps(&src[i]), mul32767));
+        x = _mm_srai_epi32(_mm_slli_epi32(x, 16), 16);
+        x = _mm_packs_epi32(x, x);
+        _mm_storeu_si128((__m128i *) &dst[i * 2], _mm_unpacklo_epi16(x, x));
+    }
+    for (; i < num; ++i) {
+        dst[i * 2] = dst[i * 2 + 1] = SDL_F32_TO_S16(src[i]);
+    }
+
+    SDL_CONVERT_EPILOGUE(AUDIO_S16LSB);
+}
+
+static void SDLCALL
+SDL_Convert_S16LSB_to_F32LSB_Mono_SSE2(SDL_AudioCVT * cvt, SDL_AudioFormat format)
+{
+    const __m128 divby32767 = _mm_set1_ps(DIVBY32767);
+    const __m128 half = _mm_set1_ps(0.5f);
+    SDL_CONVERT_PROLOGUE(Sint16, float);
+
+    num /= 2;
+    for (i = 0; i + 4 <= num; i += 4) {
+        const __m128i x = _mm_loadu_si128((const __m128i *) &src[i * 2]);
+        const __m128 a = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16)), divby32767);
+        const __m128 b = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16)), divby32767);
+        const __m128 left = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+        const __m128 right = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+        /* SDL_ConvertMono() adds in double precision, but floats made from
+           16 bit samples are close enough in scale that their sum rounds the
+           same either way */
+        _mm_storeu_ps(&dst[i], _mm_mul_ps(_mm_add_ps(left, right), half));
+    }
+    for (; i < num; ++i) {
+        dst[i] = SDL_MIX_MONO_F32(SDL_S16_TO_F32(src[i * 2]), SDL_S16_TO_F32(src[i * 2 + 1]));
+    }
+
+    SDL_CONVERT_EPILOGUE(AUDIO_F32LSB);
+}
+
+static void SDLCALL
+SDL_Convert_F32LSB_to_S16LSB_Mono_SSE2(SDL_AudioCVT * cvt, SDL_AudioFormat format)
+{
+    const __m128 mul32767 = _mm_set1_ps(32767.0f);
+    const __m128i ones = _mm_set1_epi16(1);
+    SDL_CONVERT_PROLOGUE(float, Sint16);
+
+    num /= 2;
+    for (i = 0; i + 4 <= num; i += 4) {
+        __m128i a = _mm_cvttps_epi32(_mm_mul_ps(_mm_loadu_ps(&src[i * 2]), mul32767));
+        __m128i b = _mm_cvttps_epi32(_mm_mul_ps(_mm_loadu_ps(&src[i * 2 + 4]), mul32767));
+        __m128i sum;
+        a = _mm_srai_epi32(_mm_slli_epi32(a, 16), 16);
+        b = _mm_srai_epi32(_mm_slli_epi32(b, 16), 16);
+        /* Add each left and right, then halve, rounding toward zero */
+        sum = _mm_madd_epi16(_mm_packs_epi32(a, b), ones);
+        sum = _mm_srai_epi32(_mm_add_epi32(sum, _mm_srli_epi32(sum, 31)), 1);
+        _mm_storel_epi64((__m128i *) &dst[i], _mm_packs_epi32(sum, sum));
+    }
+    for (; i < num; ++i) {
+        dst[i] = SDL_MIX_MONO_S16(SDL_F32_TO_S16(src[i * 2]), SDL_F32_TO_S16(src[i * 2 + 1]));
+    }
+
+    cvt->len_cvt /= 4;
+    SDL_CONVERT_EPILOGUE(AUDIO_S16LSB);
+}
+
+static const SDL_AudioFusedFilters sdl_audio_fused_filters_sse2[] = {
+    { AUDIO_S16LSB, AUDIO_F32LSB, SDL_ConvertStereo, SDL_Convert_S16LSB_to_F32LSB_Stereo_SSE2 },
+    { AUDIO_U8, AUDIO_S16LSB, SDL_ConvertStereo, SDL_Convert_U8_to_S16LSB_Stereo_SSE2 },
+    { AUDIO_S8, AUDIO_S16LSB, SDL_ConvertStereo, SDL_Convert_S8_to_S16LSB_Stereo_SSE2 },
+    { AUDIO_F32LSB, AUDIO_S16LSB, SDL_ConvertStereo, SDL_Convert_F32LSB_to_S16LSB_Stereo_SSE2 },
+    { AUDIO_S16LSB, AUDIO_F32LSB, SDL_ConvertMono, SDL_Convert_S16LSB_to_F32LSB_Mono_SSE2 },
+    { AUDIO_F32LSB, AUDIO_S16LSB, SDL_ConvertMono, SDL_Convert_F32LSB_to_S16LSB_Mono_SSE2 },
+    { 0, 0, NULL, NULL }
+};
+#endif /* __SSE2__ */
+
+static const SDL_AudioFusedFilters sdl_audio_fused_filters[] = {
+    { AUDIO_S16LSB, AUDIO_F32LSB, SDL_ConvertStereo, SDL_Convert_S16LSB_to_F32LSB_Stereo },
+    { AUDIO_U8, AUDIO_S16LSB, SDL_ConvertStereo, SDL_Convert_U8_to_S16LSB_Stereo },
+    { AUDIO_S8, AUDIO_S16LSB, SDL_ConvertStereo, SDL_Convert_S8_to_S16LSB_Stereo },
+    { AUDIO_F32LSB, AUDIO_S16LSB, SDL_ConvertStereo, SDL_Convert_F32LSB_to_S16LSB_Stereo },
+    { AUDIO_S16LSB, AUDIO_F32LSB, SDL_ConvertMono, SDL_Convert_S16LSB_to_F32LSB_Mono },
+    { AUDIO_F32LSB, AUDIO_S16LSB, SDL_ConvertMono, SDL_Convert_F32LSB_to_S16LSB_Mono },
+    { 0, 0, NULL, NULL }
+};
+
+static SDL_AudioFilter
+SDL_FindFusedCVT(const SDL_AudioFusedFilters *filters, SDL_AudioFormat src_fmt,
+                 SDL_AudioFormat dst_fmt, SDL_AudioFilter channel_filter)
+{
+    int i;
+    for (i = 0; filters[i].filter != NULL; i++) {
+        if ((filters[i].src_fmt == src_fmt) && (filters[i].dst_fmt == dst_fmt) &&
+            (filters[i].channel_filter == channel_filter)) {
+            return filters[i].filter;
+        }
+    }
+    return NULL;
+}
+
+/* Replace a type converter and a channel converter with one fused filter */
+static void
+SDL_FuseAudioCVT(SDL_AudioCVT * cvt, SDL_AudioFormat src_fmt, SDL_AudioFormat dst_fmt)
+{
+    SDL_AudioFilter filter = NULL;
 
-    return NULL;                /* no specialized converter code available. */
-}
+    if ((cvt->filter_index != 2) || (src_fmt == dst_fmt)) {
+        return;
+    }
+
+#ifdef __SSE2__
+    if (SDL_HasSSE2()) {
+        filter = SDL_FindFusedCVT(sdl_audio_fused_filters_sse2, src_fmt, dst_fmt, cvt->filters[1]);
+    }
+#endif
+    if (!filter) {
+        filter = SDL_FindFusedCVT(sdl_audio_fused_filters, src_fmt, dst_fmt, cvt->filters[1]);
+    }
 
+    if (filter) {
+        cvt->filters[0] = filter;
+        cvt->filter_index = 1;
+    }
+}
 
 /*
  * Find a converter between two data types. We try to select a hand-tuned
@@ -1099,6 +1907,9 @@ SDL_BuildAudioCVT(SDL_AudioCVT * cvt,
         }
     }
 
+    /* Do the type and channel conversion in one pass, if possible */
+    SDL_FuseAudioCVT(cvt, src_fmt, dst_fmt);
+
     /* Do rate conversion, if necessary. Updates (cvt). */
     if (SDL_BuildAudioResampleCVT(cvt, dst_channels, src_rate, dst_rate) ==
         -1) {
@@ -1118,4 +1929,769 @@ SDL_BuildAudioCVT(SDL_AudioCVT * cvt,
 }
 
 
+/*
+ * Polyphase windowed sinc resampler. Unlike the rate filters above it
+ *  keeps the input it still needs between calls, so audio converted in
+ *  chunks comes out the same as if it had been converted at once, and it
+ *  handles any ratio between the rates.
+ */
+
+/* Past this many positions between input frames, coefficients for the
+   positions in between are interpolated */
+#define SDL_RESAMPLER_MAX_PHASES 512
+#define SDL_RESAMPLER_MAX_TAPS 256
+
+typedef float (*SDL_DotProductFunc) (const float *a, const float *b, int num);
+
+struct SDL_AudioResampler
+{
+    int channels;
+    int src_rate;               /* the rates divided by their GCD */
+    int dst_rate;
+    int taps;                   /* input frames under the filter, a multiple of 4 */
+    int phases;                 /* rows of coefficients, less one if interpolated */
+    SDL_bool interpolate;       /* SDL_FALSE if there's a row for each position */
+    float *coefs;
+    float *row;                 /* interpolated coefficients */
+    float *input;               /* one plane of capacity frames for each channel */
+    int capacity;
+    int frames;                 /* frames in each plane */
+    int pos;                    /* first input frame under the filter */
+    int frac;                   /* how far past the middle of the filter, in 1/dst_rate */
+    SDL_DotProductFunc dot;
+};
+
+static float
+SDL_DotProduct_Scalar(const float *a, const float *b, int num)
+{
+    float sum0 = 0.0f, sum1 = 0.0f, sum2 = 0.0f, sum3 = 0.0f;
+    int i;
+    for (i = 0; i < num; i += 4) {
+        sum0 += a[i] * b[i];
+        sum1 += a[i + 1] * b[i + 1];
+        sum2 += a[i + 2] * b[i + 2];
+        sum3 += a[i + 3] * b[i + 3];
+    }
+    return (sum0 + sum1) + (sum2 + sum3);
+}
+
+#ifdef __SSE__
+static float
+SDL_DotProduct_SSE(const float *a, const float *b, int num)
+{
+    __m128 sum = _mm_setzero_ps();
+    float result[4];
+    int i;
+    for (i = 0; i < num; i += 4) {
+        sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(&a[i]), _mm_loadu_ps(&b[i])));
+    }
+    _mm_storeu_ps(result, sum);
+    return (result[0] + result[1]) + (result[2] + result[3]);
+}
+#endif
+
+#if HAVE_NEON_INTRINSICS
+static float
+SDL_DotProduct_NEON(const float *a, const float *b, int num)
+{
+    float32x4_t sum = vdupq_n_f32(0.0f);
+    float32x2_t half;
+    int i;
+    for (i = 0; i < num; i += 4) {
+        sum = vmlaq_f32(sum, vld1q_f32(&a[i]), vld1q_f32(&b[i]));
+    }
+    half = vadd_f32(vget_low_f32(sum), vget_high_f32(sum));
+    return vget_lane_f32(vpadd_f32(half, half), 0);
+}
+#endif
+
+/* Modified Bessel function of the first kind, for the Kaiser window */
+static double
+SDL_BesselI0(double x)
+{
+    double sum = 1.0, term = 1.0;
+    int k;
+    for (k = 1; k < 50 && term > sum * 1e-12; ++k) {
+        const double y = x / (2.0 * k);
+        term *= y * y;
+        sum += term;
+    }
+    return sum;
+}
+
+static void
+SDL_ResamplerRow(float *row, int taps, double offset, double cutoff, double beta)
+{
+    const double half = taps / 2;
+    double sum = 0.0;
+    int i;
+
+    for (i = 0; i < taps; ++i) {
+        /* Distance from the output position, in input frames */
+        const double t = (i - half + 1) - offset;
+        const double u = t / half;
+        double h = 2.0 * cutoff;
+        if (t != 0.0) {
+            h = SDL_sin(2.0 * M_PI * cutoff * t) / (M_PI * t);
+        }
+        if (u <= -1.0 || u >= 1.0) {
+            h = 0.0;
+        } else {
+            h *= SDL_BesselI0(beta * SDL_sqrt(1.0 - u * u)) / SDL_BesselI0(beta);
+        }
+        row[i] = (float) h;
+        sum += h;
+    }
+
+    /* Unity gain at DC */
+    for (i = 0; i < taps; ++i) {
+        row[i] = (float) (row[i] / sum);
+    }
+}
+
+static int
+SDL_GCD(int a, int b)
+{
+    while (b != 0) {
+        const int t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+SDL_ResamplerQuality
+SDL_GetResamplerQuality(void)
+{
+    const char *hint = SDL_GetHint(SDL_HINT_AUDIO_RESAMPLING_MODE);
+    if (hint) {
+        if (*hint == '0' || SDL_strcasecmp(hint, "fast") == 0) {
+            return SDL_RESAMPLER_FAST;
+        } else if (*hint == '2' || SDL_strcasecmp(hint, "best") == 0) {
+            return SDL_RESAMPLER_BEST;
+        }
+    }
+    return SDL_RESAMPLER_MEDIUM;
+}
+
+SDL_AudioResampler *
+SDL_NewAudioResampler(int channels, int src_rate, int dst_rate, SDL_ResamplerQuality quality)
+{
+    SDL_AudioResampler *resampler;
+    int base_taps, taps, phases, rows, i;
+    double rolloff, beta, cutoff;
+    int gcd;
+
+    if (channels <= 0 || src_rate <= 0 || dst_rate <= 0) {
+        SDL_InvalidParamError("resampler");
+        return NULL;
+    }
+
+    switch (quality) {
+    case SDL_RESAMPLER_FAST:
+        base_taps = 8;
+        rolloff = 0.85;
+        beta = 5.0;
+        break;
+    case SDL_RESAMPLER_BEST:
+        base_taps = 48;
+        rolloff = 0.95;
+        beta = 9.0;
+        break;
+    default:
+        base_taps = 16;
+        rolloff = 0.90;
+        beta = 7.0;
+        break;
+    }
+
+    gcd = SDL_GCD(src_rate, dst_rate);
+    src_rate /= gcd;
+    dst_rate /= gcd;
+
+    /* When downsampling, lower the cutoff below the new Nyquist frequency
+       and widen the filter to match */
+    cutoff = 0.5 * rolloff;
+    taps = base_taps;
+    if (src_rate > dst_rate) {
+        cutoff = cutoff * dst_rate / src_rate;
+        taps = (int) SDL_ceil((double) base_taps * src_rate / dst_rate);
+    }
+    taps = SDL_min((taps + 3) & ~3, SDL_RESAMPLER_MAX_TAPS);
+
+    resampler = (SDL_AudioResampler *) SDL_calloc(1, sizeof (*resampler));
+    if (!resampler) {
+        SDL_OutOfMemory();
+        return NULL;
+    }
+    resampler->channels = channels;
+    resampler->src_rate = src_rate;
+    resampler->dst_rate = dst_rate;
+    resampler->taps = taps;
+
+    if (dst_rate <= SDL_RESAMPLER_MAX_PHASES) {
+        phases = dst_rate;
+        rows = phases;
+    } else {
+        phases = SDL_RESAMPLER_MAX_PHASES;
+        rows = phases + 1;
+        resampler->interpolate = SDL_TRUE;
+    }
+    resampler->phases = phases;
+
+    resampler->coefs = (float *) SDL_malloc((rows + 1) * taps * sizeof (float));
+    if (!resampler->coefs) {
+        SDL_FreeAudioResampler(resampler);
+        SDL_OutOfMemory();
+        return NULL;
+    }
+    resampler->row = resampler->coefs + rows * taps;
+    for (i = 0; i < rows; ++i) {
+        SDL_ResamplerRow(&resampler->coefs[i * taps], taps, (double) i / phases, cutoff, beta);
+    }
+
+    resampler->dot = SDL_DotProduct_Scalar;
+#ifdef __SSE__
+    if (SDL_HasSSE()) {
+        resampler->dot = SDL_DotProduct_SSE;
+    }
+#endif
+#if HAVE_NEON_INTRINSICS
+    resampler->dot = SDL_DotProduct_NEON;
+#endif
+
+    SDL_ResetAudioResampler(resampler);
+    return resampler;
+}
+
+void
+SDL_ResetAudioResampler(SDL_AudioResampler *resampler)
+{
+    /* Start with silence in the first half of the filter, so the first
+       input frame lines up with the middle of it. Before there is any
+       input buffer, SDL_ReserveResamplerInput() adds the silence. */
+    int i;
+
+    resampler->pos = 0;
+    resampler->frac = 0;
+    resampler->frames = resampler->taps / 2 - 1;
+    for (i = 0; i < resampler->channels && resampler->input; ++i) {
+        SDL_memset(&resampler->input[i * resampler->capacity], 0, resampler->frames * sizeof (float));
+    }
+}
+
+/* Make room for more input frames, dropping the ones the filter is past */
+int
+SDL_ReserveResamplerInput(SDL_AudioResampler *resampler, int frames)
+{
+    const int channels = resampler->channels;
+    int keep = resampler->frames - resampler->pos;
+    int capacity = resampler->capacity;
+    float *input = resampler->input;
+    int i;
+
+    if (keep + frames > capacity) {
+        capacity = SDL_max(capacity * 2, keep + frames);
+        capacity = SDL_max(capacity, 1024);
+        input = (float *) SDL_malloc(capacity * channels * sizeof (float));
+        if (!input) {
+            return SDL_OutOfMemory();
+        }
+    }
+
+    for (i = 0; i < channels; ++i) {
+        const float *plane = &resampler->input[i * resampler->capacity];
+        if (!resampler->input) {
+            SDL_memset(&input[i * capacity], 0, keep * sizeof (float));
+        } else if (input != resampler->input || resampler->pos > 0) {
+            SDL_memmove(&input[i * capacity], &plane[resampler->pos], keep * sizeof (float));
+        }
+    }
+
+    if (input != resampler->input) {
+        SDL_free(resampler->input);
+        resampler->input = input;
+        resampler->capacity = capacity;
+    }
+    resampler->frames = keep;
+    resampler->pos = 0;
+    return 0;
+}
+
+int
+SDL_GetResamplerOutputFrames(const SDL_AudioResampler *resampler, int frames)
+{
+    /* Outputs until the filter runs past the end of the input */
+    const Sint64 last = (Sint64) resampler->frames + frames - resampler->taps - resampler->pos;
+    if (last < 0) {
+        return 0;
+    }
+    return (int) ((((last + 1) * resampler->dst_rate) - 1 - resampler->frac) / resampler->src_rate) + 1;
+}
+
+int
+SDL_ResampleAudio(SDL_AudioResampler *resampler, const float *in, int inframes,
+                  float *out, int outframes)
+{
+    const int channels = resampler->channels;
+    const int taps = resampler->taps;
+    const int src_rate = resampler->src_rate;
+    const int dst_rate = resampler->dst_rate;
+    int produced, i, j;
+
+    if (inframes > 0) {
+        if (SDL_ReserveResamplerInput(resampler, inframes) < 0) {
+            return -1;
+        }
+        for (i = 0; i < channels; ++i) {
+            float *plane = &resampler->input[i * resampler->capacity + resampler->frames];
+            for (j = 0; j < inframes; ++j) {
+                plane[j] = in[j * channels + i];
+            }
+        }
+        resampler->frames += inframes;
+    }
+
+    for (produced = 0; produced < outframes; ++produced) {
+        const float *row;
+
+        if (resampler->pos + taps > resampler->frames) {
+            break;
+        }
+
+        if (!resampler->interpolate) {
+            row = &resampler->coefs[resampler->frac * taps];
+        } else {
+            const Sint64 scaled = (Sint64) resampler->frac * resampler->phases;
+            const int phase = (int) (scaled / dst_rate);
+            const float t = (float) (scaled % dst_rate) / dst_rate;
+            const float *a = &resampler->coefs[phase * taps];
+            const float *b = a + taps;
+            for (j = 0; j < taps; ++j) {
+                resampler->row[j] = a[j] + (b[j] - a[j]) * t;
+            }
+            row = resampler->row;
+        }
+
+        for (i = 0; i < channels; ++i) {
+            const float *plane = &resampler->input[i * resampler->capacity + resampler->pos];
+            *(out++) = resampler->dot(plane, row, taps);
+        }
+
+        resampler->frac += src_rate;
+        while (resampler->frac >= dst_rate) {
+            resampler->frac -= dst_rate;
+            resampler->pos++;
+        }
+    }
+
+    return produced;
+}
+
+int
+SDL_CarryResamplerInput(SDL_AudioResampler *resampler, const SDL_AudioResampler *from)
+{
+    /* The output position is the middle of the filter, so this one's filter
+       starts where it puts its middle on the same input frame as (from)'s */
+    const int start = from->pos + from->taps / 2 - resampler->taps / 2;
+    const int pad = (start < 0) ? -start : 0;
+    const int frames = SDL_max(from->frames - start, pad);
+    int i;
+
+    if (resampler->channels != from->channels) {
+        return SDL_InvalidParamError("from");
+    }
+    if (!from->input) {
+        SDL_ResetAudioResampler(resampler);
+        return 0;
+    }
+
+    resampler->pos = 0;
+    resampler->frames = 0;
+    if (SDL_ReserveResamplerInput(resampler, frames) < 0) {
+        return -1;
+    }
+    for (i = 0; i < resampler->channels; ++i) {
+        float *plane = &resampler->input[i * resampler->capacity];
+        SDL_memset(plane, 0, pad * sizeof (float));
+        SDL_memcpy(plane + pad, &from->input[i * from->capacity + start + pad],
+                   (frames - pad) * sizeof (float));
+    }
+    resampler->frames = frames;
+    resampler->frac = (int) ((Sint64) from->frac * resampler->dst_rate / from->dst_rate);
+    return 0;
+}
+
+void
+SDL_FreeAudioResampler(SDL_AudioResampler *resampler)
+{
+    if (resampler) {
+        SDL_free(resampler->input);
+        SDL_free(resampler->coefs);
+        SDL_free(resampler);
+    }
+}
+
+
+/*
+ * Audio streams. Without a rate change one SDL_AudioCVT does the whole
+ *  conversion. With one, (cvt_before) gets float samples with the target
+ *  channels, the resampler changes the rate and (cvt_after) makes the
+ *  target format. Converted audio waits in a ring buffer to be read.
+ *  Both buffers only grow, so once they're big enough for the chunks
+ *  being written nothing else gets allocated.
+ */
+struct SDL_AudioStream
+{
+    SDL_AudioCVT cvt_before;
+    SDL_AudioCVT cvt_after;
+    SDL_AudioResampler *resampler;
+    int src_rate;
+    int dst_rate;
+    int src_frame_size;
+    int dst_frame_size;
+    int resample_frame_size;    /* float frames with the target channels */
+    Sint64 frames_resampled;    /* into the resampler since the last flush */
+    Sint64 frames_produced;     /* and out of it */
+    Uint8 *work_buffer;
+    int work_buffer_len;
+    Uint8 *queue;
+    int queue_capacity;
+    int queue_head;
+    int queue_size;
+};
+
+SDL_AudioStream *
+SDL_NewAudioStream(SDL_AudioFormat src_format, Uint8 src_channels, int src_rate,
+                   SDL_AudioFormat dst_format, Uint8 dst_channels, int dst_rate)
+{
+    SDL_AudioStream *stream;
+    int result;
+
+    if (src_rate <= 0 || dst_rate <= 0) {
+        SDL_SetError("Source or destination rate is zero");
+        return NULL;
+    }
+
+    stream = (SDL_AudioStream *) SDL_calloc(1, sizeof (*stream));
+    if (!stream) {
+        SDL_OutOfMemory();
+        return NULL;
+    }
+    stream->src_rate = src_rate;
+    stream->dst_rate = dst_rate;
+    stream->src_frame_size = (SDL_AUDIO_BITSIZE(src_format) / 8) * src_channels;
+    stream->dst_frame_size = (SDL_AUDIO_BITSIZE(dst_format) / 8) * dst_channels;
+    stream->resample_frame_size = sizeof (float) * dst_channels;
+
+    if (src_rate == dst_rate) {
+        result = SDL_BuildAudioCVT(&stream->cvt_before, src_format, src_channels, src_rate,
+                                   dst_format, dst_channels, dst_rate);
+    } else {
+        result = SDL_BuildAudioCVT(&stream->cvt_before, src_format, src_channels, src_rate,
+                                   AUDIO_F32SYS, dst_channels, src_rate);
+        if (result >= 0) {
+            result = SDL_BuildAudioCVT(&stream->cvt_after, AUDIO_F32SYS, dst_channels, dst_rate,
+                                       dst_format, dst_channels, dst_rate);
+        }
+        if (result >= 0) {
+            stream->resampler = SDL_NewAudioResampler(dst_channels, src_rate, dst_rate,
+                                                      SDL_GetResamplerQuality());
+            if (!stream->resampler) {
+                result = -1;
+            }
+        }
+    }
+    if (result < 0) {
+        SDL_FreeAudioStream(stream);
+        return NULL;
+    }
+    return stream;
+}
+
+static Uint8 *
+SDL_ReserveAudioStreamWork(SDL_AudioStream *stream, int len)
+{
+    if (len > stream->work_buffer_len) {
+        Uint8 *buf = (Uint8 *) SDL_realloc(stream->work_buffer, len);
+        if (!buf) {
+            SDL_OutOfMemory();
+            return NULL;
+        }
+        stream->work_buffer = buf;
+        stream->work_buffer_len = len;
+    }
+    return stream->work_buffer;
+}
+
+/* Add converted audio to the end of the queue */
+static int
+SDL_QueueAudioStreamData(SDL_AudioStream *stream, const Uint8 *data, int len)
+{
+    int tail, first;
+
+    if (stream->queue_size + len > stream->queue_capacity) {
+        int capacity = SDL_max(stream->queue_capacity * 2, stream->queue_size + len);
+        Uint8 *queue = (Uint8 *) SDL_malloc(capacity);
+        if (!queue) {
+            return SDL_OutOfMemory();
+        }
+        /* Unwrap the queued data while copying it over */
+        first = SDL_min(stream->queue_size, stream->queue_capacity - stream->queue_head);
+        if (stream->queue_size > 0) {
+            SDL_memcpy(queue, stream->queue + stream->queue_head, first);
+            SDL_memcpy(queue + first, stream->queue, stream->queue_size - first);
+        }
+        SDL_free(stream->queue);
+        stream->queue = queue;
+        stream->queue_capacity = capacity;
+        stream->queue_head = 0;
+    }
+
+    tail = stream->queue_head + stream->queue_size;
+    if (tail >= stream->queue_capacity) {
+        tail -= stream->queue_capacity;
+    }
+    first = SDL_min(len, stream->queue_capacity - tail);
+    SDL_memcpy(stream->queue + tail, data, first);
+    SDL_memcpy(stream->queue, data + first, len - first);
+    stream->queue_size += len;
+    return 0;
+}
+
+/* Resample float frames, at most maxframes, and convert them to the target
+   format. Returns the converted length, the data is in *converted. */
+static int
+SDL_ResampleAudioStream(SDL_AudioStream *stream, const float *in, int inframes,
+                        float *out, int maxframes, const Uint8 **converted)
+{
+    int outframes = SDL_ResampleAudio(stream->resampler, in, inframes, out, maxframes);
+    if (outframes < 0) {
+        return -1;
+    }
+    stream->frames_resampled += inframes;
+    stream->frames_produced += outframes;
+
+    stream->cvt_after.buf = (Uint8 *) out;
+    stream->cvt_after.len = outframes * stream->resample_frame_size;
+    SDL_ConvertAudio(&stream->cvt_after);
+    *converted = stream->cvt_after.buf;
+    return stream->cvt_after.len_cvt;
+}
+
+/* The work buffer holds len bytes of input and their first conversion in
+   before_len bytes, then the resampler's output, at most outframes */
+static void
+SDL_GetAudioStreamWorkSize(SDL_AudioStream *stream, int len, int *before_len, int *outframes)
+{
+    *before_len = (len * stream->cvt_before.len_mult + 15) & ~15;
+    *outframes = 0;
+    if (stream->resampler) {
+        const int inframes = (int) (len * stream->cvt_before.len_ratio) / stream->resample_frame_size;
+        *outframes = SDL_GetResamplerOutputFrames(stream->resampler, inframes);
+    }
+}
+
+/* Convert len bytes of input at the start of the work buffer, in place.
+   Returns the converted length, the data is in *converted. */
+static int
+SDL_ConvertAudioStreamWork(SDL_AudioStream *stream, int len, const Uint8 **converted)
+{
+    Uint8 *work = stream->work_buffer;
+    int before_len, inframes, outframes;
+
+    SDL_GetAudioStreamWorkSize(stream, len, &before_len, &outframes);
+    stream->cvt_before.buf = work;
+    stream->cvt_before.len = len;
+    SDL_ConvertAudio(&stream->cvt_before);
+
+    if (!stream->resampler) {
+        *converted = work;
+        return stream->cvt_before.len_cvt;
+    }
+    inframes = stream->cvt_before.len_cvt / stream->resample_frame_size;
+    return SDL_ResampleAudioStream(stream, (const float *) work, inframes,
+                                   (float *) (work + before_len), outframes, converted);
+}
+
+int
+SDL_AudioStreamPut(SDL_AudioStream *stream, const void *buf, int len)
+{
+    const Uint8 *converted;
+    Uint8 *work;
+
+    if (!stream) {
+        return SDL_InvalidParamError("stream");
+    }
+    if (!buf && len > 0) {
+        return SDL_InvalidParamError("buf");
+    }
+    if (len < 0 || (len % stream->src_frame_size) != 0) {
+        return SDL_SetError("Can't write partial sample frames");
+    }
+    if (len == 0) {
+        return 0;
+    }
+
+    if (!stream->cvt_before.needed && !stream->resampler) {
+        return SDL_QueueAudioStreamData(stream, (const Uint8 *) buf, len);
+    }
+
+    work = SDL_GetAudioStreamWork(stream, len);
+    if (!work) {
+        return -1;
+    }
+    SDL_memcpy(work, buf, len);
+    len = SDL_ConvertAudioStreamWork(stream, len, &converted);
+    if (len < 0) {
+        return -1;
+    }
+    return SDL_QueueAudioStreamData(stream, converted, len);
+}
+
+Uint8 *
+SDL_GetAudioStreamWork(SDL_AudioStream *stream, int len)
+{
+    int before_len, outframes;
+
+    SDL_GetAudioStreamWorkSize(stream, len, &before_len, &outframes);
+    return SDL_ReserveAudioStreamWork(stream, before_len + outframes * stream->resample_frame_size);
+}
+
+int
+SDL_AudioStreamPutWork(SDL_AudioStream *stream, int len, Uint8 *out, int outlen)
+{
+    const Uint8 *converted;
+    int direct = 0;
+
+    if (len < 0 || (len % stream->src_frame_size) != 0) {
+        return SDL_SetError("Can't write partial sample frames");
+    }
+    len = SDL_ConvertAudioStreamWork(stream, len, &converted);
+    if (len < 0) {
+        return -1;
+    }
+
+    /* Only what would be read next can skip the queue */
+    if (stream->queue_size == 0) {
+        direct = SDL_min(len, outlen);
+        SDL_memcpy(out, converted, direct);
+    }
+    if (SDL_QueueAudioStreamData(stream, converted + direct, len - direct) < 0) {
+        return -1;
+    }
+    return direct;
+}
+
+int
+SDL_AudioStreamGet(SDL_AudioStream *stream, void *buf, int len)
+{
+    int first;
+
+    if (!stream) {
+        return SDL_InvalidParamError("stream");
+    }
+    if (!buf && len > 0) {
+        return SDL_InvalidParamError("buf");
+    }
+    if (len < 0 || (len % stream->dst_frame_size) != 0) {
+        return SDL_SetError("Can't read partial sample frames");
+    }
+
+    len = SDL_min(len, stream->queue_size);
+    first = SDL_min(len, stream->queue_capacity - stream->queue_head);
+    if (len > 0) {
+        SDL_memcpy(buf, stream->queue + stream->queue_head, first);
+        SDL_memcpy((Uint8 *) buf + first, stream->queue, len - first);
+    }
+
+    stream->queue_head += len;
+    if (stream->queue_head >= stream->queue_capacity) {
+        stream->queue_head -= stream->queue_capacity;
+    }
+    stream->queue_size -= len;
+    if (stream->queue_size == 0) {
+        stream->queue_head = 0;
+    }
+    return len;
+}
+
+int
+SDL_AudioStreamAvailable(SDL_AudioStream *stream)
+{
+    return stream ? stream->queue_size : 0;
+}
+
+int
+SDL_AudioStreamFlush(SDL_AudioStream *stream)
+{
+    /* Silence to push the last frames through the filter */
+    const int chunk = 64;
+    Sint64 remaining;
+    float *silence, *out;
+    int maxframes;
+
+    if (!stream) {
+        return SDL_InvalidParamError("stream");
+    }
+    if (!stream->resampler) {
+        return 0;
+    }
+
+    /* As many frames as the audio written lasts, rounding up */
+    remaining = (stream->frames_resampled * stream->dst_rate + stream->src_rate - 1) / stream->src_rate;
+    remaining -= stream->frames_produced;
+
+    maxframes = SDL_GetResamplerOutputFrames(stream->resampler, chunk) + 1;
+    silence = (float *) SDL_ReserveAudioStreamWork(stream, (chunk + maxframes) * stream->resample_frame_size);
+    if (!silence) {
+        return -1;
+    }
+    out = silence + chunk * (stream->resample_frame_size / sizeof (float));
+    SDL_memset(silence, 0, chunk * stream->resample_frame_size);
+
+    while (remaining > 0) {
+        const Sint64 produced = stream->frames_produced;
+        const Uint8 *converted;
+        const int len = SDL_ResampleAudioStream(stream, silence, chunk, out,
+                                                (int) SDL_min(remaining, maxframes),
+                                                &converted);
+        if (len < 0 || SDL_QueueAudioStreamData(stream, converted, len) < 0) {
+            return -1;
+        }
+        remaining -= stream->frames_produced - produced;
+    }
+
+    SDL_ResetAudioResampler(stream->resampler);
+    stream->frames_resampled = 0;
+    stream->frames_produced = 0;
+    return 0;
+}
+
+void
+SDL_AudioStreamClear(SDL_AudioStream *stream)
+{
+    if (stream) {
+        if (stream->resampler) {
+            SDL_ResetAudioResampler(stream->resampler);
+        }
+        stream->frames_resampled = 0;
+        stream->frames_produced = 0;
+        stream->queue_head = 0;
+        stream->queue_size = 0;
+    }
+}
+
+void
+SDL_FreeAudioStream(SDL_AudioStream *stream)
+{
+    if (stream) {
+        SDL_FreeAudioResampler(stream->resampler);
+        SDL_free(stream->work_buffer);
+        SDL_free(stream->queue);
+        SDL_free(stream);
+    }
+}
+
+
 /* vi: set ts=4 sw=4 expandtab: */
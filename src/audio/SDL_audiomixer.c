@@ -0,0 +1,1067 @@
+/*
+  Simple DirectMedia Layer
+  Copyright (C) 1997-2014 Sam Lantinga <slouken@libsdl.org>
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+#include "../SDL_internal.h"
+
+/* A voice mixer that takes over an audio device's callback */
+
+#include "SDL_audio.h"
+#include "SDL_cpuinfo.h"
+#include "SDL_audio_c.h"
+#include "SDL_sysaudio.h"
+
+#define SDL_MIXER_MAX_VOICES 65535
+#define SDL_MIXER_MAX_PITCH  16.0f
+
+/* Input frames given to a voice's resampler at a time */
+#define SDL_MIXER_CHUNK 256
+
+/* Silent frames fed to a resampler after the end of a source, to get the
+   last of it out of the widest filter */
+#define SDL_MIXER_TAIL 128
+
+static const float SDL_MixerSilence[SDL_MIXER_CHUNK * 2];
+
+typedef struct SDL_MixerSource
+{
+    float *data;                /* Float samples, mono or stereo */
+    Uint32 frames;
+    int channels;
+    int freq;
+} SDL_MixerSource;
+
+typedef enum
+{
+    SDL_MIXERVOICE_FREE,
+    SDL_MIXERVOICE_STARTING,    /* Claimed, but the audio thread skips it */
+    SDL_MIXERVOICE_PLAYING
+} SDL_MixerVoiceState;
+
+typedef struct SDL_MixerVoice
+{
+    SDL_MixerVoiceState state;
+    Uint32 generation;          /* Part of the voice ID, so old IDs don't reach a new sound */
+    SDL_MixerSource *source;
+    Uint32 position;            /* Next source frame to mix or resample */
+    int tail;                   /* Silent frames fed to the resampler after the end */
+    SDL_bool loop;
+    float gain;
+    float pan;
+    float pitch;
+    float left;                 /* Gain of each output channel */
+    float right;
+    int rate;                   /* The source's rate times the pitch */
+    SDL_bool resampling;
+    SDL_AudioResampler *resampler;  /* Kept for the next sound with the same rate */
+    int resampler_rate;
+} SDL_MixerVoice;
+
+/* These return how many frames they did, the rest is done one at a time */
+typedef int (*SDL_MixVoiceFunc) (float *accum, const float *src, int frames, float left, float right);
+typedef int (*SDL_StoreMixFunc) (void *dst, const float *accum, int frames);
+
+struct SDL_AudioMixer
+{
+    SDL_AudioDeviceID id;
+    SDL_AudioCallback callback; /* What the device had before */
+    void *userdata;
+
+    /* The format the device's callback is asked for */
+    SDL_AudioFormat format;
+    int channels;
+    int freq;
+    int frames;                 /* Frames mixed at a time */
+    SDL_ResamplerQuality quality;
+
+    SDL_MixerSource **sources;
+    int num_sources;
+    SDL_MixerVoice *voices;
+    int num_voices;
+
+    float *accum;               /* Stereo mix of all voices */
+    float *scratch;             /* A voice's resampled frames */
+
+    SDL_MixVoiceFunc mix_mono;
+    SDL_MixVoiceFunc mix_stereo;
+    SDL_StoreMixFunc store_s16;
+    SDL_StoreMixFunc store_f32;
+};
+typedef struct SDL_AudioMixer SDL_AudioMixer;
+
+
+/*
+ * Vectorized mixing. The voices are added to a stereo float mix, which is
+ *  clamped and converted once, when everything is in it.
+ */
+#if HAVE_AVX2_INTRINSICS
+static int SDL_TARGETING_AVX2
+SDL_MixVoiceMono_AVX2(float *accum, const float *src, int frames, float left, float right)
+{
+    const __m256 gains = _mm256_setr_ps(left, right, left, right, left, right, left, right);
+    int i;
+
+    for (i = 0; i + 8 <= frames; i += 8) {
+        const __m256 s = _mm256_loadu_ps(&src[i]);
+        const __m256 lo = _mm256_unpacklo_ps(s, s);  /* 0 0 1 1 4 4 5 5 */
+        const __m256 hi = _mm256_unpackhi_ps(s, s);  /* 2 2 3 3 6 6 7 7 */
+        const __m256 a = _mm256_permute2f128_ps(lo, hi, 0x20);
+        const __m256 b = _mm256_permute2f128_ps(lo, hi, 0x31);
+        float *dst = &accum[i * 2];
+        _mm256_storeu_ps(dst, _mm256_add_ps(_mm256_loadu_ps(dst), _mm256_mul_ps(a, gains)));
+        _mm256_storeu_ps(dst + 8, _mm256_add_ps(_mm256_loadu_ps(dst + 8), _mm256_mul_ps(b, gains)));
+    }
+    return i;
+}
+
+static int SDL_TARGETING_AVX2
+SDL_MixVoiceStereo_AVX2(float *accum, const float *src, int frames, float left, float right)
+{
+    const __m256 gains = _mm256_setr_ps(left, right, left, right, left, right, left, right);
+    int i;
+
+    for (i = 0; i + 8 <= frames; i += 8) {
+        float *dst = &accum[i * 2];
+        const __m256 a = _mm256_mul_ps(_mm256_loadu_ps(&src[i * 2]), gains);
+        const __m256 b = _mm256_mul_ps(_mm256_loadu_ps(&src[i * 2 + 8]), gains);
+        _mm256_storeu_ps(dst, _mm256_add_ps(_mm256_loadu_ps(dst), a));
+        _mm256_storeu_ps(dst + 8, _mm256_add_ps(_mm256_loadu_ps(dst + 8), b));
+    }
+    return i;
+}
+#endif /* HAVE_AVX2_INTRINSICS */
+
+#ifdef __SSE2__
+static int
+SDL_MixVoiceMono_SSE2(float *accum, const float *src, int frames, float left, float right)
+{
+    const __m128 gains = _mm_setr_ps(left, right, left, right);
+    int i;
+
+    for (i = 0; i + 4 <= frames; i += 4) {
+        const __m128 s = _mm_loadu_ps(&src[i]);
+        const __m128 a = _mm_mul_ps(_mm_unpacklo_ps(s, s), gains);
+        const __m128 b = _mm_mul_ps(_mm_unpackhi_ps(s, s), gains);
+        float *dst = &accum[i * 2];
+        _mm_storeu_ps(dst, _mm_add_ps(_mm_loadu_ps(dst), a));
+        _mm_storeu_ps(dst + 4, _mm_add_ps(_mm_loadu_ps(dst + 4), b));
+    }
+    return i;
+}
+
+static int
+SDL_MixVoiceStereo_SSE2(float *accum, const float *src, int frames, float left, float right)
+{
+    const __m128 gains = _mm_setr_ps(left, right, left, right);
+    int i;
+
+    for (i = 0; i + 4 <= frames; i += 4) {
+        float *dst = &accum[i * 2];
+        const __m128 a = _mm_mul_ps(_mm_loadu_ps(&src[i * 2]), gains);
+        const __m128 b = _mm_mul_ps(_mm_loadu_ps(&src[i * 2 + 4]), gains);
+        _mm_storeu_ps(dst, _mm_add_ps(_mm_loadu_ps(dst), a));
+        _mm_storeu_ps(dst + 4, _mm_add_ps(_mm_loadu_ps(dst + 4), b));
+    }
+    return i;
+}
+
+static int
+SDL_StoreMixS16_SSE2(void *dst, const float *accum, int frames)
+{
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 minus_one = _mm_set1_ps(-1.0f);
+    const __m128 mul32767 = _mm_set1_ps(32767.0f);
+    Sint16 *out = (Sint16 *) dst;
+    int i;
+
+    /* min() before max(), like the C version, so NaN comes out as 1.0f */
+    for (i = 0; i + 4 <= frames; i += 4) {
+        const __m128 a = _mm_max_ps(_mm_min_ps(_mm_loadu_ps(&accum[i * 2]), one), minus_one);
+        const __m128 b = _mm_max_ps(_mm_min_ps(_mm_loadu_ps(&accum[i * 2 + 4]), one), minus_one);
+        const __m128i x = _mm_cvttps_epi32(_mm_mul_ps(a, mul32767));
+        const __m128i y = _mm_cvttps_epi32(_mm_mul_ps(b, mul32767));
+        _mm_storeu_si128((__m128i *) &out[i * 2], _mm_packs_epi32(x, y));
+    }
+    return i;
+}
+
+static int
+SDL_StoreMixF32_SSE2(void *dst, const float *accum, int frames)
+{
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 minus_one = _mm_set1_ps(-1.0f);
+    float *out = (float *) dst;
+    int i;
+
+    for (i = 0; i + 2 <= frames; i += 2) {
+        const __m128 a = _mm_max_ps(_mm_min_ps(_mm_loadu_ps(&accum[i * 2]), one), minus_one);
+        _mm_storeu_ps(&out[i * 2], a);
+    }
+    return i;
+}
+#endif /* __SSE2__ */
+
+#if HAVE_NEON_INTRINSICS
+static int
+SDL_MixVoiceMono_NEON(float *accum, const float *src, int frames, float left, float right)
+{
+    const float32x2_t lr = { left, right };
+    const float32x4_t gains = vcombine_f32(lr, lr);
+    int i;
+
+    for (i = 0; i + 4 <= frames; i += 4) {
+        const float32x4_t s = vld1q_f32(&src[i]);
+        const float32x4x2_t z = vzipq_f32(s, s);
+        float *dst = &accum[i * 2];
+        vst1q_f32(dst, vmlaq_f32(vld1q_f32(dst), z.val[0], gains));
+        vst1q_f32(dst + 4, vmlaq_f32(vld1q_f32(dst + 4), z.val[1], gains));
+    }
+    return i;
+}
+
+static int
+SDL_MixVoiceStereo_NEON(float *accum, const float *src, int frames, float left, float right)
+{
+    const float32x2_t lr = { left, right };
+    const float32x4_t gains = vcombine_f32(lr, lr);
+    int i;
+
+    for (i = 0; i + 4 <= frames; i += 4) {
+        float *dst = &accum[i * 2];
+        vst1q_f32(dst, vmlaq_f32(vld1q_f32(dst), vld1q_f32(&src[i * 2]), gains));
+        vst1q_f32(dst + 4, vmlaq_f32(vld1q_f32(dst + 4), vld1q_f32(&src[i * 2 + 4]), gains));
+    }
+    return i;
+}
+
+static int
+SDL_StoreMixS16_NEON(void *dst, const float *accum, int frames)
+{
+    const float32x4_t one = vdupq_n_f32(1.0f);
+    const float32x4_t minus_one = vdupq_n_f32(-1.0f);
+    Sint16 *out = (Sint16 *) dst;
+    int i;
+
+    for (i = 0; i + 4 <= frames; i += 4) {
+        const float32x4_t a = vmaxq_f32(vminq_f32(vld1q_f32(&accum[i * 2]), one), minus_one);
+        const float32x4_t b = vmaxq_f32(vminq_f32(vld1q_f32(&accum[i * 2 + 4]), one), minus_one);
+        const int32x4_t x = vcvtq_s32_f32(vmulq_n_f32(a, 32767.0f));
+        const int32x4_t y = vcvtq_s32_f32(vmulq_n_f32(b, 32767.0f));
+        vst1q_s16(&out[i * 2], vcombine_s16(vmovn_s32(x), vmovn_s32(y)));
+    }
+    return i;
+}
+
+static int
+SDL_StoreMixF32_NEON(void *dst, const float *accum, int frames)
+{
+    const float32x4_t one = vdupq_n_f32(1.0f);
+    const float32x4_t minus_one = vdupq_n_f32(-1.0f);
+    float *out = (float *) dst;
+    int i;
+
+    for (i = 0; i + 2 <= frames; i += 2) {
+        vst1q_f32(&out[i * 2], vmaxq_f32(vminq_f32(vld1q_f32(&accum[i * 2]), one), minus_one));
+    }
+    return i;
+}
+#endif /* HAVE_NEON_INTRINSICS */
+
+static void
+SDL_ChooseMixerFuncs(SDL_AudioMixer *mixer)
+{
+#if HAVE_AVX2_INTRINSICS
+    if (SDL_HasAVX2()) {
+        mixer->mix_mono = SDL_MixVoiceMono_AVX2;
+        mixer->mix_stereo = SDL_MixVoiceStereo_AVX2;
+    }
+#endif
+#ifdef __SSE2__
+    if (SDL_HasSSE2()) {
+        if (!mixer->mix_mono) {
+            mixer->mix_mono = SDL_MixVoiceMono_SSE2;
+            mixer->mix_stereo = SDL_MixVoiceStereo_SSE2;
+        }
+        mixer->store_s16 = SDL_StoreMixS16_SSE2;
+        mixer->store_f32 = SDL_StoreMixF32_SSE2;
+    }
+#endif
+#if HAVE_NEON_INTRINSICS
+    mixer->mix_mono = SDL_MixVoiceMono_NEON;
+    mixer->mix_stereo = SDL_MixVoiceStereo_NEON;
+    mixer->store_s16 = SDL_StoreMixS16_NEON;
+    mixer->store_f32 = SDL_StoreMixF32_NEON;
+#endif
+}
+
+
+static void
+SDL_MixVoiceFrames(SDL_AudioMixer *mixer, float *accum, const float *src,
+                   int channels, int frames, float left, float right)
+{
+    int i = 0;
+
+    if (channels == 1) {
+        if (mixer->mix_mono) {
+            i = mixer->mix_mono(accum, src, frames, left, right);
+        }
+        for (; i < frames; ++i) {
+            accum[i * 2] += src[i] * left;
+            accum[i * 2 + 1] += src[i] * right;
+        }
+    } else {
+        if (mixer->mix_stereo) {
+            i = mixer->mix_stereo(accum, src, frames, left, right);
+        }
+        for (; i < frames; ++i) {
+            accum[i * 2] += src[i * 2] * left;
+            accum[i * 2 + 1] += src[i * 2 + 1] * right;
+        }
+    }
+}
+
+/* Returns SDL_TRUE when a voice that doesn't loop reaches the end */
+static SDL_bool
+SDL_MixVoice(SDL_AudioMixer *mixer, SDL_MixerVoice *voice, int frames)
+{
+    const SDL_MixerSource *source = voice->source;
+    int done = 0;
+
+    while (done < frames) {
+        int n;
+
+        if (voice->position == source->frames) {
+            if (!voice->loop) {
+                return SDL_TRUE;
+            }
+            voice->position = 0;
+        }
+        n = (int) SDL_min(source->frames - voice->position, (Uint32) (frames - done));
+        SDL_MixVoiceFrames(mixer, &mixer->accum[done * 2],
+                           &source->data[voice->position * source->channels],
+                           source->channels, n, voice->left, voice->right);
+        voice->position += n;
+        done += n;
+    }
+    return SDL_FALSE;
+}
+
+/* The same for a voice whose rate isn't the device's. The resampler is
+   given about as much input as the output needs, so it doesn't pile up. */
+static SDL_bool
+SDL_MixResampledVoice(SDL_AudioMixer *mixer, SDL_MixerVoice *voice, int frames)
+{
+    const SDL_MixerSource *source = voice->source;
+    const int channels = source->channels;
+    SDL_bool finished = SDL_FALSE;
+    int got = 0;
+
+    while (got < frames) {
+        const int need = frames - got;
+        const int avail = SDL_GetResamplerOutputFrames(voice->resampler, 0);
+        const float *in = NULL;
+        int inframes = 0;
+        int n;
+
+        if (avail < need) {
+            int want = (int) ((Sint64) (need - avail) * voice->resampler_rate / mixer->freq) + 1;
+            want = SDL_min(want, SDL_MIXER_CHUNK);
+
+            if (voice->position == source->frames && voice->loop) {
+                voice->position = 0;
+            }
+            if (voice->position < source->frames) {
+                inframes = (int) SDL_min((Uint32) want, source->frames - voice->position);
+                in = &source->data[voice->position * channels];
+                voice->position += inframes;
+            } else if (voice->tail < SDL_MIXER_TAIL) {
+                inframes = SDL_min(want, SDL_MIXER_TAIL - voice->tail);
+                in = SDL_MixerSilence;
+                voice->tail += inframes;
+            }
+        }
+
+        n = SDL_ResampleAudio(voice->resampler, in, inframes, &mixer->scratch[got * channels], need);
+        if (n < 0 || (n == 0 && inframes == 0)) {
+            finished = SDL_TRUE;
+            break;
+        }
+        got += n;
+    }
+
+    SDL_MixVoiceFrames(mixer, mixer->accum, mixer->scratch, channels, got, voice->left, voice->right);
+    return finished;
+}
+
+static void
+SDL_StoreMixedSample(Uint8 *dst, float sample, SDL_AudioFormat format)
+{
+    const int size = SDL_AUDIO_BITSIZE(format) / 8;
+    Uint32 bits;
+    int i;
+
+    if (SDL_AUDIO_ISFLOAT(format)) {
+        union { float f; Uint32 u; } x;
+        x.f = sample;
+        bits = x.u;
+    } else if (size == 4) {
+        bits = (Uint32) (Sint32) ((double) sample * 2147483647.0);
+    } else {
+        bits = (Uint32) (Sint32) (sample * ((size == 2) ? 32767.0f : 127.0f));
+    }
+    if (!SDL_AUDIO_ISSIGNED(format)) {
+        bits ^= 1u << (size * 8 - 1);
+    }
+    for (i = 0; i < size; ++i) {
+        dst[SDL_AUDIO_ISBIGENDIAN(format) ? (size - 1 - i) : i] = (Uint8) (bits >> (i * 8));
+    }
+}
+
+static void
+SDL_StoreMixedAudio(SDL_AudioMixer *mixer, Uint8 *stream, int frames)
+{
+    const float *accum = mixer->accum;
+    const int size = SDL_AUDIO_BITSIZE(mixer->format) / 8;
+    int i = 0, j;
+
+    if (mixer->channels == 2 && mixer->format == AUDIO_S16SYS) {
+        Sint16 *dst = (Sint16 *) stream;
+        if (mixer->store_s16) {
+            i = mixer->store_s16(dst, accum, frames);
+        }
+        for (i *= 2; i < frames * 2; ++i) {
+            float sample = SDL_min(accum[i], 1.0f);
+            sample = SDL_max(sample, -1.0f);
+            dst[i] = (Sint16) (sample * 32767.0f);
+        }
+        return;
+    }
+    if (mixer->channels == 2 && mixer->format == AUDIO_F32SYS) {
+        float *dst = (float *) stream;
+        if (mixer->store_f32) {
+            i = mixer->store_f32(dst, accum, frames);
+        }
+        for (i *= 2; i < frames * 2; ++i) {
+            float sample = SDL_min(accum[i], 1.0f);
+            dst[i] = SDL_max(sample, -1.0f);
+        }
+        return;
+    }
+
+    /* Any other format, one sample at a time. Mono gets both sides of the
+       mix, channels past the first two get silence. */
+    for (i = 0; i < frames; ++i) {
+        for (j = 0; j < mixer->channels; ++j) {
+            float sample;
+            if (mixer->channels == 1) {
+                sample = 0.5f * (accum[i * 2] + accum[i * 2 + 1]);
+            } else if (j < 2) {
+                sample = accum[i * 2 + j];
+            } else {
+                sample = 0.0f;
+            }
+            sample = SDL_min(sample, 1.0f);
+            sample = SDL_max(sample, -1.0f);
+            SDL_StoreMixedSample(stream, sample, mixer->format);
+            stream += size;
+        }
+    }
+}
+
+static void SDLCALL
+SDL_AudioMixerCallback(void *userdata, Uint8 *stream, int len)
+{
+    SDL_AudioMixer *mixer = (SDL_AudioMixer *) userdata;
+    const int framesize = (SDL_AUDIO_BITSIZE(mixer->format) / 8) * mixer->channels;
+    int frames = len / framesize;
+    int i;
+
+    while (frames > 0) {
+        const int n = SDL_min(frames, mixer->frames);
+
+        SDL_memset(mixer->accum, 0, n * 2 * sizeof (float));
+        for (i = 0; i < mixer->num_voices; ++i) {
+            SDL_MixerVoice *voice = &mixer->voices[i];
+            SDL_bool finished;
+
+            if (voice->state != SDL_MIXERVOICE_PLAYING) {
+                continue;
+            }
+            if (voice->resampling) {
+                finished = SDL_MixResampledVoice(mixer, voice, n);
+            } else {
+                finished = SDL_MixVoice(mixer, voice, n);
+            }
+            if (finished) {
+                voice->state = SDL_MIXERVOICE_FREE;
+                voice->source = NULL;
+            }
+        }
+        SDL_StoreMixedAudio(mixer, stream, n);
+
+        stream += n * framesize;
+        frames -= n;
+    }
+}
+
+
+/* The mixer is only looked up with the device locked, so it can't be
+   detached and freed while it's in use. Returns NULL, unlocked, if there's
+   no mixer. */
+static SDL_AudioMixer *
+lock_audio_mixer(SDL_AudioDeviceID devid)
+{
+    SDL_AudioDevice *device = SDL_GetOpenAudioDevice(devid);
+
+    if (!device) {
+        return NULL;
+    }
+    SDL_LockAudioDevice(devid);
+    if (!device->mixer) {
+        SDL_UnlockAudioDevice(devid);
+        SDL_SetError("Audio device has no mixer attached");
+        return NULL;
+    }
+    return device->mixer;
+}
+
+/* These are called with the device locked */
+static SDL_MixerSource *
+get_mixer_source(SDL_AudioMixer *mixer, int id)
+{
+    if (id <= 0 || id > mixer->num_sources || !mixer->sources[id - 1]) {
+        SDL_SetError("Invalid mixer source");
+        return NULL;
+    }
+    return mixer->sources[id - 1];
+}
+
+static SDL_MixerVoice *
+find_mixer_voice(SDL_AudioMixer *mixer, int id)
+{
+    const int slot = (id & 0xFFFF) - 1;
+    const Uint32 generation = ((Uint32) id) >> 16;
+
+    if (id <= 0 || slot < 0 || slot >= mixer->num_voices ||
+        mixer->voices[slot].generation != generation) {
+        return NULL;
+    }
+    return &mixer->voices[slot];
+}
+
+static SDL_MixerVoice *
+get_mixer_voice(SDL_AudioMixer *mixer, int id)
+{
+    SDL_MixerVoice *voice = find_mixer_voice(mixer, id);
+
+    if (!voice) {
+        SDL_SetError("Invalid mixer voice");
+    }
+    return voice;
+}
+
+static void
+update_voice_gains(SDL_MixerVoice *voice)
+{
+    voice->left = voice->gain * SDL_min(1.0f, 1.0f - voice->pan);
+    voice->right = voice->gain * SDL_min(1.0f, 1.0f + voice->pan);
+}
+
+/* Make a voice read its source at a new rate. A voice that starts out at
+   the device's rate is mixed directly; otherwise it needs a resampler.
+   Returns SDL_TRUE if it needs a new one, which resample_voice() makes. */
+static SDL_bool
+change_voice_rate(SDL_AudioMixer *mixer, SDL_MixerVoice *voice, int rate)
+{
+    voice->rate = rate;
+    if (voice->resampling ? (voice->resampler_rate == rate) : (rate == mixer->freq)) {
+        return SDL_FALSE;
+    }
+    if (!voice->resampling && voice->resampler && voice->resampler_rate == rate) {
+        SDL_ResetAudioResampler(voice->resampler);
+        voice->resampling = SDL_TRUE;
+        return SDL_FALSE;
+    }
+    return SDL_TRUE;
+}
+
+/* Give a voice a resampler for its new rate. It's made with the device
+   unlocked so the audio thread doesn't wait on it, and the mixer can be
+   detached meanwhile, so this returns the mixer locked again, or NULL and
+   unlocked if it's gone. Either way the caller has to look the voice up
+   again. A resampler that was already going hands its input over, so
+   changing the pitch doesn't click. */
+static SDL_AudioMixer *
+resample_voice(SDL_AudioDeviceID devid, SDL_AudioMixer *mixer, int id, int *retval)
+{
+    SDL_MixerVoice *voice = find_mixer_voice(mixer, id);
+    const int channels = voice->source->channels;
+    const int rate = voice->rate;
+    const int freq = mixer->freq;
+    const int quality = mixer->quality;
+    SDL_AudioResampler *resampler;
+
+    SDL_UnlockAudioDevice(devid);
+    resampler = SDL_NewAudioResampler(channels, rate, freq, quality);
+    if (resampler && SDL_ReserveResamplerInput(resampler, SDL_MIXER_CHUNK) < 0) {
+        SDL_FreeAudioResampler(resampler);
+        resampler = NULL;
+    }
+    mixer = lock_audio_mixer(devid);
+
+    if (!mixer || !resampler) {
+        SDL_FreeAudioResampler(resampler);
+        *retval = -1;
+        return mixer;
+    }
+    *retval = 0;
+
+    voice = find_mixer_voice(mixer, id);
+    if (!voice || voice->state == SDL_MIXERVOICE_FREE || voice->rate != rate ||
+        voice->source->channels != channels || mixer->freq != freq ||
+        (voice->resampling && voice->resampler_rate == rate)) {
+        /* Stopped, restarted or changed again while unlocked */
+        SDL_FreeAudioResampler(resampler);
+        return mixer;
+    }
+
+    if (voice->resampling && SDL_CarryResamplerInput(resampler, voice->resampler) < 0) {
+        SDL_ResetAudioResampler(resampler);
+    }
+    SDL_FreeAudioResampler(voice->resampler);
+    voice->resampler = resampler;
+    voice->resampler_rate = rate;
+    voice->resampling = SDL_TRUE;
+    return mixer;
+}
+
+static int
+voice_rate(const SDL_MixerVoice *voice)
+{
+    return (int) (voice->source->freq * voice->pitch + 0.5f);
+}
+
+
+int
+SDL_AttachAudioMixer(SDL_AudioDeviceID devid, int max_voices)
+{
+    SDL_AudioDevice *device = SDL_GetOpenAudioDevice(devid);
+    SDL_AudioMixer *mixer;
+
+    if (!device) {
+        return -1;
+    }
+    if (device->iscapture) {
+        return SDL_SetError("Can't attach a mixer to a capture device");
+    }
+    if (device->mixer) {
+        return SDL_SetError("Audio device already has a mixer attached");
+    }
+    if (device->queue_lock) {
+        /* Opened without a callback, SDL_QueueAudio() would have nowhere to go */
+        return SDL_SetError("Can't attach a mixer to a device that queues its audio");
+    }
+    if (max_voices <= 0 || max_voices > SDL_MIXER_MAX_VOICES) {
+        return SDL_InvalidParamError("max_voices");
+    }
+
+    mixer = (SDL_AudioMixer *) SDL_calloc(1, sizeof (*mixer));
+    if (!mixer) {
+        return SDL_OutOfMemory();
+    }
+    mixer->id = devid;
+    mixer->format = device->callbackspec.format;
+    mixer->channels = device->callbackspec.channels;
+    mixer->freq = device->callbackspec.freq;
+    mixer->frames = device->callbackspec.samples;
+    mixer->quality = SDL_GetResamplerQuality();
+    mixer->num_voices = max_voices;
+    mixer->voices = (SDL_MixerVoice *) SDL_calloc(max_voices, sizeof (SDL_MixerVoice));
+    mixer->accum = (float *) SDL_malloc(mixer->frames * 2 * sizeof (float));
+    mixer->scratch = (float *) SDL_malloc(mixer->frames * 2 * sizeof (float));
+    if (!mixer->voices || !mixer->accum || !mixer->scratch) {
+        SDL_FreeAudioMixer(mixer);
+        return SDL_OutOfMemory();
+    }
+    SDL_ChooseMixerFuncs(mixer);
+
+    SDL_LockAudioDevice(devid);
+    mixer->callback = device->spec.callback;
+    mixer->userdata = device->spec.userdata;
+    device->spec.callback = SDL_AudioMixerCallback;
+    device->spec.userdata = mixer;
+    device->mixer = mixer;
+    SDL_UnlockAudioDevice(devid);
+    return 0;
+}
+
+void
+SDL_DetachAudioMixer(SDL_AudioDeviceID devid)
+{
+    SDL_AudioDevice *device = SDL_GetOpenAudioDevice(devid);
+    SDL_AudioMixer *mixer;
+
+    if (!device) {
+        return;
+    }
+
+    SDL_LockAudioDevice(devid);
+    mixer = device->mixer;
+    if (!mixer) {
+        SDL_UnlockAudioDevice(devid);
+        return;
+    }
+    device->spec.callback = mixer->callback;
+    device->spec.userdata = mixer->userdata;
+    device->mixer = NULL;
+    SDL_UnlockAudioDevice(devid);
+
+    SDL_FreeAudioMixer(mixer);
+}
+
+void
+SDL_FreeAudioMixer(SDL_AudioMixer *mixer)
+{
+    int i;
+
+    if (!mixer) {
+        return;
+    }
+    for (i = 0; i < mixer->num_sources; ++i) {
+        if (mixer->sources[i]) {
+            SDL_free(mixer->sources[i]->data);
+            SDL_free(mixer->sources[i]);
+        }
+    }
+    for (i = 0; mixer->voices && i < mixer->num_voices; ++i) {
+        SDL_FreeAudioResampler(mixer->voices[i].resampler);
+    }
+    SDL_free(mixer->sources);
+    SDL_free(mixer->voices);
+    SDL_free(mixer->accum);
+    SDL_free(mixer->scratch);
+    SDL_free(mixer);
+}
+
+int
+SDL_AddMixerSource(SDL_AudioDeviceID devid, const SDL_AudioSpec * spec,
+                   const Uint8 * buf, Uint32 len)
+{
+    SDL_AudioMixer *mixer;
+    SDL_MixerSource *source;
+    SDL_MixerSource **sources;
+    SDL_AudioCVT cvt;
+    int channels, framesize, id;
+
+    if (!spec) {
+        return SDL_InvalidParamError("spec");
+    }
+    if (!buf) {
+        return SDL_InvalidParamError("buf");
+    }
+    if (spec->channels == 0 || spec->freq <= 0) {
+        return SDL_InvalidParamError("spec");
+    }
+    framesize = (SDL_AUDIO_BITSIZE(spec->format) / 8) * spec->channels;
+    if (len == 0 || (len % framesize) != 0 || len > 0x0FFFFFFF) {
+        return SDL_InvalidParamError("len");
+    }
+
+    channels = (spec->channels == 1) ? 1 : 2;
+    if (SDL_BuildAudioCVT(&cvt, spec->format, spec->channels, spec->freq,
+                          AUDIO_F32SYS, channels, spec->freq) < 0) {
+        return -1;
+    }
+    cvt.len = (int) len;
+    cvt.buf = (Uint8 *) SDL_malloc(cvt.len * cvt.len_mult);
+    source = (SDL_MixerSource *) SDL_malloc(sizeof (*source));
+    if (!cvt.buf || !source) {
+        SDL_free(cvt.buf);
+        SDL_free(source);
+        return SDL_OutOfMemory();
+    }
+    SDL_memcpy(cvt.buf, buf, len);
+    if (SDL_ConvertAudio(&cvt) < 0) {
+        SDL_free(cvt.buf);
+        SDL_free(source);
+        return -1;
+    }
+    source->data = (float *) cvt.buf;
+    source->frames = (Uint32) cvt.len_cvt / (channels * sizeof (float));
+    source->channels = channels;
+    source->freq = spec->freq;
+
+    mixer = lock_audio_mixer(devid);
+    if (!mixer) {
+        SDL_free(source->data);
+        SDL_free(source);
+        return -1;
+    }
+    for (id = 0; id < mixer->num_sources; ++id) {
+        if (!mixer->sources[id]) {
+            break;
+        }
+    }
+    if (id == mixer->num_sources) {
+        sources = (SDL_MixerSource **) SDL_realloc(mixer->sources, (id + 1) * sizeof (*sources));
+        if (!sources) {
+            SDL_UnlockAudioDevice(devid);
+            SDL_free(source->data);
+            SDL_free(source);
+            return SDL_OutOfMemory();
+        }
+        mixer->sources = sources;
+        ++mixer->num_sources;
+    }
+    mixer->sources[id] = source;
+    SDL_UnlockAudioDevice(devid);
+
+    return id + 1;
+}
+
+void
+SDL_RemoveMixerSource(SDL_AudioDeviceID devid, int id)
+{
+    SDL_AudioMixer *mixer = lock_audio_mixer(devid);
+    SDL_MixerSource *source;
+    int i;
+
+    if (!mixer) {
+        return;
+    }
+
+    source = get_mixer_source(mixer, id);
+    if (source) {
+        for (i = 0; i < mixer->num_voices; ++i) {
+            SDL_MixerVoice *voice = &mixer->voices[i];
+            if (voice->state != SDL_MIXERVOICE_FREE && voice->source == source) {
+                voice->state = SDL_MIXERVOICE_FREE;
+                voice->source = NULL;
+            }
+        }
+        mixer->sources[id - 1] = NULL;
+    }
+    SDL_UnlockAudioDevice(devid);
+
+    if (source) {
+        SDL_free(source->data);
+        SDL_free(source);
+    }
+}
+
+int
+SDL_PlayMixerVoice(SDL_AudioDeviceID devid, int sourceid, int loop, float gain, float pan)
+{
+    SDL_AudioMixer *mixer;
+    SDL_MixerSource *source;
+    SDL_MixerVoice *voice = NULL;
+    Uint32 generation;
+    int i, id, retval = 0;
+
+    if (!(gain >= 0.0f)) {
+        return SDL_InvalidParamError("gain");
+    }
+    if (!(pan >= -1.0f && pan <= 1.0f)) {
+        return SDL_InvalidParamError("pan");
+    }
+
+    mixer = lock_audio_mixer(devid);
+    if (!mixer) {
+        return -1;
+    }
+    source = get_mixer_source(mixer, sourceid);
+    if (!source) {
+        SDL_UnlockAudioDevice(devid);
+        return -1;
+    }
+    for (i = 0; i < mixer->num_voices; ++i) {
+        if (mixer->voices[i].state == SDL_MIXERVOICE_FREE) {
+            voice = &mixer->voices[i];
+            break;
+        }
+    }
+    if (!voice) {
+        SDL_UnlockAudioDevice(devid);
+        return SDL_SetError("All %d voices are playing", mixer->num_voices);
+    }
+
+    /* Generations go from 1 to 0x7FFF, so IDs are positive */
+    generation = (voice->generation % 0x7FFF) + 1;
+    voice->generation = generation;
+    voice->state = SDL_MIXERVOICE_STARTING;
+    voice->source = source;
+    voice->position = 0;
+    voice->tail = 0;
+    voice->loop = loop ? SDL_TRUE : SDL_FALSE;
+    voice->gain = gain;
+    voice->pan = pan;
+    voice->pitch = 1.0f;
+    voice->resampling = SDL_FALSE;
+    update_voice_gains(voice);
+    id = (int) ((generation << 16) | (i + 1));
+
+    if (change_voice_rate(mixer, voice, voice_rate(voice))) {
+        mixer = resample_voice(devid, mixer, id, &retval);
+        if (!mixer) {
+            return -1;
+        }
+        voice = find_mixer_voice(mixer, id);
+    }
+    if (voice && voice->state == SDL_MIXERVOICE_STARTING) {
+        voice->state = (retval < 0) ? SDL_MIXERVOICE_FREE : SDL_MIXERVOICE_PLAYING;
+    }
+    SDL_UnlockAudioDevice(devid);
+
+    return (retval < 0) ? -1 : id;
+}
+
+int
+SDL_StopMixerVoice(SDL_AudioDeviceID devid, int id)
+{
+    SDL_AudioMixer *mixer = lock_audio_mixer(devid);
+    SDL_MixerVoice *voice;
+
+    if (!mixer) {
+        return -1;
+    }
+
+    voice = get_mixer_voice(mixer, id);
+    if (voice) {
+        voice->state = SDL_MIXERVOICE_FREE;
+        voice->source = NULL;
+    }
+    SDL_UnlockAudioDevice(devid);
+    return voice ? 0 : -1;
+}
+
+SDL_bool
+SDL_IsMixerVoicePlaying(SDL_AudioDeviceID devid, int id)
+{
+    SDL_AudioMixer *mixer = lock_audio_mixer(devid);
+    SDL_MixerVoice *voice;
+    SDL_bool playing = SDL_FALSE;
+
+    if (!mixer) {
+        return SDL_FALSE;
+    }
+
+    voice = get_mixer_voice(mixer, id);
+    if (voice && voice->state != SDL_MIXERVOICE_FREE) {
+        playing = SDL_TRUE;
+    }
+    SDL_UnlockAudioDevice(devid);
+    return playing;
+}
+
+int
+SDL_SetMixerVoiceLoop(SDL_AudioDeviceID devid, int id, int loop)
+{
+    SDL_AudioMixer *mixer = lock_audio_mixer(devid);
+    SDL_MixerVoice *voice;
+
+    if (!mixer) {
+        return -1;
+    }
+
+    voice = get_mixer_voice(mixer, id);
+    if (voice) {
+        voice->loop = loop ? SDL_TRUE : SDL_FALSE;
+    }
+    SDL_UnlockAudioDevice(devid);
+    return voice ? 0 : -1;
+}
+
+int
+SDL_SetMixerVoiceGain(SDL_AudioDeviceID devid, int id, float gain)
+{
+    SDL_AudioMixer *mixer;
+    SDL_MixerVoice *voice;
+
+    if (!(gain >= 0.0f)) {
+        return SDL_InvalidParamError("gain");
+    }
+
+    mixer = lock_audio_mixer(devid);
+    if (!mixer) {
+        return -1;
+    }
+    voice = get_mixer_voice(mixer, id);
+    if (voice) {
+        voice->gain = gain;
+        update_voice_gains(voice);
+    }
+    SDL_UnlockAudioDevice(devid);
+    return voice ? 0 : -1;
+}
+
+int
+SDL_SetMixerVoicePan(SDL_AudioDeviceID devid, int id, float pan)
+{
+    SDL_AudioMixer *mixer;
+    SDL_MixerVoice *voice;
+
+    if (!(pan >= -1.0f && pan <= 1.0f)) {
+        return SDL_InvalidParamError("pan");
+    }
+
+    mixer = lock_audio_mixer(devid);
+    if (!mixer) {
+        return -1;
+    }
+    voice = get_mixer_voice(mixer, id);
+    if (voice) {
+        voice->pan = pan;
+        update_voice_gains(voice);
+    }
+    SDL_UnlockAudioDevice(devid);
+    return voice ? 0 : -1;
+}
+
+int
+SDL_SetMixerVoicePitch(SDL_AudioDeviceID devid, int id, float pitch)
+{
+    SDL_AudioMixer *mixer;
+    SDL_MixerVoice *voice;
+    int retval = -1;
+
+    if (!(pitch > 0.0f && pitch <= SDL_MIXER_MAX_PITCH)) {
+        return SDL_InvalidParamError("pitch");
+    }
+
+    mixer = lock_audio_mixer(devid);
+    if (!mixer) {
+        return -1;
+    }
+    voice = get_mixer_voice(mixer, id);
+    if (voice) {
+        voice->pitch = pitch;
+        retval = 0;
+        if (voice->state != SDL_MIXERVOICE_FREE &&
+            change_voice_rate(mixer, voice, SDL_max(voice_rate(voice), 1))) {
+            mixer = resample_voice(devid, mixer, id, &retval);
+            if (!mixer) {
+                return -1;
+            }
+        }
+    }
+    SDL_UnlockAudioDevice(devid);
+    return retval;
+}
+
+/* vi: set ts=4 sw=4 expandtab: */
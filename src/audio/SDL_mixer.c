@@ -25,6 +25,7 @@
 #include "SDL_cpuinfo.h"
 #include "SDL_timer.h"
 #include "SDL_audio.h"
+#include "SDL_audio_c.h"
 #include "SDL_sysaudio.h"
 
 /* This table is used to add two sound values together and pin
@@ -86,14 +87,343 @@ static const Uint8 mix8[] = {
 #define ADJUST_VOLUME_U8(s, v)  (s = (((s-128)*v)/SDL_MIX_MAXVOLUME)+128)
 
 
+/*
+ * Vectorized mixing for the native byte order 16-bit, 32-bit and float
+ *  formats. They give exactly the same results as the loops below: the
+ *  volume is applied the same way, including C's rounding toward zero,
+ *  then the sum is saturated. They return how many samples they mixed,
+ *  and the loops below take care of the rest.
+ */
+#ifdef __SSE2__
+/* Divide 32-bit products by SDL_MIX_MAXVOLUME, rounding toward zero */
+static SDL_INLINE __m128i
+SDL_MixDivide_SSE2(__m128i x)
+{
+    const __m128i bias = _mm_and_si128(_mm_srai_epi32(x, 31), _mm_set1_epi32(SDL_MIX_MAXVOLUME - 1));
+    return _mm_srai_epi32(_mm_add_epi32(x, bias), 7);
+}
+
+/* There's no saturating 32-bit add, so pick INT_MAX or INT_MIN where
+   both have the same sign and the sum doesn't */
+static SDL_INLINE __m128i
+SDL_MixAdds32_SSE2(__m128i a, __m128i b)
+{
+    const __m128i sum = _mm_add_epi32(a, b);
+    const __m128i overflow = _mm_srai_epi32(_mm_andnot_si128(_mm_xor_si128(a, b), _mm_xor_si128(a, sum)), 31);
+    const __m128i saturated = _mm_xor_si128(_mm_srai_epi32(a, 31), _mm_set1_epi32(0x7FFFFFFF));
+    return _mm_or_si128(_mm_and_si128(overflow, saturated), _mm_andnot_si128(overflow, sum));
+}
+
+static Uint32
+SDL_MixAudio_S16_SSE2(Sint16 *dst, const Sint16 *src, Uint32 num, int volume)
+{
+    const __m128i vol = _mm_set1_epi16((Sint16) volume);
+    Uint32 i = 0;
+
+    if (volume == SDL_MIX_MAXVOLUME) {
+        for (; i + 8 <= num; i += 8) {
+            const __m128i a = _mm_loadu_si128((const __m128i *) &src[i]);
+            const __m128i b = _mm_loadu_si128((const __m128i *) &dst[i]);
+            _mm_storeu_si128((__m128i *) &dst[i], _mm_adds_epi16(a, b));
+        }
+        return i;
+    }
+
+    for (; i + 8 <= num; i += 8) {
+        const __m128i a = _mm_loadu_si128((const __m128i *) &src[i]);
+        const __m128i b = _mm_loadu_si128((const __m128i *) &dst[i]);
+        const __m128i lo = _mm_mullo_epi16(a, vol);
+        const __m128i hi = _mm_mulhi_epi16(a, vol);
+        const __m128i p0 = SDL_MixDivide_SSE2(_mm_unpacklo_epi16(lo, hi));
+        const __m128i p1 = SDL_MixDivide_SSE2(_mm_unpackhi_epi16(lo, hi));
+        _mm_storeu_si128((__m128i *) &dst[i], _mm_adds_epi16(_mm_packs_epi32(p0, p1), b));
+    }
+    return i;
+}
+
+/* The products don't fit in 32 bits, but they have at most 38 significant
+   bits, so doubles hold them exactly and truncating gives C's division */
+static Uint32
+SDL_MixAudio_S32_SSE2(Sint32 *dst, const Sint32 *src, Uint32 num, int volume)
+{
+    const __m128d scale = _mm_set1_pd((double) volume / SDL_MIX_MAXVOLUME);
+    Uint32 i = 0;
+
+    for (; i + 4 <= num; i += 4) {
+        __m128i a = _mm_loadu_si128((const __m128i *) &src[i]);
+        const __m128i b = _mm_loadu_si128((const __m128i *) &dst[i]);
+        if (volume != SDL_MIX_MAXVOLUME) {
+            const __m128i a0 = _mm_cvttpd_epi32(_mm_mul_pd(_mm_cvtepi32_pd(a), scale));
+            const __m128i a1 = _mm_cvttpd_epi32(_mm_mul_pd(_mm_cvtepi32_pd(_mm_srli_si128(a, 8)), scale));
+            a = _mm_unpacklo_epi64(a0, a1);
+        }
+        _mm_storeu_si128((__m128i *) &dst[i], SDL_MixAdds32_SSE2(a, b));
+    }
+    return i;
+}
+
+/* The sum of two floats rounds the same in float as through double, and
+   the clamp only turns overflows into FLT_MAX. The limits go first so NaN
+   comes through like it does in C. */
+static Uint32
+SDL_MixAudio_F32_SSE2(float *dst, const float *src, Uint32 num, int volume)
+{
+    const __m128 fvolume = _mm_set1_ps((float) volume);
+    const __m128 fmaxvolume = _mm_set1_ps(1.0f / ((float) SDL_MIX_MAXVOLUME));
+    const __m128 max_audioval = _mm_set1_ps(3.402823466e+38F);
+    const __m128 min_audioval = _mm_set1_ps(-3.402823466e+38F);
+    Uint32 i = 0;
+
+    for (; i + 4 <= num; i += 4) {
+        __m128 a = _mm_loadu_ps(&src[i]);
+        const __m128 b = _mm_loadu_ps(&dst[i]);
+        if (volume != SDL_MIX_MAXVOLUME) {
+            a = _mm_mul_ps(_mm_mul_ps(a, fvolume), fmaxvolume);
+        }
+        a = _mm_max_ps(min_audioval, _mm_min_ps(max_audioval, _mm_add_ps(a, b)));
+        _mm_storeu_ps(&dst[i], a);
+    }
+    return i;
+}
+#endif /* __SSE2__ */
+
+#if HAVE_AVX2_INTRINSICS
+static SDL_INLINE __m256i SDL_TARGETING_AVX2
+SDL_MixDivide_AVX2(__m256i x)
+{
+    const __m256i bias = _mm256_and_si256(_mm256_srai_epi32(x, 31), _mm256_set1_epi32(SDL_MIX_MAXVOLUME - 1));
+    return _mm256_srai_epi32(_mm256_add_epi32(x, bias), 7);
+}
+
+static SDL_INLINE __m256i SDL_TARGETING_AVX2
+SDL_MixAdds32_AVX2(__m256i a, __m256i b)
+{
+    const __m256i sum = _mm256_add_epi32(a, b);
+    const __m256i overflow = _mm256_andnot_si256(_mm256_xor_si256(a, b), _mm256_xor_si256(a, sum));
+    const __m256i saturated = _mm256_xor_si256(_mm256_srai_epi32(a, 31), _mm256_set1_epi32(0x7FFFFFFF));
+    return _mm256_castps_si256(_mm256_blendv_ps(_mm256_castsi256_ps(sum), _mm256_castsi256_ps(saturated),
+                                                _mm256_castsi256_ps(overflow)));
+}
+
+/* unpacklo/unpackhi and packs all work within 128-bit lanes, so the
+   samples come back out in order */
+static Uint32 SDL_TARGETING_AVX2
+SDL_MixAudio_S16_AVX2(Sint16 *dst, const Sint16 *src, Uint32 num, int volume)
+{
+    const __m256i vol = _mm256_set1_epi16((Sint16) volume);
+    Uint32 i = 0;
+
+    if (volume == SDL_MIX_MAXVOLUME) {
+        for (; i + 16 <= num; i += 16) {
+            const __m256i a = _mm256_loadu_si256((const __m256i *) &src[i]);
+            const __m256i b = _mm256_loadu_si256((const __m256i *) &dst[i]);
+            _mm256_storeu_si256((__m256i *) &dst[i], _mm256_adds_epi16(a, b));
+        }
+        return i;
+    }
+
+    for (; i + 16 <= num; i += 16) {
+        const __m256i a = _mm256_loadu_si256((const __m256i *) &src[i]);
+        const __m256i b = _mm256_loadu_si256((const __m256i *) &dst[i]);
+        const __m256i lo = _mm256_mullo_epi16(a, vol);
+        const __m256i hi = _mm256_mulhi_epi16(a, vol);
+        const __m256i p0 = SDL_MixDivide_AVX2(_mm256_unpacklo_epi16(lo, hi));
+        const __m256i p1 = SDL_MixDivide_AVX2(_mm256_unpackhi_epi16(lo, hi));
+        _mm256_storeu_si256((__m256i *) &dst[i], _mm256_adds_epi16(_mm256_packs_epi32(p0, p1), b));
+    }
+    return i;
+}
+
+static Uint32 SDL_TARGETING_AVX2
+SDL_MixAudio_S32_AVX2(Sint32 *dst, const Sint32 *src, Uint32 num, int volume)
+{
+    const __m256d scale = _mm256_set1_pd((double) volume / SDL_MIX_MAXVOLUME);
+    Uint32 i = 0;
+
+    for (; i + 8 <= num; i += 8) {
+        __m256i a = _mm256_loadu_si256((const __m256i *) &src[i]);
+        const __m256i b = _mm256_loadu_si256((const __m256i *) &dst[i]);
+        if (volume != SDL_MIX_MAXVOLUME) {
+            const __m128i a0 = _mm256_cvttpd_epi32(_mm256_mul_pd(_mm256_cvtepi32_pd(_mm256_castsi256_si128(a)), scale));
+            const __m128i a1 = _mm256_cvttpd_epi32(_mm256_mul_pd(_mm256_cvtepi32_pd(_mm256_extracti128_si256(a, 1)), scale));
+            a = _mm256_inserti128_si256(_mm256_castsi128_si256(a0), a1, 1);
+        }
+        _mm256_storeu_si256((__m256i *) &dst[i], SDL_MixAdds32_AVX2(a, b));
+    }
+    return i;
+}
+
+static Uint32 SDL_TARGETING_AVX2
+SDL_MixAudio_F32_AVX2(float *dst, const float *src, Uint32 num, int volume)
+{
+    const __m256 fvolume = _mm256_set1_ps((float) volume);
+    const __m256 fmaxvolume = _mm256_set1_ps(1.0f / ((float) SDL_MIX_MAXVOLUME));
+    const __m256 max_audioval = _mm256_set1_ps(3.402823466e+38F);
+    const __m256 min_audioval = _mm256_set1_ps(-3.402823466e+38F);
+    Uint32 i = 0;
+
+    for (; i + 8 <= num; i += 8) {
+        __m256 a = _mm256_loadu_ps(&src[i]);
+        const __m256 b = _mm256_loadu_ps(&dst[i]);
+        if (volume != SDL_MIX_MAXVOLUME) {
+            a = _mm256_mul_ps(_mm256_mul_ps(a, fvolume), fmaxvolume);
+        }
+        a = _mm256_max_ps(min_audioval, _mm256_min_ps(max_audioval, _mm256_add_ps(a, b)));
+        _mm256_storeu_ps(&dst[i], a);
+    }
+    return i;
+}
+#endif /* HAVE_AVX2_INTRINSICS */
+
+#if HAVE_NEON_INTRINSICS
+static SDL_INLINE int32x4_t
+SDL_MixDivide_NEON(int32x4_t x)
+{
+    const int32x4_t bias = vandq_s32(vshrq_n_s32(x, 31), vdupq_n_s32(SDL_MIX_MAXVOLUME - 1));
+    return vshrq_n_s32(vaddq_s32(x, bias), 7);
+}
+
+static SDL_INLINE int32x2_t
+SDL_MixDivide64_NEON(int64x2_t x)
+{
+    const int64x2_t bias = vandq_s64(vshrq_n_s64(x, 63), vdupq_n_s64(SDL_MIX_MAXVOLUME - 1));
+    return vmovn_s64(vshrq_n_s64(vaddq_s64(x, bias), 7));
+}
+
+static Uint32
+SDL_MixAudio_S16_NEON(Sint16 *dst, const Sint16 *src, Uint32 num, int volume)
+{
+    const int16x4_t vol = vdup_n_s16((Sint16) volume);
+    Uint32 i = 0;
+
+    if (volume == SDL_MIX_MAXVOLUME) {
+        for (; i + 8 <= num; i += 8) {
+            vst1q_s16(&dst[i], vqaddq_s16(vld1q_s16(&src[i]), vld1q_s16(&dst[i])));
+        }
+        return i;
+    }
+
+    for (; i + 8 <= num; i += 8) {
+        const int16x8_t a = vld1q_s16(&src[i]);
+        const int32x4_t p0 = SDL_MixDivide_NEON(vmull_s16(vget_low_s16(a), vol));
+        const int32x4_t p1 = SDL_MixDivide_NEON(vmull_s16(vget_high_s16(a), vol));
+        const int16x8_t scaled = vcombine_s16(vmovn_s32(p0), vmovn_s32(p1));
+        vst1q_s16(&dst[i], vqaddq_s16(scaled, vld1q_s16(&dst[i])));
+    }
+    return i;
+}
+
+static Uint32
+SDL_MixAudio_S32_NEON(Sint32 *dst, const Sint32 *src, Uint32 num, int volume)
+{
+    const int32x2_t vol = vdup_n_s32(volume);
+    Uint32 i = 0;
+
+    if (volume == SDL_MIX_MAXVOLUME) {
+        for (; i + 4 <= num; i += 4) {
+            vst1q_s32(&dst[i], vqaddq_s32(vld1q_s32(&src[i]), vld1q_s32(&dst[i])));
+        }
+        return i;
+    }
+
+    for (; i + 4 <= num; i += 4) {
+        const int32x4_t a = vld1q_s32(&src[i]);
+        const int32x2_t p0 = SDL_MixDivide64_NEON(vmull_s32(vget_low_s32(a), vol));
+        const int32x2_t p1 = SDL_MixDivide64_NEON(vmull_s32(vget_high_s32(a), vol));
+        vst1q_s32(&dst[i], vqaddq_s32(vcombine_s32(p0, p1), vld1q_s32(&dst[i])));
+    }
+    return i;
+}
+
+static Uint32
+SDL_MixAudio_F32_NEON(float *dst, const float *src, Uint32 num, int volume)
+{
+    const float32x4_t fvolume = vdupq_n_f32((float) volume);
+    const float32x4_t fmaxvolume = vdupq_n_f32(1.0f / ((float) SDL_MIX_MAXVOLUME));
+    const float32x4_t max_audioval = vdupq_n_f32(3.402823466e+38F);
+    const float32x4_t min_audioval = vdupq_n_f32(-3.402823466e+38F);
+    Uint32 i = 0;
+
+    for (; i + 4 <= num; i += 4) {
+        float32x4_t a = vld1q_f32(&src[i]);
+        if (volume != SDL_MIX_MAXVOLUME) {
+            a = vmulq_f32(vmulq_f32(a, fvolume), fmaxvolume);
+        }
+        a = vaddq_f32(a, vld1q_f32(&dst[i]));
+        vst1q_f32(&dst[i], vmaxq_f32(vminq_f32(a, max_audioval), min_audioval));
+    }
+    return i;
+}
+#endif /* HAVE_NEON_INTRINSICS */
+
+/* Returns how many bytes were mixed, 0 if there's no vectorized code for
+   this format or volume */
+static Uint32
+SDL_MixAudioVectorized(Uint8 * dst, const Uint8 * src, SDL_AudioFormat format,
+                       Uint32 len, int volume)
+{
+    Uint32 (*mix16) (Sint16 *, const Sint16 *, Uint32, int) = NULL;
+    Uint32 (*mix32) (Sint32 *, const Sint32 *, Uint32, int) = NULL;
+    Uint32 (*mixf32) (float *, const float *, Uint32, int) = NULL;
+
+    /* Volumes out of range wrap around in the loops below */
+    if (volume < 0 || volume > SDL_MIX_MAXVOLUME) {
+        return 0;
+    }
+
+#if HAVE_AVX2_INTRINSICS
+    if (SDL_HasAVX2()) {
+        mix16 = SDL_MixAudio_S16_AVX2;
+        mix32 = SDL_MixAudio_S32_AVX2;
+        mixf32 = SDL_MixAudio_F32_AVX2;
+    }
+#endif
+#ifdef __SSE2__
+    if (!mix16 && SDL_HasSSE2()) {
+        mix16 = SDL_MixAudio_S16_SSE2;
+        mix32 = SDL_MixAudio_S32_SSE2;
+        mixf32 = SDL_MixAudio_F32_SSE2;
+    }
+#endif
+#if HAVE_NEON_INTRINSICS
+    if (!mix16) {
+        mix16 = SDL_MixAudio_S16_NEON;
+        mix32 = SDL_MixAudio_S32_NEON;
+        mixf32 = SDL_MixAudio_F32_NEON;
+    }
+#endif
+    if (!mix16) {
+        return 0;
+    }
+
+    switch (format) {
+    case AUDIO_S16SYS:
+        return mix16((Sint16 *) dst, (const Sint16 *) src, len / 2, volume) * 2;
+    case AUDIO_S32SYS:
+        return mix32((Sint32 *) dst, (const Sint32 *) src, len / 4, volume) * 4;
+    case AUDIO_F32SYS:
+        return mixf32((float *) dst, (const float *) src, len / 4, volume) * 4;
+    default:
+        return 0;
+    }
+}
+
+
 void
 SDL_MixAudioFormat(Uint8 * dst, const Uint8 * src, SDL_AudioFormat format,
                    Uint32 len, int volume)
 {
+    Uint32 mixed;
+
     if (volume == 0) {
         return;
     }
 
+    mixed = SDL_MixAudioVectorized(dst, src, format, len, volume);
+    dst += mixed;
+    src += mixed;
+    len -= mixed;
+
     switch (format) {
 
     case AUDIO_U8:
@@ -153,7 +483,9 @@ SDL_MixAudioFormat(Uint8 * dst, const Uint8 * src, SDL_AudioFormat format,
             len /= 2;
             while (len--) {
                 src1 = ((src[1]) << 8 | src[0]);
-                ADJUST_VOLUME(src1, volume);
+                if (volume != SDL_MIX_MAXVOLUME) {
+                    ADJUST_VOLUME(src1, volume);
+                }
                 src2 = ((dst[1]) << 8 | dst[0]);
                 src += 2;
                 dst_sample = src1 + src2;
@@ -184,7 +516,9 @@ SDL_MixAudioFormat(Uint8 * dst, const Uint8 * src, SDL_AudioFormat format,
             len /= 2;
             while (len--) {
                 src1 = ((src[0]) << 8 | src[1]);
-                ADJUST_VOLUME(src1, volume);
+                if (volume != SDL_MIX_MAXVOLUME) {
+                    ADJUST_VOLUME(src1, volume);
+                }
                 src2 = ((dst[0]) << 8 | dst[1]);
                 src += 2;
                 dst_sample = src1 + src2;
@@ -215,7 +549,9 @@ SDL_MixAudioFormat(Uint8 * dst, const Uint8 * src, SDL_AudioFormat format,
             while (len--) {
                 src1 = (Sint64) ((Sint32) SDL_SwapLE32(*src32));
                 src32++;
-                ADJUST_VOLUME(src1, volume);
+                if (volume != SDL_MIX_MAXVOLUME) {
+                    ADJUST_VOLUME(src1, volume);
+                }
                 src2 = (Sint64) ((Sint32) SDL_SwapLE32(*dst32));
                 dst_sample = src1 + src2;
                 if (dst_sample > max_audioval) {
@@ -241,7 +577,9 @@ SDL_MixAudioFormat(Uint8 * dst, const Uint8 * src, SDL_AudioFormat format,
             while (len--) {
                 src1 = (Sint64) ((Sint32) SDL_SwapBE32(*src32));
                 src32++;
-                ADJUST_VOLUME(src1, volume);
+                if (volume != SDL_MIX_MAXVOLUME) {
+                    ADJUST_VOLUME(src1, volume);
+                }
                 src2 = (Sint64) ((Sint32) SDL_SwapBE32(*dst32));
                 dst_sample = src1 + src2;
                 if (dst_sample > max_audioval) {
@@ -268,7 +606,10 @@ SDL_MixAudioFormat(Uint8 * dst, const Uint8 * src, SDL_AudioFormat format,
 
             len /= 4;
             while (len--) {
-                src1 = ((SDL_SwapFloatLE(*src32) * fvolume) * fmaxvolume);
+                src1 = SDL_SwapFloatLE(*src32);
+                if (volume != SDL_MIX_MAXVOLUME) {
+                    src1 = (src1 * fvolume) * fmaxvolume;
+                }
                 src2 = SDL_SwapFloatLE(*dst32);
                 src32++;
 
@@ -297,7 +638,10 @@ SDL_MixAudioFormat(Uint8 * dst, const Uint8 * src, SDL_AudioFormat format,
 
             len /= 4;
             while (len--) {
-                src1 = ((SDL_SwapFloatBE(*src32) * fvolume) * fmaxvolume);
+                src1 = SDL_SwapFloatBE(*src32);
+                if (volume != SDL_MIX_MAXVOLUME) {
+                    src1 = (src1 * fvolume) * fmaxvolume;
+                }
                 src2 = SDL_SwapFloatBE(*dst32);
                 src32++;
 
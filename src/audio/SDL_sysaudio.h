@@ -23,6 +23,7 @@
 #ifndef _SDL_sysaudio_h
 #define _SDL_sysaudio_h
 
+#include "SDL_atomic.h"
 #include "SDL_mutex.h"
 #include "SDL_thread.h"
 
@@ -46,25 +47,58 @@ extern void SDL_RemoveAudioDevice(const int iscapture, void *handle);
 extern void SDL_OpenedAudioDeviceDisconnected(SDL_AudioDevice *device);
 
 
-/* This is the size of a packet when using SDL_QueueAudio(). We allocate
-   these as necessary and pool them, under the assumption that we'll
-   eventually end up with a handful that keep recycling, meeting whatever
-   the app needs. We keep packing data tightly as more arrives to avoid
-   wasting space, and if we get a giant block of data, we'll split them
-   into multiple packets behind the scenes. My expectation is that most
-   apps will have 2-3 of these in the pool. 8k should cover most needs, but
-   if this is crippling for some embedded system, we can #ifdef this.
-   The system preallocates enough packets for 2 callbacks' worth of data. */
-#define SDL_AUDIOBUFFERQUEUE_PACKETLEN (8 * 1024)
+/* Audio backends call this when the device reports that it ran out of
+   audio to play. It shows up in SDL_GetAudioDeviceStats(). */
+extern void SDL_AudioDeviceUnderrun(SDL_AudioDevice *device);
+
+/* The open output or capture device with this ID, or NULL with the error
+   set if there isn't one. */
+extern SDL_AudioDevice *SDL_GetOpenAudioDevice(SDL_AudioDeviceID id);
+
+/* Frees the voice mixer attached with SDL_AttachAudioMixer(), once the
+   device's callback can't run anymore. */
+struct SDL_AudioMixer;
+extern void SDL_FreeAudioMixer(struct SDL_AudioMixer *mixer);
+
+/* Callback times are kept in buckets 1/8 of a power of two wide, so the
+   99th percentile is known to about 10% */
+#define SDL_AUDIOSTATS_BUCKETS (30 * 8)
+
+/* Timing of the device thread, in microseconds. */
+typedef struct SDL_AudioTimingStats
+{
+    Uint32 buffers;
+    Uint64 callback_total;
+    Uint32 callback_min;
+    Uint32 callback_max;
+    Uint64 convert_total;
+    Uint32 convert_max;
+    Uint64 wait_total;
+    Uint32 wait_max;
+    Uint32 waits;
+    Uint32 late_buffers;
+    Uint32 dropped_buffers;
+    Uint32 underruns;
+    Uint32 latency;
+    Uint32 histogram[SDL_AUDIOSTATS_BUCKETS];
+} SDL_AudioTimingStats;
+
+/* This is the smallest ring for SDL_QueueAudio(). The system starts with
+   one big enough for 2 callbacks' worth of data, and when the app queues
+   more than fits, writes move on to a new ring twice as big (or bigger, for
+   a giant block of data) while the audio thread finishes the old one. The
+   app's thread frees rings the audio thread is done with, so the audio
+   thread never waits on it, allocates or frees. */
+#define SDL_AUDIOQUEUE_MINRING (8 * 1024)
 
 /* Used by apps that queue audio instead of using the callback. */
-typedef struct SDL_AudioBufferQueue
+typedef struct SDL_AudioQueueRing
 {
-    Uint8 data[SDL_AUDIOBUFFERQUEUE_PACKETLEN];  /* packet data. */
-    Uint32 datalen;  /* bytes currently in use in this packet. */
-    Uint32 startpos;  /* bytes currently consumed in this packet. */
-    struct SDL_AudioBufferQueue *next;  /* next item in linked list. */
-} SDL_AudioBufferQueue;
+    Uint8 *data;  /* ring data, right after this struct. */
+    Uint32 size;  /* a power of two. */
+    Uint32 start;  /* queue position of the first byte written here. */
+    void *next;  /* ring that writes moved on to; set atomically. */
+} SDL_AudioQueueRing;
 
 typedef struct SDL_AudioDriverImpl
 {
@@ -149,6 +183,9 @@ struct SDL_AudioDevice
     /* The current audio specification (shared with audio thread) */
     SDL_AudioSpec spec;
 
+    /* The format the app asked for, which the callback is given */
+    SDL_AudioSpec callbackspec;
+
     /* An audio conversion block for audio format emulation */
     SDL_AudioCVT convert;
 
@@ -156,6 +193,9 @@ struct SDL_AudioDevice
     int use_streamer;
     SDL_AudioStreamer streamer;
 
+    /* Converts the callback's audio, unless the driver runs the callback */
+    SDL_AudioStream *stream;
+
     /* Current state flags */
     /* !!! FIXME: should be SDL_bool */
     int iscapture;
@@ -174,11 +214,23 @@ struct SDL_AudioDevice
     SDL_Thread *thread;
     SDL_threadID threadid;
 
-    /* Queued buffers (if app not using callback). */
-    SDL_AudioBufferQueue *buffer_queue_head; /* device fed from here. */
-    SDL_AudioBufferQueue *buffer_queue_tail; /* queue fills to here. */
-    SDL_AudioBufferQueue *buffer_queue_pool; /* these are unused packets. */
-    Uint32 queued_bytes;  /* number of bytes of audio data in the queue. */
+    /* Queued audio (if app not using callback). Positions count bytes
+       queued since the device opened, wrapping around. */
+    SDL_mutex *queue_lock;  /* between queueing threads; device never takes it. */
+    void *queue_read_ring;  /* device fed from here; set atomically. */
+    SDL_AudioQueueRing *queue_write_ring;  /* queue fills here. */
+    SDL_AudioQueueRing *queue_oldest_ring;  /* freed up to queue_read_ring. */
+    SDL_atomic_t queue_read;  /* position the device has played up to. */
+    SDL_atomic_t queue_write;  /* position the queue has been filled up to. */
+    SDL_atomic_t queue_discard;  /* SDL_ClearQueuedAudio() skips up to here. */
+
+    /* Timing stats, for SDL_GetAudioDeviceStats(). */
+    SDL_SpinLock stats_lock;
+    SDL_AudioTimingStats stats;
+    Uint32 stats_log_interval;  /* ms between logging them, 0 to not. */
+
+    /* Voice mixer that has taken over the callback, if any. */
+    struct SDL_AudioMixer *mixer;
 
     /* * * */
     /* Data private to this driver */
@@ -28,381 +28,427 @@
 
 static int ReadChunk(SDL_RWops * src, Chunk * chunk);
 
-struct MS_ADPCM_decodestate
-{
-    Uint8 hPredictor;
-    Uint16 iDelta;
-    Sint16 iSamp1;
-    Sint16 iSamp2;
+/* Output samples are stored little-endian, like the PCM data in the file */
+#define PUT_SAMPLE16(dst, sample) \
+    do { (dst)[0] = (Uint8) (sample); (dst)[1] = (Uint8) ((sample) >> 8); } while (0)
+
+/* The MS ADPCM and IMA ADPCM decoders work on one block at a time, so the
+   same code serves SDL_LoadWAV_RW() and SDL_WaveStream. Each channel is a
+   recurrence on the sample before it, so there's nothing for SIMD to work
+   on; instead a channel's state is kept in locals while a block decodes,
+   and the nibble math is done without branches. */
+
+static const Sint32 MS_ADPCM_adaptive[16] = {
+    230, 230, 230, 230, 307, 409, 512, 614,
+    768, 614, 512, 409, 307, 230, 230, 230
 };
-static struct MS_ADPCM_decoder
+
+typedef struct MS_ADPCM_ChannelState
 {
-    WaveFMT wavefmt;
-    Uint16 wSamplesPerBlock;
-    Uint16 wNumCoef;
-    Sint16 aCoeff[7][2];
-    /* * * */
-    struct MS_ADPCM_decodestate state[2];
-} MS_ADPCM_state;
+    Sint32 coeff1;
+    Sint32 coeff2;
+    Sint32 delta;
+    Sint32 sample1;
+    Sint32 sample2;
+} MS_ADPCM_ChannelState;
 
 static int
-InitMS_ADPCM(WaveFMT * format)
+InitMS_ADPCM(WaveDecoder * decoder, const Uint8 * extra, Uint32 extralen)
 {
-    Uint8 *rogue_feel;
+    Uint16 numcoef;
     int i;
 
-    /* Set the rogue pointer to the MS_ADPCM specific data */
-    MS_ADPCM_state.wavefmt.encoding = SDL_SwapLE16(format->encoding);
-    MS_ADPCM_state.wavefmt.channels = SDL_SwapLE16(format->channels);
-    MS_ADPCM_state.wavefmt.frequency = SDL_SwapLE32(format->frequency);
-    MS_ADPCM_state.wavefmt.byterate = SDL_SwapLE32(format->byterate);
-    MS_ADPCM_state.wavefmt.blockalign = SDL_SwapLE16(format->blockalign);
-    MS_ADPCM_state.wavefmt.bitspersample =
-        SDL_SwapLE16(format->bitspersample);
-    rogue_feel = (Uint8 *) format + sizeof(*format);
-    if (sizeof(*format) == 16) {
-        /* const Uint16 extra_info = ((rogue_feel[1] << 8) | rogue_feel[0]); */
-        rogue_feel += sizeof(Uint16);
-    }
-    MS_ADPCM_state.wSamplesPerBlock = ((rogue_feel[1] << 8) | rogue_feel[0]);
-    rogue_feel += sizeof(Uint16);
-    MS_ADPCM_state.wNumCoef = ((rogue_feel[1] << 8) | rogue_feel[0]);
-    rogue_feel += sizeof(Uint16);
-    if (MS_ADPCM_state.wNumCoef != 7) {
-        SDL_SetError("Unknown set of MS_ADPCM coefficients");
-        return (-1);
+    /* Skip the size of the extra information */
+    if (extralen < 3 * sizeof(Uint16)) {
+        return SDL_SetError("Invalid MS_ADPCM format chunk");
     }
-    for (i = 0; i < MS_ADPCM_state.wNumCoef; ++i) {
-        MS_ADPCM_state.aCoeff[i][0] = ((rogue_feel[1] << 8) | rogue_feel[0]);
-        rogue_feel += sizeof(Uint16);
-        MS_ADPCM_state.aCoeff[i][1] = ((rogue_feel[1] << 8) | rogue_feel[0]);
-        rogue_feel += sizeof(Uint16);
+    decoder->blockframes = ((extra[3] << 8) | extra[2]);
+    numcoef = ((extra[5] << 8) | extra[4]);
+    extra += 3 * sizeof(Uint16);
+    extralen -= 3 * sizeof(Uint16);
+    if (numcoef != SDL_arraysize(decoder->coeff) ||
+        extralen < sizeof(decoder->coeff)) {
+        return SDL_SetError("Unknown set of MS_ADPCM coefficients");
+    }
+    for (i = 0; i < numcoef; ++i) {
+        decoder->coeff[i][0] = ((extra[1] << 8) | extra[0]);
+        decoder->coeff[i][1] = ((extra[3] << 8) | extra[2]);
+        extra += 2 * sizeof(Sint16);
+    }
+
+    /* A block header holds 7 bytes and two samples per channel,
+       and the rest of the block holds 2 samples per byte */
+    if (decoder->channels > 2 || decoder->blockframes < 2 ||
+        decoder->blockalign < 7 * decoder->channels +
+        ((decoder->blockframes - 2) * decoder->channels + 1) / 2) {
+        return SDL_SetError("Invalid MS_ADPCM block size");
     }
     return (0);
 }
 
-static Sint32
-MS_ADPCM_nibble(struct MS_ADPCM_decodestate *state,
-                Uint8 nybble, Sint16 * coeff)
+static SDL_INLINE Sint32
+MS_ADPCM_nibble(MS_ADPCM_ChannelState * state, Uint32 nybble)
 {
     const Sint32 max_audioval = ((1 << (16 - 1)) - 1);
     const Sint32 min_audioval = -(1 << (16 - 1));
-    const Sint32 adaptive[] = {
-        230, 230, 230, 230, 307, 409, 512, 614,
-        768, 614, 512, 409, 307, 230, 230, 230
-    };
     Sint32 new_sample, delta;
 
-    new_sample = ((state->iSamp1 * coeff[0]) +
-                  (state->iSamp2 * coeff[1])) / 256;
-    if (nybble & 0x08) {
-        new_sample += state->iDelta * (nybble - 0x10);
-    } else {
-        new_sample += state->iDelta * nybble;
-    }
-    if (new_sample < min_audioval) {
-        new_sample = min_audioval;
-    } else if (new_sample > max_audioval) {
-        new_sample = max_audioval;
-    }
-    delta = ((Sint32) state->iDelta * adaptive[nybble]) / 256;
-    if (delta < 16) {
-        delta = 16;
-    }
-    state->iDelta = (Uint16) delta;
-    state->iSamp2 = state->iSamp1;
-    state->iSamp1 = (Sint16) new_sample;
+    new_sample = ((state->sample1 * state->coeff1) +
+                  (state->sample2 * state->coeff2)) / 256;
+    new_sample += state->delta * (((Sint32) nybble ^ 8) - 8);
+    new_sample = SDL_max(new_sample, min_audioval);
+    new_sample = SDL_min(new_sample, max_audioval);
+
+    delta = (state->delta * MS_ADPCM_adaptive[nybble]) >> 8;
+    state->delta = (Uint16) SDL_max(delta, 16);
+    state->sample2 = state->sample1;
+    state->sample1 = new_sample;
     return (new_sample);
 }
 
 static int
-MS_ADPCM_decode(Uint8 ** audio_buf, Uint32 * audio_len)
+MS_ADPCM_DecodeBlock(const WaveDecoder * decoder, const Uint8 * encoded,
+                     Uint8 * decoded)
 {
-    struct MS_ADPCM_decodestate *state[2];
-    Uint8 *freeable, *encoded, *decoded;
-    Sint32 encoded_len, samplesleft;
-    Sint8 nybble;
-    Uint8 stereo;
-    Sint16 *coeff[2];
-    Sint32 new_sample;
-
-    /* Allocate the proper sized output buffer */
-    encoded_len = *audio_len;
-    encoded = *audio_buf;
-    freeable = *audio_buf;
-    *audio_len = (encoded_len / MS_ADPCM_state.wavefmt.blockalign) *
-        MS_ADPCM_state.wSamplesPerBlock *
-        MS_ADPCM_state.wavefmt.channels * sizeof(Sint16);
-    *audio_buf = (Uint8 *) SDL_malloc(*audio_len);
-    if (*audio_buf == NULL) {
-        return SDL_OutOfMemory();
-    }
-    decoded = *audio_buf;
-
-    /* Get ready... Go! */
-    stereo = (MS_ADPCM_state.wavefmt.channels == 2);
-    state[0] = &MS_ADPCM_state.state[0];
-    state[1] = &MS_ADPCM_state.state[stereo];
-    while (encoded_len >= MS_ADPCM_state.wavefmt.blockalign) {
-        /* Grab the initial information for this block */
-        state[0]->hPredictor = *encoded++;
-        if (stereo) {
-            state[1]->hPredictor = *encoded++;
-        }
-        state[0]->iDelta = ((encoded[1] << 8) | encoded[0]);
-        encoded += sizeof(Sint16);
-        if (stereo) {
-            state[1]->iDelta = ((encoded[1] << 8) | encoded[0]);
-            encoded += sizeof(Sint16);
-        }
-        state[0]->iSamp1 = ((encoded[1] << 8) | encoded[0]);
-        encoded += sizeof(Sint16);
-        if (stereo) {
-            state[1]->iSamp1 = ((encoded[1] << 8) | encoded[0]);
-            encoded += sizeof(Sint16);
-        }
-        state[0]->iSamp2 = ((encoded[1] << 8) | encoded[0]);
-        encoded += sizeof(Sint16);
-        if (stereo) {
-            state[1]->iSamp2 = ((encoded[1] << 8) | encoded[0]);
-            encoded += sizeof(Sint16);
+    const int channels = decoder->channels;
+    MS_ADPCM_ChannelState state[2];
+    MS_ADPCM_ChannelState left, right;
+    Uint32 nybbles;
+    Sint32 sample;
+    int c;
+
+    /* Grab the initial information for this block */
+    for (c = 0; c < channels; ++c) {
+        const Uint8 predictor = encoded[c];
+        const Uint8 *delta = &encoded[channels + 2 * c];
+        const Uint8 *sample1 = &encoded[3 * channels + 2 * c];
+        const Uint8 *sample2 = &encoded[5 * channels + 2 * c];
+
+        if (predictor >= SDL_arraysize(decoder->coeff)) {
+            return SDL_SetError("Invalid MS_ADPCM predictor");
         }
-        coeff[0] = MS_ADPCM_state.aCoeff[state[0]->hPredictor];
-        coeff[1] = MS_ADPCM_state.aCoeff[state[1]->hPredictor];
+        state[c].coeff1 = decoder->coeff[predictor][0];
+        state[c].coeff2 = decoder->coeff[predictor][1];
+        state[c].delta = ((delta[1] << 8) | delta[0]);
+        state[c].sample1 = (Sint16) ((sample1[1] << 8) | sample1[0]);
+        state[c].sample2 = (Sint16) ((sample2[1] << 8) | sample2[0]);
+    }
+    encoded += 7 * channels;
 
-        /* Store the two initial samples we start with */
-        decoded[0] = state[0]->iSamp2 & 0xFF;
-        decoded[1] = state[0]->iSamp2 >> 8;
+    /* Store the two initial samples we start with */
+    for (c = 0; c < channels; ++c) {
+        PUT_SAMPLE16(decoded, state[c].sample2);
         decoded += 2;
-        if (stereo) {
-            decoded[0] = state[1]->iSamp2 & 0xFF;
-            decoded[1] = state[1]->iSamp2 >> 8;
-            decoded += 2;
-        }
-        decoded[0] = state[0]->iSamp1 & 0xFF;
-        decoded[1] = state[0]->iSamp1 >> 8;
+    }
+    for (c = 0; c < channels; ++c) {
+        PUT_SAMPLE16(decoded, state[c].sample1);
         decoded += 2;
-        if (stereo) {
-            decoded[0] = state[1]->iSamp1 & 0xFF;
-            decoded[1] = state[1]->iSamp1 >> 8;
-            decoded += 2;
-        }
+    }
 
-        /* Decode and store the other samples in this block */
-        samplesleft = (MS_ADPCM_state.wSamplesPerBlock - 2) *
-            MS_ADPCM_state.wavefmt.channels;
-        while (samplesleft > 0) {
-            nybble = (*encoded) >> 4;
-            new_sample = MS_ADPCM_nibble(state[0], nybble, coeff[0]);
-            decoded[0] = new_sample & 0xFF;
-            new_sample >>= 8;
-            decoded[1] = new_sample & 0xFF;
-            decoded += 2;
-
-            nybble = (*encoded) & 0x0F;
-            new_sample = MS_ADPCM_nibble(state[1], nybble, coeff[1]);
-            decoded[0] = new_sample & 0xFF;
-            new_sample >>= 8;
-            decoded[1] = new_sample & 0xFF;
-            decoded += 2;
-
-            ++encoded;
-            samplesleft -= 2;
+    /* Decode and store the other samples in this block, the high nibble
+       of each byte first; in stereo that's the left channel */
+    nybbles = (decoder->blockframes - 2) * channels;
+    if (channels == 2) {
+        left = state[0];
+        right = state[1];
+        for (; nybbles >= 2; nybbles -= 2) {
+            const Uint32 byte = *encoded++;
+            sample = MS_ADPCM_nibble(&left, byte >> 4);
+            PUT_SAMPLE16(decoded, sample);
+            sample = MS_ADPCM_nibble(&right, byte & 0x0F);
+            PUT_SAMPLE16(decoded + 2, sample);
+            decoded += 4;
+        }
+    } else {
+        left = state[0];
+        for (; nybbles >= 2; nybbles -= 2) {
+            const Uint32 byte = *encoded++;
+            sample = MS_ADPCM_nibble(&left, byte >> 4);
+            PUT_SAMPLE16(decoded, sample);
+            sample = MS_ADPCM_nibble(&left, byte & 0x0F);
+            PUT_SAMPLE16(decoded + 2, sample);
+            decoded += 4;
+        }
+        if (nybbles) {
+            sample = MS_ADPCM_nibble(&left, *encoded >> 4);
+            PUT_SAMPLE16(decoded, sample);
         }
-        encoded_len -= MS_ADPCM_state.wavefmt.blockalign;
     }
-    SDL_free(freeable);
     return (0);
 }
 
-struct IMA_ADPCM_decodestate
-{
-    Sint32 sample;
-    Sint8 index;
+static const Sint8 IMA_ADPCM_index_table[16] = {
+    -1, -1, -1, -1,
+    2, 4, 6, 8,
+    -1, -1, -1, -1,
+    2, 4, 6, 8
+};
+
+static const Sint32 IMA_ADPCM_step_table[89] = {
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31,
+    34, 37, 41, 45, 50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130,
+    143, 157, 173, 190, 209, 230, 253, 279, 307, 337, 371, 408,
+    449, 494, 544, 598, 658, 724, 796, 876, 963, 1060, 1166, 1282,
+    1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327,
+    3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630,
+    9493, 10442, 11487, 12635, 13899, 15289, 16818, 18500, 20350,
+    22385, 24623, 27086, 29794, 32767
 };
-static struct IMA_ADPCM_decoder
+
+typedef struct IMA_ADPCM_ChannelState
 {
-    WaveFMT wavefmt;
-    Uint16 wSamplesPerBlock;
-    /* * * */
-    struct IMA_ADPCM_decodestate state[2];
-} IMA_ADPCM_state;
+    Sint32 sample;
+    Sint32 index;
+} IMA_ADPCM_ChannelState;
 
 static int
-InitIMA_ADPCM(WaveFMT * format)
+InitIMA_ADPCM(WaveDecoder * decoder, const Uint8 * extra, Uint32 extralen)
 {
-    Uint8 *rogue_feel;
-
-    /* Set the rogue pointer to the IMA_ADPCM specific data */
-    IMA_ADPCM_state.wavefmt.encoding = SDL_SwapLE16(format->encoding);
-    IMA_ADPCM_state.wavefmt.channels = SDL_SwapLE16(format->channels);
-    IMA_ADPCM_state.wavefmt.frequency = SDL_SwapLE32(format->frequency);
-    IMA_ADPCM_state.wavefmt.byterate = SDL_SwapLE32(format->byterate);
-    IMA_ADPCM_state.wavefmt.blockalign = SDL_SwapLE16(format->blockalign);
-    IMA_ADPCM_state.wavefmt.bitspersample =
-        SDL_SwapLE16(format->bitspersample);
-    rogue_feel = (Uint8 *) format + sizeof(*format);
-    if (sizeof(*format) == 16) {
-        /* const Uint16 extra_info = ((rogue_feel[1] << 8) | rogue_feel[0]); */
-        rogue_feel += sizeof(Uint16);
-    }
-    IMA_ADPCM_state.wSamplesPerBlock = ((rogue_feel[1] << 8) | rogue_feel[0]);
+    Uint32 groups;
+
+    /* Skip the size of the extra information */
+    if (extralen < 2 * sizeof(Uint16)) {
+        return SDL_SetError("Invalid IMA ADPCM format chunk");
+    }
+    decoder->blockframes = ((extra[3] << 8) | extra[2]);
+
+    if (decoder->channels > 2) {
+        return SDL_SetError("IMA ADPCM decoder can only handle %u channels",
+                            2);
+    }
+
+    /* A block header holds 4 bytes per channel, including the first
+       sample, and then each channel has 4 bytes for every 8 samples */
+    groups = ((Uint32) decoder->blockframes - 1) / 8;
+    if (decoder->blockframes == 0 || (decoder->blockframes - 1) % 8 != 0 ||
+        decoder->blockalign < 4 * decoder->channels * (1 + groups)) {
+        return SDL_SetError("Invalid IMA ADPCM block size");
+    }
     return (0);
 }
 
-static Sint32
-IMA_ADPCM_nibble(struct IMA_ADPCM_decodestate *state, Uint8 nybble)
+static SDL_INLINE Sint32
+IMA_ADPCM_nibble(IMA_ADPCM_ChannelState * state, Uint32 nybble)
 {
     const Sint32 max_audioval = ((1 << (16 - 1)) - 1);
     const Sint32 min_audioval = -(1 << (16 - 1));
-    const int index_table[16] = {
-        -1, -1, -1, -1,
-        2, 4, 6, 8,
-        -1, -1, -1, -1,
-        2, 4, 6, 8
-    };
-    const Sint32 step_table[89] = {
-        7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31,
-        34, 37, 41, 45, 50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130,
-        143, 157, 173, 190, 209, 230, 253, 279, 307, 337, 371, 408,
-        449, 494, 544, 598, 658, 724, 796, 876, 963, 1060, 1166, 1282,
-        1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327,
-        3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630,
-        9493, 10442, 11487, 12635, 13899, 15289, 16818, 18500, 20350,
-        22385, 24623, 27086, 29794, 32767
-    };
-    Sint32 delta, step;
+    const Sint32 step = IMA_ADPCM_step_table[state->index];
+    const Sint32 sign = -(Sint32) (nybble >> 3);
+    Sint32 delta, sample, index;
 
     /* Compute difference and new sample value */
-    if (state->index > 88) {
-        state->index = 88;
-    } else if (state->index < 0) {
-        state->index = 0;
-    }
-    /* explicit cast to avoid gcc warning about using 'char' as array index */
-    step = step_table[(int)state->index];
     delta = step >> 3;
-    if (nybble & 0x04)
-        delta += step;
-    if (nybble & 0x02)
-        delta += (step >> 1);
-    if (nybble & 0x01)
-        delta += (step >> 2);
-    if (nybble & 0x08)
-        delta = -delta;
-    state->sample += delta;
+    delta += step & -(Sint32) ((nybble >> 2) & 1);
+    delta += (step >> 1) & -(Sint32) ((nybble >> 1) & 1);
+    delta += (step >> 2) & -(Sint32) (nybble & 1);
+    sample = state->sample + ((delta ^ sign) - sign);
+    sample = SDL_max(sample, min_audioval);
+    state->sample = SDL_min(sample, max_audioval);
 
     /* Update index value */
-    state->index += index_table[nybble];
+    index = state->index + IMA_ADPCM_index_table[nybble];
+    index = SDL_max(index, 0);
+    state->index = SDL_min(index, 88);
+    return (state->sample);
+}
 
-    /* Clamp output sample */
-    if (state->sample > max_audioval) {
-        state->sample = max_audioval;
-    } else if (state->sample < min_audioval) {
-        state->sample = min_audioval;
+static int
+IMA_ADPCM_DecodeBlock(const WaveDecoder * decoder, const Uint8 * encoded,
+                      Uint8 * decoded)
+{
+    const int channels = decoder->channels;
+    const Uint32 framesize = decoder->framesize;
+    const Uint32 groups = ((Uint32) decoder->blockframes - 1) / 8;
+    IMA_ADPCM_ChannelState state;
+    Sint32 sample;
+    Uint32 i;
+    int c, j;
+
+    /* Each channel decodes on its own, so run through a whole block of
+       one channel before the next */
+    for (c = 0; c < channels; ++c) {
+        const Uint8 *header = &encoded[4 * c];
+        const Uint8 *data = &encoded[4 * channels + 4 * c];
+        Uint8 *dst = decoded + 2 * c;
+
+        /* Fill the state information for this block, the reserved byte
+           in the header should be 0 but nothing depends on it */
+        state.sample = (Sint16) ((header[1] << 8) | header[0]);
+        state.index = (Sint8) header[2];
+        state.index = SDL_max(state.index, 0);
+        state.index = SDL_min(state.index, 88);
+
+        /* Store the initial sample we start with */
+        PUT_SAMPLE16(dst, state.sample);
+        dst += framesize;
+
+        /* Decode and store the other samples, 8 at a time, the low
+           nibble of each byte first */
+        for (i = 0; i < groups; ++i) {
+            for (j = 0; j < 4; ++j) {
+                const Uint32 byte = data[j];
+                sample = IMA_ADPCM_nibble(&state, byte & 0x0F);
+                PUT_SAMPLE16(dst, sample);
+                dst += framesize;
+                sample = IMA_ADPCM_nibble(&state, byte >> 4);
+                PUT_SAMPLE16(dst, sample);
+                dst += framesize;
+            }
+            data += 4 * channels;
+        }
     }
-    return (state->sample);
+    return (0);
 }
 
-/* Fill the decode buffer with a channel block of data (8 samples) */
-static void
-Fill_IMA_ADPCM_block(Uint8 * decoded, Uint8 * encoded,
-                     int channel, int numchannels,
-                     struct IMA_ADPCM_decodestate *state)
+static int
+DecodeWaveBlock(const WaveDecoder * decoder, const Uint8 * encoded,
+                Uint8 * decoded)
 {
-    int i;
-    Sint8 nybble;
-    Sint32 new_sample;
-
-    decoded += (channel * 2);
-    for (i = 0; i < 4; ++i) {
-        nybble = (*encoded) & 0x0F;
-        new_sample = IMA_ADPCM_nibble(state, nybble);
-        decoded[0] = new_sample & 0xFF;
-        new_sample >>= 8;
-        decoded[1] = new_sample & 0xFF;
-        decoded += 2 * numchannels;
-
-        nybble = (*encoded) >> 4;
-        new_sample = IMA_ADPCM_nibble(state, nybble);
-        decoded[0] = new_sample & 0xFF;
-        new_sample >>= 8;
-        decoded[1] = new_sample & 0xFF;
-        decoded += 2 * numchannels;
-
-        ++encoded;
+    if (decoder->encoding == MS_ADPCM_CODE) {
+        return MS_ADPCM_DecodeBlock(decoder, encoded, decoded);
+    } else {
+        return IMA_ADPCM_DecodeBlock(decoder, encoded, decoded);
     }
 }
 
+/* Decode a whole ADPCM data chunk, replacing the encoded data */
 static int
-IMA_ADPCM_decode(Uint8 ** audio_buf, Uint32 * audio_len)
+DecodeWaveData(const WaveDecoder * decoder, Uint8 ** audio_buf,
+               Uint32 * audio_len)
 {
-    struct IMA_ADPCM_decodestate *state;
-    Uint8 *freeable, *encoded, *decoded;
-    Sint32 encoded_len, samplesleft;
-    unsigned int c, channels;
-
-    /* Check to make sure we have enough variables in the state array */
-    channels = IMA_ADPCM_state.wavefmt.channels;
-    if (channels > SDL_arraysize(IMA_ADPCM_state.state)) {
-        SDL_SetError("IMA ADPCM decoder can only handle %u channels",
-                     (unsigned int)SDL_arraysize(IMA_ADPCM_state.state));
-        return (-1);
+    const Uint32 blocksize = decoder->blockframes * decoder->framesize;
+    const Uint32 blocks = *audio_len / decoder->blockalign;
+    Uint8 *encoded = *audio_buf;
+    Uint8 *decoded;
+    Uint32 i;
+
+    if (blocks > 0xFFFFFFFF / blocksize) {
+        return SDL_OutOfMemory();
     }
-    state = IMA_ADPCM_state.state;
-
-    /* Allocate the proper sized output buffer */
-    encoded_len = *audio_len;
-    encoded = *audio_buf;
-    freeable = *audio_buf;
-    *audio_len = (encoded_len / IMA_ADPCM_state.wavefmt.blockalign) *
-        IMA_ADPCM_state.wSamplesPerBlock *
-        IMA_ADPCM_state.wavefmt.channels * sizeof(Sint16);
-    *audio_buf = (Uint8 *) SDL_malloc(*audio_len);
-    if (*audio_buf == NULL) {
+    decoded = (Uint8 *) SDL_malloc(blocks ? blocks * blocksize : 1);
+    if (decoded == NULL) {
         return SDL_OutOfMemory();
     }
-    decoded = *audio_buf;
-
-    /* Get ready... Go! */
-    while (encoded_len >= IMA_ADPCM_state.wavefmt.blockalign) {
-        /* Grab the initial information for this block */
-        for (c = 0; c < channels; ++c) {
-            /* Fill the state information for this block */
-            state[c].sample = ((encoded[1] << 8) | encoded[0]);
-            encoded += 2;
-            if (state[c].sample & 0x8000) {
-                state[c].sample -= 0x10000;
-            }
-            state[c].index = *encoded++;
-            /* Reserved byte in buffer header, should be 0 */
-            if (*encoded++ != 0) {
-                /* Uh oh, corrupt data?  Buggy code? */ ;
-            }
-
-            /* Store the initial sample we start with */
-            decoded[0] = (Uint8) (state[c].sample & 0xFF);
-            decoded[1] = (Uint8) (state[c].sample >> 8);
-            decoded += 2;
+    for (i = 0; i < blocks; ++i) {
+        if (DecodeWaveBlock(decoder, encoded, decoded + i * blocksize) < 0) {
+            SDL_free(decoded);
+            return (-1);
         }
+        encoded += decoder->blockalign;
+    }
+    SDL_free(*audio_buf);
+    *audio_buf = decoded;
+    *audio_len = blocks * blocksize;
+    return (0);
+}
 
-        /* Decode and store the other samples in this block */
-        samplesleft = (IMA_ADPCM_state.wSamplesPerBlock - 1) * channels;
-        while (samplesleft > 0) {
-            for (c = 0; c < channels; ++c) {
-                Fill_IMA_ADPCM_block(decoded, encoded,
-                                     c, channels, &state[c]);
-                encoded += 4;
-                samplesleft -= 8;
-            }
-            decoded += (channels * 8 * 2);
-        }
-        encoded_len -= IMA_ADPCM_state.wavefmt.blockalign;
+/* Check the magic header */
+static int
+ReadWaveHeader(SDL_RWops * src, Uint32 * wavelen)
+{
+    Uint32 RIFFchunk;
+    Uint32 WAVEmagic;
+
+    RIFFchunk = SDL_ReadLE32(src);
+    *wavelen = SDL_ReadLE32(src);
+    if (*wavelen == WAVE) {     /* The RIFFchunk has already been read */
+        WAVEmagic = *wavelen;
+        *wavelen = RIFFchunk;
+        RIFFchunk = RIFF;
+    } else {
+        WAVEmagic = SDL_ReadLE32(src);
+    }
+    if ((RIFFchunk != RIFF) || (WAVEmagic != WAVE)) {
+        return SDL_SetError("Unrecognized file type (not WAVE)");
     }
-    SDL_free(freeable);
     return (0);
 }
 
+/* Decode the audio data format */
+static int
+InitWaveDecoder(WaveDecoder * decoder, const Chunk * chunk,
+                SDL_AudioSpec * spec)
+{
+    const WaveFMT *format = (const WaveFMT *) chunk->data;
+    const Uint8 *extra = chunk->data + sizeof(*format);
+    const Uint32 extralen = chunk->length - sizeof(*format);
+    Uint16 bitspersample;
+
+    if (chunk->length < sizeof(*format)) {
+        return SDL_SetError("Invalid WAVE format chunk");
+    }
+    SDL_zerop(decoder);
+    decoder->encoding = SDL_SwapLE16(format->encoding);
+    decoder->channels = SDL_SwapLE16(format->channels);
+    decoder->blockalign = SDL_SwapLE16(format->blockalign);
+    bitspersample = SDL_SwapLE16(format->bitspersample);
+    if (decoder->channels == 0 || decoder->channels > 255) {
+        return SDL_SetError("Invalid number of WAVE channels: %d",
+                            decoder->channels);
+    }
+
+    SDL_memset(spec, 0, (sizeof *spec));
+    spec->freq = SDL_SwapLE32(format->frequency);
+    spec->channels = (Uint8) decoder->channels;
+    spec->samples = 4096;       /* Good default buffer size */
+
+    switch (decoder->encoding) {
+    case PCM_CODE:
+        /* We can understand this */
+        switch (bitspersample) {
+        case 8:
+            spec->format = AUDIO_U8;
+            break;
+        case 16:
+            spec->format = AUDIO_S16;
+            break;
+        case 32:
+            spec->format = AUDIO_S32;
+            break;
+        default:
+            return SDL_SetError("Unknown %d-bit PCM data format",
+                                bitspersample);
+        }
+        break;
+    case IEEE_FLOAT_CODE:
+        /* We can understand this */
+        if (bitspersample != 32) {
+            return SDL_SetError("Unknown %d-bit PCM data format",
+                                bitspersample);
+        }
+        spec->format = AUDIO_F32;
+        break;
+    case MS_ADPCM_CODE:
+    case IMA_ADPCM_CODE:
+        /* Try to understand this */
+        if (bitspersample != 4) {
+            return SDL_SetError("Unknown %d-bit PCM data format",
+                                bitspersample);
+        }
+        spec->format = AUDIO_S16;
+        break;
+    case MP3_CODE:
+        return SDL_SetError("MPEG Layer 3 data not supported");
+    default:
+        return SDL_SetError("Unknown WAVE data format: 0x%.4x",
+                            decoder->encoding);
+    }
+    decoder->framesize = (SDL_AUDIO_BITSIZE(spec->format) / 8) *
+        decoder->channels;
+
+    switch (decoder->encoding) {
+    case MS_ADPCM_CODE:
+        return InitMS_ADPCM(decoder, extra, extralen);
+    case IMA_ADPCM_CODE:
+        return InitIMA_ADPCM(decoder, extra, extralen);
+    default:
+        /* Raw samples are read a sample frame at a time */
+        decoder->blockalign = decoder->framesize;
+        decoder->blockframes = 1;
+        return (0);
+    }
+}
+
 SDL_AudioSpec *
 SDL_LoadWAV_RW(SDL_RWops * src, int freesrc,
                SDL_AudioSpec * spec, Uint8 ** audio_buf, Uint32 * audio_len)
@@ -410,13 +456,11 @@ SDL_LoadWAV_RW(SDL_RWops * src, int freesrc,
     int was_error;
     Chunk chunk;
     int lenread;
-    int IEEE_float_encoded, MS_ADPCM_encoded, IMA_ADPCM_encoded;
     int samplesize;
+    WaveDecoder decoder;
 
     /* WAV magic header */
-    Uint32 RIFFchunk;
     Uint32 wavelen = 0;
-    Uint32 WAVEmagic;
     Uint32 headerDiff = 0;
 
     /* FMT chunk */
@@ -432,17 +476,7 @@ SDL_LoadWAV_RW(SDL_RWops * src, int freesrc,
     }
 
     /* Check the magic header */
-    RIFFchunk = SDL_ReadLE32(src);
-    wavelen = SDL_ReadLE32(src);
-    if (wavelen == WAVE) {      /* The RIFFchunk has already been read */
-        WAVEmagic = wavelen;
-        wavelen = RIFFchunk;
-        RIFFchunk = RIFF;
-    } else {
-        WAVEmagic = SDL_ReadLE32(src);
-    }
-    if ((RIFFchunk != RIFF) || (WAVEmagic != WAVE)) {
-        SDL_SetError("Unrecognized file type (not WAVE)");
+    if (ReadWaveHeader(src, &wavelen) < 0) {
         was_error = 1;
         goto done;
     }
@@ -469,81 +503,10 @@ SDL_LoadWAV_RW(SDL_RWops * src, int freesrc,
         was_error = 1;
         goto done;
     }
-    IEEE_float_encoded = MS_ADPCM_encoded = IMA_ADPCM_encoded = 0;
-    switch (SDL_SwapLE16(format->encoding)) {
-    case PCM_CODE:
-        /* We can understand this */
-        break;
-    case IEEE_FLOAT_CODE:
-        IEEE_float_encoded = 1;
-        /* We can understand this */
-        break;
-    case MS_ADPCM_CODE:
-        /* Try to understand this */
-        if (InitMS_ADPCM(format) < 0) {
-            was_error = 1;
-            goto done;
-        }
-        MS_ADPCM_encoded = 1;
-        break;
-    case IMA_ADPCM_CODE:
-        /* Try to understand this */
-        if (InitIMA_ADPCM(format) < 0) {
-            was_error = 1;
-            goto done;
-        }
-        IMA_ADPCM_encoded = 1;
-        break;
-    case MP3_CODE:
-        SDL_SetError("MPEG Layer 3 data not supported");
+    if (InitWaveDecoder(&decoder, &chunk, spec) < 0) {
         was_error = 1;
         goto done;
-    default:
-        SDL_SetError("Unknown WAVE data format: 0x%.4x",
-                     SDL_SwapLE16(format->encoding));
-        was_error = 1;
-        goto done;
-    }
-    SDL_memset(spec, 0, (sizeof *spec));
-    spec->freq = SDL_SwapLE32(format->frequency);
-
-    if (IEEE_float_encoded) {
-        if ((SDL_SwapLE16(format->bitspersample)) != 32) {
-            was_error = 1;
-        } else {
-            spec->format = AUDIO_F32;
-        }
-    } else {
-        switch (SDL_SwapLE16(format->bitspersample)) {
-        case 4:
-            if (MS_ADPCM_encoded || IMA_ADPCM_encoded) {
-                spec->format = AUDIO_S16;
-            } else {
-                was_error = 1;
-            }
-            break;
-        case 8:
-            spec->format = AUDIO_U8;
-            break;
-        case 16:
-            spec->format = AUDIO_S16;
-            break;
-        case 32:
-            spec->format = AUDIO_S32;
-            break;
-        default:
-            was_error = 1;
-            break;
-        }
-    }
-
-    if (was_error) {
-        SDL_SetError("Unknown %d-bit PCM data format",
-                     SDL_SwapLE16(format->bitspersample));
-        goto done;
     }
-    spec->channels = (Uint8) SDL_SwapLE16(format->channels);
-    spec->samples = 4096;       /* Good default buffer size */
 
     /* Read the audio data chunk */
     *audio_buf = NULL;
@@ -562,14 +525,10 @@ SDL_LoadWAV_RW(SDL_RWops * src, int freesrc,
     } while (chunk.magic != DATA);
     headerDiff += 2 * sizeof(Uint32);   /* for the data chunk and len */
 
-    if (MS_ADPCM_encoded) {
-        if (MS_ADPCM_decode(audio_buf, audio_len) < 0) {
-            was_error = 1;
-            goto done;
-        }
-    }
-    if (IMA_ADPCM_encoded) {
-        if (IMA_ADPCM_decode(audio_buf, audio_len) < 0) {
+    if (decoder.blockframes > 1) {
+        if (DecodeWaveData(&decoder, audio_buf, audio_len) < 0) {
+            SDL_free(*audio_buf);
+            *audio_buf = NULL;
             was_error = 1;
             goto done;
         }
@@ -604,6 +563,268 @@ SDL_FreeWAV(Uint8 * audio_buf)
     SDL_free(audio_buf);
 }
 
+#define WAVE_NO_BLOCK   0xFFFFFFFF
+
+struct SDL_WaveStream
+{
+    SDL_RWops *src;
+    int freesrc;
+    WaveDecoder decoder;
+    Sint64 data_start;          /* Where the data chunk starts in src */
+    Uint32 length;              /* Sample frames in the data chunk */
+    Uint32 position;            /* Sample frame the next read starts at */
+    Uint32 next_block;          /* Block that src is positioned at */
+    Uint32 decoded_block;       /* Block held in decoded */
+    Uint8 *encoded;             /* One ADPCM block as it is in the file */
+    Uint8 *decoded;             /* One ADPCM block decoded */
+};
+
+SDL_WaveStream *
+SDL_OpenWaveStream(SDL_RWops * src, int freesrc, SDL_AudioSpec * spec)
+{
+    SDL_WaveStream *stream = NULL;
+    SDL_bool have_format = SDL_FALSE;
+    WaveDecoder decoder;
+    Chunk chunk;
+    Uint32 header[2];
+    Uint32 wavelen;
+    Uint32 blocks;
+
+    /* Make sure we are passed a valid data source */
+    if (src == NULL) {
+        return NULL;
+    }
+    if (spec == NULL) {
+        SDL_InvalidParamError("spec");
+        goto error;
+    }
+
+    SDL_zero(chunk);
+    if (ReadWaveHeader(src, &wavelen) < 0) {
+        goto error;
+    }
+
+    /* Read the format chunk and skip everything else up to the data */
+    for (;;) {
+        if (SDL_RWread(src, header, sizeof(header), 1) != 1) {
+            SDL_SetError("No data chunk in the WAVE file");
+            goto error;
+        }
+        chunk.magic = SDL_SwapLE32(header[0]);
+        chunk.length = SDL_SwapLE32(header[1]);
+        if (chunk.magic == DATA) {
+            break;
+        }
+        if (chunk.magic == FMT && !have_format) {
+            chunk.data = (Uint8 *) SDL_malloc(chunk.length);
+            if (chunk.data == NULL) {
+                SDL_OutOfMemory();
+                goto error;
+            }
+            if (SDL_RWread(src, chunk.data, chunk.length, 1) != 1) {
+                SDL_Error(SDL_EFREAD);
+                goto error;
+            }
+            if (InitWaveDecoder(&decoder, &chunk, spec) < 0) {
+                goto error;
+            }
+            SDL_free(chunk.data);
+            chunk.data = NULL;
+            have_format = SDL_TRUE;
+        } else if (SDL_RWseek(src, chunk.length, RW_SEEK_CUR) < 0) {
+            goto error;
+        }
+    }
+    if (!have_format) {
+        SDL_SetError("Complex WAVE files not supported");
+        goto error;
+    }
+
+    stream = (SDL_WaveStream *) SDL_calloc(1, sizeof(*stream));
+    if (stream == NULL) {
+        SDL_OutOfMemory();
+        goto error;
+    }
+    stream->src = src;
+    stream->freesrc = freesrc;
+    stream->decoder = decoder;
+    stream->data_start = SDL_RWtell(src);
+    blocks = chunk.length / decoder.blockalign;
+    blocks = SDL_min(blocks, 0xFFFFFFFF / decoder.blockframes);
+    stream->length = blocks * decoder.blockframes;
+    stream->next_block = 0;
+    stream->decoded_block = WAVE_NO_BLOCK;
+    if (decoder.blockframes > 1) {
+        stream->encoded = (Uint8 *) SDL_malloc(decoder.blockalign);
+        stream->decoded = (Uint8 *) SDL_malloc(decoder.blockframes *
+                                               decoder.framesize);
+        if (stream->encoded == NULL || stream->decoded == NULL) {
+            SDL_OutOfMemory();
+            goto error;
+        }
+    }
+    return stream;
+
+  error:
+    SDL_free(chunk.data);
+    if (stream) {
+        SDL_free(stream->encoded);
+        SDL_free(stream->decoded);
+        SDL_free(stream);
+    }
+    if (freesrc) {
+        SDL_RWclose(src);
+    }
+    return NULL;
+}
+
+static int
+SeekWaveBlock(SDL_WaveStream * stream, Uint32 block)
+{
+    const Sint64 offset = stream->data_start +
+        (Sint64) block * stream->decoder.blockalign;
+
+    stream->next_block = WAVE_NO_BLOCK;
+    if (stream->data_start < 0) {
+        return SDL_SetError("Can't seek in this WAVE data source");
+    }
+    if (SDL_RWseek(stream->src, offset, RW_SEEK_SET) != offset) {
+        return SDL_Error(SDL_EFSEEK);
+    }
+    stream->next_block = block;
+    return (0);
+}
+
+static int
+ReadWaveBlock(SDL_WaveStream * stream, Uint32 block, Uint8 * decoded)
+{
+    if (block != stream->next_block && SeekWaveBlock(stream, block) < 0) {
+        return (-1);
+    }
+    if (SDL_RWread(stream->src, stream->encoded,
+                   stream->decoder.blockalign, 1) != 1) {
+        stream->next_block = WAVE_NO_BLOCK;
+        return SDL_Error(SDL_EFREAD);
+    }
+    stream->next_block = block + 1;
+    return DecodeWaveBlock(&stream->decoder, stream->encoded, decoded);
+}
+
+int
+SDL_WaveStreamRead(SDL_WaveStream * stream, void *buf, int len)
+{
+    const WaveDecoder *decoder;
+    Uint8 *dst = (Uint8 *) buf;
+    Uint32 frames, done = 0;
+
+    if (stream == NULL) {
+        return SDL_InvalidParamError("stream");
+    }
+    if (len < 0) {
+        return SDL_InvalidParamError("len");
+    }
+
+    decoder = &stream->decoder;
+    frames = (Uint32) len / decoder->framesize;
+    frames = SDL_min(frames, stream->length - stream->position);
+    while (done < frames) {
+        const Uint32 block = stream->position / decoder->blockframes;
+        const Uint32 offset = stream->position % decoder->blockframes;
+        Uint32 count = SDL_min(decoder->blockframes - offset, frames - done);
+
+        if (block == stream->decoded_block) {
+            SDL_memcpy(dst, stream->decoded + offset * decoder->framesize,
+                       count * decoder->framesize);
+        } else if (decoder->blockframes == 1) {
+            /* Raw samples go straight into the buffer, as many as fit */
+            if (block != stream->next_block &&
+                SeekWaveBlock(stream, block) < 0) {
+                break;
+            }
+            count = (Uint32) SDL_RWread(stream->src, dst, decoder->framesize,
+                                        frames - done);
+            if (count < frames - done) {
+                /* src may have stopped in the middle of a sample frame */
+                stream->next_block = WAVE_NO_BLOCK;
+            } else {
+                stream->next_block += count;
+            }
+            if (count == 0) {
+                SDL_Error(SDL_EFREAD);
+                break;
+            }
+        } else if (count == decoder->blockframes) {
+            /* A whole block fits, so decode it straight into the buffer */
+            if (ReadWaveBlock(stream, block, dst) < 0) {
+                break;
+            }
+        } else {
+            stream->decoded_block = WAVE_NO_BLOCK;
+            if (ReadWaveBlock(stream, block, stream->decoded) < 0) {
+                break;
+            }
+            stream->decoded_block = block;
+            SDL_memcpy(dst, stream->decoded + offset * decoder->framesize,
+                       count * decoder->framesize);
+        }
+        dst += count * decoder->framesize;
+        stream->position += count;
+        done += count;
+    }
+
+    if (done == 0 && frames > 0) {
+        return (-1);
+    }
+    return (int) (done * decoder->framesize);
+}
+
+int
+SDL_WaveStreamSeek(SDL_WaveStream * stream, Uint32 frame)
+{
+    Uint32 block;
+
+    if (stream == NULL) {
+        return SDL_InvalidParamError("stream");
+    }
+    if (frame > stream->length) {
+        return SDL_SetError("Seeking past the end of the WAVE data");
+    }
+
+    /* Move src now, so a stream that can't seek finds out here */
+    block = frame / stream->decoder.blockframes;
+    if (block != stream->next_block && block != stream->decoded_block &&
+        SeekWaveBlock(stream, block) < 0) {
+        return (-1);
+    }
+    stream->position = frame;
+    return (0);
+}
+
+Uint32
+SDL_WaveStreamTell(SDL_WaveStream * stream)
+{
+    return stream ? stream->position : 0;
+}
+
+Uint32
+SDL_WaveStreamLength(SDL_WaveStream * stream)
+{
+    return stream ? stream->length : 0;
+}
+
+void
+SDL_CloseWaveStream(SDL_WaveStream * stream)
+{
+    if (stream) {
+        if (stream->freesrc) {
+            SDL_RWclose(stream->src);
+        }
+        SDL_free(stream->encoded);
+        SDL_free(stream->decoded);
+        SDL_free(stream);
+    }
+}
+
 static int
 ReadChunk(SDL_RWops * src, Chunk * chunk)
 {
@@ -64,4 +64,15 @@ typedef struct Chunk
     Uint8 *data;
 } Chunk;
 
+/* What it takes to decode the data chunk, one block at a time */
+typedef struct WaveDecoder
+{
+    Uint16 encoding;
+    Uint16 channels;
+    Uint16 blockalign;          /* Bytes in an encoded block */
+    Uint16 blockframes;         /* Sample frames decoded from a block */
+    Uint32 framesize;           /* Bytes in a decoded sample frame */
+    Sint16 coeff[7][2];         /* MS ADPCM predictor coefficients */
+} WaveDecoder;
+
 /* vi: set ts=4 sw=4 expandtab: */
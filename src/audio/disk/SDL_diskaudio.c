@@ -31,6 +31,8 @@
 #include "SDL_rwops.h"
 #include "SDL_timer.h"
 #include "SDL_audio.h"
+#include "SDL_hints.h"
+#include "SDL_log.h"
 #include "../SDL_audiomem.h"
 #include "../SDL_audio_c.h"
 #include "SDL_diskaudio.h"
@@ -57,25 +59,67 @@ DISKAUD_GetOutputFilename(const char *devname)
 static void
 DISKAUD_WaitDevice(_THIS)
 {
-    SDL_Delay(this->hidden->write_delay);
+    if (!this->hidden->offline || this->paused) {
+        SDL_Delay(this->hidden->write_delay);
+    }
+}
+
+/* How many times faster than realtime the buffers were written */
+static void
+DISKAUD_LogThroughput(_THIS)
+{
+    struct SDL_PrivateAudioData *h = this->hidden;
+    const double elapsed = (double) (SDL_GetPerformanceCounter() - h->start) /
+                           (double) SDL_GetPerformanceFrequency();
+    const double seconds = (double) h->frames_written / this->spec.freq;
+
+    if (h->frames_written == 0) {
+        return;
+    }
+    SDL_Log("Disk audio: wrote %u frames (%.3f s of audio) in %.3f s, %.1fx realtime",
+            (unsigned int) h->frames_written, seconds, elapsed,
+            (elapsed > 0.0) ? (seconds / elapsed) : 0.0);
 }
 
 static void
 DISKAUD_PlayDevice(_THIS)
 {
+    struct SDL_PrivateAudioData *h = this->hidden;
+    const Uint32 frame_size = h->mixlen / this->spec.samples;
+    Uint32 len = h->mixlen;
     size_t written;
 
+    /* Offline, paused time isn't worth writing */
+    if (h->offline && this->paused) {
+        return;
+    }
+    if (h->frames_written == 0) {
+        h->start = SDL_GetPerformanceCounter();
+    }
+    if (h->frames_to_write) {
+        len = SDL_min(len, (h->frames_to_write - h->frames_written) * frame_size);
+    }
+
     /* Write the audio data */
-    written = SDL_RWwrite(this->hidden->output,
-                          this->hidden->mixbuf, 1, this->hidden->mixlen);
+    written = SDL_RWwrite(h->output, h->mixbuf, 1, len);
 
     /* If we couldn't write, assume fatal error for now */
-    if (written != this->hidden->mixlen) {
+    if (written != len) {
         SDL_OpenedAudioDeviceDisconnected(this);
+        return;
     }
 #ifdef DEBUG_AUDIO
     fprintf(stderr, "Wrote %d bytes of audio data\n", written);
 #endif
+
+    h->frames_written += len / frame_size;
+    if (h->frames_to_write && h->frames_written == h->frames_to_write) {
+        /* All done: stop, and let the app know like for a lost device */
+        if (h->offline) {
+            DISKAUD_LogThroughput(this);
+        }
+        SDL_OpenedAudioDeviceDisconnected(this);
+    }
 }
 
 static Uint8 *
@@ -88,6 +132,9 @@ static void
 DISKAUD_CloseDevice(_THIS)
 {
     if (this->hidden != NULL) {
+        if (this->hidden->offline && this->hidden->frames_written != this->hidden->frames_to_write) {
+            DISKAUD_LogThroughput(this);
+        }
         SDL_FreeAudioMem(this->hidden->mixbuf);
         this->hidden->mixbuf = NULL;
         if (this->hidden->output != NULL) {
@@ -115,6 +162,14 @@ DISKAUD_OpenDevice(_THIS, void *handle, const char *devname, int iscapture)
     this->hidden->mixlen = this->spec.size;
     this->hidden->write_delay =
         (envr) ? SDL_atoi(envr) : DISKDEFAULT_WRITEDELAY;
+    envr = SDL_GetHint(SDL_HINT_AUDIO_DISK_OFFLINE);
+    if (envr && SDL_atoi(envr)) {
+        this->hidden->offline = SDL_TRUE;
+    }
+    envr = SDL_GetHint(SDL_HINT_AUDIO_DISK_FRAMES);
+    if (envr && SDL_atoi(envr) > 0) {
+        this->hidden->frames_to_write = (Uint32) SDL_atoi(envr);
+    }
 
     /* Open the audio device */
     this->hidden->output = SDL_RWFromFile(fname, "wb");
@@ -36,6 +36,10 @@ struct SDL_PrivateAudioData
     Uint8 *mixbuf;
     Uint32 mixlen;
     Uint32 write_delay;
+    SDL_bool offline;  /* don't wait between buffers. */
+    Uint32 frames_to_write;  /* stop after this many, 0 to never stop. */
+    Uint32 frames_written;
+    Uint64 start;  /* performance counter at the first frame written. */
 };
 
 #endif /* _SDL_diskaudio_h */
@@ -593,3 +593,33 @@
 #define SDL_ClearQueuedAudio SDL_ClearQueuedAudio_REAL
 #define SDL_GetGrabbedWindow SDL_GetGrabbedWindow_REAL
 #define SDL_SetWindowsMessageHook SDL_SetWindowsMessageHook_REAL
+#define SDL_GetCoalescedEventCount SDL_GetCoalescedEventCount_REAL
+#define SDL_PushEvents SDL_PushEvents_REAL
+#define SDL_GetEventTimestampNS SDL_GetEventTimestampNS_REAL
+#define SDL_GetKeyboardSnapshot SDL_GetKeyboardSnapshot_REAL
+#define SDL_NewAudioStream SDL_NewAudioStream_REAL
+#define SDL_AudioStreamPut SDL_AudioStreamPut_REAL
+#define SDL_AudioStreamGet SDL_AudioStreamGet_REAL
+#define SDL_AudioStreamAvailable SDL_AudioStreamAvailable_REAL
+#define SDL_AudioStreamFlush SDL_AudioStreamFlush_REAL
+#define SDL_AudioStreamClear SDL_AudioStreamClear_REAL
+#define SDL_FreeAudioStream SDL_FreeAudioStream_REAL
+#define SDL_GetAudioDeviceStats SDL_GetAudioDeviceStats_REAL
+#define SDL_ResetAudioDeviceStats SDL_ResetAudioDeviceStats_REAL
+#define SDL_OpenWaveStream SDL_OpenWaveStream_REAL
+#define SDL_WaveStreamRead SDL_WaveStreamRead_REAL
+#define SDL_WaveStreamSeek SDL_WaveStreamSeek_REAL
+#define SDL_WaveStreamTell SDL_WaveStreamTell_REAL
+#define SDL_WaveStreamLength SDL_WaveStreamLength_REAL
+#define SDL_CloseWaveStream SDL_CloseWaveStream_REAL
+#define SDL_AttachAudioMixer SDL_AttachAudioMixer_REAL
+#define SDL_DetachAudioMixer SDL_DetachAudioMixer_REAL
+#define SDL_AddMixerSource SDL_AddMixerSource_REAL
+#define SDL_RemoveMixerSource SDL_RemoveMixerSource_REAL
+#define SDL_PlayMixerVoice SDL_PlayMixerVoice_REAL
+#define SDL_StopMixerVoice SDL_StopMixerVoice_REAL
+#define SDL_IsMixerVoicePlaying SDL_IsMixerVoicePlaying_REAL
+#define SDL_SetMixerVoiceLoop SDL_SetMixerVoiceLoop_REAL
+#define SDL_SetMixerVoiceGain SDL_SetMixerVoiceGain_REAL
+#define SDL_SetMixerVoicePan SDL_SetMixerVoicePan_REAL
+#define SDL_SetMixerVoicePitch SDL_SetMixerVoicePitch_REAL
@@ -627,3 +627,33 @@ SDL_DYNAPI_PROC(SDL_Window*,SDL_GetGrabbedWindow,(void),(),return)
 #ifdef __WIN32__
 SDL_DYNAPI_PROC(void,SDL_SetWindowsMessageHook,(SDL_WindowsMessageHook a, void *b),(a,b),)
 #endif
+SDL_DYNAPI_PROC(Uint32,SDL_GetCoalescedEventCount,(Uint32 a),(a),return)
+SDL_DYNAPI_PROC(int,SDL_PushEvents,(SDL_Event *a, int b),(a,b),return)
+SDL_DYNAPI_PROC(Uint64,SDL_GetEventTimestampNS,(const SDL_Event *a),(a),return)
+SDL_DYNAPI_PROC(int,SDL_GetKeyboardSnapshot,(Uint8 *a, int b, SDL_Keymod *c),(a,b,c),return)
+SDL_DYNAPI_PROC(SDL_AudioStream*,SDL_NewAudioStream,(SDL_AudioFormat a, Uint8 b, int c, SDL_AudioFormat d, Uint8 e, int f),(a,b,c,d,e,f),return)
+SDL_DYNAPI_PROC(int,SDL_AudioStreamPut,(SDL_AudioStream *a, const void *b, int c),(a,b,c),return)
+SDL_DYNAPI_PROC(int,SDL_AudioStreamGet,(SDL_AudioStream *a, void *b, int c),(a,b,c),return)
+SDL_DYNAPI_PROC(int,SDL_AudioStreamAvailable,(SDL_AudioStream *a),(a),return)
+SDL_DYNAPI_PROC(int,SDL_AudioStreamFlush,(SDL_AudioStream *a),(a),return)
+SDL_DYNAPI_PROC(void,SDL_AudioStreamClear,(SDL_AudioStream *a),(a),)
+SDL_DYNAPI_PROC(void,SDL_FreeAudioStream,(SDL_AudioStream *a),(a),)
+SDL_DYNAPI_PROC(int,SDL_GetAudioDeviceStats,(SDL_AudioDeviceID a, SDL_AudioDeviceStats *b),(a,b),return)
+SDL_DYNAPI_PROC(void,SDL_ResetAudioDeviceStats,(SDL_AudioDeviceID a),(a),)
+SDL_DYNAPI_PROC(SDL_WaveStream*,SDL_OpenWaveStream,(SDL_RWops *a, int b, SDL_AudioSpec *c),(a,b,c),return)
+SDL_DYNAPI_PROC(int,SDL_WaveStreamRead,(SDL_WaveStream *a, void *b, int c),(a,b,c),return)
+SDL_DYNAPI_PROC(int,SDL_WaveStreamSeek,(SDL_WaveStream *a, Uint32 b),(a,b),return)
+SDL_DYNAPI_PROC(Uint32,SDL_WaveStreamTell,(SDL_WaveStream *a),(a),return)
+SDL_DYNAPI_PROC(Uint32,SDL_WaveStreamLength,(SDL_WaveStream *a),(a),return)
+SDL_DYNAPI_PROC(void,SDL_CloseWaveStream,(SDL_WaveStream *a),(a),)
+SDL_DYNAPI_PROC(int,SDL_AttachAudioMixer,(SDL_AudioDeviceID a, int b),(a,b),return)
+SDL_DYNAPI_PROC(void,SDL_DetachAudioMixer,(SDL_AudioDeviceID a),(a),)
+SDL_DYNAPI_PROC(int,SDL_AddMixerSource,(SDL_AudioDeviceID a, const SDL_AudioSpec *b, const Uint8 *c, Uint32 d),(a,b,c,d),return)
+SDL_DYNAPI_PROC(void,SDL_RemoveMixerSource,(SDL_AudioDeviceID a, int b),(a,b),)
+SDL_DYNAPI_PROC(int,SDL_PlayMixerVoice,(SDL_AudioDeviceID a, int b, int c, float d, float e),(a,b,c,d,e),return)
+SDL_DYNAPI_PROC(int,SDL_StopMixerVoice,(SDL_AudioDeviceID a, int b),(a,b),return)
+SDL_DYNAPI_PROC(SDL_bool,SDL_IsMixerVoicePlaying,(SDL_AudioDeviceID a, int b),(a,b),return)
+SDL_DYNAPI_PROC(int,SDL_SetMixerVoiceLoop,(SDL_AudioDeviceID a, int b, int c),(a,b,c),return)
+SDL_DYNAPI_PROC(int,SDL_SetMixerVoiceGain,(SDL_AudioDeviceID a, int b, float c),(a,b,c),return)
+SDL_DYNAPI_PROC(int,SDL_SetMixerVoicePan,(SDL_AudioDeviceID a, int b, float c),(a,b,c),return)
+SDL_DYNAPI_PROC(int,SDL_SetMixerVoicePitch,(SDL_AudioDeviceID a, int b, float c),(a,b,c),return)
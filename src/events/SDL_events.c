@@ -26,6 +26,8 @@
 #include "SDL_events.h"
 #include "SDL_syswm.h"
 #include "SDL_thread.h"
+#include "SDL_atomic.h"
+#include "SDL_cpuinfo.h"
 #include "SDL_events_c.h"
 #include "../timer/SDL_timer_c.h"
 #if !SDL_JOYSTICK_DISABLED
@@ -36,6 +38,10 @@
 /* An arbitrary limit so we don't have unbounded growth */
 #define SDL_MAX_QUEUED_EVENTS   65535
 
+/* How far back past motion of other devices a motion event looks for one
+   to merge into */
+#define SDL_MAX_COALESCE_DEPTH  8
+
 /* Public data -- the event filter */
 SDL_EventFilter SDL_EventOK = NULL;
 void *SDL_EventOKParam;
@@ -43,10 +49,25 @@ void *SDL_EventOKParam;
 typedef struct SDL_EventWatcher {
     SDL_EventFilter callback;
     void *userdata;
-    struct SDL_EventWatcher *next;
 } SDL_EventWatcher;
 
-static SDL_EventWatcher *SDL_event_watchers = NULL;
+/* The watchers are an array that is never changed once published, events
+   pushed from any thread walk it without locking. Adding or removing a
+   watcher publishes a new copy; the old one is retired and freed once no
+   event is being dispatched. */
+typedef struct SDL_EventWatchList {
+    int count;
+    struct SDL_EventWatchList *next_retired;
+    SDL_EventWatcher watchers[1];
+} SDL_EventWatchList;
+
+static struct
+{
+    SDL_EventWatchList *volatile current;
+    SDL_atomic_t readers;               /* dispatches in flight */
+    SDL_SpinLock lock;                  /* serializes adding and removing */
+    SDL_EventWatchList *volatile retired;
+} SDL_EventWatchers;
 
 typedef struct {
     Uint32 bits[8];
@@ -55,21 +76,85 @@ typedef struct {
 static SDL_DisabledEventBlock *SDL_disabled_events[256];
 static Uint32 SDL_userevents = SDL_USEREVENT;
 
-/* Private data -- event queue */
+/* Private data -- event queue
+
+   Events are pushed without locking into a bounded ring of slots, one
+   cache line each (a Vyukov style multi-producer queue). Whoever holds
+   the queue lock to look at the events first drains the ring, in push
+   order, into the linked list below, so SDL_PeepEvents() keeps working
+   on one ordered list. If the ring is full the producer takes the lock
+   and drains it itself.
+
+   Each queued event is also linked into the list of its category (the
+   high byte of the event type, e.g. all of the window events or all of
+   the joystick events), so a query for a narrow range of types only has
+   to look at the categories it covers. Entries carry a sequence number
+   so events taken from several categories still come out in the order
+   they were queued.
+ */
 typedef struct _SDL_EventEntry
 {
     SDL_Event event;
-    SDL_SysWMmsg msg;
+    Uint32 sequence;
     struct _SDL_EventEntry *prev;
     struct _SDL_EventEntry *next;
+    struct _SDL_EventEntry *category_prev;
+    struct _SDL_EventEntry *category_next;
 } SDL_EventEntry;
 
+#define SDL_NUM_EVENT_CATEGORIES    256
+#define SDL_EventCategory(type)     ((type) > SDL_LASTEVENT ? (SDL_NUM_EVENT_CATEGORIES-1) : ((type) >> 8))
+
+typedef struct
+{
+    SDL_EventEntry *head;
+    SDL_EventEntry *tail;
+    int count;
+} SDL_EventCategoryList;
+
+/* SDL_SYSWMEVENT payloads live outside the queue entries; a queued
+   event's syswm.msg points into one of these */
 typedef struct _SDL_SysWMEntry
 {
     SDL_SysWMmsg msg;
     struct _SDL_SysWMEntry *next;
 } SDL_SysWMEntry;
 
+/* The number of slots must be a power of 2 */
+#define SDL_EVENT_RING_SIZE     4096
+#define SDL_EVENT_RING_MASK     (SDL_EVENT_RING_SIZE-1)
+#define SDL_EVENT_SLOT_SIZE     64
+
+typedef union
+{
+    struct {
+        SDL_atomic_t sequence;
+        SDL_Event event;
+    } s;
+    Uint8 pad[SDL_EVENT_SLOT_SIZE];
+} SDL_EventSlot;
+
+SDL_COMPILE_TIME_ASSERT(event_slot, sizeof(SDL_EventSlot) == SDL_EVENT_SLOT_SIZE);
+
+/* SDL_AtomicGet() is a compare-and-swap, which would write to the cache
+   line on every look; a plain load ordered by barriers is enough here */
+#define SDL_RingLoad(a)         (*(volatile int *)&(a)->value)
+#define SDL_RingStore(a, v)     (*(volatile int *)&(a)->value = (v))
+
+typedef struct
+{
+    SDL_EventSlot *slots;               /* aligned into 'memory' */
+    void *memory;
+
+    char cache_pad1[SDL_CACHELINE_SIZE-2*sizeof(void*)];
+
+    SDL_atomic_t enqueue_pos;
+
+    char cache_pad2[SDL_CACHELINE_SIZE-sizeof(SDL_atomic_t)];
+
+    unsigned dequeue_pos;               /* only touched with the queue lock held */
+} SDL_EventRing;
+
 static struct
 {
     SDL_mutex *lock;
@@ -79,9 +164,63 @@ static struct
     SDL_EventEntry *head;
     SDL_EventEntry *tail;
     SDL_EventEntry *free;
+    Uint32 sequence;                    /* sequence number of the next event */
+    Uint32 used_categories[SDL_NUM_EVENT_CATEGORIES/32];
+    SDL_EventCategoryList categories[SDL_NUM_EVENT_CATEGORIES];
     SDL_SysWMEntry *wmmsg_used;
     SDL_SysWMEntry *wmmsg_free;
-} SDL_EventQ = { NULL, SDL_TRUE, 0, 0, NULL, NULL, NULL, NULL, NULL };
+    SDL_EventRing ring;
+    SDL_cond *wait_cond;                /* signalled with the queue lock */
+    SDL_atomic_t waiters;               /* threads in SDL_WaitEventTimeout() */
+    SDL_atomic_t wakeups;               /* bumped for each SDL_WakeEventWaiters() */
+    volatile SDL_bool coalesce;         /* SDL_HINT_EVENT_COALESCING */
+    Uint32 coalesced[4];                /* see SDL_CoalescedEventIndex() */
+} SDL_EventQ = { NULL, SDL_TRUE, 0, 0, NULL, NULL, NULL };
+
+/* Events held back while the thread pumping events is in a batch, see
+   SDL_BeginEventBatch(). Only the owning thread touches the events. */
+#define SDL_EVENT_BATCH_SIZE    128
+
+static struct
+{
+    SDL_atomic_t owned;
+    volatile SDL_threadID thread;
+    int depth;
+    int count;
+    SDL_Event events[SDL_EVENT_BATCH_SIZE];
+} SDL_EventBatch;
+
+/* When the input behind an event was acquired, see SDL_GetEventTimestampNS().
+   The low 32 bits of the nanoseconds since the ticks started go in the end
+   of the event padding; the rest comes back from the timestamp field. */
+#define SDL_EVENT_NS_OFFSET     (sizeof(((SDL_Event *)0)->padding) - sizeof(Uint32))
+
+SDL_COMPILE_TIME_ASSERT(event_ns_edit, sizeof(SDL_TextEditingEvent) <= SDL_EVENT_NS_OFFSET);
+SDL_COMPILE_TIME_ASSERT(event_ns_text, sizeof(SDL_TextInputEvent) <= SDL_EVENT_NS_OFFSET);
+SDL_COMPILE_TIME_ASSERT(event_ns_tfinger, sizeof(SDL_TouchFingerEvent) <= SDL_EVENT_NS_OFFSET);
+SDL_COMPILE_TIME_ASSERT(event_ns_dgesture, sizeof(SDL_DollarGestureEvent) <= SDL_EVENT_NS_OFFSET);
+
+static struct
+{
+    Uint64 base_counter;                /* performance counter at base_ticks */
+    Uint32 base_ticks;
+    Uint64 frequency;
+    SDL_TLSID acquired;                 /* see SDL_SetEventAcquisitionTime() */
+} SDL_EventClock;
+
+static int SDL_AddEvents(SDL_Event * events, int numevents);
+static SDL_bool SDL_PopEventRing(SDL_Event * event);
+static void SDL_DrainEventRing(void);
+
+static void
+SDL_EventCoalescingChanged(void *userdata, const char *name, const char *oldValue, const char *hint)
+{
+    if (hint && *hint == '1') {
+        SDL_EventQ.coalesce = SDL_TRUE;
+    } else {
+        SDL_EventQ.coalesce = SDL_FALSE;
+    }
+}
 
 
 /* Public functions */
@@ -93,6 +232,11 @@ SDL_StopEventLoop(void)
     int i;
     SDL_EventEntry *entry;
     SDL_SysWMEntry *wmmsg;
+    SDL_Event event;
+
+    /* Touches pushed by the application have gestures without a video
+       driver, and the recognizer thread may still be pushing events */
+    SDL_GestureQuit();
 
     if (SDL_EventQ.lock) {
         SDL_LockMutex(SDL_EventQ.lock);
@@ -108,6 +252,9 @@ SDL_StopEventLoop(void)
     /* Clean out EventQ */
     for (entry = SDL_EventQ.head; entry; ) {
         SDL_EventEntry *next = entry->next;
+        if (entry->event.type == SDL_SYSWMEVENT) {
+            SDL_free(entry->event.syswm.msg);
+        }
         SDL_free(entry);
         entry = next;
     }
@@ -132,8 +279,23 @@ SDL_StopEventLoop(void)
     SDL_EventQ.head = NULL;
     SDL_EventQ.tail = NULL;
     SDL_EventQ.free = NULL;
+    SDL_EventQ.sequence = 0;
+    SDL_zero(SDL_EventQ.used_categories);
+    SDL_zero(SDL_EventQ.categories);
     SDL_EventQ.wmmsg_used = NULL;
     SDL_EventQ.wmmsg_free = NULL;
+    SDL_zero(SDL_EventQ.coalesced);
+
+    /* Events still in the ring are dropped with it, but the messages of
+       SDL_SYSWMEVENTs are in the side store */
+    while (SDL_PopEventRing(&event)) {
+        if (event.type == SDL_SYSWMEVENT) {
+            SDL_free(event.syswm.msg);
+        }
+    }
+    SDL_free(SDL_EventQ.ring.memory);
+    SDL_EventQ.ring.memory = NULL;
+    SDL_EventQ.ring.slots = NULL;
 
     /* Clear disabled event state */
     for (i = 0; i < SDL_arraysize(SDL_disabled_events); ++i) {
@@ -141,13 +303,22 @@ SDL_StopEventLoop(void)
         SDL_disabled_events[i] = NULL;
     }
 
-    while (SDL_event_watchers) {
-        SDL_EventWatcher *tmp = SDL_event_watchers;
-        SDL_event_watchers = tmp->next;
-        SDL_free(tmp);
+    SDL_AtomicLock(&SDL_EventWatchers.lock);
+    SDL_free(SDL_AtomicSetPtr((void **)&SDL_EventWatchers.current, NULL));
+    while (SDL_EventWatchers.retired) {
+        SDL_EventWatchList *next = SDL_EventWatchers.retired->next_retired;
+        SDL_free(SDL_EventWatchers.retired);
+        SDL_EventWatchers.retired = next;
     }
+    SDL_AtomicUnlock(&SDL_EventWatchers.lock);
     SDL_EventOK = NULL;
 
+    SDL_DelHintCallback(SDL_HINT_EVENT_COALESCING, SDL_EventCoalescingChanged, NULL);
+
+    if (SDL_EventQ.wait_cond) {
+        SDL_DestroyCond(SDL_EventQ.wait_cond);
+        SDL_EventQ.wait_cond = NULL;
+    }
     if (SDL_EventQ.lock) {
         SDL_UnlockMutex(SDL_EventQ.lock);
         SDL_DestroyMutex(SDL_EventQ.lock);
@@ -173,45 +344,268 @@ SDL_StartEventLoop(void)
     if (SDL_EventQ.lock == NULL) {
         return (-1);
     }
+    if (!SDL_EventQ.wait_cond) {
+        SDL_EventQ.wait_cond = SDL_CreateCond();
+    }
+    if (SDL_EventQ.wait_cond == NULL) {
+        return (-1);
+    }
 #endif /* !SDL_THREADS_DISABLED */
 
+    /* Set up the ring for lock-free pushes; without it they take the lock */
+    if (!SDL_EventQ.ring.slots) {
+        SDL_EventRing *ring = &SDL_EventQ.ring;
+        int i;
+
+        ring->memory = SDL_malloc(SDL_EVENT_RING_SIZE * sizeof(SDL_EventSlot) + SDL_CACHELINE_SIZE);
+        if (ring->memory) {
+            ring->slots = (SDL_EventSlot *)(((size_t)ring->memory + SDL_CACHELINE_SIZE - 1) & ~(size_t)(SDL_CACHELINE_SIZE - 1));
+            for (i = 0; i < SDL_EVENT_RING_SIZE; ++i) {
+                SDL_AtomicSet(&ring->slots[i].s.sequence, i);
+            }
+            SDL_AtomicSet(&ring->enqueue_pos, 0);
+            ring->dequeue_pos = 0;
+        }
+    }
+
     /* Process most event types */
     SDL_EventState(SDL_TEXTINPUT, SDL_DISABLE);
     SDL_EventState(SDL_TEXTEDITING, SDL_DISABLE);
     SDL_EventState(SDL_SYSWMEVENT, SDL_DISABLE);
 
+    SDL_AddHintCallback(SDL_HINT_EVENT_COALESCING, SDL_EventCoalescingChanged, NULL);
+
+    /* Each thread pushing events says when its own input was acquired */
+    if (!SDL_EventClock.acquired) {
+        SDL_EventClock.acquired = SDL_TLSCreate();
+    }
+
+    /* Line the event clock up with the ticks */
+    SDL_EventClock.frequency = SDL_GetPerformanceFrequency();
+    SDL_EventClock.base_counter = SDL_GetPerformanceCounter();
+    SDL_EventClock.base_ticks = SDL_GetTicks();
+
     SDL_EventQ.active = SDL_TRUE;
 
     return (0);
 }
 
 
-/* Add an event to the event queue -- called with the queue locked */
+static void
+SDL_LockEventQueue(void)
+{
+    if (SDL_EventQ.lock) {
+        SDL_LockMutex(SDL_EventQ.lock);
+    }
+}
+
+static void
+SDL_UnlockEventQueue(void)
+{
+    if (SDL_EventQ.lock) {
+        SDL_UnlockMutex(SDL_EventQ.lock);
+    }
+}
+
+/* Copy the message of a SDL_SYSWMEVENT to the side store and point the
+   event at the copy -- called with the queue locked */
+static SDL_bool
+SDL_StoreSysWMEvent(SDL_Event * event)
+{
+    SDL_SysWMEntry *wmmsg;
+
+    if (SDL_EventQ.wmmsg_free) {
+        wmmsg = SDL_EventQ.wmmsg_free;
+        SDL_EventQ.wmmsg_free = wmmsg->next;
+    } else {
+        wmmsg = (SDL_SysWMEntry *)SDL_malloc(sizeof(*wmmsg));
+        if (!wmmsg) {
+            SDL_OutOfMemory();
+            return SDL_FALSE;
+        }
+    }
+    wmmsg->msg = *event->syswm.msg;
+    event->syswm.msg = &wmmsg->msg;
+    return SDL_TRUE;
+}
+
+/* Give the side store copy of a message back -- called with the queue locked */
+static void
+SDL_ReleaseSysWMEvent(SDL_Event * event)
+{
+    /* The message is the first member of its side store entry */
+    SDL_SysWMEntry *wmmsg = (SDL_SysWMEntry *)event->syswm.msg;
+
+    wmmsg->next = SDL_EventQ.wmmsg_free;
+    SDL_EventQ.wmmsg_free = wmmsg;
+}
+
+/* Point a SDL_SYSWMEVENT handed out to the application at a copy of its
+   message -- called with the queue locked.
+   We need to copy the wmmsg somewhere safe.
+   For now we'll guarantee it's valid at least until the next call to
+   SDL_PeepEvents()
+ */
+static void
+SDL_ExportSysWMEvent(SDL_Event * event)
+{
+    SDL_SysWMEntry *wmmsg;
+
+    if (SDL_EventQ.wmmsg_free) {
+        wmmsg = SDL_EventQ.wmmsg_free;
+        SDL_EventQ.wmmsg_free = wmmsg->next;
+    } else {
+        wmmsg = (SDL_SysWMEntry *)SDL_malloc(sizeof(*wmmsg));
+    }
+    wmmsg->msg = *event->syswm.msg;
+    wmmsg->next = SDL_EventQ.wmmsg_used;
+    SDL_EventQ.wmmsg_used = wmmsg;
+    event->syswm.msg = &wmmsg->msg;
+}
+
+/* The slot in SDL_EventQ.coalesced for an event type, or -1 if events of
+   that type are never merged */
+static int
+SDL_CoalescedEventIndex(Uint32 type)
+{
+    switch (type) {
+    case SDL_MOUSEMOTION:
+        return 0;
+    case SDL_JOYAXISMOTION:
+        return 1;
+    case SDL_CONTROLLERAXISMOTION:
+        return 2;
+    case SDL_FINGERMOTION:
+        return 3;
+    default:
+        return -1;
+    }
+}
+
+/* Merge 'event' into 'queued' if they come from the same mouse, axis or
+   finger; both are of the same type */
+static SDL_bool
+SDL_MergeEvent(SDL_Event *queued, const SDL_Event *event)
+{
+    switch (event->type) {
+    case SDL_MOUSEMOTION:
+        if (queued->motion.which != event->motion.which ||
+            queued->motion.windowID != event->motion.windowID) {
+            return SDL_FALSE;
+        }
+        queued->motion.state = event->motion.state;
+        queued->motion.x = event->motion.x;
+        queued->motion.y = event->motion.y;
+        queued->motion.xrel += event->motion.xrel;
+        queued->motion.yrel += event->motion.yrel;
+        break;
+    case SDL_JOYAXISMOTION:
+        if (queued->jaxis.which != event->jaxis.which ||
+            queued->jaxis.axis != event->jaxis.axis) {
+            return SDL_FALSE;
+        }
+        queued->jaxis.value = event->jaxis.value;
+        break;
+    case SDL_CONTROLLERAXISMOTION:
+        if (queued->caxis.which != event->caxis.which ||
+            queued->caxis.axis != event->caxis.axis) {
+            return SDL_FALSE;
+        }
+        queued->caxis.value = event->caxis.value;
+        break;
+    case SDL_FINGERMOTION:
+        if (queued->tfinger.touchId != event->tfinger.touchId ||
+            queued->tfinger.fingerId != event->tfinger.fingerId) {
+            return SDL_FALSE;
+        }
+        queued->tfinger.x = event->tfinger.x;
+        queued->tfinger.y = event->tfinger.y;
+        queued->tfinger.dx += event->tfinger.dx;
+        queued->tfinger.dy += event->tfinger.dy;
+        queued->tfinger.pressure = event->tfinger.pressure;
+        break;
+    default:
+        return SDL_FALSE;
+    }
+    queued->common.timestamp = event->common.timestamp;
+    SDL_memcpy(&queued->padding[SDL_EVENT_NS_OFFSET],
+               &event->padding[SDL_EVENT_NS_OFFSET], sizeof(Uint32));
+    return SDL_TRUE;
+}
+
+/* Try to fold a motion event into the run of motion events at the end of
+   the queue. Only events of the same type are looked past, so nothing is
+   moved ahead of an event of another kind. */
+static SDL_bool
+SDL_CoalesceEvent(const SDL_Event *event)
+{
+    SDL_EventEntry *entry;
+    int index, depth;
+
+    index = SDL_CoalescedEventIndex(event->type);
+    if (index < 0) {
+        return SDL_FALSE;
+    }
+
+    entry = SDL_EventQ.tail;
+    for (depth = 0; entry && depth < SDL_MAX_COALESCE_DEPTH; ++depth) {
+        if (entry->event.type != event->type) {
+            break;
+        }
+        if (SDL_MergeEvent(&entry->event, event)) {
+            ++SDL_EventQ.coalesced[index];
+            return SDL_TRUE;
+        }
+        entry = entry->prev;
+    }
+    return SDL_FALSE;
+}
+
+/* Add an event to the event queue -- called with the queue locked.
+   The message of a SDL_SYSWMEVENT must already be in the side store. */
 static int
 SDL_AddEvent(SDL_Event * event)
 {
     SDL_EventEntry *entry;
+    SDL_EventCategoryList *category;
+    Uint32 category_id;
 
-    if (SDL_EventQ.count >= SDL_MAX_QUEUED_EVENTS) {
-        SDL_SetError("Event queue is full (%d events)", SDL_EventQ.count);
-        return 0;
+    if (SDL_EventQ.coalesce && SDL_CoalesceEvent(event)) {
+        return 1;
     }
 
-    if (SDL_EventQ.free == NULL) {
+    if (SDL_EventQ.count >= SDL_MAX_QUEUED_EVENTS) {
+        SDL_SetError("Event queue is full (%d events)", SDL_EventQ.count);
+        entry = NULL;
+    } else if (SDL_EventQ.free == NULL) {
         entry = (SDL_EventEntry *)SDL_malloc(sizeof(*entry));
-        if (!entry) {
-            return 0;
-        }
     } else {
         entry = SDL_EventQ.free;
         SDL_EventQ.free = entry->next;
     }
+    if (!entry) {
+        if (event->type == SDL_SYSWMEVENT) {
+            SDL_ReleaseSysWMEvent(event);
+        }
+        return 0;
+    }
 
     entry->event = *event;
-    if (event->type == SDL_SYSWMEVENT) {
-        entry->msg = *event->syswm.msg;
-        entry->event.syswm.msg = &entry->msg;
+    entry->sequence = SDL_EventQ.sequence++;
+
+    category_id = SDL_EventCategory(event->type);
+    category = &SDL_EventQ.categories[category_id];
+    if (category->tail) {
+        category->tail->category_next = entry;
+        entry->category_prev = category->tail;
+    } else {
+        entry->category_prev = NULL;
+        category->head = entry;
+        SDL_EventQ.used_categories[category_id / 32] |= (1u << (category_id % 32));
     }
+    entry->category_next = NULL;
+    category->tail = entry;
+    ++category->count;
 
     if (SDL_EventQ.tail) {
         SDL_EventQ.tail->next = entry;
@@ -238,6 +632,9 @@ SDL_AddEvent(SDL_Event * event)
 static void
 SDL_CutEvent(SDL_EventEntry *entry)
 {
+    SDL_EventCategoryList *category;
+    Uint32 category_id;
+
     if (entry->prev) {
         entry->prev->next = entry->next;
     }
@@ -254,18 +651,521 @@ SDL_CutEvent(SDL_EventEntry *entry)
         SDL_EventQ.tail = entry->prev;
     }
 
+    category_id = SDL_EventCategory(entry->event.type);
+    category = &SDL_EventQ.categories[category_id];
+    if (entry->category_prev) {
+        entry->category_prev->category_next = entry->category_next;
+    } else {
+        category->head = entry->category_next;
+    }
+    if (entry->category_next) {
+        entry->category_next->category_prev = entry->category_prev;
+    } else {
+        category->tail = entry->category_prev;
+    }
+    SDL_assert(category->count > 0);
+    if (--category->count == 0) {
+        SDL_EventQ.used_categories[category_id / 32] &= ~(1u << (category_id % 32));
+    }
+
+    if (entry->event.type == SDL_SYSWMEVENT) {
+        SDL_ReleaseSysWMEvent(&entry->event);
+    }
+
     entry->next = SDL_EventQ.free;
     SDL_EventQ.free = entry;
     SDL_assert(SDL_EventQ.count > 0);
     --SDL_EventQ.count;
 }
 
+/* Push a run of events into the ring without taking the lock, claiming
+   all of their slots at once. Returns how many events made it in, fewer
+   than asked for (or 0) if the ring is full. */
+static int
+SDL_PushEventRing(const SDL_Event * events, int numevents)
+{
+    SDL_EventRing *ring = &SDL_EventQ.ring;
+    SDL_EventSlot *slot;
+    unsigned queue_pos;
+    unsigned slot_seq;
+    int delta, i;
+
+    if (numevents > SDL_EVENT_RING_SIZE) {
+        numevents = SDL_EVENT_RING_SIZE;
+    }
+
+    queue_pos = (unsigned)SDL_RingLoad(&ring->enqueue_pos);
+    for ( ; ; ) {
+        /* Slots are freed in order, so if the last one is free so are the
+           ones before it */
+        slot = &ring->slots[(queue_pos + numevents - 1) & SDL_EVENT_RING_MASK];
+        slot_seq = (unsigned)SDL_RingLoad(&slot->s.sequence);
+        SDL_MemoryBarrierAcquire();
+
+        delta = (int)(slot_seq - (queue_pos + numevents - 1));
+        if (delta == 0) {
+            /* The slots and the queue position match, try to claim them */
+            if (SDL_AtomicCAS(&ring->enqueue_pos, (int)queue_pos, (int)(queue_pos + numevents))) {
+                for (i = 0; i < numevents; ++i) {
+                    slot = &ring->slots[(queue_pos + i) & SDL_EVENT_RING_MASK];
+                    slot->s.event = events[i];
+                    SDL_MemoryBarrierRelease();
+                    SDL_RingStore(&slot->s.sequence, (int)(queue_pos + i + 1));
+                }
+                return numevents;
+            }
+        } else if (delta < 0) {
+            /* The slot still holds an event from the last lap, try to fit
+               fewer events before giving up */
+            if (numevents == 1) {
+                return 0;
+            }
+            numevents /= 2;
+        } else {
+            /* Another producer got here first, get the new queue position */
+            queue_pos = (unsigned)SDL_RingLoad(&ring->enqueue_pos);
+        }
+    }
+}
+
+/* Take the oldest event out of the ring -- called with the queue locked.
+   Everything in the ring is newer than anything in the queue. */
+static SDL_bool
+SDL_PopEventRing(SDL_Event * event)
+{
+    SDL_EventRing *ring = &SDL_EventQ.ring;
+    SDL_EventSlot *slot;
+
+    if (!ring->slots) {
+        return SDL_FALSE;
+    }
+
+    slot = &ring->slots[ring->dequeue_pos & SDL_EVENT_RING_MASK];
+    if ((unsigned)SDL_RingLoad(&slot->s.sequence) != ring->dequeue_pos + 1) {
+        /* Empty, or the next event is still being written */
+        return SDL_FALSE;
+    }
+    SDL_MemoryBarrierAcquire();
+    *event = slot->s.event;
+    SDL_MemoryBarrierRelease();
+    SDL_RingStore(&slot->s.sequence, (int)(ring->dequeue_pos + SDL_EVENT_RING_SIZE));
+    ++ring->dequeue_pos;
+    return SDL_TRUE;
+}
+
+/* Move the events pushed so far from the ring to the queue, in order
+   -- called with the queue locked */
+static void
+SDL_DrainEventRing(void)
+{
+    SDL_Event event;
+
+    /* When the queue is full leave them; once the ring fills up too,
+       pushes report the error */
+    while (SDL_EventQ.count < SDL_MAX_QUEUED_EVENTS && SDL_PopEventRing(&event)) {
+        SDL_AddEvent(&event);
+    }
+}
+
+/* Are there any events, taken out of the ring or not -- called with the
+   queue locked */
+static SDL_bool
+SDL_EventsPending(void)
+{
+    SDL_EventRing *ring = &SDL_EventQ.ring;
+
+    if (SDL_EventQ.count > 0) {
+        return SDL_TRUE;
+    }
+    /* Also counts events still being written, those wake us up anyway */
+    return (ring->slots && (unsigned)SDL_RingLoad(&ring->enqueue_pos) != ring->dequeue_pos);
+}
+
+/* Let a thread in SDL_WaitEventTimeout() know about new events */
+static void
+SDL_WakeEventWaiters(void)
+{
+    SDL_VideoDevice *_this;
+
+    /* Waiters sleep until this changes. Both are full barriers, so either
+       we see the waiter here or it sees the new count before it sleeps. */
+    SDL_AtomicAdd(&SDL_EventQ.wakeups, 1);
+    if (SDL_AtomicGet(&SDL_EventQ.waiters) == 0) {
+        return;
+    }
+
+    _this = SDL_GetVideoDevice();
+    if (_this && _this->WaitEventTimeout && _this->SendWakeupEvent) {
+        _this->SendWakeupEvent(_this);
+    } else if (SDL_EventQ.wait_cond) {
+        SDL_LockMutex(SDL_EventQ.lock);
+        SDL_CondBroadcast(SDL_EventQ.wait_cond);
+        SDL_UnlockMutex(SDL_EventQ.lock);
+    }
+}
+
+/* Sleep until events may have arrived or the timeout, in milliseconds or
+   -1 for none, expires */
+static void
+SDL_WaitForEvents(int timeout)
+{
+    SDL_VideoDevice *_this = SDL_GetVideoDevice();
+    SDL_bool pending;
+    int wakeups;
+
+    /* A video driver that can't block for its input only has it read by
+       SDL_PumpEvents(), so come back for another pump at least as often as
+       the old polling loop did */
+    if (_this && !_this->WaitEventTimeout) {
+        if (timeout < 0 || timeout > 10) {
+            timeout = 10;
+        }
+    }
+
+#if !SDL_JOYSTICK_DISABLED
+    /* Joysticks only report changes when SDL_PumpEvents() polls them */
+    if (SDL_WasInit(SDL_INIT_JOYSTICK) &&
+        (!SDL_disabled_events[SDL_JOYAXISMOTION >> 8] || SDL_JoystickEventState(SDL_QUERY))) {
+        if (timeout < 0 || timeout > 10) {
+            timeout = 10;
+        }
+    }
+#endif
+
+    if (!(_this && _this->WaitEventTimeout) && !SDL_EventQ.wait_cond) {
+        /* Nothing to block on, poll */
+        SDL_Delay((timeout < 0 || timeout > 10) ? 10 : timeout);
+        return;
+    }
+
+    /* Events added from here on change the wakeup count, so testing it
+       under the lock that SDL_WakeEventWaiters() signals with can't miss
+       one. Events added before are seen as pending. */
+    SDL_AtomicAdd(&SDL_EventQ.waiters, 1);
+    wakeups = SDL_AtomicGet(&SDL_EventQ.wakeups);
+    SDL_LockEventQueue();
+    pending = SDL_EventsPending();
+    if (!pending && !(_this && _this->WaitEventTimeout) &&
+        SDL_AtomicGet(&SDL_EventQ.wakeups) == wakeups) {
+        SDL_CondWaitTimeout(SDL_EventQ.wait_cond, SDL_EventQ.lock,
+                            (timeout < 0) ? SDL_MUTEX_MAXWAIT : (Uint32)timeout);
+    }
+    SDL_UnlockEventQueue();
+    if (!pending && _this && _this->WaitEventTimeout &&
+        SDL_AtomicGet(&SDL_EventQ.wakeups) == wakeups) {
+        /* A wakeup sent after this check is kept by the driver */
+        _this->WaitEventTimeout(_this, timeout);
+    }
+    SDL_AtomicAdd(&SDL_EventQ.waiters, -1);
+}
+
+/* Add events to the back of the queue, from any thread */
+static int
+SDL_AddEvents(SDL_Event * events, int numevents)
+{
+    int i, pushed, used = 0;
+
+    if (!SDL_EventQ.ring.slots) {
+        /* No ring yet, straight into the queue */
+        if (SDL_EventQ.lock && SDL_LockMutex(SDL_EventQ.lock) < 0) {
+            return SDL_SetError("Couldn't lock event queue");
+        }
+        for (i = 0; i < numevents; ++i) {
+            SDL_Event event = events[i];
+            if (event.type == SDL_SYSWMEVENT && !SDL_StoreSysWMEvent(&event)) {
+                continue;
+            }
+            used += SDL_AddEvent(&event);
+        }
+        SDL_UnlockEventQueue();
+        if (used) {
+            SDL_WakeEventWaiters();
+        }
+        return used;
+    }
+
+    for (i = 0; i < numevents; i += pushed) {
+        SDL_Event wmevent;
+        const SDL_Event *run = &events[i];
+        int runlength = 1;
+        SDL_bool full = SDL_FALSE;
+
+        if (events[i].type == SDL_SYSWMEVENT) {
+            SDL_bool stored;
+
+            wmevent = events[i];
+            SDL_LockEventQueue();
+            stored = SDL_StoreSysWMEvent(&wmevent);
+            SDL_UnlockEventQueue();
+            if (!stored) {
+                pushed = 1;
+                continue;
+            }
+            run = &wmevent;
+        } else {
+            /* Everything up to the next SDL_SYSWMEVENT goes in at once */
+            while (i + runlength < numevents &&
+                   events[i + runlength].type != SDL_SYSWMEVENT) {
+                ++runlength;
+            }
+        }
+
+        /* Even when the ring is full the events go through it, anything
+           else could overtake events of the same thread still in there */
+        while ((pushed = SDL_PushEventRing(run, runlength)) == 0) {
+            unsigned dequeue_pos;
+
+            SDL_LockEventQueue();
+            dequeue_pos = SDL_EventQ.ring.dequeue_pos;
+            SDL_DrainEventRing();
+            /* Full only if nothing could move on to the queue; whatever
+               did made room in the ring for another try */
+            full = (SDL_EventQ.count >= SDL_MAX_QUEUED_EVENTS &&
+                    SDL_EventQ.ring.dequeue_pos == dequeue_pos);
+            if (full) {
+                SDL_SetError("Event queue is full (%d events)", SDL_EventQ.count);
+                if (run == &wmevent) {
+                    SDL_ReleaseSysWMEvent(&wmevent);
+                }
+            }
+            SDL_UnlockEventQueue();
+
+            if (full) {
+                break;
+            }
+        }
+        if (full) {
+            break;
+        }
+        used += pushed;
+    }
+    if (used) {
+        SDL_WakeEventWaiters();
+    }
+    return used;
+}
+
+/* Nanoseconds since the ticks started at a performance counter value */
+static Uint64
+SDL_EventCounterToNS(Uint64 counter)
+{
+    Uint64 ns, delta;
+
+    if (!SDL_EventClock.frequency || counter < SDL_EventClock.base_counter) {
+        return 0;
+    }
+    delta = counter - SDL_EventClock.base_counter;
+    ns = (Uint64)SDL_EventClock.base_ticks * 1000000;
+    if (SDL_EventClock.frequency == 1000000000) {
+        return ns + delta;
+    }
+    ns += (delta / SDL_EventClock.frequency) * 1000000000;
+    ns += ((delta % SDL_EventClock.frequency) * 1000000000) / SDL_EventClock.frequency;
+    return ns;
+}
+
+void
+SDL_SetEventAcquisitionTime(Uint64 counter)
+{
+    Uint64 *acquired;
+
+    if (!SDL_EventClock.acquired) {
+        return;
+    }
+    /* A counter doesn't fit in a pointer everywhere, so each thread gets
+       one allocated the first time it sets one */
+    acquired = (Uint64 *)SDL_TLSGet(SDL_EventClock.acquired);
+    if (!acquired) {
+        if (!counter) {
+            return;
+        }
+        acquired = (Uint64 *)SDL_malloc(sizeof(*acquired));
+        if (!acquired || SDL_TLSSet(SDL_EventClock.acquired, acquired, SDL_free) < 0) {
+            SDL_free(acquired);
+            return;
+        }
+    }
+    *acquired = counter;
+}
+
+/* The time to stamp events pushed now with */
+static Uint32
+SDL_GetEventAcquisitionTime(void)
+{
+    const Uint64 *acquired = NULL;
+    Uint64 counter;
+
+    if (SDL_EventClock.acquired) {
+        acquired = (const Uint64 *)SDL_TLSGet(SDL_EventClock.acquired);
+    }
+    if (acquired && *acquired) {
+        counter = *acquired;
+    } else {
+        counter = SDL_GetPerformanceCounter();
+    }
+    return (Uint32)SDL_EventCounterToNS(counter);
+}
+
+static void
+SDL_SetEventTimestampNS(SDL_Event * event, Uint32 ns)
+{
+    SDL_memcpy(&event->padding[SDL_EVENT_NS_OFFSET], &ns, sizeof(ns));
+}
+
+Uint64
+SDL_GetEventTimestampNS(const SDL_Event * event)
+{
+    Uint32 low;
+    Uint64 queued, ns;
+
+    SDL_memcpy(&low, &event->padding[SDL_EVENT_NS_OFFSET], sizeof(low));
+
+    /* The input was acquired shortly before the event was queued, find
+       the latest time before then with the same low bits. The clocks are
+       read one after the other, so allow for the ticks moving on. */
+    queued = ((Uint64)event->common.timestamp + 2) * 1000000;
+    ns = (queued & ~(Uint64)0xFFFFFFFF) | low;
+    if (ns > queued) {
+        if (ns < ((Uint64)1 << 32)) {
+            return 0;
+        }
+        ns -= ((Uint64)1 << 32);
+    }
+    return ns;
+}
+
+static SDL_bool
+SDL_OwnsEventBatch(void)
+{
+    return (SDL_EventBatch.depth > 0 && SDL_EventBatch.thread == SDL_ThreadID());
+}
+
+/* Could this many more events be queued, in the ring or after draining it */
+static SDL_bool
+SDL_EventQueueHasRoom(int numevents)
+{
+    SDL_EventRing *ring = &SDL_EventQ.ring;
+    int used = SDL_EventQ.count;
+    int room = SDL_MAX_QUEUED_EVENTS;
+
+    if (ring->slots) {
+        used += (int)((unsigned)SDL_RingLoad(&ring->enqueue_pos) - ring->dequeue_pos);
+        room += SDL_EVENT_RING_SIZE;
+    }
+    return (used + numevents <= room);
+}
+
+/* Queue the held back events, and return how many of them didn't fit */
+static int
+SDL_SendEventBatch(void)
+{
+    int count = SDL_EventBatch.count;
+    int added = 0;
+
+    SDL_EventBatch.count = 0;
+    if (count > 0 && SDL_EventQ.active) {
+        added = SDL_AddEvents(SDL_EventBatch.events, count);
+        if (added < 0) {
+            added = 0;
+        }
+    }
+    if (added < count) {
+        /* SDL_PushEvent() already said these were queued */
+        SDL_SetError("Event queue is full, %d batched events were dropped", count - added);
+    }
+    return count - added;
+}
+
+/* Queue the events this thread held back before looking at the queue or
+   adding to it some other way */
+static void
+SDL_FlushOwnEventBatch(void)
+{
+    if (SDL_OwnsEventBatch()) {
+        SDL_SendEventBatch();
+    }
+}
+
+void
+SDL_BeginEventBatch(void)
+{
+    if (SDL_OwnsEventBatch()) {
+        ++SDL_EventBatch.depth;
+    } else if (SDL_AtomicCAS(&SDL_EventBatch.owned, 0, 1)) {
+        /* Only one thread batches at a time, the others push as usual */
+        SDL_EventBatch.thread = SDL_ThreadID();
+        SDL_EventBatch.depth = 1;
+    }
+}
+
+int
+SDL_EndEventBatch(void)
+{
+    int dropped = 0;
+
+    if (SDL_OwnsEventBatch() && --SDL_EventBatch.depth == 0) {
+        dropped = SDL_SendEventBatch();
+        SDL_EventBatch.thread = 0;
+        SDL_AtomicSet(&SDL_EventBatch.owned, 0);
+    }
+    return dropped;
+}
+
+/* Find the queued categories overlapping [minType, maxType], store the
+   head of each in 'heads' and return how many events they hold */
+static int
+SDL_GetEventCategories(Uint32 minType, Uint32 maxType,
+                       SDL_EventEntry **heads, int *num_heads)
+{
+    Uint32 id, last;
+    int total = 0;
+
+    *num_heads = 0;
+    if (minType > maxType) {
+        return 0;
+    }
+
+    last = SDL_EventCategory(maxType);
+    for (id = SDL_EventCategory(minType); id <= last; ++id) {
+        if (!SDL_EventQ.used_categories[id / 32]) {
+            id |= 31;
+            continue;
+        }
+        if (SDL_EventQ.used_categories[id / 32] & (1u << (id % 32))) {
+            heads[(*num_heads)++] = SDL_EventQ.categories[id].head;
+            total += SDL_EventQ.categories[id].count;
+        }
+    }
+    return total;
+}
+
+/* Take the oldest of the category heads and advance past it */
+static SDL_EventEntry *
+SDL_NextEventInOrder(SDL_EventEntry **heads, int num_heads)
+{
+    SDL_EventEntry *entry;
+    int i, oldest = -1;
+
+    for (i = 0; i < num_heads; ++i) {
+        if (heads[i] &&
+            (oldest < 0 || (Sint32)(heads[i]->sequence - heads[oldest]->sequence) < 0)) {
+            oldest = i;
+        }
+    }
+    if (oldest < 0) {
+        return NULL;
+    }
+    entry = heads[oldest];
+    heads[oldest] = entry->category_next;
+    return entry;
+}
+
 /* Lock the event queue, take a peep at it, and unlock it */
 int
 SDL_PeepEvents(SDL_Event * events, int numevents, SDL_eventaction action,
                Uint32 minType, Uint32 maxType)
 {
-    int i, used;
+    int used;
 
     /* Don't look after we've quit */
     if (!SDL_EventQ.active) {
@@ -275,64 +1175,85 @@ SDL_PeepEvents(SDL_Event * events, int numevents, SDL_eventaction action,
         }
         return (-1);
     }
+    SDL_FlushOwnEventBatch();
+    if (action == SDL_ADDEVENT) {
+        return SDL_AddEvents(events, numevents);
+    }
+
     /* Lock the event queue */
     used = 0;
     if (!SDL_EventQ.lock || SDL_LockMutex(SDL_EventQ.lock) == 0) {
-        if (action == SDL_ADDEVENT) {
-            for (i = 0; i < numevents; ++i) {
-                used += SDL_AddEvent(&events[i]);
-            }
-        } else {
-            SDL_EventEntry *entry, *next;
-            SDL_SysWMEntry *wmmsg, *wmmsg_next;
-            SDL_Event tmpevent;
-            Uint32 type;
-
-            /* If 'events' is NULL, just see if they exist */
-            if (events == NULL) {
-                action = SDL_PEEKEVENT;
-                numevents = 1;
-                events = &tmpevent;
-            }
+        SDL_EventEntry *entry, *next;
+        SDL_EventEntry *heads[SDL_NUM_EVENT_CATEGORIES];
+        int num_heads;
+        SDL_SysWMEntry *wmmsg, *wmmsg_next;
+        SDL_Event tmpevent, ringevent;
+        Uint32 type;
+
+        /* If 'events' is NULL, just see if they exist */
+        if (events == NULL) {
+            action = SDL_PEEKEVENT;
+            numevents = 1;
+            events = &tmpevent;
+        }
+
+        /* Clean out any used wmmsg data
+           FIXME: Do we want to retain the data for some period of time?
+         */
+        for (wmmsg = SDL_EventQ.wmmsg_used; wmmsg; wmmsg = wmmsg_next) {
+            wmmsg_next = wmmsg->next;
+            wmmsg->next = SDL_EventQ.wmmsg_free;
+            SDL_EventQ.wmmsg_free = wmmsg;
+        }
+        SDL_EventQ.wmmsg_used = NULL;
+
+        /* Motion is only merged in the queue, so don't take it straight
+           from the ring */
+        if (SDL_EventQ.coalesce) {
+            SDL_DrainEventRing();
+        }
 
-            /* Clean out any used wmmsg data
-               FIXME: Do we want to retain the data for some period of time?
-             */
-            for (wmmsg = SDL_EventQ.wmmsg_used; wmmsg; wmmsg = wmmsg_next) {
-                wmmsg_next = wmmsg->next;
-                wmmsg->next = SDL_EventQ.wmmsg_free;
-                SDL_EventQ.wmmsg_free = wmmsg;
+        /* Only visit the categories in range, unless that's everything */
+        if (SDL_GetEventCategories(minType, maxType, heads, &num_heads) == SDL_EventQ.count) {
+            num_heads = 0;
+        }
+        entry = num_heads ? SDL_NextEventInOrder(heads, num_heads) : SDL_EventQ.head;
+        for ( ; entry && used < numevents; entry = next) {
+            next = num_heads ? SDL_NextEventInOrder(heads, num_heads) : entry->next;
+            type = entry->event.type;
+            if (minType <= type && type <= maxType) {
+                events[used] = entry->event;
+                if (entry->event.type == SDL_SYSWMEVENT) {
+                    SDL_ExportSysWMEvent(&events[used]);
+                }
+                ++used;
+
+                if (action == SDL_GETEVENT) {
+                    SDL_CutEvent(entry);
+                }
             }
-            SDL_EventQ.wmmsg_used = NULL;
+        }
 
-            for (entry = SDL_EventQ.head; entry && used < numevents; entry = next) {
-                next = entry->next;
-                type = entry->event.type;
-                if (minType <= type && type <= maxType) {
-                    events[used] = entry->event;
-                    if (entry->event.type == SDL_SYSWMEVENT) {
-                        /* We need to copy the wmmsg somewhere safe.
-                           For now we'll guarantee it's valid at least until
-                           the next call to SDL_PeepEvents()
-                         */
-                        if (SDL_EventQ.wmmsg_free) {
-                            wmmsg = SDL_EventQ.wmmsg_free;
-                            SDL_EventQ.wmmsg_free = wmmsg->next;
-                        } else {
-                            wmmsg = (SDL_SysWMEntry *)SDL_malloc(sizeof(*wmmsg));
-                        }
-                        wmmsg->msg = *entry->event.syswm.msg;
-                        wmmsg->next = SDL_EventQ.wmmsg_used;
-                        SDL_EventQ.wmmsg_used = wmmsg;
-                        events[used].syswm.msg = &wmmsg->msg;
-                    }
-                    ++used;
+        /* Then the newer events still in the ring; the ones we take
+           don't need to go through the queue at all */
+        while (used < numevents && SDL_EventQ.count < SDL_MAX_QUEUED_EVENTS &&
+               SDL_PopEventRing(&ringevent)) {
+            type = ringevent.type;
+            if (minType <= type && type <= maxType) {
+                events[used] = ringevent;
+                if (type == SDL_SYSWMEVENT) {
+                    SDL_ExportSysWMEvent(&events[used]);
+                }
+                ++used;
 
-                    if (action == SDL_GETEVENT) {
-                        SDL_CutEvent(entry);
+                if (action == SDL_GETEVENT) {
+                    if (type == SDL_SYSWMEVENT) {
+                        SDL_ReleaseSysWMEvent(&ringevent);
                     }
+                    continue;
                 }
             }
+            SDL_AddEvent(&ringevent);
         }
         SDL_UnlockMutex(SDL_EventQ.lock);
     } else {
@@ -341,6 +1262,19 @@ SDL_PeepEvents(SDL_Event * events, int numevents, SDL_eventaction action,
     return (used);
 }
 
+Uint32
+SDL_GetCoalescedEventCount(Uint32 type)
+{
+    int index = SDL_CoalescedEventIndex(type);
+    Uint32 count = 0;
+
+    if (index >= 0 && SDL_EventQ.lock && SDL_LockMutex(SDL_EventQ.lock) == 0) {
+        count = SDL_EventQ.coalesced[index];
+        SDL_UnlockMutex(SDL_EventQ.lock);
+    }
+    return count;
+}
+
 SDL_bool
 SDL_HasEvent(Uint32 type)
 {
@@ -375,15 +1309,23 @@ SDL_FlushEvents(Uint32 minType, Uint32 maxType)
     SDL_PumpEvents();
 #endif
 
+    SDL_FlushOwnEventBatch();
+
     /* Lock the event queue */
     if (SDL_LockMutex(SDL_EventQ.lock) == 0) {
         SDL_EventEntry *entry, *next;
+        SDL_EventEntry *heads[SDL_NUM_EVENT_CATEGORIES];
+        int i, num_heads;
         Uint32 type;
-        for (entry = SDL_EventQ.head; entry; entry = next) {
-            next = entry->next;
-            type = entry->event.type;
-            if (minType <= type && type <= maxType) {
-                SDL_CutEvent(entry);
+        SDL_DrainEventRing();
+        SDL_GetEventCategories(minType, maxType, heads, &num_heads);
+        for (i = 0; i < num_heads; ++i) {
+            for (entry = heads[i]; entry; entry = next) {
+                next = entry->category_next;
+                type = entry->event.type;
+                if (minType <= type && type <= maxType) {
+                    SDL_CutEvent(entry);
+                }
             }
         }
         SDL_UnlockMutex(SDL_EventQ.lock);
@@ -396,6 +1338,9 @@ SDL_PumpEvents(void)
 {
     SDL_VideoDevice *_this = SDL_GetVideoDevice();
 
+    /* Everything that comes in during this pump is queued in one go */
+    SDL_BeginEventBatch();
+
     /* Get events from the video subsystem */
     if (_this) {
         _this->PumpEvents(_this);
@@ -406,6 +1351,8 @@ SDL_PumpEvents(void)
         SDL_JoystickUpdate();
     }
 #endif
+
+    SDL_EndEventBatch();
 }
 
 /* Public functions */
@@ -431,6 +1378,8 @@ SDL_WaitEventTimeout(SDL_Event * event, int timeout)
         expiration = SDL_GetTicks() + timeout;
 
     for (;;) {
+        Uint32 now;
+
         SDL_PumpEvents();
         switch (SDL_PeepEvents(event, 1, SDL_GETEVENT, SDL_FIRSTEVENT, SDL_LASTEVENT)) {
         case -1:
@@ -442,32 +1391,119 @@ SDL_WaitEventTimeout(SDL_Event * event, int timeout)
                 /* Polling and no events, just return */
                 return 0;
             }
-            if (timeout > 0 && SDL_TICKS_PASSED(SDL_GetTicks(), expiration)) {
+            if (timeout < 0) {
+                SDL_WaitForEvents(-1);
+                break;
+            }
+            now = SDL_GetTicks();
+            if (SDL_TICKS_PASSED(now, expiration)) {
                 /* Timeout expired and no events */
                 return 0;
             }
-            SDL_Delay(10);
+            SDL_WaitForEvents((int)(expiration - now));
             break;
         }
     }
 }
 
+/* Free the retired lists if nobody is dispatching, called with
+   SDL_EventWatchers.lock held */
+static void
+SDL_FreeRetiredEventWatchers(void)
+{
+    SDL_EventWatchList *old;
+
+    if (SDL_AtomicGet(&SDL_EventWatchers.readers) == 0) {
+        while (SDL_EventWatchers.retired) {
+            old = SDL_EventWatchers.retired;
+            SDL_EventWatchers.retired = old->next_retired;
+            SDL_free(old);
+        }
+    }
+}
+
+/* Stop counting as a reader. The last one out frees the lists retired
+   while it was dispatching, so they don't pile up when events keep coming;
+   if adding or removing holds the lock, the next one out gets them. */
+static void
+SDL_LeaveEventWatchers(void)
+{
+    if (SDL_AtomicAdd(&SDL_EventWatchers.readers, -1) == 1 &&
+        SDL_EventWatchers.retired && SDL_AtomicTryLock(&SDL_EventWatchers.lock)) {
+        SDL_FreeRetiredEventWatchers();
+        SDL_AtomicUnlock(&SDL_EventWatchers.lock);
+    }
+}
+
+/* Get the current watchers to call, NULL if there are none. Every
+   snapshot returned has to be given back with SDL_ReleaseEventWatchers(). */
+static const SDL_EventWatchList *
+SDL_AcquireEventWatchers(void)
+{
+    const SDL_EventWatchList *list;
+
+    /* Most of the time nobody is watching, don't touch the counter then */
+    if (!SDL_EventWatchers.current) {
+        return NULL;
+    }
+
+    /* This is a full barrier: either whoever replaces the list sees us
+       here and keeps the old one, or we load the new one */
+    SDL_AtomicIncRef(&SDL_EventWatchers.readers);
+    list = SDL_EventWatchers.current;
+    SDL_MemoryBarrierAcquire();
+    if (!list) {
+        SDL_LeaveEventWatchers();
+    }
+    return list;
+}
+
+static void
+SDL_ReleaseEventWatchers(const SDL_EventWatchList *list)
+{
+    if (list) {
+        SDL_MemoryBarrierRelease();
+        SDL_LeaveEventWatchers();
+    }
+}
+
 int
 SDL_PushEvent(SDL_Event * event)
 {
-    SDL_EventWatcher *curr;
+    const SDL_EventWatchList *list;
+    int i;
 
     event->common.timestamp = SDL_GetTicks();
+    SDL_SetEventTimestampNS(event, SDL_GetEventAcquisitionTime());
 
     if (SDL_EventOK && !SDL_EventOK(SDL_EventOKParam, event)) {
         return 0;
     }
 
-    for (curr = SDL_event_watchers; curr; curr = curr->next) {
-        curr->callback(curr->userdata, event);
+    list = SDL_AcquireEventWatchers();
+    if (list) {
+        for (i = 0; i < list->count; ++i) {
+            list->watchers[i].callback(list->watchers[i].userdata, event);
+        }
+        SDL_ReleaseEventWatchers(list);
     }
 
-    if (SDL_PeepEvents(event, 1, SDL_ADDEVENT, 0, 0) <= 0) {
+    /* Hold the event back if we're batching, SDL_SYSWMEVENT messages
+       don't outlive this call so they can't wait */
+    if (SDL_OwnsEventBatch() && event->type != SDL_SYSWMEVENT) {
+        if (!SDL_EventQ.active) {
+            return -1;
+        }
+        if (SDL_EventBatch.count == SDL_EVENT_BATCH_SIZE) {
+            SDL_SendEventBatch();
+        }
+        /* Fail now rather than drop the event when the batch goes in */
+        if (!SDL_EventQueueHasRoom(SDL_EventBatch.count + 1)) {
+            SDL_SetError("Event queue is full (%d events)", SDL_EventQ.count);
+            return -1;
+        }
+        SDL_EventBatch.events[SDL_EventBatch.count++] = *event;
+    } else if (SDL_PeepEvents(event, 1, SDL_ADDEVENT, 0, 0) <= 0) {
         return -1;
     }
 
@@ -476,6 +1512,61 @@ SDL_PushEvent(SDL_Event * event)
     return 1;
 }
 
+int
+SDL_PushEvents(SDL_Event * events, int numevents)
+{
+    SDL_Event batch[32];
+    const SDL_EventWatchList *list;
+    Uint32 timestamp, timestamp_ns;
+    int i, j, w, count, added, total = 0;
+
+    if (!SDL_EventQ.active) {
+        return SDL_SetError("The event system has been shut down");
+    }
+
+    SDL_FlushOwnEventBatch();
+
+    timestamp = SDL_GetTicks();
+    timestamp_ns = SDL_GetEventAcquisitionTime();
+    for (i = 0; i < numevents; ) {
+        count = 0;
+        for ( ; i < numevents && count < SDL_arraysize(batch); ++i) {
+            SDL_Event *event = &events[i];
+
+            event->common.timestamp = timestamp;
+            SDL_SetEventTimestampNS(event, timestamp_ns);
+            if (SDL_EventOK && !SDL_EventOK(SDL_EventOKParam, event)) {
+                continue;
+            }
+            batch[count++] = *event;
+        }
+
+        list = SDL_AcquireEventWatchers();
+        if (list) {
+            for (w = 0; w < list->count; ++w) {
+                const SDL_EventWatcher *watcher = &list->watchers[w];
+                for (j = 0; j < count; ++j) {
+                    watcher->callback(watcher->userdata, &batch[j]);
+                }
+            }
+            SDL_ReleaseEventWatchers(list);
+        }
+
+        added = SDL_AddEvents(batch, count);
+        if (added < 0) {
+            return (total > 0) ? total : -1;
+        }
+        for (j = 0; j < added; ++j) {
+            SDL_GestureProcessEvent(&batch[j]);
+        }
+        total += added;
+        if (added < count) {
+            break;
+        }
+    }
+    return total;
+}
+
 void
 SDL_SetEventFilter(SDL_EventFilter filter, void *userdata)
 {
@@ -498,59 +1589,96 @@ SDL_GetEventFilter(SDL_EventFilter * filter, void **userdata)
     return SDL_EventOK ? SDL_TRUE : SDL_FALSE;
 }
 
-/* FIXME: This is not thread-safe yet */
+/* Publish a new watcher list, called with SDL_EventWatchers.lock held */
+static void
+SDL_ReplaceEventWatchers(SDL_EventWatchList *list)
+{
+    SDL_EventWatchList *old;
+
+    old = (SDL_EventWatchList *)SDL_AtomicSetPtr((void **)&SDL_EventWatchers.current, list);
+    if (old) {
+        old->next_retired = SDL_EventWatchers.retired;
+        SDL_EventWatchers.retired = old;
+    }
+
+    /* Nobody dispatching now can still be looking at a retired list */
+    SDL_FreeRetiredEventWatchers();
+}
+
 void
 SDL_AddEventWatch(SDL_EventFilter filter, void *userdata)
 {
-    SDL_EventWatcher *watcher, *tail;
+    SDL_EventWatchList *list, *old;
+    int count;
 
-    watcher = (SDL_EventWatcher *)SDL_malloc(sizeof(*watcher));
-    if (!watcher) {
+    SDL_AtomicLock(&SDL_EventWatchers.lock);
+    old = SDL_EventWatchers.current;
+    count = old ? old->count : 0;
+
+    list = (SDL_EventWatchList *)SDL_malloc(sizeof(*list) + count * sizeof(list->watchers[0]));
+    if (!list) {
         /* Uh oh... */
+        SDL_AtomicUnlock(&SDL_EventWatchers.lock);
         return;
     }
 
-    /* create the watcher */
-    watcher->callback = filter;
-    watcher->userdata = userdata;
-    watcher->next = NULL;
-
-    /* add the watcher to the end of the list */
-    if (SDL_event_watchers) {
-        for (tail = SDL_event_watchers; tail->next; tail = tail->next) {
-            continue;
-        }
-        tail->next = watcher;
-    } else {
-        SDL_event_watchers = watcher;
+    /* add the watcher to the end of a copy of the list */
+    if (count) {
+        SDL_memcpy(list->watchers, old->watchers, count * sizeof(list->watchers[0]));
     }
+    list->watchers[count].callback = filter;
+    list->watchers[count].userdata = userdata;
+    list->count = count + 1;
+    list->next_retired = NULL;
+
+    SDL_ReplaceEventWatchers(list);
+    SDL_AtomicUnlock(&SDL_EventWatchers.lock);
 }
 
-/* FIXME: This is not thread-safe yet */
 void
 SDL_DelEventWatch(SDL_EventFilter filter, void *userdata)
 {
-    SDL_EventWatcher *prev = NULL;
-    SDL_EventWatcher *curr;
+    SDL_EventWatchList *list, *old;
+    int i;
 
-    for (curr = SDL_event_watchers; curr; prev = curr, curr = curr->next) {
-        if (curr->callback == filter && curr->userdata == userdata) {
-            if (prev) {
-                prev->next = curr->next;
-            } else {
-                SDL_event_watchers = curr->next;
-            }
-            SDL_free(curr);
+    SDL_AtomicLock(&SDL_EventWatchers.lock);
+    old = SDL_EventWatchers.current;
+    for (i = 0; old && i < old->count; ++i) {
+        if (old->watchers[i].callback == filter && old->watchers[i].userdata == userdata) {
             break;
         }
     }
+    if (!old || i == old->count) {
+        SDL_AtomicUnlock(&SDL_EventWatchers.lock);
+        return;
+    }
+
+    if (old->count == 1) {
+        list = NULL;
+    } else {
+        list = (SDL_EventWatchList *)SDL_malloc(sizeof(*list) + (old->count - 2) * sizeof(list->watchers[0]));
+        if (!list) {
+            SDL_AtomicUnlock(&SDL_EventWatchers.lock);
+            return;
+        }
+        SDL_memcpy(list->watchers, old->watchers, i * sizeof(list->watchers[0]));
+        SDL_memcpy(&list->watchers[i], &old->watchers[i + 1], (old->count - i - 1) * sizeof(list->watchers[0]));
+        list->count = old->count - 1;
+        list->next_retired = NULL;
+    }
+
+    SDL_ReplaceEventWatchers(list);
+    SDL_AtomicUnlock(&SDL_EventWatchers.lock);
 }
 
 void
 SDL_FilterEvents(SDL_EventFilter filter, void *userdata)
 {
+    SDL_FlushOwnEventBatch();
+
     if (SDL_EventQ.lock && SDL_LockMutex(SDL_EventQ.lock) == 0) {
         SDL_EventEntry *entry, *next;
+        SDL_DrainEventRing();
         for (entry = SDL_EventQ.head; entry; entry = next) {
             next = entry->next;
             if (!filter(userdata, &entry->event)) {
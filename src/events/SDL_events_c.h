@@ -36,6 +36,19 @@ extern int SDL_StartEventLoop(void);
 extern void SDL_StopEventLoop(void);
 extern void SDL_QuitInterrupt(void);
 
+/* Hold back the events pushed by this thread and queue them together at
+   the end of the batch; batches may nest. SDL_PushEvent() fails for an
+   event that wouldn't fit in the queue, but other threads can fill it up
+   before the batch goes in; SDL_EndEventBatch() returns how many events
+   were dropped then, with the error set. */
+extern void SDL_BeginEventBatch(void);
+extern int SDL_EndEventBatch(void);
+
+/* Stamp the events this thread pushes from now on with the time their input
+   was acquired, in SDL_GetPerformanceCounter() units. Pass 0 to go back to
+   stamping them with the time they are pushed. */
+extern void SDL_SetEventAcquisitionTime(Uint64 counter);
+
 extern int SDL_SendAppEvent(SDL_EventType eventType);
 extern int SDL_SendSysWMEvent(SDL_SysWMmsg * message);
 
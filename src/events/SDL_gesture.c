@@ -25,6 +25,8 @@
 
 #include "SDL_events.h"
 #include "SDL_endian.h"
+#include "SDL_hints.h"
+#include "SDL_thread.h"
 #include "SDL_events_c.h"
 #include "SDL_gesture_c.h"
 
@@ -39,14 +41,39 @@
 #define DOLLARNPOINTS 64
 #define DOLLARSIZE 256
 
+/* Saved templates come in blocks, one per save, so files can be appended
+   to. A block starts with a header of 4 little endian Uint32: the magic,
+   the version, the number of templates and DOLLARNPOINTS. A Uint64 gesture
+   id for each template follows, then for each template its x and then its
+   y coordinates as DOLLARNPOINTS little endian floats each.
+   Older files are just the points of each template, x and y interleaved.
+   As a float, the magic would be far outside the normalized coordinates,
+   which tells the two apart. */
+#define DOLLARMAGIC 0x474C4453  /* "SDLG" */
+#define DOLLARVERSION 1
+#define DOLLARHEADERSIZE (4*sizeof(Uint32))
+#define DOLLARTEMPLATESIZE (sizeof(Uint64) + 2*DOLLARNPOINTS*sizeof(float))
+
 #define ENABLE_DOLLAR
 
 #define PHI 0.618033989
 
+/* Recognitions waiting for the worker thread */
+#define MAXGESTUREJOBS 8
+
 typedef struct {
     float x,y;
 } SDL_FloatPoint;
 
+/* A normalized path, coordinates stored apart so the loops over them
+   vectorize */
+typedef struct {
+    float x[DOLLARNPOINTS];
+    float y[DOLLARNPOINTS];
+    float r[DOLLARNPOINTS];     /* distance of each point from the centroid */
+    float sqnorm;   /* sum of the squared distances from the centroid */
+} SDL_DollarPoints;
+
 typedef struct {
     float length;
 
@@ -55,7 +82,7 @@ typedef struct {
 } SDL_DollarPath;
 
 typedef struct {
-    SDL_FloatPoint path[DOLLARNPOINTS];
+    SDL_DollarPoints path;
     unsigned long hash;
 } SDL_DollarTemplate;
 
@@ -66,8 +93,13 @@ typedef struct {
     Uint16 numDownFingers;
 
     int numDollarTemplates;
+    int maxDollarTemplates;
     SDL_DollarTemplate *dollarTemplate;
 
+    /* Open addressed table of template index + 1 by hash, 0 if unused */
+    int dollarIndexSize;
+    int *dollarIndex;
+
     SDL_bool recording;
 } SDL_GestureTouch;
 
@@ -75,6 +107,40 @@ SDL_GestureTouch *SDL_gestureTouch;
 int SDL_numGestureTouches = 0;
 SDL_bool recordAll;
 
+/* A finger-up to recognize off the event thread */
+typedef struct {
+    SDL_TouchID touchId;
+    SDL_FloatPoint centroid;
+    Uint16 numFingers;
+    SDL_DollarPoints points;
+} SDL_GestureJob;
+
+/* Once the worker is running, 'lock' is held to change the touches or their
+   templates anywhere and to read them on the worker */
+static struct {
+    SDL_mutex *lock;
+    SDL_cond *cond;
+    SDL_Thread *thread;
+    SDL_bool quit;
+    int head;
+    int count;
+    SDL_GestureJob jobs[MAXGESTUREJOBS];
+} SDL_gestureWorker;
+
+static void SDL_LockGestures(void)
+{
+    if (SDL_gestureWorker.lock) {
+        SDL_LockMutex(SDL_gestureWorker.lock);
+    }
+}
+
+static void SDL_UnlockGestures(void)
+{
+    if (SDL_gestureWorker.lock) {
+        SDL_UnlockMutex(SDL_gestureWorker.lock);
+    }
+}
+
 #if 0
 static void PrintPath(SDL_FloatPoint *path)
 {
@@ -101,63 +167,146 @@ int SDL_RecordGesture(SDL_TouchID touchId)
     return (touchId < 0);
 }
 
-static unsigned long SDL_HashDollar(SDL_FloatPoint* points)
+static unsigned long SDL_HashDollar(const SDL_DollarPoints* points)
 {
     unsigned long hash = 5381;
     int i;
     for (i = 0; i < DOLLARNPOINTS; i++) {
-        hash = ((hash<<5) + hash) + (unsigned long)points[i].x;
-        hash = ((hash<<5) + hash) + (unsigned long)points[i].y;
+        hash = ((hash<<5) + hash) + (unsigned long)points->x[i];
+        hash = ((hash<<5) + hash) + (unsigned long)points->y[i];
     }
     return hash;
 }
 
+static void SDL_SetDollarNorms(SDL_DollarPoints* points)
+{
+    int i;
+    points->sqnorm = 0;
+    for (i = 0; i < DOLLARNPOINTS; i++) {
+        float sq = points->x[i]*points->x[i] + points->y[i]*points->y[i];
+        points->r[i] = (float)SDL_sqrt(sq);
+        points->sqnorm += sq;
+    }
+}
+
+static void SDL_SetDollarPoints(SDL_DollarPoints* points, const SDL_FloatPoint* path)
+{
+    int i;
+    for (i = 0; i < DOLLARNPOINTS; i++) {
+        points->x[i] = path[i].x;
+        points->y[i] = path[i].y;
+    }
+    SDL_SetDollarNorms(points);
+}
+
+static int SDL_DollarIndexSlot(const SDL_GestureTouch* touch, unsigned long hash)
+{
+    return (int)((hash ^ (hash >> 15)) & (touch->dollarIndexSize - 1));
+}
+
+/* Called with the gestures locked, after the template at index is set */
+static void SDL_IndexDollarTemplate(SDL_GestureTouch* touch, int index)
+{
+    int slot = SDL_DollarIndexSlot(touch, touch->dollarTemplate[index].hash);
+    while (touch->dollarIndex[slot]) {
+        slot = (slot + 1) & (touch->dollarIndexSize - 1);
+    }
+    touch->dollarIndex[slot] = index + 1;
+}
+
+/* Returns the first template added with the hash, or -1 */
+static int SDL_FindDollarTemplate(const SDL_GestureTouch* touch, unsigned long hash)
+{
+    int slot, index;
+
+    if (!touch->dollarIndex) {
+        return -1;
+    }
+    slot = SDL_DollarIndexSlot(touch, hash);
+    while ((index = touch->dollarIndex[slot]) != 0) {
+        if (touch->dollarTemplate[index - 1].hash == hash) {
+            return index - 1;
+        }
+        slot = (slot + 1) & (touch->dollarIndexSize - 1);
+    }
+    return -1;
+}
+
 
-static int SaveTemplate(SDL_DollarTemplate *templ, SDL_RWops *dst)
+static int SaveTemplates(SDL_DollarTemplate **templates, int numTemplates, SDL_RWops *dst)
 {
+    size_t size = DOLLARHEADERSIZE + numTemplates*DOLLARTEMPLATESIZE;
+    Uint8 *data;
+    Uint32 *header;
+    Uint64 *hashes;
+    float *points;
+    int i,j;
+
     if (dst == NULL) {
         return 0;
     }
 
-    /* No Longer storing the Hash, rehash on load */
-    /* if (SDL_RWops.write(dst, &(templ->hash), sizeof(templ->hash), 1) != 1) return 0; */
-
-#if SDL_BYTEORDER == SDL_LIL_ENDIAN
-    if (SDL_RWwrite(dst, templ->path,
-                    sizeof(templ->path[0]),DOLLARNPOINTS) != DOLLARNPOINTS) {
+    data = (Uint8 *)SDL_malloc(size);
+    if (!data) {
+        SDL_OutOfMemory();
         return 0;
     }
-#else
-    {
-        SDL_DollarTemplate copy = *templ;
-        SDL_FloatPoint *p = copy.path;
-        int i;
-        for (i = 0; i < DOLLARNPOINTS; i++, p++) {
-            p->x = SDL_SwapFloatLE(p->x);
-            p->y = SDL_SwapFloatLE(p->y);
-        }
 
-        if (SDL_RWwrite(dst, copy.path,
-                        sizeof(copy.path[0]),DOLLARNPOINTS) != DOLLARNPOINTS) {
-            return 0;
+    header = (Uint32 *)data;
+    header[0] = SDL_SwapLE32(DOLLARMAGIC);
+    header[1] = SDL_SwapLE32(DOLLARVERSION);
+    header[2] = SDL_SwapLE32(numTemplates);
+    header[3] = SDL_SwapLE32(DOLLARNPOINTS);
+
+    hashes = (Uint64 *)(data + DOLLARHEADERSIZE);
+    points = (float *)(hashes + numTemplates);
+    for (i = 0; i < numTemplates; i++) {
+        const SDL_DollarPoints *path = &templates[i]->path;
+        hashes[i] = SDL_SwapLE64(templates[i]->hash);
+        for (j = 0; j < DOLLARNPOINTS; j++) {
+            points[j] = SDL_SwapFloatLE(path->x[j]);
+            points[DOLLARNPOINTS + j] = SDL_SwapFloatLE(path->y[j]);
         }
+        points += 2*DOLLARNPOINTS;
     }
-#endif
 
-    return 1;
+    if (SDL_RWwrite(dst, data, size, 1) != 1) {
+        numTemplates = 0;
+    }
+    SDL_free(data);
+
+    return numTemplates;
 }
 
 
 int SDL_SaveAllDollarTemplates(SDL_RWops *dst)
 {
-    int i,j,rtrn = 0;
+    SDL_DollarTemplate **templates;
+    int i,j,numTemplates = 0;
+
+    for (i = 0; i < SDL_numGestureTouches; i++) {
+        numTemplates += SDL_gestureTouch[i].numDollarTemplates;
+    }
+    if (numTemplates == 0) {
+        return 0;
+    }
+
+    templates = (SDL_DollarTemplate **)SDL_malloc(numTemplates*sizeof(*templates));
+    if (!templates) {
+        SDL_OutOfMemory();
+        return 0;
+    }
+    numTemplates = 0;
     for (i = 0; i < SDL_numGestureTouches; i++) {
         SDL_GestureTouch* touch = &SDL_gestureTouch[i];
         for (j = 0; j < touch->numDollarTemplates; j++) {
-            rtrn += SaveTemplate(&touch->dollarTemplate[j], dst);
+            templates[numTemplates++] = &touch->dollarTemplate[j];
         }
     }
-    return rtrn;
+
+    numTemplates = SaveTemplates(templates, numTemplates, dst);
+    SDL_free(templates);
+    return numTemplates;
 }
 
 int SDL_SaveDollarTemplate(SDL_GestureID gestureId, SDL_RWops *dst)
@@ -165,37 +314,82 @@ int SDL_SaveDollarTemplate(SDL_GestureID gestureId, SDL_RWops *dst)
     int i,j;
     for (i = 0; i < SDL_numGestureTouches; i++) {
         SDL_GestureTouch* touch = &SDL_gestureTouch[i];
-        for (j = 0; j < touch->numDollarTemplates; j++) {
-            if (touch->dollarTemplate[j].hash == gestureId) {
-                return SaveTemplate(&touch->dollarTemplate[j], dst);
-            }
+        j = SDL_FindDollarTemplate(touch, (unsigned long)gestureId);
+        if (j >= 0 && touch->dollarTemplate[j].hash == gestureId) {
+            SDL_DollarTemplate *templ = &touch->dollarTemplate[j];
+            return SaveTemplates(&templ, 1, dst);
         }
     }
     return SDL_SetError("Unknown gestureId");
 }
 
-/* path is an already sampled set of points
-Returns the index of the gesture on success, or -1 */
-static int SDL_AddDollarGesture_one(SDL_GestureTouch* inTouch, SDL_FloatPoint* path)
+/* Make room for numTemplates templates, growing the array geometrically so
+   adding them one at a time doesn't copy it every time. The index is kept
+   at most half full.
+   Called with the gestures locked. */
+static int SDL_ReserveDollarTemplates(SDL_GestureTouch* inTouch, int numTemplates)
 {
     SDL_DollarTemplate* dollarTemplate;
-    SDL_DollarTemplate *templ;
-    int index;
+    int maxTemplates = inTouch->maxDollarTemplates;
+    int *dollarIndex;
+    int indexSize;
+    int i;
+
+    if (numTemplates <= maxTemplates) {
+        return 0;
+    }
+    maxTemplates = SDL_max(maxTemplates * 2, 16);
+    maxTemplates = SDL_max(maxTemplates, numTemplates);
+
+    indexSize = 32;
+    while (indexSize < maxTemplates * 2) {
+        indexSize *= 2;
+    }
+    dollarIndex = (int *)SDL_calloc(indexSize, sizeof(int));
+    if (!dollarIndex) {
+        return SDL_OutOfMemory();
+    }
 
-    index = inTouch->numDollarTemplates;
     dollarTemplate =
         (SDL_DollarTemplate *)SDL_realloc(inTouch->dollarTemplate,
-                                          (index + 1) *
+                                          maxTemplates *
                                           sizeof(SDL_DollarTemplate));
     if (!dollarTemplate) {
+        SDL_free(dollarIndex);
         return SDL_OutOfMemory();
     }
     inTouch->dollarTemplate = dollarTemplate;
+    inTouch->maxDollarTemplates = maxTemplates;
+
+    SDL_free(inTouch->dollarIndex);
+    inTouch->dollarIndex = dollarIndex;
+    inTouch->dollarIndexSize = indexSize;
+    for (i = 0; i < inTouch->numDollarTemplates; i++) {
+        SDL_IndexDollarTemplate(inTouch, i);
+    }
+    return 0;
+}
+
+/* path is an already sampled set of points
+Returns the index of the gesture on success, or -1 */
+static int SDL_AddDollarGesture_one(SDL_GestureTouch* inTouch, SDL_FloatPoint* path)
+{
+    SDL_DollarTemplate *templ;
+    int index;
+
+    SDL_LockGestures();
+    index = inTouch->numDollarTemplates;
+    if (SDL_ReserveDollarTemplates(inTouch, index + 1) < 0) {
+        SDL_UnlockGestures();
+        return -1;
+    }
 
     templ = &inTouch->dollarTemplate[index];
-    SDL_memcpy(templ->path, path, DOLLARNPOINTS*sizeof(SDL_FloatPoint));
-    templ->hash = SDL_HashDollar(templ->path);
+    SDL_SetDollarPoints(&templ->path, path);
+    templ->hash = SDL_HashDollar(&templ->path);
+    SDL_IndexDollarTemplate(inTouch, index);
     inTouch->numDollarTemplates++;
+    SDL_UnlockGestures();
 
     return index;
 }
@@ -218,52 +412,84 @@ static int SDL_AddDollarGesture(SDL_GestureTouch* inTouch, SDL_FloatPoint* path)
     return SDL_AddDollarGesture_one(inTouch, path);
 }
 
-int SDL_LoadDollarTemplates(SDL_TouchID touchId, SDL_RWops *src)
+/* Add the templates of a saved block to a touch in one go, the gesture ids
+   go straight into the touch's index */
+static int SDL_AddDollarTemplates(SDL_GestureTouch* inTouch, const Uint8 *data, int numTemplates)
 {
-    int i,loaded = 0;
-    SDL_GestureTouch *touch = NULL;
-    if (src == NULL) return 0;
-    if (touchId >= 0) {
-        for (i = 0; i < SDL_numGestureTouches; i++) {
-            if (SDL_gestureTouch[i].id == touchId) {
-                touch = &SDL_gestureTouch[i];
+    const Uint64 *hashes = (const Uint64 *)data;
+    const Uint8 *points = data + numTemplates*sizeof(Uint64);
+    int i;
+
+    SDL_LockGestures();
+    if (SDL_ReserveDollarTemplates(inTouch, inTouch->numDollarTemplates + numTemplates) < 0) {
+        SDL_UnlockGestures();
+        return -1;
+    }
+
+    for (i = 0; i < numTemplates; i++) {
+        SDL_DollarTemplate *templ = &inTouch->dollarTemplate[inTouch->numDollarTemplates + i];
+
+        templ->hash = (unsigned long)SDL_SwapLE64(hashes[i]);
+        SDL_memcpy(templ->path.x, points, sizeof(templ->path.x));
+        SDL_memcpy(templ->path.y, points + sizeof(templ->path.x), sizeof(templ->path.y));
+        points += 2*DOLLARNPOINTS*sizeof(float);
+
+#if SDL_BYTEORDER != SDL_LIL_ENDIAN
+        {
+            int j;
+            for (j = 0; j < DOLLARNPOINTS; j++) {
+                templ->path.x[j] = SDL_SwapFloatLE(templ->path.x[j]);
+                templ->path.y[j] = SDL_SwapFloatLE(templ->path.y[j]);
             }
         }
-        if (touch == NULL) {
-            return SDL_SetError("given touch id not found");
-        }
+#endif
+        SDL_SetDollarNorms(&templ->path);
+        SDL_IndexDollarTemplate(inTouch, inTouch->numDollarTemplates + i);
     }
+    inTouch->numDollarTemplates += numTemplates;
+    SDL_UnlockGestures();
+
+    return numTemplates;
+}
+
+/* Files from before the header, 'start' holds their first bytes */
+static int SDL_LoadLegacyDollarTemplates(SDL_GestureTouch *touch, SDL_RWops *src,
+                                         const void *start, size_t startSize)
+{
+    int i,loaded = 0;
 
     while (1) {
-        SDL_DollarTemplate templ;
+        SDL_FloatPoint path[DOLLARNPOINTS];
 
-        if (SDL_RWread(src,templ.path,sizeof(templ.path[0]),DOLLARNPOINTS) < DOLLARNPOINTS) {
-            if (loaded == 0) {
+        if (start) {
+            SDL_memcpy(path, start, startSize);
+            start = NULL;
+            if (SDL_RWread(src,(Uint8 *)path+startSize,sizeof(path)-startSize,1) < 1) {
                 return SDL_SetError("could not read any dollar gesture from rwops");
             }
+        } else if (SDL_RWread(src,path,sizeof(path[0]),DOLLARNPOINTS) < DOLLARNPOINTS) {
             break;
         }
 
 #if SDL_BYTEORDER != SDL_LIL_ENDIAN
         for (i = 0; i < DOLLARNPOINTS; i++) {
-            SDL_FloatPoint *p = &templ.path[i];
+            SDL_FloatPoint *p = &path[i];
             p->x = SDL_SwapFloatLE(p->x);
             p->y = SDL_SwapFloatLE(p->y);
         }
 #endif
 
-        if (touchId >= 0) {
+        if (touch) {
             /* printf("Adding loaded gesture to 1 touch\n"); */
-            if (SDL_AddDollarGesture(touch, templ.path) >= 0)
+            if (SDL_AddDollarGesture(touch, path) >= 0)
                 loaded++;
         }
         else {
             /* printf("Adding to: %i touches\n",SDL_numGestureTouches); */
             for (i = 0; i < SDL_numGestureTouches; i++) {
-                touch = &SDL_gestureTouch[i];
                 /* printf("Adding loaded gesture to + touches\n"); */
                 /* TODO: What if this fails? */
-                SDL_AddDollarGesture(touch,templ.path);
+                SDL_AddDollarGesture(&SDL_gestureTouch[i],path);
             }
             loaded++;
         }
@@ -272,24 +498,102 @@ int SDL_LoadDollarTemplates(SDL_TouchID touchId, SDL_RWops *src)
     return loaded;
 }
 
+int SDL_LoadDollarTemplates(SDL_TouchID touchId, SDL_RWops *src)
+{
+    int i,loaded = 0;
+    SDL_GestureTouch *touch = NULL;
+    Uint32 header[DOLLARHEADERSIZE/sizeof(Uint32)];
+    int numTemplates;
+    size_t size, maxSize = 0;
+    Uint8 *data = NULL;
+
+    if (src == NULL) return 0;
+    if (touchId >= 0) {
+        for (i = 0; i < SDL_numGestureTouches; i++) {
+            if (SDL_gestureTouch[i].id == touchId) {
+                touch = &SDL_gestureTouch[i];
+            }
+        }
+        if (touch == NULL) {
+            return SDL_SetError("given touch id not found");
+        }
+    }
+
+    if (SDL_RWread(src,header,sizeof(header),1) < 1) {
+        return SDL_SetError("could not read any dollar gesture from rwops");
+    }
+    if (SDL_SwapLE32(header[0]) != DOLLARMAGIC) {
+        return SDL_LoadLegacyDollarTemplates(touch, src, header, sizeof(header));
+    }
+
+    /* Read each block at once, until the end of the file */
+    do {
+        if (SDL_SwapLE32(header[0]) != DOLLARMAGIC ||
+            SDL_SwapLE32(header[1]) != DOLLARVERSION ||
+            SDL_SwapLE32(header[3]) != DOLLARNPOINTS) {
+            SDL_SetError("unsupported dollar gesture file version");
+            break;
+        }
+        numTemplates = (int)SDL_SwapLE32(header[2]);
+        if (numTemplates <= 0 || numTemplates > 0x7FFFFFFF/(int)DOLLARTEMPLATESIZE) {
+            SDL_SetError("could not read any dollar gesture from rwops");
+            break;
+        }
+        size = numTemplates*DOLLARTEMPLATESIZE;
+        if (size > maxSize) {
+            Uint8 *newData = (Uint8 *)SDL_realloc(data, size);
+            if (!newData) {
+                SDL_OutOfMemory();
+                break;
+            }
+            data = newData;
+            maxSize = size;
+        }
+        if (SDL_RWread(src,data,size,1) < 1) {
+            SDL_SetError("could not read any dollar gesture from rwops");
+            break;
+        }
+
+        if (touch) {
+            if (SDL_AddDollarTemplates(touch, data, numTemplates) < 0) {
+                break;
+            }
+        } else {
+            for (i = 0; i < SDL_numGestureTouches; i++) {
+                /* TODO: What if this fails? */
+                SDL_AddDollarTemplates(&SDL_gestureTouch[i], data, numTemplates);
+            }
+        }
+        loaded += numTemplates;
+    } while (SDL_RWread(src,header,sizeof(header),1) == 1);
+    SDL_free(data);
+
+    return (loaded > 0) ? loaded : -1;
+}
+
 
-static float dollarDifference(SDL_FloatPoint* points,SDL_FloatPoint* templ,float ang)
+static float dollarDifference(const SDL_DollarPoints* points,const SDL_DollarPoints* templ,float ang)
 {
-    /*  SDL_FloatPoint p[DOLLARNPOINTS]; */
+    const double c = SDL_cos(ang);
+    const double s = SDL_sin(ang);
     float dist = 0;
-    SDL_FloatPoint p;
     int i;
     for (i = 0; i < DOLLARNPOINTS; i++) {
-        p.x = (float)(points[i].x * SDL_cos(ang) - points[i].y * SDL_sin(ang));
-        p.y = (float)(points[i].x * SDL_sin(ang) + points[i].y * SDL_cos(ang));
-        dist += (float)(SDL_sqrt((p.x-templ[i].x)*(p.x-templ[i].x)+
-                                 (p.y-templ[i].y)*(p.y-templ[i].y)));
+        float dx = (float)(points->x[i] * c - points->y[i] * s) - templ->x[i];
+        float dy = (float)(points->x[i] * s + points->y[i] * c) - templ->y[i];
+        dist += (float)SDL_sqrt(dx*dx + dy*dy);
     }
     return dist/DOLLARNPOINTS;
-
 }
 
-static float bestDollarDifference(SDL_FloatPoint* points,SDL_FloatPoint* templ)
+/* Returns at least 'limit' without searching if the template can't get
+   below it at any rotation. Rotating doesn't change how far a point is from
+   the centroid, so each distance is at least the difference of the two
+   radii. The mean distance is also at least the root of the summed squared
+   distances over DOLLARNPOINTS, and the rotation minimizing those has a
+   closed form. Between them most templates are ruled out without a cos. */
+static float bestDollarDifference(const SDL_DollarPoints* points,const SDL_DollarPoints* templ,
+                                  float limit)
 {
     /*------------BEGIN DOLLAR BLACKBOX------------------
       -TRANSLATED DIRECTLY FROM PSUDEO-CODE AVAILABLE AT-
@@ -298,10 +602,31 @@ static float bestDollarDifference(SDL_FloatPoint* points,SDL_FloatPoint* templ)
     double ta = -M_PI/4;
     double tb = M_PI/4;
     double dt = M_PI/90;
-    float x1 = (float)(PHI*ta + (1-PHI)*tb);
-    float f1 = dollarDifference(points,templ,x1);
-    float x2 = (float)((1-PHI)*ta + PHI*tb);
-    float f2 = dollarDifference(points,templ,x2);
+    float x1, f1, x2, f2;
+    float a = 0, b = 0;
+    float sqdist, dr = 0;
+    int i;
+
+    for (i = 0; i < DOLLARNPOINTS; i++) {
+        dr += (float)SDL_fabs(points->r[i] - templ->r[i]);
+    }
+    if (dr/DOLLARNPOINTS >= limit) {
+        return limit;
+    }
+
+    for (i = 0; i < DOLLARNPOINTS; i++) {
+        a += points->x[i]*templ->x[i] + points->y[i]*templ->y[i];
+        b += points->x[i]*templ->y[i] - points->y[i]*templ->x[i];
+    }
+    sqdist = points->sqnorm + templ->sqnorm - 2*(float)SDL_sqrt(a*a + b*b);
+    if (sqdist > 0 && (float)SDL_sqrt(sqdist)/DOLLARNPOINTS >= limit) {
+        return limit;
+    }
+
+    x1 = (float)(PHI*ta + (1-PHI)*tb);
+    f1 = dollarDifference(points,templ,x1);
+    x2 = (float)((1-PHI)*ta + PHI*tb);
+    f2 = dollarDifference(points,templ,x2);
     while (SDL_fabs(ta-tb) > dt) {
         if (f1 < f2) {
             tb = x2;
@@ -318,12 +643,6 @@ static float bestDollarDifference(SDL_FloatPoint* points,SDL_FloatPoint* templ)
             f2 = dollarDifference(points,templ,x2);
         }
     }
-    /*
-      if (f1 <= f2)
-          printf("Min angle (x1): %f\n",x1);
-      else if (f1 >  f2)
-          printf("Min angle (x2): %f\n",x2);
-    */
     return SDL_min(f1,f2);
 }
 
@@ -420,32 +739,44 @@ static int dollarNormalize(const SDL_DollarPath *path,SDL_FloatPoint *points)
     return numPoints;
 }
 
-static float dollarRecognize(const SDL_DollarPath *path,int *bestTempl,SDL_GestureTouch* touch)
+/* Find the template closest to already normalized points, called with the
+   gestures locked if the worker is running */
+static float dollarMatch(const SDL_DollarPoints *points,int *bestTempl,SDL_GestureTouch* touch)
 {
-    SDL_FloatPoint points[DOLLARNPOINTS];
     int i;
     float bestDiff = 10000;
 
-    SDL_memset(points, 0, sizeof(points));
-
-    dollarNormalize(path,points);
-
-    /* PrintPath(points); */
     *bestTempl = -1;
     for (i = 0; i < touch->numDollarTemplates; i++) {
-        float diff = bestDollarDifference(points,touch->dollarTemplate[i].path);
+        float diff = bestDollarDifference(points,&touch->dollarTemplate[i].path,bestDiff);
         if (diff < bestDiff) {bestDiff = diff; *bestTempl = i;}
     }
     return bestDiff;
 }
 
+static void dollarNormalizePoints(const SDL_DollarPath *path,SDL_DollarPoints *points)
+{
+    SDL_FloatPoint normalized[DOLLARNPOINTS];
+
+    SDL_memset(normalized, 0, sizeof(normalized));
+
+    dollarNormalize(path,normalized);
+
+    /* PrintPath(normalized); */
+    SDL_SetDollarPoints(points, normalized);
+}
+
 int SDL_GestureAddTouch(SDL_TouchID touchId)
 {
-    SDL_GestureTouch *gestureTouch = (SDL_GestureTouch *)SDL_realloc(SDL_gestureTouch,
-                                                                     (SDL_numGestureTouches + 1) *
-                                                                     sizeof(SDL_GestureTouch));
+    SDL_GestureTouch *gestureTouch;
+
+    SDL_LockGestures();
+    gestureTouch = (SDL_GestureTouch *)SDL_realloc(SDL_gestureTouch,
+                                                   (SDL_numGestureTouches + 1) *
+                                                   sizeof(SDL_GestureTouch));
 
     if (!gestureTouch) {
+        SDL_UnlockGestures();
         return SDL_OutOfMemory();
     }
 
@@ -454,6 +785,7 @@ int SDL_GestureAddTouch(SDL_TouchID touchId)
     SDL_zero(SDL_gestureTouch[SDL_numGestureTouches]);
     SDL_gestureTouch[SDL_numGestureTouches].id = touchId;
     SDL_numGestureTouches++;
+    SDL_UnlockGestures();
     return 0;
 }
 
@@ -481,21 +813,136 @@ int SDL_SendGestureMulti(SDL_GestureTouch* touch,float dTheta,float dDist)
     return SDL_PushEvent(&event) > 0;
 }
 
-static int SDL_SendGestureDollar(SDL_GestureTouch* touch,
+static int SDL_SendGestureDollar(const SDL_GestureJob* job,
                           SDL_GestureID gestureId,float error)
 {
     SDL_Event event;
     event.dgesture.type = SDL_DOLLARGESTURE;
-    event.dgesture.touchId = touch->id;
-    event.dgesture.x = touch->centroid.x;
-    event.dgesture.y = touch->centroid.y;
+    event.dgesture.touchId = job->touchId;
+    event.dgesture.x = job->centroid.x;
+    event.dgesture.y = job->centroid.y;
     event.dgesture.gestureId = gestureId;
     event.dgesture.error = error;
-    /* A finger came up to trigger this event. */
-    event.dgesture.numFingers = touch->numDownFingers + 1;
+    event.dgesture.numFingers = job->numFingers;
     return SDL_PushEvent(&event) > 0;
 }
 
+static void SDL_RecognizeGesture(const SDL_GestureJob* job,SDL_GestureTouch* touch)
+{
+    int bestTempl;
+    float error;
+    error = dollarMatch(&job->points,&bestTempl,touch);
+    if (bestTempl >= 0){
+        /* Send Event */
+        unsigned long gestureId = touch->dollarTemplate[bestTempl].hash;
+        SDL_SendGestureDollar(job,gestureId,error);
+        /* printf ("%s\n",);("Dollar error: %f\n",error); */
+    }
+}
+
+static int SDLCALL SDL_GestureWorkerThread(void *data)
+{
+    SDL_GestureJob job;
+    SDL_GestureTouch *touch;
+    int bestTempl = -1;
+    unsigned long gestureId = 0;
+    float error = 0;
+
+    SDL_LockMutex(SDL_gestureWorker.lock);
+    while (!SDL_gestureWorker.quit) {
+        if (SDL_gestureWorker.count == 0) {
+            SDL_CondWait(SDL_gestureWorker.cond, SDL_gestureWorker.lock);
+            continue;
+        }
+        job = SDL_gestureWorker.jobs[SDL_gestureWorker.head];
+        SDL_gestureWorker.head = (SDL_gestureWorker.head + 1) % MAXGESTUREJOBS;
+        --SDL_gestureWorker.count;
+
+        touch = SDL_GetGestureTouch(job.touchId);
+        if (touch) {
+            error = dollarMatch(&job.points,&bestTempl,touch);
+            if (bestTempl >= 0) {
+                gestureId = touch->dollarTemplate[bestTempl].hash;
+            }
+        }
+
+        /* Don't hold up the event thread while the event goes out */
+        if (touch && bestTempl >= 0) {
+            SDL_UnlockMutex(SDL_gestureWorker.lock);
+            SDL_SendGestureDollar(&job,gestureId,error);
+            SDL_LockMutex(SDL_gestureWorker.lock);
+        }
+    }
+    SDL_UnlockMutex(SDL_gestureWorker.lock);
+    return 0;
+}
+
+/* Hand a recognition to the worker thread, starting it if needed.
+   Returns SDL_FALSE if it has to be done right away instead. */
+static SDL_bool SDL_QueueGestureJob(const SDL_GestureJob* job)
+{
+    SDL_bool queued = SDL_FALSE;
+
+    if (!SDL_gestureWorker.thread) {
+        SDL_mutex *lock = SDL_CreateMutex();
+        SDL_cond *cond = SDL_CreateCond();
+        if (!lock || !cond) {
+            SDL_DestroyMutex(lock);
+            SDL_DestroyCond(cond);
+            return SDL_FALSE;
+        }
+        /* From here on the touches are shared with the worker */
+        SDL_gestureWorker.lock = lock;
+        SDL_gestureWorker.cond = cond;
+        SDL_gestureWorker.quit = SDL_FALSE;
+        SDL_gestureWorker.head = 0;
+        SDL_gestureWorker.count = 0;
+        SDL_gestureWorker.thread = SDL_CreateThread(SDL_GestureWorkerThread, "SDLGesture", NULL);
+        if (!SDL_gestureWorker.thread) {
+            SDL_DestroyMutex(lock);
+            SDL_DestroyCond(cond);
+            SDL_zero(SDL_gestureWorker);
+            return SDL_FALSE;
+        }
+    }
+
+    SDL_LockMutex(SDL_gestureWorker.lock);
+    if (SDL_gestureWorker.count < MAXGESTUREJOBS) {
+        int tail = (SDL_gestureWorker.head + SDL_gestureWorker.count) % MAXGESTUREJOBS;
+        SDL_gestureWorker.jobs[tail] = *job;
+        ++SDL_gestureWorker.count;
+        SDL_CondSignal(SDL_gestureWorker.cond);
+        queued = SDL_TRUE;
+    }
+    SDL_UnlockMutex(SDL_gestureWorker.lock);
+    return queued;
+}
+
+void SDL_GestureQuit(void)
+{
+    int i;
+
+    if (SDL_gestureWorker.thread) {
+        SDL_LockMutex(SDL_gestureWorker.lock);
+        SDL_gestureWorker.quit = SDL_TRUE;
+        SDL_CondSignal(SDL_gestureWorker.cond);
+        SDL_UnlockMutex(SDL_gestureWorker.lock);
+        SDL_WaitThread(SDL_gestureWorker.thread, NULL);
+        SDL_DestroyMutex(SDL_gestureWorker.lock);
+        SDL_DestroyCond(SDL_gestureWorker.cond);
+        SDL_zero(SDL_gestureWorker);
+    }
+
+    for (i = 0; i < SDL_numGestureTouches; i++) {
+        SDL_free(SDL_gestureTouch[i].dollarTemplate);
+        SDL_free(SDL_gestureTouch[i].dollarIndex);
+    }
+    SDL_free(SDL_gestureTouch);
+    SDL_gestureTouch = NULL;
+    SDL_numGestureTouches = 0;
+    recordAll = SDL_FALSE;
+}
+
 
 static int SDL_SendDollarRecord(SDL_GestureTouch* touch,SDL_GestureID gestureId)
 {
@@ -525,7 +972,12 @@ void SDL_GestureProcessEvent(SDL_Event* event)
         event->type == SDL_FINGERUP) {
         SDL_GestureTouch* inTouch = SDL_GetGestureTouch(event->tfinger.touchId);
 
-        /* Shouldn't be possible */
+        /* Touches that only exist in events pushed by the application start
+           out here, so gestures can be recorded and played back on them */
+        if (inTouch == NULL && event->type == SDL_FINGERDOWN &&
+            SDL_GestureAddTouch(event->tfinger.touchId) == 0) {
+            inTouch = SDL_GetGestureTouch(event->tfinger.touchId);
+        }
         if (inTouch == NULL) return;
 
         x = event->tfinger.x;
@@ -558,16 +1010,18 @@ void SDL_GestureProcessEvent(SDL_Event* event)
                     SDL_SendDollarRecord(inTouch,-1);
                 }
             }
-            else {
-                int bestTempl;
-                float error;
-                error = dollarRecognize(&inTouch->dollarPath,
-                                        &bestTempl,inTouch);
-                if (bestTempl >= 0){
-                    /* Send Event */
-                    unsigned long gestureId = inTouch->dollarTemplate[bestTempl].hash;
-                    SDL_SendGestureDollar(inTouch,gestureId,error);
-                    /* printf ("%s\n",);("Dollar error: %f\n",error); */
+            else if (inTouch->numDollarTemplates > 0) {
+                SDL_GestureJob job;
+                const char *hint = SDL_GetHint(SDL_HINT_GESTURE_ASYNC);
+
+                job.touchId = inTouch->id;
+                job.centroid = inTouch->centroid;
+                /* A finger came up to trigger this event. */
+                job.numFingers = inTouch->numDownFingers + 1;
+                dollarNormalizePoints(&inTouch->dollarPath,&job.points);
+
+                if (!hint || *hint != '1' || !SDL_QueueGestureJob(&job)) {
+                    SDL_RecognizeGesture(&job,inTouch);
                 }
             }
 #endif
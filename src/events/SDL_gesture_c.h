@@ -29,6 +29,8 @@ extern void SDL_GestureProcessEvent(SDL_Event* event);
 
 extern int SDL_RecordGesture(SDL_TouchID touchId);
 
+extern void SDL_GestureQuit(void);
+
 #endif /* _SDL_gesture_c_h */
 
 /* vi: set ts=4 sw=4 expandtab: */
@@ -22,6 +22,7 @@
 
 /* General keyboard handling code for SDL */
 
+#include "SDL_atomic.h"
 #include "SDL_timer.h"
 #include "SDL_events.h"
 #include "SDL_events_c.h"
@@ -42,10 +43,40 @@ struct SDL_Keyboard
     Uint16 modstate;
     Uint8 keystate[SDL_NUM_SCANCODES];
     SDL_Keycode keymap[SDL_NUM_SCANCODES];
+
+    /* The first scancode of each keycode below 128 in the keymap */
+    SDL_Scancode asciimap[128];
+
+    /* Odd while modstate or keystate are being changed */
+    SDL_atomic_t sequence;
 };
 
 static SDL_Keyboard SDL_keyboard;
 
+/* Modifiers held down with each key, built by SDL_KeyboardInit() */
+static Uint16 SDL_keymods[SDL_NUM_SCANCODES];
+
+/* Modifiers that a key press switches on or off */
+#define SDL_TOGGLE_KEYMODS  (KMOD_NUM | KMOD_CAPS)
+
+static const struct
+{
+    SDL_Scancode scancode;
+    Uint16 mod;
+} SDL_modifier_keys[] = {
+    { SDL_SCANCODE_NUMLOCKCLEAR, KMOD_NUM },
+    { SDL_SCANCODE_CAPSLOCK, KMOD_CAPS },
+    { SDL_SCANCODE_LCTRL, KMOD_LCTRL },
+    { SDL_SCANCODE_RCTRL, KMOD_RCTRL },
+    { SDL_SCANCODE_LSHIFT, KMOD_LSHIFT },
+    { SDL_SCANCODE_RSHIFT, KMOD_RSHIFT },
+    { SDL_SCANCODE_LALT, KMOD_LALT },
+    { SDL_SCANCODE_RALT, KMOD_RALT },
+    { SDL_SCANCODE_LGUI, KMOD_LGUI },
+    { SDL_SCANCODE_RGUI, KMOD_RGUI },
+    { SDL_SCANCODE_MODE, KMOD_MODE },
+};
+
 static const SDL_Keycode SDL_default_keymap[SDL_NUM_SCANCODES] = {
     0, 0, 0, 0,
     'a',
@@ -549,14 +580,47 @@ SDL_UCS4ToUTF8(Uint32 ch, char *dst)
     return dst;
 }
 
+static void
+SDL_UpdateKeymapIndex(SDL_Keyboard *keyboard)
+{
+    SDL_Scancode scancode;
+
+    SDL_zero(keyboard->asciimap);
+    for (scancode = SDL_NUM_SCANCODES; scancode-- > SDL_SCANCODE_UNKNOWN; ) {
+        SDL_Keycode key = keyboard->keymap[scancode];
+        if (key >= 0 && key < SDL_arraysize(keyboard->asciimap)) {
+            keyboard->asciimap[key] = scancode;
+        }
+    }
+}
+
+/* Readers retry while the keyboard state is being changed */
+static void
+SDL_BeginKeyboardUpdate(SDL_Keyboard *keyboard)
+{
+    SDL_AtomicIncRef(&keyboard->sequence);
+}
+
+static void
+SDL_EndKeyboardUpdate(SDL_Keyboard *keyboard)
+{
+    SDL_AtomicIncRef(&keyboard->sequence);
+}
+
 /* Public functions */
 int
 SDL_KeyboardInit(void)
 {
     SDL_Keyboard *keyboard = &SDL_keyboard;
+    int i;
 
     /* Set the default keymap */
     SDL_memcpy(keyboard->keymap, SDL_default_keymap, sizeof(SDL_default_keymap));
+    SDL_UpdateKeymapIndex(keyboard);
+
+    for (i = 0; i < SDL_arraysize(SDL_modifier_keys); ++i) {
+        SDL_keymods[SDL_modifier_keys[i].scancode] = SDL_modifier_keys[i].mod;
+    }
     return (0);
 }
 
@@ -592,6 +656,7 @@ SDL_SetKeymap(int start, SDL_Keycode * keys, int length)
     }
 
     SDL_memcpy(&keyboard->keymap[start], keys, sizeof(*keys) * length);
+    SDL_UpdateKeymapIndex(keyboard);
 }
 
 void
@@ -662,7 +727,7 @@ SDL_SendKeyboardKey(Uint8 state, SDL_Scancode scancode)
 {
     SDL_Keyboard *keyboard = &SDL_keyboard;
     int posted;
-    Uint16 modstate;
+    Uint16 mod, modstate;
     Uint32 type;
     Uint8 repeat;
 
@@ -673,83 +738,6 @@ SDL_SendKeyboardKey(Uint8 state, SDL_Scancode scancode)
     printf("The '%s' key has been %s\n", SDL_GetScancodeName(scancode),
            state == SDL_PRESSED ? "pressed" : "released");
 #endif
-    if (state == SDL_PRESSED) {
-        modstate = keyboard->modstate;
-        switch (scancode) {
-        case SDL_SCANCODE_NUMLOCKCLEAR:
-            keyboard->modstate ^= KMOD_NUM;
-            break;
-        case SDL_SCANCODE_CAPSLOCK:
-            keyboard->modstate ^= KMOD_CAPS;
-            break;
-        case SDL_SCANCODE_LCTRL:
-            keyboard->modstate |= KMOD_LCTRL;
-            break;
-        case SDL_SCANCODE_RCTRL:
-            keyboard->modstate |= KMOD_RCTRL;
-            break;
-        case SDL_SCANCODE_LSHIFT:
-            keyboard->modstate |= KMOD_LSHIFT;
-            break;
-        case SDL_SCANCODE_RSHIFT:
-            keyboard->modstate |= KMOD_RSHIFT;
-            break;
-        case SDL_SCANCODE_LALT:
-            keyboard->modstate |= KMOD_LALT;
-            break;
-        case SDL_SCANCODE_RALT:
-            keyboard->modstate |= KMOD_RALT;
-            break;
-        case SDL_SCANCODE_LGUI:
-            keyboard->modstate |= KMOD_LGUI;
-            break;
-        case SDL_SCANCODE_RGUI:
-            keyboard->modstate |= KMOD_RGUI;
-            break;
-        case SDL_SCANCODE_MODE:
-            keyboard->modstate |= KMOD_MODE;
-            break;
-        default:
-            break;
-        }
-    } else {
-        switch (scancode) {
-        case SDL_SCANCODE_NUMLOCKCLEAR:
-        case SDL_SCANCODE_CAPSLOCK:
-            break;
-        case SDL_SCANCODE_LCTRL:
-            keyboard->modstate &= ~KMOD_LCTRL;
-            break;
-        case SDL_SCANCODE_RCTRL:
-            keyboard->modstate &= ~KMOD_RCTRL;
-            break;
-        case SDL_SCANCODE_LSHIFT:
-            keyboard->modstate &= ~KMOD_LSHIFT;
-            break;
-        case SDL_SCANCODE_RSHIFT:
-            keyboard->modstate &= ~KMOD_RSHIFT;
-            break;
-        case SDL_SCANCODE_LALT:
-            keyboard->modstate &= ~KMOD_LALT;
-            break;
-        case SDL_SCANCODE_RALT:
-            keyboard->modstate &= ~KMOD_RALT;
-            break;
-        case SDL_SCANCODE_LGUI:
-            keyboard->modstate &= ~KMOD_LGUI;
-            break;
-        case SDL_SCANCODE_RGUI:
-            keyboard->modstate &= ~KMOD_RGUI;
-            break;
-        case SDL_SCANCODE_MODE:
-            keyboard->modstate &= ~KMOD_MODE;
-            break;
-        default:
-            break;
-        }
-        modstate = keyboard->modstate;
-    }
-
     /* Figure out what type of event this is */
     switch (state) {
     case SDL_PRESSED:
@@ -763,17 +751,37 @@ SDL_SendKeyboardKey(Uint8 state, SDL_Scancode scancode)
         return 0;
     }
 
+    /* Key events carry the modifiers from before this key went down or
+       after it came up */
+    SDL_BeginKeyboardUpdate(keyboard);
+    mod = SDL_keymods[scancode];
+    if (state == SDL_PRESSED) {
+        modstate = keyboard->modstate;
+        if (mod & SDL_TOGGLE_KEYMODS) {
+            keyboard->modstate ^= mod;
+        } else {
+            keyboard->modstate |= mod;
+        }
+    } else {
+        if (!(mod & SDL_TOGGLE_KEYMODS)) {
+            keyboard->modstate &= ~mod;
+        }
+        modstate = keyboard->modstate;
+    }
+
     /* Drop events that don't change state */
     repeat = (state && keyboard->keystate[scancode]);
     if (keyboard->keystate[scancode] == state && !repeat) {
 #if 0
         printf("Keyboard event didn't change state - dropped!\n");
 #endif
+        SDL_EndKeyboardUpdate(keyboard);
         return 0;
     }
 
     /* Update internal keyboard state */
     keyboard->keystate[scancode] = state;
+    SDL_EndKeyboardUpdate(keyboard);
 
     /* Post the event, if desired */
     posted = 0;
@@ -850,6 +858,39 @@ SDL_GetKeyboardState(int *numkeys)
     return keyboard->keystate;
 }
 
+int
+SDL_GetKeyboardSnapshot(Uint8 *keystate, int numkeys, SDL_Keymod *modstate)
+{
+    SDL_Keyboard *keyboard = &SDL_keyboard;
+    Uint16 mod;
+    int sequence;
+
+    if (numkeys < 0 || (numkeys > 0 && !keystate)) {
+        return SDL_InvalidParamError("numkeys");
+    }
+    numkeys = SDL_min(numkeys, SDL_NUM_SCANCODES);
+
+    for (;;) {
+        sequence = SDL_AtomicGet(&keyboard->sequence);
+        if (sequence & 1) {
+            continue;
+        }
+        if (numkeys > 0) {
+            SDL_memcpy(keystate, keyboard->keystate, numkeys);
+        }
+        mod = keyboard->modstate;
+        SDL_MemoryBarrierAcquire();
+        if (SDL_AtomicGet(&keyboard->sequence) == sequence) {
+            break;
+        }
+    }
+
+    if (modstate) {
+        *modstate = (SDL_Keymod)mod;
+    }
+    return numkeys;
+}
+
 SDL_Keymod
 SDL_GetModState(void)
 {
@@ -863,7 +904,9 @@ SDL_SetModState(SDL_Keymod modstate)
 {
     SDL_Keyboard *keyboard = &SDL_keyboard;
 
+    SDL_BeginKeyboardUpdate(keyboard);
     keyboard->modstate = modstate;
+    SDL_EndKeyboardUpdate(keyboard);
 }
 
 SDL_Keycode
@@ -885,6 +928,10 @@ SDL_GetScancodeFromKey(SDL_Keycode key)
     SDL_Keyboard *keyboard = &SDL_keyboard;
     SDL_Scancode scancode;
 
+    if (key >= 0 && key < SDL_arraysize(keyboard->asciimap)) {
+        return keyboard->asciimap[key];
+    }
+
     for (scancode = SDL_SCANCODE_UNKNOWN; scancode < SDL_NUM_SCANCODES;
          ++scancode) {
         if (keyboard->keymap[scancode] == key) {
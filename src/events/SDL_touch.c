@@ -357,6 +357,8 @@ SDL_TouchQuit(void)
 
     SDL_free(SDL_touchDevices);
     SDL_touchDevices = NULL;
+
+    SDL_GestureQuit();
 }
 
 /* vi: set ts=4 sw=4 expandtab: */
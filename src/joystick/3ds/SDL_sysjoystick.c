@@ -30,6 +30,7 @@
 
 #include "../SDL_sysjoystick.h"
 #include "../SDL_joystick_c.h"
+#include "../../events/SDL_events_c.h"
 
 #include "SDL_events.h"
 #include "SDL_error.h"
@@ -46,8 +47,29 @@ static const u32 button_map[] = {
     KEY_X, KEY_A, KEY_B, KEY_Y,
     KEY_L, KEY_R,
     KEY_DOWN, KEY_LEFT, KEY_UP, KEY_RIGHT,
-    KEY_SELECT, KEY_START, KEY_TOUCH };
-static int analog_map[256];  /* Map analog inputs to -32768 -> 32767 */
+    KEY_SELECT, KEY_START, KEY_TOUCH,
+    KEY_ZL, KEY_ZR };
+
+/* The circle pad reports about -156 to 156 on each axis, the C-stick less */
+#define N3DS_ANALOG_MAX         160
+/* Radius around the center, in raw units, read as no input at all */
+#define N3DS_ANALOG_DEADZONE    15
+/* Smallest change of an axis, in SDL units, worth an event */
+#define N3DS_AXIS_HYSTERESIS    512
+
+/* Farthest from zero, in raw units, a stick may rest and still be taken
+   as its center, anything more is a thumb holding it at open time */
+#define N3DS_ANALOG_CENTER_MAX  24
+
+#define N3DS_NUM_AXES           4
+
+/* Map raw analog inputs (-N3DS_ANALOG_MAX to N3DS_ANALOG_MAX)
+   to SDL joystick positions (-32767 to 32767) */
+static Sint16 analog_map[2*N3DS_ANALOG_MAX + 1];
+/* Last value reported per axis */
+static Sint16 axis_state[N3DS_NUM_AXES];
+/* Resting position of the circle pad and the C-stick, read at open */
+static circlePosition stick_center[N3DS_NUM_AXES / 2];
 
 typedef struct
 {
@@ -119,13 +141,13 @@ int SDL_SYS_JoystickInit(void)
         return SDL_SetError("Can't create input thread");
     }*/
 
-    /* Create an accurate map from analog inputs (0 to 255)
-       to SDL joystick positions (-32768 to 32767) */
-    for (i = 0; i < 128; i++)
+    /* Create an accurate map from analog inputs (-N3DS_ANALOG_MAX to
+       N3DS_ANALOG_MAX) to SDL joystick positions (-32767 to 32767) */
+    for (i = 0; i <= N3DS_ANALOG_MAX; i++)
     {
-        float t = (float)i/127.0f;
-        analog_map[i+128] = calc_bezier_y(t);
-        analog_map[127-i] = -1 * analog_map[i+128];
+        float t = (float)i/N3DS_ANALOG_MAX;
+        analog_map[N3DS_ANALOG_MAX+i] = calc_bezier_y(t);
+        analog_map[N3DS_ANALOG_MAX-i] = -1 * analog_map[N3DS_ANALOG_MAX+i];
     }
 
     return 1;
@@ -162,6 +184,28 @@ const char *SDL_SYS_JoystickName(int index)
     return(NULL);
 }
 
+/* Take where the sticks rest now as their centers. A stick that is off
+   by more than the sticks ever drift is being held, so it keeps zero. */
+static void
+SampleStickCenters(void)
+{
+    circlePosition pos[N3DS_NUM_AXES / 2];
+    int i;
+
+    hidScanInput();
+    hidCircleRead(&pos[0]);
+    hidCstickRead(&pos[1]);
+
+    for (i = 0; i < N3DS_NUM_AXES / 2; i++) {
+        if (pos[i].dx * pos[i].dx + pos[i].dy * pos[i].dy <=
+            N3DS_ANALOG_CENTER_MAX * N3DS_ANALOG_CENTER_MAX) {
+            stick_center[i] = pos[i];
+        } else {
+            SDL_zero(stick_center[i]);
+        }
+    }
+}
+
 /* Function to open a joystick for use.
    The joystick to open is specified by the device index.
    This should fill the nbuttons and naxes fields of the joystick structure.
@@ -169,10 +213,15 @@ const char *SDL_SYS_JoystickName(int index)
  */
 int SDL_SYS_JoystickOpen(SDL_Joystick *joystick, int device_index)
 {
-    joystick->nbuttons = 13;
-    joystick->naxes = 2;
+    /* The C-stick (axes 2 and 3) and ZL/ZR are only there on the New 3DS,
+       other models report them centered and released */
+    joystick->nbuttons = sizeof(button_map)/sizeof(button_map[0]);
+    joystick->naxes = N3DS_NUM_AXES;
     joystick->nhats = 0;
 
+    SDL_zero(axis_state);
+    SampleStickCenters();
+
     return 0;
 }
 
@@ -187,37 +236,72 @@ SDL_bool SDL_SYS_JoystickAttached(SDL_Joystick *joystick)
  * but instead should call SDL_PrivateJoystick*() to deliver events
  * and update joystick device state.
  */
+static void
+SetAxis(SDL_Joystick *joystick, int axis, Sint16 value)
+{
+    int delta = value - axis_state[axis];
+
+    /* Let jitter around the last position go, but always report
+       reaching the center or the rim */
+    if (delta == 0)
+        return;
+    if (value != 0 && value != 32767 && value != -32767 &&
+        delta > -N3DS_AXIS_HYSTERESIS && delta < N3DS_AXIS_HYSTERESIS)
+        return;
+
+    axis_state[axis] = value;
+    SDL_PrivateJoystickAxis(joystick, axis, value);
+}
+
+static void
+UpdateStick(SDL_Joystick *joystick, int axis, const circlePosition *pos)
+{
+    const circlePosition *center = &stick_center[axis / 2];
+    int dx = pos->dx - center->dx;
+    int dy = pos->dy - center->dy;
+    int mag2 = dx*dx + dy*dy;
+    Sint16 x = 0, y = 0;
+
+    if (mag2 > N3DS_ANALOG_DEADZONE*N3DS_ANALOG_DEADZONE) {
+        /* Radial deadzone: stretch what's left of the radius over the
+           full range so there is no jump at its edge */
+        double mag = SDL_sqrt((double)mag2);
+        double scale = (mag - N3DS_ANALOG_DEADZONE) * N3DS_ANALOG_MAX /
+                       ((N3DS_ANALOG_MAX - N3DS_ANALOG_DEADZONE) * mag);
+        int sx = (int)(dx * scale);
+        int sy = (int)(dy * scale);
+
+        sx = SDL_max(-N3DS_ANALOG_MAX, SDL_min(sx, N3DS_ANALOG_MAX));
+        sy = SDL_max(-N3DS_ANALOG_MAX, SDL_min(sy, N3DS_ANALOG_MAX));
+        x = analog_map[N3DS_ANALOG_MAX + sx];
+        /* Up is positive on the 3DS, down is in SDL */
+        y = analog_map[N3DS_ANALOG_MAX - sy];
+    }
+
+    SetAxis(joystick, axis, x);
+    SetAxis(joystick, axis + 1, y);
+}
+
 void SDL_SYS_JoystickUpdate(SDL_Joystick *joystick)
 {
 	int i;
 	u32 buttons;
 	u32 changed;
-	touchPosition touch;
-	circlePosition circle;
-	unsigned char x, y;
+	circlePosition circle, cstick;
 	static u32 old_buttons = 0;
-	static unsigned char old_x = 0, old_y = 0;
 
 	hidScanInput();
-	hidTouchRead(&touch);
+	/* The performance counter is the system tick, stamp the events with
+	   the time the pad was read */
+	SDL_SetEventAcquisitionTime(svcGetSystemTick());
 	hidCircleRead(&circle);
+	hidCstickRead(&cstick);
 
-	//SDL_SemWait(pad_sem);
 	buttons = hidKeysHeld();
-	//printf("held: %i\n", buttons);
-	x = circle.dx;
-	y = circle.dy;
-	//SDL_SemPost(pad_sem);
 
 	/* Axes */
-	if(old_x != x) {
-		SDL_PrivateJoystickAxis(joystick, 0, analog_map[x]);
-		old_x = x;
-	}
-	if(old_y != y) {
-		SDL_PrivateJoystickAxis(joystick, 1, analog_map[y]);
-		old_y = y;
-	}
+	UpdateStick(joystick, 0, &circle);
+	UpdateStick(joystick, 2, &cstick);
 
 	/* Buttons */
 	changed = old_buttons ^ buttons;
@@ -234,6 +318,7 @@ void SDL_SYS_JoystickUpdate(SDL_Joystick *joystick)
 			}
 		}
 	}
+	SDL_SetEventAcquisitionTime(0);
 	//sceKernelDelayThread(0);
 }
 
@@ -653,6 +653,11 @@ SDL_JoystickUpdate(void)
 {
     SDL_Joystick *joystick;
 
+#if !SDL_EVENTS_DISABLED
+    /* Queue the events of all the joysticks together */
+    SDL_BeginEventBatch();
+#endif
+
     joystick = SDL_joysticks;
     while (joystick) {
         SDL_Joystick *joysticknext;
@@ -695,6 +700,10 @@ SDL_JoystickUpdate(void)
        dangling hardware data from removed devices can be free'd
      */
     SDL_SYS_JoystickDetect();
+
+#if !SDL_EVENTS_DISABLED
+    SDL_EndEventBatch();
+#endif
 }
 
 int
@@ -33,11 +33,13 @@
 #include <fcntl.h>
 #include <sys/ioctl.h>
 #include <limits.h>             /* For the definition of PATH_MAX */
+#include <time.h>
 #include <linux/joystick.h>
 
 #include "SDL_assert.h"
 #include "SDL_joystick.h"
 #include "SDL_endian.h"
+#include "SDL_timer.h"
 #include "../SDL_sysjoystick.h"
 #include "../SDL_joystick_c.h"
 #include "SDL_sysjoystick_c.h"
@@ -612,6 +614,17 @@ SDL_SYS_JoystickOpen(SDL_Joystick * joystick, int device_index)
     /* Set the joystick to non-blocking read mode */
     fcntl(fd, F_SETFL, O_NONBLOCK);
 
+#ifdef EVIOCSCLOCKID
+    /* Have the kernel timestamp input on the monotonic clock, which is
+       what the performance counter counts in nanoseconds */
+    if (SDL_GetPerformanceFrequency() == 1000000000) {
+        int clock_id = CLOCK_MONOTONIC;
+        if (ioctl(fd, EVIOCSCLOCKID, &clock_id) == 0) {
+            joystick->hwdata->monotonic_time = SDL_TRUE;
+        }
+    }
+#endif
+
     /* Get the number of buttons and axes on the joystick */
     ConfigJoystick(joystick, fd);
 
@@ -743,6 +756,12 @@ HandleInputEvents(SDL_Joystick * joystick)
         len /= sizeof(events[0]);
         for (i = 0; i < len; ++i) {
             code = events[i].code;
+#if !SDL_EVENTS_DISABLED
+            if (joystick->hwdata->monotonic_time) {
+                SDL_SetEventAcquisitionTime((Uint64)events[i].time.tv_sec * 1000000000 +
+                                            (Uint64)events[i].time.tv_usec * 1000);
+            }
+#endif
             switch (events[i].type) {
             case EV_KEY:
                 if (code >= BTN_MISC) {
@@ -805,6 +824,9 @@ HandleInputEvents(SDL_Joystick * joystick)
             }
         }
     }
+#if !SDL_EVENTS_DISABLED
+    SDL_SetEventAcquisitionTime(0);
+#endif
 }
 
 void
@@ -52,6 +52,9 @@ struct joystick_hwdata
     } abs_correct[ABS_MAX];
 
     int fresh;
+
+    /* Input is timestamped with the clock of SDL_GetPerformanceCounter() */
+    SDL_bool monotonic_time;
 };
 
 /* vi: set ts=4 sw=4 expandtab: */
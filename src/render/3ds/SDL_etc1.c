@@ -0,0 +1,389 @@
+/*
+  Simple DirectMedia Layer
+  Copyright (C) 1997-2014 Sam Lantinga <slouken@libsdl.org>
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+#include "../../SDL_internal.h"
+
+#include "SDL_etc1.h"
+
+/* Pixels are numbered the way ETC1 stores them: i = x*4 + y */
+#define ETC1_PIXEL(rgba, pitch, i)  ((rgba) + ((i) & 3) * (pitch) + ((i) >> 2) * 4)
+
+static const int ETC1_modifiers[8][2] = {
+    { 2, 8 }, { 5, 17 }, { 9, 29 }, { 13, 42 },
+    { 18, 60 }, { 24, 80 }, { 33, 106 }, { 47, 183 }
+};
+
+typedef struct
+{
+    int flip;           /* 0: 2x4 subblocks side by side, 1: 4x2 on top of each other */
+    int diff;           /* differential (555 + 333 delta) or individual (444 444) */
+    int color[2][3];    /* quantized base colors (for diff, color[1] is absolute) */
+    int table[2];
+    Uint8 sel[16];
+} ETC1_Params;
+
+static SDL_INLINE int
+ETC1_Clamp(int v)
+{
+    return (v < 0) ? 0 : ((v > 255) ? 255 : v);
+}
+
+static SDL_INLINE int
+ETC1_Expand(int c, int diff)
+{
+    return diff ? ((c << 3) | (c >> 2)) : (c * 17);
+}
+
+static SDL_INLINE int
+ETC1_InSubblock(int i, int flip)
+{
+    return flip ? ((i & 3) >> 1) : (i >> 3);
+}
+
+static Uint32
+ETC1_ReadBE32(const Uint8 *p)
+{
+    return ((Uint32)p[0] << 24) | ((Uint32)p[1] << 16) | ((Uint32)p[2] << 8) | p[3];
+}
+
+static void
+ETC1_WriteBE32(Uint8 *p, Uint32 v)
+{
+    p[0] = (Uint8)(v >> 24);
+    p[1] = (Uint8)(v >> 16);
+    p[2] = (Uint8)(v >> 8);
+    p[3] = (Uint8)v;
+}
+
+/* Pick the modifier table and selectors for one subblock.
+   Returns the squared error, or bound if it can't beat it. */
+static Uint32
+ETC1_FitSubblock(const int pixels[16][3], int sub, const int base[3],
+                 ETC1_Params *params, Uint32 bound)
+{
+    Uint32 best = bound;
+    int t, i, c, m;
+
+    for (t = 0; t < 8; t++) {
+        Uint8 sel[16];
+        Uint32 err = 0;
+
+        for (i = 0; i < 16 && err < best; i++) {
+            Uint32 pixel_best = 0xFFFFFFFF;
+            if (ETC1_InSubblock(i, params->flip) != sub) {
+                continue;
+            }
+            for (m = 0; m < 4; m++) {
+                const int mod = (m & 2) ? -ETC1_modifiers[t][m & 1] : ETC1_modifiers[t][m & 1];
+                Uint32 e = 0;
+                for (c = 0; c < 3; c++) {
+                    const int d = ETC1_Clamp(base[c] + mod) - pixels[i][c];
+                    e += d * d;
+                }
+                if (e < pixel_best) {
+                    pixel_best = e;
+                    sel[i] = (Uint8)m;
+                }
+            }
+            err += pixel_best;
+        }
+
+        if (err < best) {
+            best = err;
+            params->table[sub] = t;
+            for (i = 0; i < 16; i++) {
+                if (ETC1_InSubblock(i, params->flip) == sub) {
+                    params->sel[i] = sel[i];
+                }
+            }
+        }
+    }
+    return best;
+}
+
+static Uint32
+ETC1_Fit(const int pixels[16][3], ETC1_Params *params, Uint32 bound)
+{
+    Uint32 err = 0;
+    int sub, c;
+
+    for (sub = 0; sub < 2 && err < bound; sub++) {
+        int base[3];
+        for (c = 0; c < 3; c++) {
+            base[c] = ETC1_Expand(params->color[sub][c], params->diff);
+        }
+        err += ETC1_FitSubblock(pixels, sub, base, params, bound - err);
+    }
+    return err;
+}
+
+static void
+ETC1_Pack(const ETC1_Params *p, Uint8 *block)
+{
+    Uint32 hi, lo = 0;
+    int i;
+
+    if (p->diff) {
+        hi = (p->color[0][0] << 27) | (((p->color[1][0] - p->color[0][0]) & 7) << 24) |
+             (p->color[0][1] << 19) | (((p->color[1][1] - p->color[0][1]) & 7) << 16) |
+             (p->color[0][2] << 11) | (((p->color[1][2] - p->color[0][2]) & 7) << 8);
+    } else {
+        hi = (p->color[0][0] << 28) | (p->color[1][0] << 24) |
+             (p->color[0][1] << 20) | (p->color[1][1] << 16) |
+             (p->color[0][2] << 12) | (p->color[1][2] << 8);
+    }
+    hi |= (p->table[0] << 5) | (p->table[1] << 2) | (p->diff << 1) | p->flip;
+
+    for (i = 0; i < 16; i++) {
+        lo |= ((Uint32)(p->sel[i] >> 1) << (16 + i)) | ((Uint32)(p->sel[i] & 1) << i);
+    }
+
+    ETC1_WriteBE32(block, hi);
+    ETC1_WriteBE32(block + 4, lo);
+}
+
+static void
+ETC1_Unpack(const Uint8 *block, ETC1_Params *p)
+{
+    const Uint32 hi = ETC1_ReadBE32(block);
+    const Uint32 lo = ETC1_ReadBE32(block + 4);
+    int i, c;
+
+    p->flip = hi & 1;
+    p->diff = (hi >> 1) & 1;
+    p->table[0] = (hi >> 5) & 7;
+    p->table[1] = (hi >> 2) & 7;
+    for (c = 0; c < 3; c++) {
+        const int shift = 24 - c * 8;
+        if (p->diff) {
+            int delta = (hi >> shift) & 7;
+            if (delta & 4) {
+                delta -= 8;
+            }
+            p->color[0][c] = (hi >> (shift + 3)) & 31;
+            p->color[1][c] = p->color[0][c] + delta;
+        } else {
+            p->color[0][c] = (hi >> (shift + 4)) & 15;
+            p->color[1][c] = (hi >> shift) & 15;
+        }
+    }
+    for (i = 0; i < 16; i++) {
+        p->sel[i] = (Uint8)((((lo >> (16 + i)) & 1) << 1) | ((lo >> i) & 1));
+    }
+}
+
+void
+SDL_ETC1_EncodeBlock(const Uint8 *rgba, int pitch, Uint8 *block)
+{
+    int pixels[16][3];
+    ETC1_Params best, trial;
+    Uint32 best_err = 0xFFFFFFFF;
+    int i, c, sub;
+
+    for (i = 0; i < 16; i++) {
+        const Uint8 *px = ETC1_PIXEL(rgba, pitch, i);
+        for (c = 0; c < 3; c++) {
+            pixels[i][c] = px[c];
+        }
+    }
+
+    best.flip = best.diff = 0;
+    for (sub = 0; sub < 2; sub++) {
+        best.table[sub] = 0;
+        for (c = 0; c < 3; c++) {
+            best.color[sub][c] = 0;
+        }
+    }
+    for (i = 0; i < 16; i++) {
+        best.sel[i] = 0;
+    }
+    trial = best;
+    for (trial.flip = 0; trial.flip < 2; trial.flip++) {
+        int avg[2][3];
+        SDL_bool diff_ok = SDL_TRUE;
+
+        for (sub = 0; sub < 2; sub++) {
+            for (c = 0; c < 3; c++) {
+                avg[sub][c] = 0;
+            }
+        }
+        for (i = 0; i < 16; i++) {
+            sub = ETC1_InSubblock(i, trial.flip);
+            for (c = 0; c < 3; c++) {
+                avg[sub][c] += pixels[i][c];
+            }
+        }
+        for (sub = 0; sub < 2; sub++) {
+            for (c = 0; c < 3; c++) {
+                avg[sub][c] = (avg[sub][c] + 4) / 8;
+            }
+        }
+
+        /* Differential mode: 5-bit base colors that are close together */
+        trial.diff = 1;
+        for (sub = 0; sub < 2; sub++) {
+            for (c = 0; c < 3; c++) {
+                trial.color[sub][c] = (avg[sub][c] * 31 + 127) / 255;
+            }
+        }
+        for (c = 0; c < 3; c++) {
+            const int delta = trial.color[1][c] - trial.color[0][c];
+            if (delta < -4 || delta > 3) {
+                diff_ok = SDL_FALSE;
+            }
+        }
+        if (diff_ok) {
+            const Uint32 err = ETC1_Fit(pixels, &trial, best_err);
+            if (err < best_err) {
+                best_err = err;
+                best = trial;
+            }
+        }
+
+        /* Individual mode: two independent 4-bit base colors */
+        trial.diff = 0;
+        for (sub = 0; sub < 2; sub++) {
+            for (c = 0; c < 3; c++) {
+                trial.color[sub][c] = (avg[sub][c] * 15 + 127) / 255;
+            }
+        }
+        {
+            const Uint32 err = ETC1_Fit(pixels, &trial, best_err);
+            if (err < best_err) {
+                best_err = err;
+                best = trial;
+            }
+        }
+    }
+
+    ETC1_Pack(&best, block);
+}
+
+void
+SDL_ETC1_DecodeBlock(const Uint8 *block, Uint8 *rgba, int pitch)
+{
+    ETC1_Params p;
+    int i, c;
+
+    ETC1_Unpack(block, &p);
+    for (i = 0; i < 16; i++) {
+        const int sub = ETC1_InSubblock(i, p.flip);
+        const int sel = p.sel[i];
+        const int mod = (sel & 2) ? -ETC1_modifiers[p.table[sub]][sel & 1] : ETC1_modifiers[p.table[sub]][sel & 1];
+        Uint8 *px = ETC1_PIXEL(rgba, pitch, i);
+
+        for (c = 0; c < 3; c++) {
+            px[c] = (Uint8)ETC1_Clamp(ETC1_Expand(p.color[sub][c], p.diff) + mod);
+        }
+        px[3] = 0xFF;
+    }
+}
+
+void
+SDL_ETC1_FlipBlock(Uint8 *block)
+{
+    ETC1_Params p;
+    Uint8 sel[16];
+    int i, c, tmp;
+
+    ETC1_Unpack(block, &p);
+
+    /* Mirroring y is i ^ 3 in ETC1 pixel order */
+    for (i = 0; i < 16; i++) {
+        sel[i ^ 3] = p.sel[i];
+    }
+    for (i = 0; i < 16; i++) {
+        p.sel[i] = sel[i];
+    }
+
+    if (p.flip) {
+        /* The top and bottom subblocks trade places */
+        tmp = p.table[0];
+        p.table[0] = p.table[1];
+        p.table[1] = tmp;
+        for (c = 0; c < 3; c++) {
+            tmp = p.color[0][c];
+            p.color[0][c] = p.color[1][c];
+            p.color[1][c] = tmp;
+            if (p.diff && (p.color[1][c] - p.color[0][c]) > 3) {
+                /* The negated delta doesn't fit in 3 bits */
+                Uint8 rgba[4 * 4 * 4];
+                Uint8 flipped[4 * 4 * 4];
+                SDL_ETC1_DecodeBlock(block, rgba, 4 * 4);
+                for (i = 0; i < 4 * 16; i++) {
+                    flipped[i] = rgba[(3 - i / 16) * 16 + i % 16];
+                }
+                SDL_ETC1_EncodeBlock(flipped, 4 * 4, block);
+                return;
+            }
+        }
+    }
+
+    ETC1_Pack(&p, block);
+}
+
+void
+SDL_ETC1A4_EncodeBlock(const Uint8 *rgba, int pitch, Uint8 *block)
+{
+    int i;
+
+    for (i = 0; i < 8; i++) {
+        block[i] = 0;
+    }
+    for (i = 0; i < 16; i++) {
+        const int a = (ETC1_PIXEL(rgba, pitch, i)[3] * 15 + 127) / 255;
+        block[i >> 1] |= (Uint8)(a << ((i & 1) * 4));
+    }
+    SDL_ETC1_EncodeBlock(rgba, pitch, block + 8);
+}
+
+void
+SDL_ETC1A4_DecodeBlock(const Uint8 *block, Uint8 *rgba, int pitch)
+{
+    int i;
+
+    SDL_ETC1_DecodeBlock(block + 8, rgba, pitch);
+    for (i = 0; i < 16; i++) {
+        const int a = (block[i >> 1] >> ((i & 1) * 4)) & 15;
+        ETC1_PIXEL(rgba, pitch, i)[3] = (Uint8)(a * 17);
+    }
+}
+
+void
+SDL_ETC1A4_FlipBlock(Uint8 *block)
+{
+    Uint8 alpha[8];
+    int i;
+
+    for (i = 0; i < 8; i++) {
+        alpha[i] = 0;
+    }
+    for (i = 0; i < 16; i++) {
+        const int a = (block[i >> 1] >> ((i & 1) * 4)) & 15;
+        const int j = i ^ 3;
+        alpha[j >> 1] |= (Uint8)(a << ((j & 1) * 4));
+    }
+    for (i = 0; i < 8; i++) {
+        block[i] = alpha[i];
+    }
+    SDL_ETC1_FlipBlock(block + 8);
+}
+
+/* vi: set ts=4 sw=4 expandtab: */
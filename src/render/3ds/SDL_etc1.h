@@ -0,0 +1,53 @@
+/*
+  Simple DirectMedia Layer
+  Copyright (C) 1997-2014 Sam Lantinga <slouken@libsdl.org>
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+#ifndef _SDL_etc1_h
+#define _SDL_etc1_h
+
+#include "SDL_stdinc.h"
+
+/* ETC1 block codec used by the 3DS renderer.
+
+   This file has no 3DS dependencies and calls no SDL functions, so it can
+   be built into a host program and checked there (see test/testetc1.c).
+
+   Blocks cover 4x4 pixels. An ETC1 block is 8 bytes in the usual
+   big-endian layout (as in .pkm files). An ETC1A4 block is 8 bytes of
+   alpha followed by an ETC1 block; the alpha is a little-endian 64-bit
+   word holding one 4-bit value per pixel, pixel (x,y) at nibble x*4+y.
+   Pixels are passed around as R,G,B,A bytes.
+*/
+
+#define SDL_ETC1_BLOCK_SIZE     8
+#define SDL_ETC1A4_BLOCK_SIZE   16
+
+extern void SDL_ETC1_EncodeBlock(const Uint8 *rgba, int pitch, Uint8 *block);
+extern void SDL_ETC1_DecodeBlock(const Uint8 *block, Uint8 *rgba, int pitch);
+extern void SDL_ETC1A4_EncodeBlock(const Uint8 *rgba, int pitch, Uint8 *block);
+extern void SDL_ETC1A4_DecodeBlock(const Uint8 *block, Uint8 *rgba, int pitch);
+
+/* Mirror a block top to bottom, losslessly unless the flipped block
+   can't be represented (then it is decoded and re-encoded) */
+extern void SDL_ETC1_FlipBlock(Uint8 *block);
+extern void SDL_ETC1A4_FlipBlock(Uint8 *block);
+
+#endif /* _SDL_etc1_h */
+
+/* vi: set ts=4 sw=4 expandtab: */
@@ -23,9 +23,12 @@
 #if SDL_VIDEO_RENDER_3DS
 
 #include "SDL_hints.h"
+#include "SDL_system.h"
 #include "../SDL_sysrender.h"
+#include "../../video/3ds/SDL_3dsvideo.h"
 #include <3ds.h>
 #include "shader_vsh_shbin.h"
+#include "SDL_etc1.h"
 
 /* 3DS renderer implementation, based on the CTRULIB  */
 
@@ -84,19 +87,20 @@ SDL_RenderDriver N3DS_RenderDriver = {
     .info = {
         .name = "3DS",
         .flags = SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC | SDL_RENDERER_TARGETTEXTURE,
-        .num_texture_formats = 4,
+        .num_texture_formats = 6,
         .texture_formats = { [0] = SDL_PIXELFORMAT_BGR565,
 	                     [1] = SDL_PIXELFORMAT_ABGR1555,
 	                     [2] = SDL_PIXELFORMAT_ABGR4444,
 	                     [3] = SDL_PIXELFORMAT_ABGR8888,
+	                     [4] = SDL_PIXELFORMAT_ETC1,
+	                     [5] = SDL_PIXELFORMAT_ETC1A4,
         },
-        .max_texture_width = 512,
-        .max_texture_height = 512,
+        .max_texture_width = 1024,
+        .max_texture_height = 1024,
      }
 };
 
-#define N3DS_SCREEN_WIDTH    400
-#define N3DS_SCREEN_HEIGHT   240
+#define N3DS_NUM_SCREENS          2
 
 #define N3DS_FRAME_BUFFER_WIDTH  512
 #define N3DS_FRAME_BUFFER_SIZE   (N3DS_FRAME_BUFFER_WIDTH*N3DS_SCREEN_HEIGHT)
@@ -111,15 +115,12 @@ SDL_RenderDriver N3DS_RenderDriver = {
 #define COL8888(r,g,b,a)    ((r) | ((g)<<8) | ((b)<<16) | ((a)<<24))
 
 
-
+/* GPU state shared by the renderers of the top and bottom screens.
+   Both record into one command list which is submitted once per frame. */
 typedef struct
 {
 	// GPU commando fifo
 	u32 *gpu_cmd;
-	// GPU framebuffer address
-	u32 *gpu_fb_addr;
-	// GPU depth buffer address
-	u32 *gpu_depth_fb_addr;
 	// Temporary memory pool
 	void *pool_addr;
 	u32 pool_index;
@@ -128,16 +129,46 @@ typedef struct
 	DVLB_s *dvlb;
 	shaderProgram_s shader;
 	u32 projection_desc;
+
+	int             refcount;
+	SDL_bool        displayListAvail;
+	u32             cmd_offset;                     /* shared list offset while another is recorded */
+	SDL_Renderer    *bound;                         /* renderer whose viewport is set in the list */
+	SDL_Renderer    *renderers[N3DS_NUM_SCREENS];   /* live renderer per screen */
+
+} N3DS_GPUContext;
+
+static N3DS_GPUContext N3DS_gpu;
+
+
+typedef struct
+{
+	gfxScreen_t     screen;
+	int             width;
+	// GPU framebuffer address
+	u32 *gpu_fb_addr;
+	// GPU depth buffer address
+	u32 *gpu_depth_fb_addr;
 	//Matrix
-	float ortho_matrix_top[4*4];
-	float ortho_matrix_bot[4*4];
+	float ortho_matrix[4*4];
+
+	/* Stereoscopic mode: the top screen records into a list of its own
+	   which is run once per eye, only the eye setup at its head differs */
+	SDL_bool        stereo;
+	float           parallax;                       /* z of the following vertices */
+	float           slider;                         /* 3D slider for the frame being recorded */
+	u32 *gpu_fb_right_addr;
+	u32 *stereo_cmd;
+	u32             stereo_cmd_offset;
+	SDL_bool        stereo_recording;
 
 
 
 	void*           frontbuffer;
 	void*           backbuffer;
 	SDL_bool        initialized ;
-	SDL_bool        displayListAvail ;
+	SDL_bool        drawn ;                         /* has commands in the current list */
+	SDL_bool        presentPending ;                /* presented, waiting for the batch */
 	unsigned int    psm ;
 	unsigned int    bpp ;
 
@@ -206,35 +237,35 @@ static void GPU_SetDummyTexEnv(u8 num)
 		0xFFFFFFFF);
 }
 
-void *N3DS_pool_malloc(N3DS_RenderData *data, u32 size)
+void *N3DS_pool_malloc(N3DS_GPUContext *gpu, u32 size)
 {
-	if ((data->pool_index + size) < data->pool_size) {
-		void *addr = (void *)((u32)data->pool_addr + data->pool_index);
-		data->pool_index += size;
+	if ((gpu->pool_index + size) < gpu->pool_size) {
+		void *addr = (void *)((u32)gpu->pool_addr + gpu->pool_index);
+		gpu->pool_index += size;
 		return addr;
 	}
 	return NULL;
 }
 
-void *N3DS_pool_memalign(N3DS_RenderData *data, u32 size, u32 alignment)
+void *N3DS_pool_memalign(N3DS_GPUContext *gpu, u32 size, u32 alignment)
 {
-	u32 new_index = (data->pool_index + alignment - 1) & ~(alignment - 1);
-	if ((new_index + size) < data->pool_size) {
-		void *addr = (void *)((u32)data->pool_addr + new_index);
-		data->pool_index = new_index + size;
+	u32 new_index = (gpu->pool_index + alignment - 1) & ~(alignment - 1);
+	if ((new_index + size) < gpu->pool_size) {
+		void *addr = (void *)((u32)gpu->pool_addr + new_index);
+		gpu->pool_index = new_index + size;
 		return addr;
 	}
 	return NULL;
 }
 
-unsigned int N3DS_pool_space_free(N3DS_RenderData *data)
+unsigned int N3DS_pool_space_free(N3DS_GPUContext *gpu)
 {
-	return data->pool_size - data->pool_index;
+	return gpu->pool_size - gpu->pool_index;
 }
 
-void N3DS_pool_reset(N3DS_RenderData *data)
+void N3DS_pool_reset(N3DS_GPUContext *gpu)
 {
-	data->pool_index = 0;
+	gpu->pool_index = 0;
 }
 
 static void vector_mult_matrix4x4(const float *msrc, const vector_3f *vsrc, vector_3f *vdst);
@@ -288,6 +319,10 @@ PixelFormatTo3DSFMT(Uint32 format)
         return GPU_RGBA4;
     case SDL_PIXELFORMAT_ABGR8888:
         return GPU_RGBA8;
+    case SDL_PIXELFORMAT_ETC1:
+        return GPU_ETC1;
+    case SDL_PIXELFORMAT_ETC1A4:
+        return GPU_ETC1A4;
     default:
         return GPU_RGBA8;
     }
@@ -296,15 +331,97 @@ PixelFormatTo3DSFMT(Uint32 format)
 void
 StartDrawing(SDL_Renderer * renderer)
 {
-	N3DS_RenderData *data = (N3DS_RenderData *) renderer->driverdata;
-	if(data->displayListAvail)
+	N3DS_GPUContext *gpu = &N3DS_gpu;
+	if(gpu->displayListAvail)
 		return;
 
-	N3DS_pool_reset(data);
+	N3DS_pool_reset(gpu);
 	GPUCMD_SetBufferOffset(0);
 	//sceGuStart(GU_DIRECT, DisplayList);
 
-	data->displayListAvail = SDL_TRUE;
+	gpu->bound = NULL;
+	gpu->displayListAvail = SDL_TRUE;
+}
+
+static void N3DS_SubmitFrame(void);
+
+/* Remember where the list being recorded into left off */
+static void
+ParkCommandList(void)
+{
+	N3DS_GPUContext *gpu = &N3DS_gpu;
+	u32 *buf, size, offset;
+
+	GPUCMD_GetBuffer(&buf, &size, &offset);
+	if (gpu->bound && ((N3DS_RenderData *) gpu->bound->driverdata)->stereo)
+		((N3DS_RenderData *) gpu->bound->driverdata)->stereo_cmd_offset = offset;
+	else
+		gpu->cmd_offset = offset;
+}
+
+/* Point the stereo list at one eye. Emits the same number of words for
+   either eye so the head of a recorded list can be rewritten in place. */
+static void
+SetupEye(SDL_Renderer * renderer, gfx3dSide_t side)
+{
+	N3DS_GPUContext *gpu = &N3DS_gpu;
+	N3DS_RenderData *data = (N3DS_RenderData *) renderer->driverdata;
+	float shear[4*4], eye_matrix[4*4];
+	u32 *fb = (side == GFX_LEFT) ? data->gpu_fb_addr : data->gpu_fb_right_addr;
+
+	/* Shift x by the vertex z, half the separation to each side,
+	   then flatten z so the parallax doesn't reach the depth range */
+	matrix_identity4x4(shear);
+	shear[0*4 + 2] = (side == GFX_LEFT ? -0.5f : 0.5f) * data->slider;
+	shear[2*4 + 2] = 0.0f;
+	matrix_mult4x4(data->ortho_matrix, shear, eye_matrix);
+
+	GPU_SetViewport((u32 *)osConvertVirtToPhys((u32)data->gpu_depth_fb_addr),
+		(u32 *)osConvertVirtToPhys((u32)fb),
+		0, 0, N3DS_SCREEN_HEIGHT, data->width);
+	/* Draw order decides, as with the depth buffer cleared to 0 */
+	GPU_SetDepthTestAndWriteMask(true, GPU_ALWAYS, GPU_WRITE_COLOR);
+	matrix_gpu_set_uniform(eye_matrix, gpu->projection_desc);
+}
+
+/* Make the renderer's screen the target of the following draw commands */
+static void
+BindRenderer(SDL_Renderer * renderer)
+{
+	N3DS_GPUContext *gpu = &N3DS_gpu;
+	N3DS_RenderData *data = (N3DS_RenderData *) renderer->driverdata;
+
+	/* This screen was presented but the other one never was:
+	   don't hold the finished frame back any longer */
+	if (data->presentPending)
+		N3DS_SubmitFrame();
+
+	StartDrawing(renderer);
+	data->drawn = SDL_TRUE;
+
+	if (gpu->bound == renderer)
+		return;
+
+	ParkCommandList();
+
+	if (data->stereo) {
+		if (data->stereo_recording) {
+			GPUCMD_SetBuffer(data->stereo_cmd, N3DS_GPU_FIFO_SIZE, data->stereo_cmd_offset);
+		} else {
+			GPUCMD_SetBuffer(data->stereo_cmd, N3DS_GPU_FIFO_SIZE, 0);
+			data->slider = osGet3DSliderState();
+			SetupEye(renderer, GFX_LEFT);
+			data->stereo_recording = SDL_TRUE;
+		}
+	} else {
+		GPUCMD_SetBuffer(gpu->gpu_cmd, N3DS_GPU_FIFO_SIZE, gpu->cmd_offset);
+		GPU_SetViewport((u32 *)osConvertVirtToPhys((u32)data->gpu_depth_fb_addr),
+			(u32 *)osConvertVirtToPhys((u32)data->gpu_fb_addr),
+			0, 0, N3DS_SCREEN_HEIGHT, data->width);
+		matrix_gpu_set_uniform(data->ortho_matrix, gpu->projection_desc);
+	}
+
+	gpu->bound = renderer;
 }
 
 
@@ -326,6 +443,176 @@ static inline u32 get_morton_offset(u32 x, u32 y, u32 bytes_per_pixel)
     return (i + offset) * bytes_per_pixel;
 }
 
+static SDL_bool
+UseETC1Compression(void)
+{
+    const char *hint = SDL_GetHint(SDL_HINT_RENDER_3DS_ETC1);
+
+    return (hint && *hint == '1') ? SDL_TRUE : SDL_FALSE;
+}
+
+static SDL_bool
+UseStereo(void)
+{
+    const char *hint = SDL_GetHint(SDL_HINT_RENDER_3DS_STEREO);
+
+    return (hint && *hint == '1') ? SDL_TRUE : SDL_FALSE;
+}
+
+static SDL_INLINE SDL_bool
+IsCompressed(const N3DS_TextureData *n3ds_texture)
+{
+    return (n3ds_texture->format == GPU_ETC1 || n3ds_texture->format == GPU_ETC1A4);
+}
+
+static SDL_INLINE int
+CompressedBlockSize(const N3DS_TextureData *n3ds_texture)
+{
+    return (n3ds_texture->format == GPU_ETC1A4) ? SDL_ETC1A4_BLOCK_SIZE : SDL_ETC1_BLOCK_SIZE;
+}
+
+/* Address of 4x4 block (bx,by) in a compressed texture. The GPU wants
+   8x8 tiles holding four Z-ordered blocks, and rows stored bottom up like
+   the swizzled RGBA8 textures. */
+static Uint8 *
+CompressedBlockAddress(N3DS_TextureData *n3ds_texture, int bx, int by)
+{
+	int fy = n3ds_texture->textureHeight / 4 - 1 - by;
+	int tile = (fy >> 1) * (n3ds_texture->textureWidth >> 3) + (bx >> 1);
+	int sub = (bx & 1) | ((fy & 1) << 1);
+
+	return (Uint8 *)n3ds_texture->data + (tile * 4 + sub) * CompressedBlockSize(n3ds_texture);
+}
+
+/* ETC1 words are read little endian by the GPU */
+static void
+ReverseETC1Word(Uint8 *block)
+{
+	int i;
+	for (i = 0; i < 4; i++) {
+		Uint8 tmp = block[i];
+		block[i] = block[7 - i];
+		block[7 - i] = tmp;
+	}
+}
+
+static void
+StoreCompressedBlock(N3DS_TextureData *n3ds_texture, int bx, int by, const Uint8 *src)
+{
+	Uint8 *dst = CompressedBlockAddress(n3ds_texture, bx, by);
+
+	SDL_memcpy(dst, src, CompressedBlockSize(n3ds_texture));
+	if (n3ds_texture->format == GPU_ETC1A4) {
+		SDL_ETC1A4_FlipBlock(dst);
+		ReverseETC1Word(dst + 8);
+	} else {
+		SDL_ETC1_FlipBlock(dst);
+		ReverseETC1Word(dst);
+	}
+}
+
+static void
+LoadCompressedBlock(N3DS_TextureData *n3ds_texture, int bx, int by, Uint8 *rgba)
+{
+	Uint8 block[SDL_ETC1A4_BLOCK_SIZE];
+
+	SDL_memcpy(block, CompressedBlockAddress(n3ds_texture, bx, by), CompressedBlockSize(n3ds_texture));
+	if (n3ds_texture->format == GPU_ETC1A4) {
+		ReverseETC1Word(block + 8);
+		SDL_ETC1A4_FlipBlock(block);
+		SDL_ETC1A4_DecodeBlock(block, rgba, 4 * 4);
+	} else {
+		ReverseETC1Word(block);
+		SDL_ETC1_FlipBlock(block);
+		SDL_ETC1_DecodeBlock(block, rgba, 4 * 4);
+	}
+}
+
+/* Upload blocks the application compressed itself. The rectangle must be
+   block aligned, except where it meets the right or bottom edge. */
+static int
+UpdatePrecompressed(N3DS_TextureData *n3ds_texture, SDL_Texture * texture,
+                    const SDL_Rect * rect, const Uint8 *pixels, int pitch)
+{
+	const int blocksize = CompressedBlockSize(n3ds_texture);
+	int bx, by;
+
+	if ((rect->x & 3) || (rect->y & 3) ||
+	    ((rect->w & 3) && rect->x + rect->w != texture->w) ||
+	    ((rect->h & 3) && rect->y + rect->h != texture->h)) {
+		return SDL_SetError("Compressed texture updates must be aligned to 4x4 blocks");
+	}
+
+	for (by = 0; by < (rect->h + 3) / 4; by++) {
+		const Uint8 *src = pixels + by * pitch;
+		for (bx = 0; bx < (rect->w + 3) / 4; bx++) {
+			StoreCompressedBlock(n3ds_texture, rect->x / 4 + bx, rect->y / 4 + by, src);
+			src += blocksize;
+		}
+	}
+	return 0;
+}
+
+/* Compress ABGR8888 or BGR565 pixels as they are uploaded */
+static int
+UpdateCompressing(N3DS_TextureData *n3ds_texture, SDL_Texture * texture,
+                  const SDL_Rect * rect, const Uint8 *pixels, int pitch)
+{
+	const int bpp = SDL_BYTESPERPIXEL(texture->format);
+	int bx, by, x, y;
+
+	for (by = rect->y / 4; by < (rect->y + rect->h + 3) / 4; by++) {
+		for (bx = rect->x / 4; bx < (rect->x + rect->w + 3) / 4; bx++) {
+			Uint8 rgba[4 * 4 * 4];
+			Uint8 block[SDL_ETC1A4_BLOCK_SIZE];
+			SDL_bool partial = (bx * 4 < rect->x || by * 4 < rect->y ||
+			                    bx * 4 + 4 > rect->x + rect->w ||
+			                    by * 4 + 4 > rect->y + rect->h);
+
+			/* Keep the pixels of a partially covered block */
+			if (partial) {
+				LoadCompressedBlock(n3ds_texture, bx, by, rgba);
+			}
+
+			for (y = 0; y < 4; y++) {
+				const int ty = by * 4 + y;
+				if (ty < rect->y || ty >= rect->y + rect->h)
+					continue;
+				for (x = 0; x < 4; x++) {
+					const int tx = bx * 4 + x;
+					const Uint8 *src;
+					Uint8 *dst = &rgba[(y * 4 + x) * 4];
+
+					if (tx < rect->x || tx >= rect->x + rect->w)
+						continue;
+					src = pixels + (ty - rect->y) * pitch + (tx - rect->x) * bpp;
+					if (bpp == 4) {
+						/* ABGR8888 is R,G,B,A in memory */
+						dst[0] = src[0];
+						dst[1] = src[1];
+						dst[2] = src[2];
+						dst[3] = src[3];
+					} else {
+						const Uint16 p = *(const Uint16 *)src;
+						dst[0] = (Uint8)(((p & 0x1F) * 527 + 23) >> 6);
+						dst[1] = (Uint8)((((p >> 5) & 0x3F) * 259 + 33) >> 6);
+						dst[2] = (Uint8)((((p >> 11) & 0x1F) * 527 + 23) >> 6);
+						dst[3] = 0xFF;
+					}
+				}
+			}
+
+			if (n3ds_texture->format == GPU_ETC1A4) {
+				SDL_ETC1A4_EncodeBlock(rgba, 4 * 4, block);
+			} else {
+				SDL_ETC1_EncodeBlock(rgba, 4 * 4, block);
+			}
+			StoreCompressedBlock(n3ds_texture, bx, by, block);
+		}
+	}
+	return 0;
+}
+
 int
 TextureSwizzle(N3DS_TextureData *n3ds_texture)
 {
@@ -365,6 +652,7 @@ int TextureUnswizzle(N3DS_TextureData *n3ds_texture)
 SDL_Renderer *
 N3DS_CreateRenderer(SDL_Window * window, Uint32 flags)
 {
+	N3DS_GPUContext *gpu = &N3DS_gpu;
 	SDL_Renderer *renderer;
 	N3DS_RenderData *data;
 	int pixelformat;
@@ -406,6 +694,24 @@ N3DS_CreateRenderer(SDL_Window * window, Uint32 flags)
 
 	if (data->initialized != SDL_FALSE)
 		return 0;
+
+	/* Render to the screen the window was created on */
+	if (((SDL_WindowData *) window->driverdata)->screen == GFX_BOTTOM) {
+		data->screen = GFX_BOTTOM;
+		data->width = N3DS_BOTTOM_SCREEN_WIDTH;
+	} else {
+		data->screen = GFX_TOP;
+		data->width = N3DS_TOP_SCREEN_WIDTH;
+	}
+
+	if (gpu->renderers[data->screen] != NULL) {
+		SDL_SetError("The %s screen already has a renderer",
+			data->screen == GFX_TOP ? "top" : "bottom");
+		SDL_free(data);
+		SDL_free(renderer);
+		return NULL;
+	}
+
 	data->initialized = SDL_TRUE;
 
 	if (flags & SDL_RENDERER_PRESENTVSYNC) {
@@ -432,34 +738,43 @@ N3DS_CreateRenderer(SDL_Window * window, Uint32 flags)
 		break;
 	}
 
-	data->gpu_fb_addr       = vramMemAlign(400*240*4, 0x100);
-	data->gpu_depth_fb_addr = vramMemAlign(400*240*2, 0x100);
-	data->gpu_cmd           = linearAlloc(N3DS_GPU_FIFO_SIZE);
-	data->pool_addr         = linearAlloc(N3DS_TEMPPOOL_SIZE);
-	data->pool_size         = N3DS_TEMPPOOL_SIZE;
+	data->gpu_fb_addr       = vramMemAlign(data->width*N3DS_SCREEN_HEIGHT*4, 0x100);
+	data->gpu_depth_fb_addr = vramMemAlign(data->width*N3DS_SCREEN_HEIGHT*2, 0x100);
+
+	/* The 3D effect is only available on the top screen */
+	if (data->screen == GFX_TOP && UseStereo()) {
+		data->stereo            = SDL_TRUE;
+		data->gpu_fb_right_addr = vramMemAlign(data->width*N3DS_SCREEN_HEIGHT*4, 0x100);
+		data->stereo_cmd        = linearAlloc(N3DS_GPU_FIFO_SIZE);
+	}
+	if (data->screen == GFX_TOP)
+		gfxSet3D(data->stereo);
+
+	matrix_init_orthographic(data->ortho_matrix, 0.0f, (float)data->width,
+		0.0f, (float)N3DS_SCREEN_HEIGHT, 0.0f, 1.0f);
+
+	gpu->renderers[data->screen] = renderer;
+	if (gpu->refcount++ > 0) {
+		/* The other screen already set up the GPU */
+		return renderer;
+	}
+
+	gpu->gpu_cmd           = linearAlloc(N3DS_GPU_FIFO_SIZE);
+	gpu->pool_addr         = linearAlloc(N3DS_TEMPPOOL_SIZE);
+	gpu->pool_size         = N3DS_TEMPPOOL_SIZE;
 
-	gfxInitDefault();
 	GPU_Init(NULL);
-	gfxSet3D(false);
-	GPU_Reset(NULL, data->gpu_cmd, N3DS_GPU_FIFO_SIZE);
+	GPU_Reset(NULL, gpu->gpu_cmd, N3DS_GPU_FIFO_SIZE);
 
 	//Setup the shader
-	data->dvlb = DVLB_ParseFile((u32 *)shader_vsh_shbin, shader_vsh_shbin_size);
-	shaderProgramInit(&data->shader);
-	shaderProgramSetVsh(&data->shader, &data->dvlb->DVLE[0]);
+	gpu->dvlb = DVLB_ParseFile((u32 *)shader_vsh_shbin, shader_vsh_shbin_size);
+	shaderProgramInit(&gpu->shader);
+	shaderProgramSetVsh(&gpu->shader, &gpu->dvlb->DVLE[0]);
 
 	//Get shader uniform descriptors
-	data->projection_desc = shaderInstanceGetUniformLocation(data->shader.vertexShader, "projection");
+	gpu->projection_desc = shaderInstanceGetUniformLocation(gpu->shader.vertexShader, "projection");
 
-	shaderProgramUse(&data->shader);
-
-	matrix_init_orthographic(data->ortho_matrix_top, 0.0f, 400.0f, 0.0f, 240.0f, 0.0f, 1.0f);
-	matrix_init_orthographic(data->ortho_matrix_bot, 0.0f, 320.0f, 0.0f, 240.0f, 0.0f, 1.0f);
-	matrix_gpu_set_uniform(data->ortho_matrix_top, data->projection_desc);
-
-	GPU_SetViewport((u32 *)osConvertVirtToPhys((u32)data->gpu_depth_fb_addr),
-		(u32 *)osConvertVirtToPhys((u32)data->gpu_fb_addr),
-		0, 0, 240, 400);
+	shaderProgramUse(&gpu->shader);
 
 	GPU_DepthMap(-1.0f, 0.0f);
 	GPU_SetFaceCulling(GPU_CULL_NONE);
@@ -489,10 +804,7 @@ N3DS_CreateRenderer(SDL_Window * window, Uint32 flags)
 	GPUCMD_FlushAndRun();
 	gspWaitForP3D();
 
-	N3DS_pool_reset(data);
-
-	consoleInit(GFX_BOTTOM, NULL); /* !!!! */
-	printf("SDL2\n");
+	N3DS_pool_reset(gpu);
 
 	return renderer;
 }
@@ -516,10 +828,19 @@ N3DS_CreateTexture(SDL_Renderer * renderer, SDL_Texture * texture)
     n3ds_texture->swizzled = SDL_FALSE;
     n3ds_texture->width = texture->w;
     n3ds_texture->height = texture->h;
-    n3ds_texture->textureHeight = TextureNextPow2(texture->h);
-    n3ds_texture->textureWidth = TextureNextPow2(texture->w);
+    /* The GPU won't sample anything smaller than one 8x8 tile */
+    n3ds_texture->textureHeight = SDL_max(TextureNextPow2(texture->h), 8);
+    n3ds_texture->textureWidth = SDL_max(TextureNextPow2(texture->w), 8);
     n3ds_texture->format = PixelFormatTo3DSFMT(texture->format);
 
+    if (texture->access == SDL_TEXTUREACCESS_STATIC && UseETC1Compression()) {
+        if (n3ds_texture->format == GPU_RGBA8) {
+            n3ds_texture->format = GPU_ETC1A4;
+        } else if (n3ds_texture->format == GPU_RGB565) {
+            n3ds_texture->format = GPU_ETC1;
+        }
+    }
+
     switch(n3ds_texture->format)
     {
         case GPU_RGB565:
@@ -532,12 +853,28 @@ N3DS_CreateTexture(SDL_Renderer * renderer, SDL_Texture * texture)
             n3ds_texture->bits = 32;
             break;
 
+        case GPU_ETC1:
+            n3ds_texture->bits = 4;
+            break;
+
+        case GPU_ETC1A4:
+            n3ds_texture->bits = 8;
+            break;
+
         default:
-            return -1;
+            SDL_free(n3ds_texture);
+            return SDL_SetError("Unsupported texture format");
     }
 
-    n3ds_texture->pitch = n3ds_texture->textureWidth * SDL_BYTESPERPIXEL(texture->format);
-    n3ds_texture->size = n3ds_texture->textureHeight*n3ds_texture->pitch;
+    if (IsCompressed(n3ds_texture)) {
+        /* Written straight into the GPU's tiled layout */
+        n3ds_texture->swizzled = SDL_TRUE;
+        n3ds_texture->pitch = (n3ds_texture->textureWidth / 4) * CompressedBlockSize(n3ds_texture);
+        n3ds_texture->size = (n3ds_texture->textureHeight / 4) * n3ds_texture->pitch;
+    } else {
+        n3ds_texture->pitch = n3ds_texture->textureWidth * SDL_BYTESPERPIXEL(texture->format);
+        n3ds_texture->size = n3ds_texture->textureHeight*n3ds_texture->pitch;
+    }
     n3ds_texture->data = linearAlloc(n3ds_texture->size);
 
     if(!n3ds_texture->data)
@@ -595,12 +932,23 @@ static int
 N3DS_UpdateTexture(SDL_Renderer * renderer, SDL_Texture * texture,
                    const SDL_Rect * rect, const void *pixels, int pitch)
 {
-/*  N3DS_TextureData *n3ds_texture = (N3DS_TextureData *) texture->driverdata; */
+    N3DS_TextureData *n3ds_texture = (N3DS_TextureData *) texture->driverdata;
     const Uint8 *src;
     Uint8 *dst;
     int row, length,dpitch;
     src = pixels;
 
+    if (IsCompressed(n3ds_texture)) {
+        int status;
+        if (SDL_ISPIXELFORMAT_FOURCC(texture->format)) {
+            status = UpdatePrecompressed(n3ds_texture, texture, rect, pixels, pitch);
+        } else {
+            status = UpdateCompressing(n3ds_texture, texture, rect, pixels, pitch);
+        }
+        GSPGPU_FlushDataCache(n3ds_texture->data, n3ds_texture->size);
+        return status;
+    }
+
     N3DS_LockTexture(renderer, texture,rect,(void **)&dst, &dpitch);
     length = rect->w * SDL_BYTESPERPIXEL(texture->format);
     if (length == pitch && length == dpitch) {
@@ -623,6 +971,10 @@ N3DS_LockTexture(SDL_Renderer * renderer, SDL_Texture * texture,
 {
     N3DS_TextureData *n3ds_texture = (N3DS_TextureData *) texture->driverdata;
 
+    if (IsCompressed(n3ds_texture)) {
+        return SDL_SetError("Compressed textures can't be locked");
+    }
+
     *pixels =
         (void *) ((Uint8 *) n3ds_texture->data + rect->y * n3ds_texture->pitch +
                   rect->x * SDL_BYTESPERPIXEL(texture->format));
@@ -696,13 +1048,20 @@ N3DS_RenderClear(SDL_Renderer *renderer)
 {
 	N3DS_RenderData *data = (N3DS_RenderData *)renderer->driverdata;
 	/* start list */
-	StartDrawing(renderer);
+	BindRenderer(renderer);
 
 	//Clear the screen
 	u32 color = COL8888(renderer->r, renderer->g, renderer->b, renderer->a);
+	u32 pixels = data->width*N3DS_SCREEN_HEIGHT;
 
-	GX_MemoryFill(data->gpu_fb_addr, color, &data->gpu_fb_addr[0x2EE00],
-		0x201, data->gpu_depth_fb_addr, 0x00000000, &data->gpu_depth_fb_addr[0x2EE00], 0x201);
+	if (data->stereo) {
+		/* No depth test in stereo mode, the right eye takes its place */
+		GX_MemoryFill(data->gpu_fb_addr, color, &data->gpu_fb_addr[pixels],
+			0x201, data->gpu_fb_right_addr, color, &data->gpu_fb_right_addr[pixels], 0x201);
+	} else {
+		GX_MemoryFill(data->gpu_fb_addr, color, &data->gpu_fb_addr[pixels],
+			0x201, data->gpu_depth_fb_addr, 0x00000000, &data->gpu_depth_fb_addr[pixels/2], 0x201);
+	}
 	gspWaitForPSC0();
 
     return 0;
@@ -763,18 +1122,21 @@ static int
 N3DS_RenderFillRects(SDL_Renderer * renderer, const SDL_FRect * rects,
                      int count)
 {
+	N3DS_GPUContext *gpu = &N3DS_gpu;
 	N3DS_RenderData *data = (N3DS_RenderData *) renderer->driverdata;
 	int i;
-	//StartDrawing(renderer);
+	BindRenderer(renderer);
 
 	for (i = 0; i < count; ++i) {
 		const SDL_FRect *rect = &rects[i];
-		vertex_pos_col *vertices = (vertex_pos_col*)N3DS_pool_malloc(data, (sizeof(vertex_pos_col)*4));
+		vertex_pos_col *vertices = (vertex_pos_col*)N3DS_pool_malloc(gpu, (sizeof(vertex_pos_col)*4));
+		if (!vertices)
+			return SDL_OutOfMemory();
 
-		vertices[0].position = (vector_3f){(float)rect->x,         (float)rect->y,         0.0f};
-		vertices[1].position = (vector_3f){(float)rect->x+rect->w, (float)rect->y,         0.0f};
-		vertices[2].position = (vector_3f){(float)rect->x,         (float)rect->y+rect->h, 0.0f};
-		vertices[3].position = (vector_3f){(float)rect->x+rect->w, (float)rect->y+rect->h, 0.0f};
+		vertices[0].position = (vector_3f){(float)rect->x,         (float)rect->y,         data->parallax};
+		vertices[1].position = (vector_3f){(float)rect->x+rect->w, (float)rect->y,         data->parallax};
+		vertices[2].position = (vector_3f){(float)rect->x,         (float)rect->y+rect->h, data->parallax};
+		vertices[3].position = (vector_3f){(float)rect->x+rect->w, (float)rect->y+rect->h, data->parallax};
 
 		vertices[0].color = (vector_4f){renderer->r/255.0f,  renderer->g/255.0f, renderer->b/255.0f, renderer->a/255.0f};
 		vertices[1].color = vertices[0].color;
@@ -854,6 +1216,7 @@ static int
 N3DS_RenderCopy(SDL_Renderer * renderer, SDL_Texture * texture,
                 const SDL_Rect * srcrect, const SDL_FRect * dstrect)
 {
+	N3DS_GPUContext *gpu = &N3DS_gpu;
 	N3DS_RenderData *data = (N3DS_RenderData *) renderer->driverdata;
 	N3DS_TextureData *n3ds_texture = (N3DS_TextureData *) texture->driverdata;
 	float x, y, width, height;
@@ -872,7 +1235,7 @@ N3DS_RenderCopy(SDL_Renderer * renderer, SDL_Texture * texture,
 
 	alpha = texture->a;
 
-	//StartDrawing(renderer);
+	BindRenderer(renderer);
 	TextureActivate(texture);
 	N3DS_SetBlendMode(renderer, renderer->blendMode);
 
@@ -884,12 +1247,14 @@ N3DS_RenderCopy(SDL_Renderer * renderer, SDL_Texture * texture,
 		//sceGuColor(0xFFFFFFFF);
 	}
 
-	vertex_pos_tex* vertices = (vertex_pos_tex*)N3DS_pool_malloc(data, (sizeof(vertex_pos_tex))*4);
+	vertex_pos_tex* vertices = (vertex_pos_tex*)N3DS_pool_malloc(gpu, (sizeof(vertex_pos_tex))*4);
+	if (!vertices)
+		return SDL_OutOfMemory();
 
-	vertices[0].position = (vector_3f){(float)x,       (float)y,        0.0f};
-	vertices[1].position = (vector_3f){(float)x+width, (float)y,        0.0f};
-	vertices[2].position = (vector_3f){(float)x,       (float)y+height, 0.0f};
-	vertices[3].position = (vector_3f){(float)x+width, (float)y+height, 0.0f};
+	vertices[0].position = (vector_3f){(float)x,       (float)y,        data->parallax};
+	vertices[1].position = (vector_3f){(float)x+width, (float)y,        data->parallax};
+	vertices[2].position = (vector_3f){(float)x,       (float)y+height, data->parallax};
+	vertices[3].position = (vector_3f){(float)x+width, (float)y+height, data->parallax};
 
 	//float u = texture->width/(float)texture->textureWidth;
 	//float v = texture->height/(float)texture->textureHeight;
@@ -932,6 +1297,7 @@ N3DS_RenderCopyEx(SDL_Renderer * renderer, SDL_Texture * texture,
                 const SDL_Rect * srcrect, const SDL_FRect * dstrect,
                 const double angle, const SDL_FPoint *center, const SDL_RendererFlip flip)
 {
+	N3DS_GPUContext *gpu = &N3DS_gpu;
 	N3DS_RenderData *data = (N3DS_RenderData *) renderer->driverdata;
 	N3DS_TextureData *n3ds_texture = (N3DS_TextureData *) texture->driverdata;
 	float x, y, width, height;
@@ -955,7 +1321,7 @@ N3DS_RenderCopyEx(SDL_Renderer * renderer, SDL_Texture * texture,
 
 	alpha = texture->a;
 
-	//StartDrawing(renderer);
+	BindRenderer(renderer);
 	TextureActivate(texture);
 	N3DS_SetBlendMode(renderer, renderer->blendMode);
 
@@ -987,31 +1353,33 @@ N3DS_RenderCopyEx(SDL_Renderer * renderer, SDL_Texture * texture,
 	float ch = c*height;
 	float sh = s*height;
 
-	vertex_pos_tex* vertices = (vertex_pos_tex*)N3DS_pool_malloc(data, sizeof(vertex_pos_tex)<<2);
+	vertex_pos_tex* vertices = (vertex_pos_tex*)N3DS_pool_malloc(gpu, sizeof(vertex_pos_tex)<<2);
+	if (!vertices)
+		return SDL_OutOfMemory();
 
 	vertices[0].texcoord.u = u0;
 	vertices[0].texcoord.v = v0;
 	vertices[0].position.x = x - cw + sh;
 	vertices[0].position.y = y - sw - ch;
-	vertices[0].position.z = 0;
+	vertices[0].position.z = data->parallax;
 
 	vertices[1].texcoord.u = u0;
 	vertices[1].texcoord.v = v1;
 	vertices[1].position.x = x - cw - sh;
 	vertices[1].position.y = y - sw + ch;
-	vertices[1].position.z = 0;
+	vertices[1].position.z = data->parallax;
 
 	vertices[2].texcoord.u = u1;
 	vertices[2].texcoord.v = v1;
 	vertices[2].position.x = x + cw - sh;
 	vertices[2].position.y = y + sw + ch;
-	vertices[2].position.z = 0;
+	vertices[2].position.z = data->parallax;
 
 	vertices[3].texcoord.u = u1;
 	vertices[3].texcoord.v = v0;
 	vertices[3].position.x = x + cw + sh;
 	vertices[3].position.y = y + sw - ch;
-	vertices[3].position.z = 0;
+	vertices[3].position.z = data->parallax;
 
 	if (flip & SDL_FLIP_HORIZONTAL) {
 		Swap(&vertices[0].texcoord.v, &vertices[2].texcoord.v);
@@ -1041,33 +1409,130 @@ N3DS_RenderCopyEx(SDL_Renderer * renderer, SDL_Texture * texture,
     return 0;
 }
 
+/* Render the stereo list for the left eye, then for the right one */
 static void
-N3DS_RenderPresent(SDL_Renderer * renderer)
+RunStereoList(SDL_Renderer * renderer)
 {
 	N3DS_RenderData *data = (N3DS_RenderData *) renderer->driverdata;
-	if (!data->displayListAvail)
-		return;
+	u32 *buf, size, end;
 
-	data->displayListAvail = SDL_FALSE;
+	if (!data->stereo_recording)
+		return;
+	data->stereo_recording = SDL_FALSE;
 
+	GPUCMD_SetBuffer(data->stereo_cmd, N3DS_GPU_FIFO_SIZE, data->stereo_cmd_offset);
+	/* Put back the depth state SetupEye() changed, at the tail of the list
+	   so it runs after each eye and doesn't leak into the bottom screen */
+	GPU_SetDepthTestAndWriteMask(true, GPU_GEQUAL, GPU_WRITE_ALL);
 	GPU_FinishDrawing();
 	GPUCMD_Finalize();
+	GPUCMD_GetBuffer(&buf, &size, &end);
+	GPUCMD_FlushAndRun();
+	gspWaitForP3D();
+
+	/* With the slider down both eyes get the left image */
+	if (data->slider <= 0.0f)
+		return;
+
+	GPUCMD_SetBufferOffset(0);
+	SetupEye(renderer, GFX_RIGHT);
+	GPUCMD_SetBufferOffset(end);
 	GPUCMD_FlushAndRun();
 	gspWaitForP3D();
+}
+
+/* Run the command list recorded for both screens and show the result */
+static void
+N3DS_SubmitFrame(void)
+{
+	N3DS_GPUContext *gpu = &N3DS_gpu;
+	SDL_bool vsync = SDL_FALSE;
+	int presented = 0;
+	int i;
+
+	if (gpu->displayListAvail) {
+		gpu->displayListAvail = SDL_FALSE;
+
+		ParkCommandList();
+		if (gpu->cmd_offset > 0) {
+			GPUCMD_SetBuffer(gpu->gpu_cmd, N3DS_GPU_FIFO_SIZE, gpu->cmd_offset);
+			GPU_FinishDrawing();
+			GPUCMD_Finalize();
+			GPUCMD_FlushAndRun();
+			gspWaitForP3D();
+		}
+
+		if (gpu->renderers[GFX_TOP])
+			RunStereoList(gpu->renderers[GFX_TOP]);
+
+		GPUCMD_SetBuffer(gpu->gpu_cmd, N3DS_GPU_FIFO_SIZE, 0);
+		gpu->cmd_offset = 0;
+		gpu->bound = NULL;
+	}
 
-	//Copy the GPU rendered FB to the screen FB
-	GX_DisplayTransfer(data->gpu_fb_addr, GX_BUFFER_DIM(240, 400),
-		(u32 *)gfxGetFramebuffer(GFX_TOP, GFX_LEFT, NULL, NULL),
-		GX_BUFFER_DIM(240, 400), 0x1000);
+	//Copy the GPU rendered FBs to the screen FBs
+	for (i = 0; i < N3DS_NUM_SCREENS; i++) {
+		SDL_Renderer *renderer = gpu->renderers[i];
+		N3DS_RenderData *data;
+
+		if (!renderer)
+			continue;
+		data = (N3DS_RenderData *) renderer->driverdata;
+		if (!data->presentPending)
+			continue;
+
+		GX_DisplayTransfer(data->gpu_fb_addr, GX_BUFFER_DIM(N3DS_SCREEN_HEIGHT, data->width),
+			(u32 *)gfxGetFramebuffer(data->screen, GFX_LEFT, NULL, NULL),
+			GX_BUFFER_DIM(N3DS_SCREEN_HEIGHT, data->width), 0x1000);
+		gspWaitForPPF();
+		if (data->stereo) {
+			u32 *right = (data->slider > 0.0f) ? data->gpu_fb_right_addr : data->gpu_fb_addr;
+			GX_DisplayTransfer(right, GX_BUFFER_DIM(N3DS_SCREEN_HEIGHT, data->width),
+				(u32 *)gfxGetFramebuffer(data->screen, GFX_RIGHT, NULL, NULL),
+				GX_BUFFER_DIM(N3DS_SCREEN_HEIGHT, data->width), 0x1000);
+			gspWaitForPPF();
+		}
 
-	gspWaitForPPF();
+		vsync |= data->vsync;
+		data->presentPending = SDL_FALSE;
+		data->drawn = SDL_FALSE;
+		presented++;
+	}
 
+	if (!presented)
+		return;
 
-	/* Swap buffers */
+	/* Swap buffers, once for both screens */
 	gfxSwapBuffersGpu();
-	if (data->vsync) {
+	if (vsync) {
 		gspWaitForEvent(GSPGPU_EVENT_VBlank0, true);
 	}
+}
+
+static void
+N3DS_RenderPresent(SDL_Renderer * renderer)
+{
+	N3DS_GPUContext *gpu = &N3DS_gpu;
+	N3DS_RenderData *data = (N3DS_RenderData *) renderer->driverdata;
+	int i;
+
+	if (!data->drawn)
+		return;
+
+	data->presentPending = SDL_TRUE;
+
+	/* Hold the frame until the other screen has presented as well,
+	   if it drew anything this frame */
+	for (i = 0; i < N3DS_NUM_SCREENS; i++) {
+		SDL_Renderer *other = gpu->renderers[i];
+		if (other && other != renderer) {
+			N3DS_RenderData *otherdata = (N3DS_RenderData *) other->driverdata;
+			if (otherdata->drawn && !otherdata->presentPending)
+				return;
+		}
+	}
+
+	N3DS_SubmitFrame();
 
 	//sceGuFinish();
 	//sceGuSync(0,0);
@@ -1096,29 +1561,40 @@ N3DS_DestroyTexture(SDL_Renderer * renderer, SDL_Texture * texture)
 static void
 N3DS_DestroyRenderer(SDL_Renderer * renderer)
 {
+	N3DS_GPUContext *gpu = &N3DS_gpu;
 	N3DS_RenderData *data = (N3DS_RenderData *) renderer->driverdata;
 	if (data) {
 		if (!data->initialized)
 			return;
 
-		//StartDrawing(renderer);
+		/* Don't leave the other screen waiting on us */
+		if (data->drawn)
+			N3DS_SubmitFrame();
+		gpu->bound = NULL;
 
-		gfxExit();
-		shaderProgramFree(&data->shader);
-		DVLB_Free(data->dvlb);
-
-		linearFree(data->pool_addr);
-		linearFree(data->gpu_cmd);
 		vramFree(data->gpu_fb_addr);
 		vramFree(data->gpu_depth_fb_addr);
+		if (data->stereo) {
+			vramFree(data->gpu_fb_right_addr);
+			linearFree(data->stereo_cmd);
+			gfxSet3D(false);
+		}
+		gpu->renderers[data->screen] = NULL;
+
+		if (--gpu->refcount == 0) {
+			shaderProgramFree(&gpu->shader);
+			DVLB_Free(gpu->dvlb);
 
+			linearFree(gpu->pool_addr);
+			linearFree(gpu->gpu_cmd);
+			SDL_zerop(gpu);
+		}
 
 		//sceGuTerm();
 		/*      vfree(data->backbuffer); */
 		/*      vfree(data->frontbuffer); */
 
 		data->initialized = SDL_FALSE;
-		data->displayListAvail = SDL_FALSE;
 		SDL_free(data);
 	}
 	SDL_free(renderer);
@@ -1254,6 +1730,20 @@ void matrix_init_orthographic(float *m, float left, float right, float bottom, f
 	matrix_swap_xy(m);
 }
 
+int
+N3DS_RenderSetParallax(SDL_Renderer * renderer, float parallax)
+{
+	N3DS_RenderData *data = (N3DS_RenderData *) renderer->driverdata;
+
+	/* Make sure that this is a 3DS renderer */
+	if (renderer->DestroyRenderer != N3DS_DestroyRenderer) {
+		return SDL_SetError("Renderer is not a 3DS renderer");
+	}
+
+	/* Anything but 0 would leave the depth range of a flat renderer */
+	data->parallax = data->stereo ? parallax : 0.0f;
+	return 0;
+}
 #endif /* SDL_VIDEO_RENDER_3DS */
 
 /* vi: set ts=4 sw=4 expandtab: */
@@ -1920,4 +1920,18 @@ int SDL_GL_UnbindTexture(SDL_Texture *texture)
     return SDL_Unsupported();
 }
 
+#ifdef __3DS__
+int
+SDL_RenderSet3DSParallax(SDL_Renderer * renderer, float parallax)
+{
+    CHECK_RENDERER_MAGIC(renderer, -1);
+
+#if SDL_VIDEO_RENDER_3DS
+    return N3DS_RenderSetParallax(renderer, parallax);
+#else
+    return SDL_Unsupported();
+#endif
+}
+#endif /* __3DS__ */
+
 /* vi: set ts=4 sw=4 expandtab: */
@@ -195,6 +195,8 @@ extern SDL_RenderDriver PSP_RenderDriver;
 #endif
 #if SDL_VIDEO_RENDER_3DS
 extern SDL_RenderDriver N3DS_RenderDriver;
+/* Backs SDL_RenderSet3DSParallax(), once the renderer has been validated */
+extern int N3DS_RenderSetParallax(SDL_Renderer * renderer, float parallax);
 #endif
 extern SDL_RenderDriver SW_RenderDriver;
 
@@ -26,6 +26,7 @@
 #include "SDL_timer.h"
 #include "SDL_error.h"
 #include "../SDL_timer_c.h"
+#include <3ds.h>
 #include <stdlib.h>
 #include <time.h>
 #include <sys/time.h>
@@ -64,16 +65,21 @@ Uint32 SDL_GetTicks(void)
     return(ticks);
 }
 
+/* The ARM11 system tick, so input can be timed more finely than in ms */
+#ifndef SYSCLOCK_ARM11
+#define SYSCLOCK_ARM11  268111856
+#endif
+
 Uint64
 SDL_GetPerformanceCounter(void)
 {
-    return SDL_GetTicks();
+    return svcGetSystemTick();
 }
 
 Uint64
 SDL_GetPerformanceFrequency(void)
 {
-    return 1000;
+    return SYSCLOCK_ARM11;
 }
 
 void SDL_Delay(Uint32 ms)
@@ -0,0 +1,202 @@
+/*
+  Simple DirectMedia Layer
+  Copyright (C) 1997-2014 Sam Lantinga <slouken@libsdl.org>
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+#include "../../SDL_internal.h"
+
+#if SDL_VIDEO_DRIVER_3DS
+
+#include "../SDL_sysvideo.h"
+#include "SDL_3dsvideo.h"
+#include "SDL_3dsframebuffer_c.h"
+
+/* Software framebuffer for the 3DS screens.
+
+   The application draws into a linear staging surface laid out like any
+   other SDL surface. The LCD framebuffers are rotated 90 degrees (each
+   column of the screen is a contiguous run of 240 BGR8 pixels, bottom to
+   top), so on update the dirty rectangles are transposed into a rotated
+   copy of the screen, and the changed columns are DMA'd from there into
+   back buffer with the transfer engine. Only the columns touched since a
+   buffer was last shown are transferred.
+
+   gfxSwapBuffers() flips both screens at once, so another window's update
+   also swaps this one's buffers. The LCD buffers are told apart by address
+   rather than by counting swaps.
+*/
+
+#define N3DS_SURFACE_FORMAT   SDL_PIXELFORMAT_RGB888
+#define N3DS_FB_BPP           3
+
+int
+N3DS_CreateWindowFramebuffer(_THIS, SDL_Window * window, Uint32 * format, void ** pixels, int *pitch)
+{
+    SDL_WindowData *wdata = (SDL_WindowData *) window->driverdata;
+    int screen_w = (wdata->screen == GFX_TOP) ? N3DS_TOP_SCREEN_WIDTH : N3DS_BOTTOM_SCREEN_WIDTH;
+    int w, h;
+
+    /* Free the old framebuffer */
+    N3DS_DestroyWindowFramebuffer(_this, window);
+
+    SDL_GetWindowSize(window, &w, &h);
+    wdata->fb_w = SDL_min(w, screen_w);
+    wdata->fb_h = SDL_min(h, N3DS_SCREEN_HEIGHT);
+    wdata->fb_pitch = w * SDL_BYTESPERPIXEL(N3DS_SURFACE_FORMAT);
+
+    wdata->fb_pixels = linearAlloc(wdata->fb_pitch * h);
+    wdata->fb_rotated = linearAlloc(screen_w * N3DS_SCREEN_HEIGHT * N3DS_FB_BPP);
+    if (!wdata->fb_pixels || !wdata->fb_rotated) {
+        N3DS_DestroyWindowFramebuffer(_this, window);
+        return SDL_OutOfMemory();
+    }
+    SDL_memset(wdata->fb_pixels, 0, wdata->fb_pitch * h);
+    SDL_memset(wdata->fb_rotated, 0, screen_w * N3DS_SCREEN_HEIGHT * N3DS_FB_BPP);
+
+    /* Both LCD buffers start out stale */
+    wdata->fb_dirty_lo[0] = wdata->fb_dirty_lo[1] = 0;
+    wdata->fb_dirty_hi[0] = wdata->fb_dirty_hi[1] = screen_w;
+    wdata->fb_buffers[0] = wdata->fb_buffers[1] = NULL;
+
+    *format = N3DS_SURFACE_FORMAT;
+    *pixels = wdata->fb_pixels;
+    *pitch = wdata->fb_pitch;
+    return 0;
+}
+
+/* Which of the two LCD buffers this is, so its stale columns can be found */
+static int
+N3DS_GetBackBufferIndex(SDL_WindowData *wdata, u8 *fb)
+{
+    const int screen_w = (wdata->screen == GFX_TOP) ? N3DS_TOP_SCREEN_WIDTH : N3DS_BOTTOM_SCREEN_WIDTH;
+    int i;
+
+    for (i = 0; i < 2; i++) {
+        if (wdata->fb_buffers[i] == fb) {
+            return i;
+        }
+    }
+    for (i = 0; i < 2; i++) {
+        if (!wdata->fb_buffers[i]) {
+            wdata->fb_buffers[i] = fb;
+            return i;
+        }
+    }
+
+    /* The screen got new buffers, so neither is known to be up to date */
+    wdata->fb_buffers[0] = fb;
+    wdata->fb_buffers[1] = NULL;
+    wdata->fb_dirty_lo[0] = wdata->fb_dirty_lo[1] = 0;
+    wdata->fb_dirty_hi[0] = wdata->fb_dirty_hi[1] = screen_w;
+    return 0;
+}
+
+/* Copy a rectangle of the application surface into the rotated image */
+static void
+N3DS_RotateRect(SDL_WindowData *wdata, const SDL_Rect *rect)
+{
+    int x, y;
+
+    for (x = rect->x; x < rect->x + rect->w; x++) {
+        const Uint8 *src = wdata->fb_pixels + rect->y * wdata->fb_pitch + x * 4;
+        Uint8 *dst = wdata->fb_rotated +
+            (x * N3DS_SCREEN_HEIGHT + (N3DS_SCREEN_HEIGHT - 1 - rect->y)) * N3DS_FB_BPP;
+
+        for (y = rect->h; y--; ) {
+            /* RGB888 is B,G,R,X in memory, the LCD wants B,G,R */
+            dst[0] = src[0];
+            dst[1] = src[1];
+            dst[2] = src[2];
+            src += wdata->fb_pitch;
+            dst -= N3DS_FB_BPP;
+        }
+    }
+}
+
+int
+N3DS_UpdateWindowFramebuffer(_THIS, SDL_Window * window, const SDL_Rect * rects, int numrects)
+{
+    SDL_WindowData *wdata = (SDL_WindowData *) window->driverdata;
+    const SDL_Rect bounds = { 0, 0, wdata->fb_w, wdata->fb_h };
+    const int column = N3DS_SCREEN_HEIGHT * N3DS_FB_BPP;
+    int lo = wdata->fb_w, hi = 0;
+    u8 *fb;
+    int back, i;
+
+    if (!wdata->fb_pixels) {
+        return SDL_SetError("Couldn't find framebuffer for window");
+    }
+
+    for (i = 0; i < numrects; i++) {
+        SDL_Rect rect;
+        if (!SDL_IntersectRect(&rects[i], &bounds, &rect)) {
+            continue;
+        }
+        N3DS_RotateRect(wdata, &rect);
+        lo = SDL_min(lo, rect.x);
+        hi = SDL_max(hi, rect.x + rect.w);
+    }
+
+    if (lo < hi) {
+        /* Rotated columns are contiguous, so one flush covers them */
+        GSPGPU_FlushDataCache(wdata->fb_rotated + lo * column, (hi - lo) * column);
+
+        /* Both LCD buffers are now out of date in these columns */
+        for (i = 0; i < 2; i++) {
+            wdata->fb_dirty_lo[i] = SDL_min(wdata->fb_dirty_lo[i], lo);
+            wdata->fb_dirty_hi[i] = SDL_max(wdata->fb_dirty_hi[i], hi);
+        }
+    }
+
+    /* Bring the back buffer up to date, it may be two updates behind */
+    fb = gfxGetFramebuffer(wdata->screen, GFX_LEFT, NULL, NULL);
+    back = N3DS_GetBackBufferIndex(wdata, fb);
+    lo = wdata->fb_dirty_lo[back];
+    hi = wdata->fb_dirty_hi[back];
+    if (lo < hi) {
+        GX_TextureCopy((u32 *)(wdata->fb_rotated + lo * column), 0,
+            (u32 *)(fb + lo * column), 0,
+            (hi - lo) * column, 0x8 /* raw copy */);
+        gspWaitForPPF();
+    }
+    wdata->fb_dirty_lo[back] = wdata->fb_w;
+    wdata->fb_dirty_hi[back] = 0;
+
+    gfxFlushBuffers();
+    gfxSwapBuffers();
+    return 0;
+}
+
+void
+N3DS_DestroyWindowFramebuffer(_THIS, SDL_Window * window)
+{
+    SDL_WindowData *wdata = (SDL_WindowData *) window->driverdata;
+
+    if (wdata->fb_pixels) {
+        linearFree(wdata->fb_pixels);
+        wdata->fb_pixels = NULL;
+    }
+    if (wdata->fb_rotated) {
+        linearFree(wdata->fb_rotated);
+        wdata->fb_rotated = NULL;
+    }
+}
+
+#endif /* SDL_VIDEO_DRIVER_3DS */
+
+/* vi: set ts=4 sw=4 expandtab: */
@@ -37,6 +37,7 @@
 /* 3DS declarations */
 #include "SDL_3dsvideo.h"
 #include "SDL_3dsevents_c.h"
+#include "SDL_3dsframebuffer_c.h"
 //#include "SDL_pspgl_c.h"
 
 /* unused
@@ -126,6 +127,9 @@ N3DS_Create()
     device->RestoreWindow = N3DS_RestoreWindow;
     device->SetWindowGrab = N3DS_SetWindowGrab;
     device->DestroyWindow = N3DS_DestroyWindow;
+    device->CreateWindowFramebuffer = N3DS_CreateWindowFramebuffer;
+    device->UpdateWindowFramebuffer = N3DS_UpdateWindowFramebuffer;
+    device->DestroyWindowFramebuffer = N3DS_DestroyWindowFramebuffer;
     device->GetWindowWMInfo = N3DS_GetWindowWMInfo;
     /*device->GL_LoadLibrary = N3DS_GL_LoadLibrary; 3DS STUB
     device->GL_GetProcAddress = N3DS_GL_GetProcAddress;
@@ -156,16 +160,23 @@ VideoBootStrap N3DS_bootstrap = {
 /*****************************************************************************/
 /* SDL Video and Display initialization/handling functions                   */
 /*****************************************************************************/
-int
-N3DS_VideoInit(_THIS)
+static int
+N3DS_AddDisplay(gfxScreen_t screen, int w, int h)
 {
     SDL_VideoDisplay display;
     SDL_DisplayMode current_mode;
+    SDL_DisplayData *dispdata;
+
+    dispdata = (SDL_DisplayData *) SDL_calloc(1, sizeof(SDL_DisplayData));
+    if (dispdata == NULL) {
+        return SDL_OutOfMemory();
+    }
+    dispdata->screen = screen;
 
     SDL_zero(current_mode);
 
-    current_mode.w = 400;
-    current_mode.h = 240;
+    current_mode.w = w;
+    current_mode.h = h;
 
     current_mode.refresh_rate = 60;
     /* 32 bpp for default */
@@ -176,17 +187,33 @@ N3DS_VideoInit(_THIS)
     SDL_zero(display);
     display.desktop_mode = current_mode;
     display.current_mode = current_mode;
-    display.driverdata = NULL;
+    display.driverdata = dispdata;
 
     SDL_AddVideoDisplay(&display);
 
+    return 0;
+}
+
+int
+N3DS_VideoInit(_THIS)
+{
+    /* The framebuffers are owned by the video driver, so both the
+       renderer and the window framebuffer can draw to them */
+    gfxInitDefault();
+
+    if (N3DS_AddDisplay(GFX_TOP, N3DS_TOP_SCREEN_WIDTH, N3DS_SCREEN_HEIGHT) < 0 ||
+        N3DS_AddDisplay(GFX_BOTTOM, N3DS_BOTTOM_SCREEN_WIDTH, N3DS_SCREEN_HEIGHT) < 0) {
+        gfxExit();
+        return -1;
+    }
+
     return 1;
 }
 
 void
 N3DS_VideoQuit(_THIS)
 {
-
+    gfxExit();
 }
 
 void
@@ -216,6 +243,7 @@ int
 N3DS_CreateWindow(_THIS, SDL_Window * window)
 {
 	SDL_WindowData *wdata;
+	SDL_DisplayData *dispdata;
 
 	/* Allocate window internal data */
 	wdata = (SDL_WindowData *) SDL_calloc(1, sizeof(SDL_WindowData));
@@ -223,6 +251,10 @@ N3DS_CreateWindow(_THIS, SDL_Window * window)
 		return SDL_OutOfMemory();
 	}
 
+	/* Windows placed on display 1 go to the bottom screen */
+	dispdata = (SDL_DisplayData *) SDL_GetDisplayForWindow(window)->driverdata;
+	wdata->screen = dispdata->screen;
+
 	/* Setup driver data for this window */
 	window->driverdata = wdata;
 
@@ -287,6 +319,8 @@ N3DS_SetWindowGrab(_THIS, SDL_Window * window, SDL_bool grabbed)
 void
 N3DS_DestroyWindow(_THIS, SDL_Window * window)
 {
+    SDL_free(window->driverdata);
+    window->driverdata = NULL;
 }
 
 /*****************************************************************************/
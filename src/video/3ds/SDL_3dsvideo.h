@@ -24,9 +24,16 @@
 
 //#include <GLES/egl.h>
 
+#include <3ds.h>
+
 #include "../../SDL_internal.h"
 #include "../SDL_sysvideo.h"
 
+/* Display 0 is the top screen, display 1 the bottom (touch) screen */
+#define N3DS_TOP_SCREEN_WIDTH     400
+#define N3DS_BOTTOM_SCREEN_WIDTH  320
+#define N3DS_SCREEN_HEIGHT        240
+
 typedef struct SDL_VideoData
 {
     SDL_bool egl_initialized;   /* OpenGL ES device initialization status */
@@ -39,6 +46,7 @@ typedef struct SDL_VideoData
 
 typedef struct SDL_DisplayData
 {
+    gfxScreen_t screen;         /* GFX_TOP or GFX_BOTTOM                  */
 
 } SDL_DisplayData;
 
@@ -46,6 +54,15 @@ typedef struct SDL_DisplayData
 typedef struct SDL_WindowData
 {
     SDL_bool uses_gles;         /* if true window must support OpenGL ES */
+    gfxScreen_t screen;         /* screen the window was created on       */
+
+    /* Window framebuffer (SDL_3dsframebuffer.c) */
+    Uint8 *fb_pixels;           /* surface handed to the application      */
+    Uint8 *fb_rotated;          /* the same image in LCD (rotated) layout */
+    int fb_w, fb_h, fb_pitch;
+    u8 *fb_buffers[2];          /* the screen's LCD buffers, once seen    */
+    int fb_dirty_lo[2];         /* stale column range per LCD buffer      */
+    int fb_dirty_hi[2];
 
 } SDL_WindowData;
 
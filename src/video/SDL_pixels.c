@@ -124,6 +124,8 @@ SDL_GetPixelFormatName(Uint32 format)
     CASE(SDL_PIXELFORMAT_YVYU)
     CASE(SDL_PIXELFORMAT_NV12)
     CASE(SDL_PIXELFORMAT_NV21)
+    CASE(SDL_PIXELFORMAT_ETC1)
+    CASE(SDL_PIXELFORMAT_ETC1A4)
 #undef CASE
     default:
         return "SDL_PIXELFORMAT_UNKNOWN";
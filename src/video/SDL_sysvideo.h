@@ -243,6 +243,12 @@ struct SDL_VideoDevice
      */
     void (*PumpEvents) (_THIS);
 
+    /* Block until the OS may have events for PumpEvents() or the timeout,
+       in milliseconds or -1 for none, expires. Optional; SendWakeupEvent()
+       must make it return early from another thread. */
+    int (*WaitEventTimeout) (_THIS, int timeout);
+    void (*SendWakeupEvent) (_THIS);
+
     /* Suspend the screensaver */
     void (*SuspendScreenSaver) (_THIS);
 
@@ -25,17 +25,66 @@
 /* Being a null driver, there's no event stream. We just define stubs for
    most of the API. */
 
+#include "SDL_mutex.h"
+#include "SDL_timer.h"
 #include "../../events/SDL_events_c.h"
 
 #include "SDL_nullvideo.h"
 #include "SDL_nullevents_c.h"
 
+/* Posted by SDL_PushEvent() while someone waits for events */
+static SDL_sem *DUMMY_wakeup = NULL;
+
 void
 DUMMY_PumpEvents(_THIS)
 {
     /* do nothing. */
 }
 
+int
+DUMMY_InitEvents(_THIS)
+{
+#if !SDL_THREADS_DISABLED
+    DUMMY_wakeup = SDL_CreateSemaphore(0);
+    if (!DUMMY_wakeup) {
+        return -1;
+    }
+#endif
+    return 0;
+}
+
+void
+DUMMY_QuitEvents(_THIS)
+{
+    if (DUMMY_wakeup) {
+        SDL_DestroySemaphore(DUMMY_wakeup);
+        DUMMY_wakeup = NULL;
+    }
+}
+
+int
+DUMMY_WaitEventTimeout(_THIS, int timeout)
+{
+    if (!DUMMY_wakeup) {
+        /* Nothing can wake us up, don't sleep for long */
+        SDL_Delay((timeout < 0 || timeout > 10) ? 10 : timeout);
+        return 0;
+    }
+    if (timeout < 0) {
+        return (SDL_SemWait(DUMMY_wakeup) == 0);
+    }
+    return (SDL_SemWaitTimeout(DUMMY_wakeup, timeout) == 0);
+}
+
+void
+DUMMY_SendWakeupEvent(_THIS)
+{
+    /* One pending wakeup is enough */
+    if (DUMMY_wakeup && SDL_SemValue(DUMMY_wakeup) == 0) {
+        SDL_SemPost(DUMMY_wakeup);
+    }
+}
+
 #endif /* SDL_VIDEO_DRIVER_DUMMY */
 
 /* vi: set ts=4 sw=4 expandtab: */
@@ -23,5 +23,9 @@
 #include "SDL_nullvideo.h"
 
 extern void DUMMY_PumpEvents(_THIS);
+extern int DUMMY_InitEvents(_THIS);
+extern void DUMMY_QuitEvents(_THIS);
+extern int DUMMY_WaitEventTimeout(_THIS, int timeout);
+extern void DUMMY_SendWakeupEvent(_THIS);
 
 /* vi: set ts=4 sw=4 expandtab: */
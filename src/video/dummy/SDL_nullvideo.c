@@ -90,6 +90,8 @@ DUMMY_CreateDevice(int devindex)
     device->VideoQuit = DUMMY_VideoQuit;
     device->SetDisplayMode = DUMMY_SetDisplayMode;
     device->PumpEvents = DUMMY_PumpEvents;
+    device->WaitEventTimeout = DUMMY_WaitEventTimeout;
+    device->SendWakeupEvent = DUMMY_SendWakeupEvent;
     device->CreateWindowFramebuffer = SDL_DUMMY_CreateWindowFramebuffer;
     device->UpdateWindowFramebuffer = SDL_DUMMY_UpdateWindowFramebuffer;
     device->DestroyWindowFramebuffer = SDL_DUMMY_DestroyWindowFramebuffer;
@@ -123,6 +125,10 @@ DUMMY_VideoInit(_THIS)
     SDL_zero(mode);
     SDL_AddDisplayMode(&_this->displays[0], &mode);
 
+    if (DUMMY_InitEvents(_this) < 0) {
+        return -1;
+    }
+
     /* We're done! */
     return 0;
 }
@@ -136,6 +142,7 @@ DUMMY_SetDisplayMode(_THIS, SDL_VideoDisplay * display, SDL_DisplayMode * mode)
 void
 DUMMY_VideoQuit(_THIS)
 {
+    DUMMY_QuitEvents(_this);
 }
 
 #endif /* SDL_VIDEO_DRIVER_DUMMY */
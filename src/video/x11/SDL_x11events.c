@@ -502,6 +502,49 @@ ReconcileKeyboardState(_THIS, const SDL_WindowData *data)
     }
 }
 
+/* The time the server saw the input behind an event, in performance
+   counter units, or 0 if we can't tell */
+static Uint64
+X11_GetEventAcquisitionTime(const XEvent *xevent)
+{
+    Time time;
+    Uint64 now;
+    Uint32 age;
+
+    switch (xevent->type) {
+    case KeyPress:
+    case KeyRelease:
+        time = xevent->xkey.time;
+        break;
+    case ButtonPress:
+    case ButtonRelease:
+        time = xevent->xbutton.time;
+        break;
+    case MotionNotify:
+        time = xevent->xmotion.time;
+        break;
+    case EnterNotify:
+    case LeaveNotify:
+        time = xevent->xcrossing.time;
+        break;
+    default:
+        return 0;
+    }
+
+    /* The X server timestamps are milliseconds of the monotonic clock on
+       Linux, which is what the performance counter counts in nanoseconds.
+       If the times are far apart the server uses some other clock. */
+    if (SDL_GetPerformanceFrequency() != 1000000000) {
+        return 0;
+    }
+    now = SDL_GetPerformanceCounter();
+    age = (Uint32)(now / 1000000) - (Uint32)time;
+    if (age > 1000) {
+        return 0;
+    }
+    return (now - (now % 1000000)) - (Uint64)age * 1000000;
+}
+
 static void
 X11_DispatchEvent(_THIS)
 {
@@ -517,6 +560,9 @@ X11_DispatchEvent(_THIS)
     SDL_zero(xevent);           /* valgrind fix. --ryan. */
     X11_XNextEvent(display, &xevent);
 
+    /* Whatever this event turns into happened when the server saw it */
+    SDL_SetEventAcquisitionTime(X11_GetEventAcquisitionTime(&xevent));
+
     /* Save the original keycode for dead keys, which are filtered out by
        the XFilterEvent() call below.
     */
@@ -1315,11 +1361,110 @@ X11_PumpEvents(_THIS)
     while (X11_Pending(data->display)) {
         X11_DispatchEvent(_this);
     }
+    SDL_SetEventAcquisitionTime(0);
 
     /* FIXME: Only need to do this when there are pending focus changes */
     X11_HandleFocusChanges(_this);
 }
 
+/* How long X11_PumpEvents() can go without being called */
+static int
+X11_MaxWaitTimeout(_THIS, int timeout)
+{
+    SDL_VideoData *data = (SDL_VideoData *) _this->driverdata;
+    int i;
+
+    /* Focus changes are settled on a timer */
+    for (i = 0; i < data->numwindows; ++i) {
+        SDL_WindowData *windowdata = data->windowlist[i];
+        if (windowdata && windowdata->pending_focus != PENDING_FOCUS_NONE) {
+            return (timeout < 0 || timeout > 10) ? 10 : timeout;
+        }
+    }
+
+#ifdef SDL_USE_IBUS
+    /* IBus talks to us over D-Bus, not the X connection */
+    if (SDL_GetEventState(SDL_TEXTINPUT) == SDL_ENABLE) {
+        return (timeout < 0 || timeout > 10) ? 10 : timeout;
+    }
+#endif
+
+    /* The screensaver gets poked every 30 seconds */
+    if (_this->suspend_screensaver && data->screensaver_activity) {
+        const Uint32 now = SDL_GetTicks();
+        int left = 0;
+        if (!SDL_TICKS_PASSED(now, data->screensaver_activity + 30000)) {
+            left = (int)(data->screensaver_activity + 30000 - now);
+        }
+        if (timeout < 0 || timeout > left) {
+            timeout = left;
+        }
+    }
+    return timeout;
+}
+
+int
+X11_WaitEventTimeout(_THIS, int timeout)
+{
+    SDL_VideoData *data = (SDL_VideoData *) _this->driverdata;
+    Display *display = data->display;
+    struct timeval tv, *tvp = NULL;
+    int x11_fd, max_fd;
+    fd_set fdset;
+
+    /* Events Xlib has already read won't show up on the connection */
+    X11_XFlush(display);
+    if (X11_XEventsQueued(display, QueuedAlready)) {
+        return 1;
+    }
+
+    timeout = X11_MaxWaitTimeout(_this, timeout);
+    if (data->wakeup_pipe[0] < 0 && (timeout < 0 || timeout > 10)) {
+        /* Nobody can wake us up, don't sleep for long */
+        timeout = 10;
+    }
+
+    x11_fd = ConnectionNumber(display);
+    FD_ZERO(&fdset);
+    FD_SET(x11_fd, &fdset);
+    max_fd = x11_fd;
+    if (data->wakeup_pipe[0] >= 0) {
+        FD_SET(data->wakeup_pipe[0], &fdset);
+        max_fd = SDL_max(max_fd, data->wakeup_pipe[0]);
+    }
+
+    if (timeout >= 0) {
+        tv.tv_sec = timeout / 1000;
+        tv.tv_usec = (timeout % 1000) * 1000;
+        tvp = &tv;
+    }
+
+    if (select(max_fd + 1, &fdset, NULL, NULL, tvp) <= 0) {
+        /* Timed out, or interrupted by a signal */
+        return 0;
+    }
+
+    if (data->wakeup_pipe[0] >= 0 && FD_ISSET(data->wakeup_pipe[0], &fdset)) {
+        char buf[64];
+        while (read(data->wakeup_pipe[0], buf, sizeof(buf)) > 0) {
+            continue;
+        }
+    }
+    return 1;
+}
+
+void
+X11_SendWakeupEvent(_THIS)
+{
+    SDL_VideoData *data = (SDL_VideoData *) _this->driverdata;
+    const char c = 0;
+
+    /* If the pipe is full there's a wakeup pending already */
+    if (data->wakeup_pipe[1] >= 0) {
+        ssize_t result = write(data->wakeup_pipe[1], &c, 1);
+        (void) result;
+    }
+}
 
 void
 X11_SuspendScreenSaver(_THIS)
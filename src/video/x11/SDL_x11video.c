@@ -23,6 +23,7 @@
 #if SDL_VIDEO_DRIVER_X11
 
 #include <unistd.h> /* For getpid() and readlink() */
+#include <fcntl.h>
 
 #include "SDL_video.h"
 #include "SDL_mouse.h"
@@ -219,6 +220,8 @@ X11_CreateDevice(int devindex)
     device->SetDisplayMode = X11_SetDisplayMode;
     device->SuspendScreenSaver = X11_SuspendScreenSaver;
     device->PumpEvents = X11_PumpEvents;
+    device->WaitEventTimeout = X11_WaitEventTimeout;
+    device->SendWakeupEvent = X11_SendWakeupEvent;
 
     device->CreateWindow = X11_CreateWindow;
     device->CreateWindowFrom = X11_CreateWindowFrom;
@@ -372,6 +375,14 @@ X11_VideoInit(_THIS)
     /* Get the process PID to be associated to the window */
     data->pid = getpid();
 
+    /* Waits for events can be cut short through this pipe */
+    if (pipe(data->wakeup_pipe) == 0) {
+        fcntl(data->wakeup_pipe[0], F_SETFL, O_NONBLOCK);
+        fcntl(data->wakeup_pipe[1], F_SETFL, O_NONBLOCK);
+    } else {
+        data->wakeup_pipe[0] = data->wakeup_pipe[1] = -1;
+    }
+
     /* Open a connection to the X input manager */
 #ifdef X_HAVE_UTF8_STRING
     if (SDL_X11_HAVE_UTF8) {
@@ -437,6 +448,11 @@ X11_VideoQuit(_THIS)
     SDL_VideoData *data = (SDL_VideoData *) _this->driverdata;
 
     SDL_free(data->classname);
+    if (data->wakeup_pipe[0] >= 0) {
+        close(data->wakeup_pipe[0]);
+        close(data->wakeup_pipe[1]);
+        data->wakeup_pipe[0] = data->wakeup_pipe[1] = -1;
+    }
 #ifdef X_HAVE_UTF8_STRING
     if (data->im) {
         X11_XCloseIM(data->im);
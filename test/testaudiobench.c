@@ -0,0 +1,385 @@
+/*
+  Copyright (C) 1997-2014 Sam Lantinga <slouken@libsdl.org>
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely.
+*/
+
+/* Check that SDL_ConvertAudio() gives the same bits as the plain C
+   conversions for the formats that have vectorized converters, then
+   measure how many samples per second each conversion goes through.
+   Conversions that also change the channels are checked against doing
+   the type and the channel conversion one after the other. */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "SDL.h"
+
+#define NUM_SAMPLES     4096
+#define DEFAULT_SECONDS 0.25
+
+/* Same constants as the converters in SDL */
+#define DIVBY32767 3.05185094759972e-05f
+#define DIVBY2147483647 4.6566128752458e-10f
+
+typedef void (*Reference) (const void *src, void *dst, int num);
+
+typedef struct
+{
+    const char *name;
+    SDL_AudioFormat src_fmt;
+    SDL_AudioFormat dst_fmt;
+    Reference reference;
+} Conversion;
+
+static void
+S16ToF32(const void *src, void *dst, int num)
+{
+    int i;
+    for (i = 0; i < num; ++i) {
+        ((float *) dst)[i] = ((float) ((const Sint16 *) src)[i]) * DIVBY32767;
+    }
+}
+
+static void
+F32ToS16(const void *src, void *dst, int num)
+{
+    int i;
+    for (i = 0; i < num; ++i) {
+        ((Sint16 *) dst)[i] = (Sint16) (((const float *) src)[i] * 32767.0f);
+    }
+}
+
+static void
+S32ToF32(const void *src, void *dst, int num)
+{
+    int i;
+    for (i = 0; i < num; ++i) {
+        ((float *) dst)[i] = ((float) ((const Sint32 *) src)[i]) * DIVBY2147483647;
+    }
+}
+
+static void
+F32ToS32(const void *src, void *dst, int num)
+{
+    int i;
+    for (i = 0; i < num; ++i) {
+        ((Sint32 *) dst)[i] = (Sint32) (((const float *) src)[i] * 2147483647.0);
+    }
+}
+
+static void
+U8ToS16(const void *src, void *dst, int num)
+{
+    int i;
+    for (i = 0; i < num; ++i) {
+        ((Sint16 *) dst)[i] = (Sint16) (((Sint16) (((const Uint8 *) src)[i] ^ 0x80)) << 8);
+    }
+}
+
+static void
+S8ToS16(const void *src, void *dst, int num)
+{
+    int i;
+    for (i = 0; i < num; ++i) {
+        ((Sint16 *) dst)[i] = (Sint16) (((Sint16) ((const Sint8 *) src)[i]) << 8);
+    }
+}
+
+static void
+SwapF32(const void *src, void *dst, int num)
+{
+    int i;
+    for (i = 0; i < num; ++i) {
+        ((Uint32 *) dst)[i] = SDL_Swap32(((const Uint32 *) src)[i]);
+    }
+}
+
+static const Conversion conversions[] = {
+    { "S16LSB -> F32LSB", AUDIO_S16LSB, AUDIO_F32LSB, S16ToF32 },
+    { "F32LSB -> S16LSB", AUDIO_F32LSB, AUDIO_S16LSB, F32ToS16 },
+    { "S32LSB -> F32LSB", AUDIO_S32LSB, AUDIO_F32LSB, S32ToF32 },
+    { "F32LSB -> S32LSB", AUDIO_F32LSB, AUDIO_S32LSB, F32ToS32 },
+    { "U8     -> S16LSB", AUDIO_U8, AUDIO_S16LSB, U8ToS16 },
+    { "S8     -> S16LSB", AUDIO_S8, AUDIO_S16LSB, S8ToS16 },
+    { "F32LSB -> F32MSB", AUDIO_F32LSB, AUDIO_F32MSB, SwapF32 },
+    { "F32MSB -> F32LSB", AUDIO_F32MSB, AUDIO_F32LSB, SwapF32 },
+};
+
+typedef struct
+{
+    const char *name;
+    SDL_AudioFormat src_fmt;
+    Uint8 src_channels;
+    SDL_AudioFormat dst_fmt;
+    Uint8 dst_channels;
+} Chain;
+
+static const Chain chains[] = {
+    { "S16LSB mono   -> F32LSB stereo", AUDIO_S16LSB, 1, AUDIO_F32LSB, 2 },
+    { "U8 mono       -> S16LSB stereo", AUDIO_U8, 1, AUDIO_S16LSB, 2 },
+    { "S8 mono       -> S16LSB stereo", AUDIO_S8, 1, AUDIO_S16LSB, 2 },
+    { "F32LSB mono   -> S16LSB stereo", AUDIO_F32LSB, 1, AUDIO_S16LSB, 2 },
+    { "S16LSB stereo -> F32LSB mono  ", AUDIO_S16LSB, 2, AUDIO_F32LSB, 1 },
+    { "F32LSB stereo -> S16LSB mono  ", AUDIO_F32LSB, 2, AUDIO_S16LSB, 1 },
+};
+
+/* Random samples, floats within [-1, 1] since larger values don't
+   convert to anything well defined */
+static void
+FillSamples(SDL_AudioFormat format, void *buf, int num)
+{
+    int i;
+    for (i = 0; i < num; ++i) {
+        Uint32 bits = ((Uint32) rand() << 16) ^ (Uint32) rand();
+        if (SDL_AUDIO_ISFLOAT(format)) {
+            float value = (float) ((int) (bits % 2000001) - 1000000) / 1000000.0f;
+            if (i < 4) {
+                value = (i & 1) ? -1.0f : 1.0f;
+            }
+            if (SDL_AUDIO_ISBIGENDIAN(format)) {
+                value = SDL_SwapFloatBE(value);
+            }
+            ((float *) buf)[i] = value;
+        } else {
+            SDL_memcpy((Uint8 *) buf + i * (SDL_AUDIO_BITSIZE(format) / 8), &bits, SDL_AUDIO_BITSIZE(format) / 8);
+        }
+    }
+}
+
+static int
+CheckConversion(const Conversion *conv)
+{
+    static Uint32 src[NUM_SAMPLES], expected[NUM_SAMPLES];
+    static Uint8 buf[NUM_SAMPLES * 4];
+    const int src_size = SDL_AUDIO_BITSIZE(conv->src_fmt) / 8;
+    const int dst_size = SDL_AUDIO_BITSIZE(conv->dst_fmt) / 8;
+    SDL_AudioCVT cvt;
+    int num;
+
+    /* Every length up to a few vectors, to cover the leftover samples */
+    for (num = 0; num < 80; ++num) {
+        FillSamples(conv->src_fmt, src, num);
+        conv->reference(src, expected, num);
+
+        if (SDL_BuildAudioCVT(&cvt, conv->src_fmt, 1, 48000, conv->dst_fmt, 1, 48000) < 0) {
+            SDL_Log("%s: SDL_BuildAudioCVT() failed: %s\n", conv->name, SDL_GetError());
+            return -1;
+        }
+        cvt.buf = buf;
+        cvt.len = num * src_size;
+        SDL_memcpy(buf, src, cvt.len);
+        if (SDL_ConvertAudio(&cvt) < 0) {
+            SDL_Log("%s: SDL_ConvertAudio() failed: %s\n", conv->name, SDL_GetError());
+            return -1;
+        }
+        if (cvt.len_cvt != num * dst_size || SDL_memcmp(buf, expected, cvt.len_cvt) != 0) {
+            SDL_Log("%s: %d samples don't match the C conversion\n", conv->name, num);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static void
+MeasureConversion(const Conversion *conv, double seconds)
+{
+    static Uint32 src[NUM_SAMPLES];
+    static Uint8 buf[NUM_SAMPLES * 4];
+    const int src_size = SDL_AUDIO_BITSIZE(conv->src_fmt) / 8;
+    const Uint64 frequency = SDL_GetPerformanceFrequency();
+    Uint64 start, elapsed;
+    Uint64 samples = 0;
+    SDL_AudioCVT cvt;
+
+    FillSamples(conv->src_fmt, src, NUM_SAMPLES);
+    SDL_BuildAudioCVT(&cvt, conv->src_fmt, 1, 48000, conv->dst_fmt, 1, 48000);
+    cvt.buf = buf;
+    cvt.len = NUM_SAMPLES * src_size;
+
+    start = SDL_GetPerformanceCounter();
+    do {
+        SDL_memcpy(buf, src, cvt.len);
+        SDL_ConvertAudio(&cvt);
+        samples += NUM_SAMPLES;
+        elapsed = SDL_GetPerformanceCounter() - start;
+    } while (elapsed < seconds * frequency);
+
+    SDL_Log("%s: %8.1f Msamples/s\n", conv->name,
+            samples / ((double) elapsed / frequency) / 1000000.0);
+}
+
+/* On builds that do scalar float math on the x87, the scalar code rounds
+   differently from the vector code now and then, so conversions through
+   float are allowed to be off by one in the last place of a full scale
+   sample. */
+static int
+SamplesMatch(const Chain *chain, const Uint8 *a, const Uint8 *b, int len)
+{
+    int i;
+
+    if (!SDL_AUDIO_ISFLOAT(chain->src_fmt) && !SDL_AUDIO_ISFLOAT(chain->dst_fmt)) {
+        return SDL_memcmp(a, b, len) == 0;
+    }
+    for (i = 0; i < len; i += SDL_AUDIO_BITSIZE(chain->dst_fmt) / 8) {
+        if (SDL_AUDIO_ISFLOAT(chain->dst_fmt)) {
+            const float x = *(const float *) (a + i);
+            const float y = *(const float *) (b + i);
+            if (SDL_fabs(x - y) > 1.2e-7) {
+                return 0;
+            }
+        } else {
+            const int x = *(const Sint16 *) (a + i);
+            const int y = *(const Sint16 *) (b + i);
+            if (SDL_abs(x - y) > 1) {
+                return 0;
+            }
+        }
+    }
+    return 1;
+}
+
+static int
+CheckChain(const Chain *chain)
+{
+    static Uint32 src[NUM_SAMPLES];
+    static Uint8 buf[NUM_SAMPLES * 8], expected[NUM_SAMPLES * 8];
+    const int src_size = SDL_AUDIO_BITSIZE(chain->src_fmt) / 8 * chain->src_channels;
+    SDL_AudioCVT cvt, type_cvt, channel_cvt;
+    int num;
+
+    if (SDL_BuildAudioCVT(&cvt, chain->src_fmt, chain->src_channels, 48000,
+                          chain->dst_fmt, chain->dst_channels, 48000) < 0 ||
+        SDL_BuildAudioCVT(&type_cvt, chain->src_fmt, chain->src_channels, 48000,
+                          chain->dst_fmt, chain->src_channels, 48000) < 0 ||
+        SDL_BuildAudioCVT(&channel_cvt, chain->dst_fmt, chain->src_channels, 48000,
+                          chain->dst_fmt, chain->dst_channels, 48000) < 0) {
+        SDL_Log("%s: SDL_BuildAudioCVT() failed: %s\n", chain->name, SDL_GetError());
+        return -1;
+    }
+
+    for (num = 0; num < 80; ++num) {
+        FillSamples(chain->src_fmt, src, num * chain->src_channels);
+
+        type_cvt.buf = expected;
+        type_cvt.len = num * src_size;
+        SDL_memcpy(expected, src, type_cvt.len);
+        SDL_ConvertAudio(&type_cvt);
+        channel_cvt.buf = expected;
+        channel_cvt.len = type_cvt.len_cvt;
+        SDL_ConvertAudio(&channel_cvt);
+
+        cvt.buf = buf;
+        cvt.len = num * src_size;
+        SDL_memcpy(buf, src, cvt.len);
+        SDL_ConvertAudio(&cvt);
+        if (cvt.len_cvt != channel_cvt.len_cvt || !SamplesMatch(chain, buf, expected, cvt.len_cvt)) {
+            SDL_Log("%s: %d frames don't match converting in two steps\n", chain->name, num);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/* Frames per second in one pass, and in two steps like without fusing */
+static void
+MeasureChain(const Chain *chain, double seconds)
+{
+    static Uint32 src[NUM_SAMPLES];
+    static Uint8 buf[NUM_SAMPLES * 8];
+    const int frames = NUM_SAMPLES / 2;
+    const int src_size = SDL_AUDIO_BITSIZE(chain->src_fmt) / 8 * chain->src_channels;
+    const Uint64 frequency = SDL_GetPerformanceFrequency();
+    Uint64 start, elapsed;
+    Uint64 total;
+    double fused;
+    SDL_AudioCVT cvt, type_cvt, channel_cvt;
+
+    FillSamples(chain->src_fmt, src, frames * chain->src_channels);
+    SDL_BuildAudioCVT(&cvt, chain->src_fmt, chain->src_channels, 48000,
+                      chain->dst_fmt, chain->dst_channels, 48000);
+    SDL_BuildAudioCVT(&type_cvt, chain->src_fmt, chain->src_channels, 48000,
+                      chain->dst_fmt, chain->src_channels, 48000);
+    SDL_BuildAudioCVT(&channel_cvt, chain->dst_fmt, chain->src_channels, 48000,
+                      chain->dst_fmt, chain->dst_channels, 48000);
+    cvt.buf = type_cvt.buf = channel_cvt.buf = buf;
+    cvt.len = type_cvt.len = frames * src_size;
+
+    total = 0;
+    start = SDL_GetPerformanceCounter();
+    do {
+        SDL_memcpy(buf, src, cvt.len);
+        SDL_ConvertAudio(&cvt);
+        total += frames;
+        elapsed = SDL_GetPerformanceCounter() - start;
+    } while (elapsed < seconds * frequency);
+    fused = total / ((double) elapsed / frequency) / 1000000.0;
+
+    total = 0;
+    start = SDL_GetPerformanceCounter();
+    do {
+        SDL_memcpy(buf, src, type_cvt.len);
+        SDL_ConvertAudio(&type_cvt);
+        channel_cvt.len = type_cvt.len_cvt;
+        SDL_ConvertAudio(&channel_cvt);
+        total += frames;
+        elapsed = SDL_GetPerformanceCounter() - start;
+    } while (elapsed < seconds * frequency);
+
+    SDL_Log("%s: %8.1f Mframes/s, %8.1f Mframes/s in two steps\n", chain->name,
+            fused, total / ((double) elapsed / frequency) / 1000000.0);
+}
+
+int
+main(int argc, char *argv[])
+{
+    double seconds = DEFAULT_SECONDS;
+    int status = 0;
+    int i;
+
+    /* Enable standard application logging */
+    SDL_LogSetPriority(SDL_LOG_CATEGORY_APPLICATION, SDL_LOG_PRIORITY_INFO);
+
+    for (i = 1; i < argc; ++i) {
+        if (SDL_strcmp(argv[i], "--seconds") == 0 && argv[i+1]) {
+            seconds = SDL_atof(argv[++i]);
+        } else {
+            SDL_Log("Usage: %s [--seconds N]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (SDL_Init(0) < 0) {
+        SDL_Log("Couldn't initialize SDL: %s\n", SDL_GetError());
+        return 1;
+    }
+
+    SDL_Log("SSE2: %s, AVX2: %s\n", SDL_HasSSE2() ? "yes" : "no", SDL_HasAVX2() ? "yes" : "no");
+
+    srand(0);
+    for (i = 0; i < SDL_arraysize(conversions); ++i) {
+        if (CheckConversion(&conversions[i]) < 0) {
+            status = 1;
+            continue;
+        }
+        MeasureConversion(&conversions[i], seconds);
+    }
+    for (i = 0; i < SDL_arraysize(chains); ++i) {
+        if (CheckChain(&chains[i]) < 0) {
+            status = 1;
+            continue;
+        }
+        MeasureChain(&chains[i], seconds);
+    }
+
+    SDL_Quit();
+    return status;
+}
+
+/* vi: set ts=4 sw=4 expandtab: */
@@ -969,6 +969,524 @@ int audio_openCloseAudioDeviceConnected()
 
 
 
+/**
+ * \brief Converts audio through a stream in chunks of random size and checks it against one big write.
+ *
+ * \sa https://wiki.libsdl.org/SDL_NewAudioStream
+ * \sa https://wiki.libsdl.org/SDL_AudioStreamPut
+ * \sa https://wiki.libsdl.org/SDL_AudioStreamGet
+ */
+int audio_convertAudioStream()
+{
+   const int numFrames = 2000;
+   const int outFrames = numFrames * 2;
+   const int outLen = outFrames * 2 * sizeof(float);
+   SDL_AudioStream *whole, *chunked;
+   Sint16 *input;
+   Uint8 *expected, *output;
+   int result, i, len, got;
+
+   input = (Sint16 *)SDL_malloc(numFrames * sizeof(Sint16));
+   expected = (Uint8 *)SDL_malloc(outLen);
+   output = (Uint8 *)SDL_malloc(outLen);
+   SDLTest_AssertCheck(input != NULL && expected != NULL && output != NULL, "Check buffers are not NULL");
+   if (input == NULL || expected == NULL || output == NULL) return TEST_ABORTED;
+   for (i = 0; i < numFrames; i++) {
+     input[i] = SDLTest_RandomSint16();
+   }
+
+   /* Mono 22050 Hz to stereo 44100 Hz, written all at once */
+   whole = SDL_NewAudioStream(AUDIO_S16SYS, 1, 22050, AUDIO_F32SYS, 2, 44100);
+   SDLTest_AssertPass("Call to SDL_NewAudioStream(AUDIO_S16SYS, 1, 22050, AUDIO_F32SYS, 2, 44100)");
+   SDLTest_AssertCheck(whole != NULL, "Verify stream is not NULL");
+   if (whole == NULL) return TEST_ABORTED;
+   result = SDL_AudioStreamPut(whole, input, numFrames * sizeof(Sint16));
+   SDLTest_AssertCheck(result == 0, "Verify result value; expected: 0, got: %i", result);
+   result = SDL_AudioStreamFlush(whole);
+   SDLTest_AssertCheck(result == 0, "Verify result value; expected: 0, got: %i", result);
+   result = SDL_AudioStreamAvailable(whole);
+   SDLTest_AssertCheck(result == outLen, "Verify available bytes; expected: %i, got: %i", outLen, result);
+   got = SDL_AudioStreamGet(whole, expected, outLen);
+   SDLTest_AssertCheck(got == outLen, "Verify bytes read; expected: %i, got: %i", outLen, got);
+
+   /* The same, in pieces, reading as it goes */
+   chunked = SDL_NewAudioStream(AUDIO_S16SYS, 1, 22050, AUDIO_F32SYS, 2, 44100);
+   SDLTest_AssertCheck(chunked != NULL, "Verify stream is not NULL");
+   if (chunked == NULL) return TEST_ABORTED;
+   got = 0;
+   for (i = 0; i < numFrames; i += len) {
+     len = SDLTest_RandomIntegerInRange(1, 300);
+     len = SDL_min(len, numFrames - i);
+     result = SDL_AudioStreamPut(chunked, input + i, len * sizeof(Sint16));
+     if (result != 0) break;
+     got += SDL_AudioStreamGet(chunked, output + got, outLen - got);
+   }
+   SDLTest_AssertCheck(result == 0, "Verify result of writing chunks; expected: 0, got: %i", result);
+   SDL_AudioStreamFlush(chunked);
+   got += SDL_AudioStreamGet(chunked, output + got, outLen - got);
+   SDLTest_AssertCheck(got == outLen, "Verify bytes read; expected: %i, got: %i", outLen, got);
+   SDLTest_AssertCheck(SDL_memcmp(output, expected, outLen) == 0, "Verify chunked output matches the single write");
+
+   /* Partial frames are refused */
+   result = SDL_AudioStreamPut(chunked, input, 1);
+   SDLTest_AssertCheck(result == -1, "Verify result of writing a partial frame; expected: -1, got: %i", result);
+   result = SDL_AudioStreamGet(chunked, output, 3);
+   SDLTest_AssertCheck(result == -1, "Verify result of reading a partial frame; expected: -1, got: %i", result);
+
+   /* Clearing drops everything */
+   SDL_AudioStreamPut(chunked, input, numFrames * sizeof(Sint16));
+   SDL_AudioStreamClear(chunked);
+   result = SDL_AudioStreamAvailable(chunked);
+   SDLTest_AssertCheck(result == 0, "Verify available bytes after clearing; expected: 0, got: %i", result);
+
+   SDL_FreeAudioStream(whole);
+   SDL_FreeAudioStream(chunked);
+   SDLTest_AssertPass("Call to SDL_FreeAudioStream()");
+   SDL_free(input);
+   SDL_free(expected);
+   SDL_free(output);
+
+   return TEST_COMPLETED;
+}
+
+
+/**
+ * \brief Checks the timing stats of a playing audio device.
+ *
+ * \sa https://wiki.libsdl.org/SDL_GetAudioDeviceStats
+ * \sa https://wiki.libsdl.org/SDL_ResetAudioDeviceStats
+ */
+int audio_getAudioDeviceStats()
+{
+   SDL_AudioSpec desired, obtained;
+   SDL_AudioDeviceStats stats;
+   SDL_AudioDeviceID id;
+   int result;
+   int totalDelay;
+
+   /* The dummy driver always opens and throws every buffer away */
+   result = SDL_AudioInit("dummy");
+   SDLTest_AssertPass("Call to SDL_AudioInit('dummy')");
+   SDLTest_AssertCheck(result == 0, "Validate result value; expected: 0 got: %d", result);
+
+   SDL_memset(&desired, 0, sizeof(desired));
+   desired.freq = 22050;
+   desired.format = AUDIO_S16SYS;
+   desired.channels = 2;
+   desired.samples = 512;
+   desired.callback = _audio_testCallback;
+   id = SDL_OpenAudioDevice(NULL, 0, &desired, &obtained, 0);
+   SDLTest_AssertPass("Call to SDL_OpenAudioDevice()");
+   SDLTest_AssertCheck(id > 1, "Validate device ID; expected: >1 got: %d", id);
+   if (id <= 1) {
+      return TEST_ABORTED;
+   }
+
+   /* Nothing counted while paused */
+   result = SDL_GetAudioDeviceStats(id, &stats);
+   SDLTest_AssertPass("Call to SDL_GetAudioDeviceStats()");
+   SDLTest_AssertCheck(result == 0, "Validate result value; expected: 0 got: %d", result);
+   SDLTest_AssertCheck(stats.buffers == 0, "Validate buffers; expected: 0 got: %u", stats.buffers);
+   SDLTest_AssertCheck(stats.buffer_us == 512 * 1000000 / obtained.freq,
+                       "Validate buffer_us; expected: %d got: %u", 512 * 1000000 / obtained.freq, stats.buffer_us);
+
+   _audio_testCallbackCounter = 0;
+   SDL_PauseAudioDevice(id, 0);
+   totalDelay = 0;
+   do {
+      SDL_Delay(10);
+      totalDelay += 10;
+      SDL_GetAudioDeviceStats(id, &stats);
+   } while (stats.buffers < 2 && totalDelay < 2000);
+   SDLTest_AssertCheck(stats.buffers >= 2, "Validate buffers; expected: >=2 got: %u", stats.buffers);
+   SDLTest_AssertCheck(_audio_testCallbackCounter >= 2, "Validate callback count; expected: >=2 got: %d", _audio_testCallbackCounter);
+   SDLTest_AssertCheck(stats.callback_min_us <= stats.callback_avg_us && stats.callback_avg_us <= stats.callback_max_us,
+                       "Validate callback min <= avg <= max; got: %u, %u, %u",
+                       stats.callback_min_us, stats.callback_avg_us, stats.callback_max_us);
+   SDLTest_AssertCheck(stats.callback_p99_us <= stats.callback_max_us,
+                       "Validate callback p99 <= max; got: %u, %u", stats.callback_p99_us, stats.callback_max_us);
+   SDLTest_AssertCheck(stats.dropped_buffers > 0, "Validate dropped buffers; expected: >0 got: %u", stats.dropped_buffers);
+
+   /* The device thread decides whether a buffer counts before running the
+      callback, so the one it was filling can still come in after the reset */
+   SDL_PauseAudioDevice(id, 1);
+   SDL_ResetAudioDeviceStats(id);
+   SDLTest_AssertPass("Call to SDL_ResetAudioDeviceStats()");
+   SDL_GetAudioDeviceStats(id, &stats);
+   SDLTest_AssertCheck(stats.buffers <= 1, "Validate buffers after reset; expected: <=1 got: %u", stats.buffers);
+
+   SDL_CloseAudioDevice(id);
+   SDLTest_AssertPass("Call to SDL_CloseAudioDevice()");
+
+   /* Closed devices have no stats */
+   result = SDL_GetAudioDeviceStats(id, &stats);
+   SDLTest_AssertCheck(result == -1, "Validate result value for closed device; expected: -1 got: %d", result);
+
+   /* Go back to the default driver */
+   SDL_QuitSubSystem(SDL_INIT_AUDIO);
+   SDL_InitSubSystem(SDL_INIT_AUDIO);
+   SDLTest_AssertPass("Restart audio subsystem");
+
+   return TEST_COMPLETED;
+}
+
+
+/**
+ * \brief Renders a set number of frames to a file with the disk driver, faster than realtime.
+ *
+ * \sa https://wiki.libsdl.org/SDL_OpenAudioDevice
+ * \sa https://wiki.libsdl.org/SDL_GetAudioDeviceStatus
+ */
+int audio_renderDiskOffline()
+{
+   /* Not a whole number of buffers, so the last one gets cut short */
+   const int frames = 512 * 5 + 100;
+   SDL_AudioSpec desired, obtained;
+   SDL_AudioDeviceID id;
+   SDL_RWops *rw;
+   Sint64 size;
+   char framesHint[16];
+   int result;
+   int totalDelay;
+
+   SDL_SetHint(SDL_HINT_AUDIO_DISK_OFFLINE, "1");
+   SDL_snprintf(framesHint, sizeof(framesHint), "%d", frames);
+   SDL_SetHint(SDL_HINT_AUDIO_DISK_FRAMES, framesHint);
+   result = SDL_AudioInit("disk");
+   SDLTest_AssertPass("Call to SDL_AudioInit('disk')");
+   SDLTest_AssertCheck(result == 0, "Validate result value; expected: 0 got: %d", result);
+
+   SDL_memset(&desired, 0, sizeof(desired));
+   desired.freq = 22050;
+   desired.format = AUDIO_S16SYS;
+   desired.channels = 2;
+   desired.samples = 512;
+   desired.callback = _audio_testCallback;
+   id = SDL_OpenAudioDevice("sdlaudio.raw", 0, &desired, &obtained, 0);
+   SDLTest_AssertPass("Call to SDL_OpenAudioDevice()");
+   SDLTest_AssertCheck(id > 1, "Validate device ID; expected: >1 got: %d", id);
+   if (id <= 1) {
+      SDL_SetHint(SDL_HINT_AUDIO_DISK_OFFLINE, NULL);
+      SDL_SetHint(SDL_HINT_AUDIO_DISK_FRAMES, NULL);
+      return TEST_ABORTED;
+   }
+
+   /* Well over the 120 ms the audio lasts, in case the machine is busy */
+   _audio_testCallbackCounter = 0;
+   SDL_PauseAudioDevice(id, 0);
+   totalDelay = 0;
+   while (SDL_GetAudioDeviceStatus(id) != SDL_AUDIO_STOPPED && totalDelay < 2000) {
+      SDL_Delay(10);
+      totalDelay += 10;
+   }
+   SDLTest_AssertCheck(SDL_GetAudioDeviceStatus(id) == SDL_AUDIO_STOPPED,
+                       "Validate device stopped after the frames were written; waited: %d ms", totalDelay);
+   SDLTest_AssertCheck(_audio_testCallbackCounter >= 6, "Validate callback count; expected: >=6 got: %d", _audio_testCallbackCounter);
+
+   SDL_CloseAudioDevice(id);
+   SDLTest_AssertPass("Call to SDL_CloseAudioDevice()");
+
+   /* Exactly the frames asked for, no more */
+   rw = SDL_RWFromFile("sdlaudio.raw", "rb");
+   SDLTest_AssertCheck(rw != NULL, "Validate output file opened");
+   if (rw != NULL) {
+      size = SDL_RWsize(rw);
+      SDLTest_AssertCheck(size == frames * 4, "Validate output file size; expected: %d got: %d", frames * 4, (int) size);
+      SDL_RWclose(rw);
+   }
+
+   SDL_SetHint(SDL_HINT_AUDIO_DISK_OFFLINE, NULL);
+   SDL_SetHint(SDL_HINT_AUDIO_DISK_FRAMES, NULL);
+
+   /* Go back to the default driver */
+   SDL_QuitSubSystem(SDL_INIT_AUDIO);
+   SDL_InitSubSystem(SDL_INIT_AUDIO);
+   SDLTest_AssertPass("Restart audio subsystem");
+
+   return TEST_COMPLETED;
+}
+
+
+/* Write a little-endian value into a WAVE file being built */
+static void
+_audio_putLE(Uint8 **dst, Uint32 value, int size)
+{
+   int i;
+   for (i = 0; i < size; i++) {
+      *(*dst)++ = (Uint8)(value >> (8 * i));
+   }
+}
+
+/**
+ * \brief Reads a stereo IMA ADPCM WAVE file through a stream, in chunks and after seeking.
+ *
+ * \sa https://wiki.libsdl.org/SDL_OpenWaveStream
+ * \sa https://wiki.libsdl.org/SDL_WaveStreamRead
+ * \sa https://wiki.libsdl.org/SDL_WaveStreamSeek
+ */
+int audio_readWaveStream()
+{
+   const int channels = 2;
+   const int blockalign = 256 * 2;
+   const int blockframes = (256 - 4) * 2 + 1;
+   const int blocks = 20;
+   const int framesize = 2 * 2;
+   const int filesize = 12 + 8 + 20 + 8 + blocks * blockalign;
+   SDL_AudioSpec spec, streamspec;
+   SDL_WaveStream *stream;
+   Uint8 *file, *dst, *expected, *output;
+   Uint32 expectedlen, frame;
+   int i, j, len, result;
+
+   file = (Uint8 *)SDL_malloc(filesize);
+   output = (Uint8 *)SDL_malloc(blocks * blockframes * framesize);
+   SDLTest_AssertCheck(file != NULL && output != NULL, "Validate buffers were allocated");
+   if (file == NULL || output == NULL) {
+      SDL_free(file);
+      SDL_free(output);
+      return TEST_ABORTED;
+   }
+
+   /* RIFF header, format chunk and random ADPCM data */
+   dst = file;
+   _audio_putLE(&dst, 0x46464952, 4);
+   _audio_putLE(&dst, filesize - 8, 4);
+   _audio_putLE(&dst, 0x45564157, 4);
+   _audio_putLE(&dst, 0x20746D66, 4);
+   _audio_putLE(&dst, 20, 4);
+   _audio_putLE(&dst, 0x0011, 2);
+   _audio_putLE(&dst, channels, 2);
+   _audio_putLE(&dst, 22050, 4);
+   _audio_putLE(&dst, 22050 * blockalign / blockframes, 4);
+   _audio_putLE(&dst, blockalign, 2);
+   _audio_putLE(&dst, 4, 2);
+   _audio_putLE(&dst, 2, 2);
+   _audio_putLE(&dst, blockframes, 2);
+   _audio_putLE(&dst, 0x61746164, 4);
+   _audio_putLE(&dst, blocks * blockalign, 4);
+   for (i = 0; i < blocks; i++) {
+      for (j = 0; j < blockalign; j++) {
+         dst[j] = SDLTest_RandomUint8();
+      }
+      for (j = 0; j < channels; j++) {
+         dst[4 * j + 2] = SDLTest_RandomIntegerInRange(0, 88);
+         dst[4 * j + 3] = 0;
+      }
+      dst += blockalign;
+   }
+
+   /* What the stream reads has to match the whole file loaded at once */
+   if (SDL_LoadWAV_RW(SDL_RWFromConstMem(file, filesize), 1, &spec, &expected, &expectedlen) == NULL) {
+      SDLTest_AssertCheck(SDL_FALSE, "Call to SDL_LoadWAV_RW() failed: %s", SDL_GetError());
+      SDL_free(file);
+      SDL_free(output);
+      return TEST_ABORTED;
+   }
+   SDLTest_AssertPass("Call to SDL_LoadWAV_RW()");
+   SDLTest_AssertCheck(expectedlen == blocks * blockframes * framesize,
+                       "Validate loaded length; expected: %d got: %u", blocks * blockframes * framesize, expectedlen);
+
+   stream = SDL_OpenWaveStream(SDL_RWFromConstMem(file, filesize), 1, &streamspec);
+   SDLTest_AssertPass("Call to SDL_OpenWaveStream()");
+   SDLTest_AssertCheck(stream != NULL, "Validate stream is not NULL");
+   if (stream == NULL) {
+      SDL_FreeWAV(expected);
+      SDL_free(file);
+      SDL_free(output);
+      return TEST_ABORTED;
+   }
+   SDLTest_AssertCheck(streamspec.format == spec.format && streamspec.channels == spec.channels && streamspec.freq == spec.freq,
+                       "Validate stream spec matches SDL_LoadWAV_RW()");
+   SDLTest_AssertCheck(SDL_WaveStreamLength(stream) * framesize == expectedlen,
+                       "Validate stream length; expected: %u got: %u", expectedlen / framesize, SDL_WaveStreamLength(stream));
+
+   /* Read it all in chunks that don't line up with the blocks */
+   i = 0;
+   do {
+      len = SDLTest_RandomIntegerInRange(1, 3 * blockframes * framesize);
+      result = SDL_WaveStreamRead(stream, output + i, SDL_min(len, (int)expectedlen - i));
+      if (result > 0) {
+         i += result;
+      }
+   } while (result > 0 && i < (int)expectedlen);
+   SDLTest_AssertPass("Read stream in chunks");
+   SDLTest_AssertCheck(i == (int)expectedlen, "Validate bytes read; expected: %u got: %d", expectedlen, i);
+   SDLTest_AssertCheck(SDL_memcmp(output, expected, expectedlen) == 0, "Validate streamed audio matches loaded audio");
+   result = SDL_WaveStreamRead(stream, output, framesize);
+   SDLTest_AssertCheck(result == 0, "Validate read at the end; expected: 0 got: %d", result);
+
+   /* Seek around and read a little from each place */
+   for (i = 0; i < 50; i++) {
+      frame = SDLTest_RandomIntegerInRange(0, blocks * blockframes - 1);
+      len = SDLTest_RandomIntegerInRange(1, 2 * blockframes) * framesize;
+      len = SDL_min(len, (int)(expectedlen - frame * framesize));
+      result = SDL_WaveStreamSeek(stream, frame);
+      SDLTest_AssertCheck(result == 0, "Validate seek to frame %u; expected: 0 got: %d", frame, result);
+      result = SDL_WaveStreamRead(stream, output, len);
+      SDLTest_AssertCheck(result == len, "Validate read after seek; expected: %d got: %d", len, result);
+      SDLTest_AssertCheck(SDL_memcmp(output, expected + frame * framesize, len) == 0,
+                          "Validate audio read at frame %u matches loaded audio", frame);
+      SDLTest_AssertCheck(SDL_WaveStreamTell(stream) == frame + len / framesize,
+                          "Validate position; expected: %d got: %u", frame + len / framesize, SDL_WaveStreamTell(stream));
+   }
+
+   /* Seeking past the end is an error */
+   result = SDL_WaveStreamSeek(stream, blocks * blockframes + 1);
+   SDLTest_AssertCheck(result == -1, "Validate seek past the end; expected: -1 got: %d", result);
+
+   SDL_CloseWaveStream(stream);
+   SDLTest_AssertPass("Call to SDL_CloseWaveStream()");
+
+   SDL_FreeWAV(expected);
+   SDL_free(file);
+   SDL_free(output);
+
+   return TEST_COMPLETED;
+}
+
+/**
+ * \brief Plays voices through a mixer attached to an audio device.
+ *
+ * \sa https://wiki.libsdl.org/SDL_AttachAudioMixer
+ * \sa https://wiki.libsdl.org/SDL_PlayMixerVoice
+ * \sa https://wiki.libsdl.org/SDL_StopMixerVoice
+ */
+int audio_mixVoices()
+{
+   SDL_AudioSpec desired, obtained, spec;
+   SDL_AudioDeviceID id;
+   Sint16 samples[256];
+   int source, voice1, voice2, voice3;
+   int result, i;
+   int totalDelay;
+
+   result = SDL_AudioInit("dummy");
+   SDLTest_AssertPass("Call to SDL_AudioInit('dummy')");
+   SDLTest_AssertCheck(result == 0, "Validate result value; expected: 0 got: %d", result);
+
+   SDL_memset(&desired, 0, sizeof(desired));
+   desired.freq = 22050;
+   desired.format = AUDIO_S16SYS;
+   desired.channels = 2;
+   desired.samples = 512;
+   desired.callback = _audio_testCallback;
+   id = SDL_OpenAudioDevice(NULL, 0, &desired, &obtained, 0);
+   SDLTest_AssertPass("Call to SDL_OpenAudioDevice()");
+   SDLTest_AssertCheck(id > 1, "Validate device ID; expected: >1 got: %d", id);
+   if (id <= 1) {
+      return TEST_ABORTED;
+   }
+
+   result = SDL_AttachAudioMixer(id, 0);
+   SDLTest_AssertCheck(result == -1, "Validate attaching with no voices; expected: -1 got: %d", result);
+   result = SDL_AttachAudioMixer(id, 2);
+   SDLTest_AssertPass("Call to SDL_AttachAudioMixer()");
+   SDLTest_AssertCheck(result == 0, "Validate result value; expected: 0 got: %d", result);
+   result = SDL_AttachAudioMixer(id, 2);
+   SDLTest_AssertCheck(result == -1, "Validate attaching a second mixer; expected: -1 got: %d", result);
+
+   /* A short sound, at the device's rate so it's mixed directly */
+   for (i = 0; i < SDL_arraysize(samples); i++) {
+      samples[i] = (Sint16)SDLTest_RandomIntegerInRange(-8192, 8192);
+   }
+   SDL_memset(&spec, 0, sizeof(spec));
+   spec.freq = obtained.freq;
+   spec.format = AUDIO_S16SYS;
+   spec.channels = 1;
+   source = SDL_AddMixerSource(id, &spec, (const Uint8 *)samples, sizeof(samples));
+   SDLTest_AssertPass("Call to SDL_AddMixerSource()");
+   SDLTest_AssertCheck(source > 0, "Validate source ID; expected: >0 got: %d", source);
+   spec.channels = 2;
+   result = SDL_AddMixerSource(id, &spec, (const Uint8 *)samples, sizeof(samples) - 2);
+   SDLTest_AssertCheck(result == -1, "Validate adding a partial frame; expected: -1 got: %d", result);
+
+   voice1 = SDL_PlayMixerVoice(id, source, 1, 0.5f, 0.0f);
+   SDLTest_AssertPass("Call to SDL_PlayMixerVoice()");
+   SDLTest_AssertCheck(voice1 > 0, "Validate looping voice ID; expected: >0 got: %d", voice1);
+   voice2 = SDL_PlayMixerVoice(id, source, 0, 1.0f, -1.0f);
+   SDLTest_AssertCheck(voice2 > 0 && voice2 != voice1, "Validate voice ID; expected: >0 and new got: %d", voice2);
+   result = SDL_PlayMixerVoice(id, source, 0, 1.0f, 0.0f);
+   SDLTest_AssertCheck(result == -1, "Validate playing with all voices busy; expected: -1 got: %d", result);
+   result = SDL_PlayMixerVoice(id, source + 1, 0, 1.0f, 0.0f);
+   SDLTest_AssertCheck(result == -1, "Validate playing an invalid source; expected: -1 got: %d", result);
+
+   /* Out of range settings are rejected, the rest go through */
+   result = SDL_SetMixerVoiceGain(id, voice1, -1.0f);
+   SDLTest_AssertCheck(result == -1, "Validate negative gain; expected: -1 got: %d", result);
+   result = SDL_SetMixerVoicePan(id, voice1, 2.0f);
+   SDLTest_AssertCheck(result == -1, "Validate pan past the right; expected: -1 got: %d", result);
+   result = SDL_SetMixerVoicePitch(id, voice1, 0.0f);
+   SDLTest_AssertCheck(result == -1, "Validate zero pitch; expected: -1 got: %d", result);
+   result = SDL_SetMixerVoiceGain(id, voice1, 0.25f);
+   SDLTest_AssertCheck(result == 0, "Validate setting gain; expected: 0 got: %d", result);
+   result = SDL_SetMixerVoicePan(id, voice1, 0.5f);
+   SDLTest_AssertCheck(result == 0, "Validate setting pan; expected: 0 got: %d", result);
+   result = SDL_SetMixerVoicePitch(id, voice1, 1.5f);
+   SDLTest_AssertCheck(result == 0, "Validate setting pitch; expected: 0 got: %d", result);
+
+   /* The voice that doesn't loop stops by itself */
+   SDL_PauseAudioDevice(id, 0);
+   totalDelay = 0;
+   while (SDL_IsMixerVoicePlaying(id, voice2) && totalDelay < 2000) {
+      SDL_Delay(10);
+      totalDelay += 10;
+   }
+   SDLTest_AssertCheck(!SDL_IsMixerVoicePlaying(id, voice2), "Validate voice stopped at the end of its source");
+   SDLTest_AssertCheck(SDL_IsMixerVoicePlaying(id, voice1), "Validate looping voice still playing");
+
+   result = SDL_StopMixerVoice(id, voice1);
+   SDLTest_AssertPass("Call to SDL_StopMixerVoice()");
+   SDLTest_AssertCheck(result == 0, "Validate result value; expected: 0 got: %d", result);
+   SDLTest_AssertCheck(!SDL_IsMixerVoicePlaying(id, voice1), "Validate stopped voice isn't playing");
+   result = SDL_StopMixerVoice(id, voice2);
+   SDLTest_AssertCheck(result == 0, "Validate stopping a finished voice; expected: 0 got: %d", result);
+   result = SDL_StopMixerVoice(id, 0);
+   SDLTest_AssertCheck(result == -1, "Validate stopping an invalid voice; expected: -1 got: %d", result);
+
+   /* A new voice in an old one's place doesn't answer to the old ID */
+   voice3 = SDL_PlayMixerVoice(id, source, 1, 1.0f, 0.0f);
+   SDLTest_AssertCheck(voice3 > 0 && voice3 != voice1 && voice3 != voice2, "Validate new voice ID; got: %d", voice3);
+   SDLTest_AssertCheck(!SDL_IsMixerVoicePlaying(id, voice1) && !SDL_IsMixerVoicePlaying(id, voice2),
+                       "Validate old voice IDs aren't playing");
+   SDL_RemoveMixerSource(id, source);
+   SDLTest_AssertPass("Call to SDL_RemoveMixerSource()");
+   SDLTest_AssertCheck(!SDL_IsMixerVoicePlaying(id, voice3), "Validate removing the source stopped its voice");
+
+   /* The device gets its own callback back */
+   SDL_DetachAudioMixer(id);
+   SDLTest_AssertPass("Call to SDL_DetachAudioMixer()");
+   _audio_testCallbackCounter = 0;
+   totalDelay = 0;
+   while (_audio_testCallbackCounter == 0 && totalDelay < 2000) {
+      SDL_Delay(10);
+      totalDelay += 10;
+   }
+   SDLTest_AssertCheck(_audio_testCallbackCounter > 0, "Validate callback was called after detaching; got: %d", _audio_testCallbackCounter);
+   result = SDL_PlayMixerVoice(id, source, 0, 1.0f, 0.0f);
+   SDLTest_AssertCheck(result == -1, "Validate playing without a mixer; expected: -1 got: %d", result);
+
+   SDL_CloseAudioDevice(id);
+   SDLTest_AssertPass("Call to SDL_CloseAudioDevice()");
+
+   /* A device that queues its audio has no callback to take over */
+   desired.callback = NULL;
+   id = SDL_OpenAudioDevice(NULL, 0, &desired, &obtained, 0);
+   SDLTest_AssertPass("Call to SDL_OpenAudioDevice() without a callback");
+   SDLTest_AssertCheck(id > 1, "Validate device ID; expected: >1 got: %d", id);
+   if (id > 1) {
+      result = SDL_AttachAudioMixer(id, 2);
+      SDLTest_AssertCheck(result == -1, "Validate attaching to a queueing device; expected: -1 got: %d", result);
+      SDL_CloseAudioDevice(id);
+   }
+
+   /* Go back to the default driver */
+   SDL_QuitSubSystem(SDL_INIT_AUDIO);
+   SDL_InitSubSystem(SDL_INIT_AUDIO);
+   SDLTest_AssertPass("Restart audio subsystem");
+
+   return TEST_COMPLETED;
+}
+
 /* ================= Test Case References ================== */
 
 /* Audio test cases */
@@ -1022,11 +1540,27 @@ static const SDLTest_TestCaseReference audioTest14 =
 static const SDLTest_TestCaseReference audioTest15 =
         { (SDLTest_TestCaseFp)audio_pauseUnpauseAudio, "audio_pauseUnpauseAudio", "Pause and Unpause audio for various audio specs while testing callback.", TEST_ENABLED };
 
+static const SDLTest_TestCaseReference audioTest16 =
+        { (SDLTest_TestCaseFp)audio_convertAudioStream, "audio_convertAudioStream", "Convert audio through a stream in chunks.", TEST_ENABLED };
+
+static const SDLTest_TestCaseReference audioTest17 =
+        { (SDLTest_TestCaseFp)audio_getAudioDeviceStats, "audio_getAudioDeviceStats", "Checks the timing stats of a playing audio device.", TEST_ENABLED };
+
+static const SDLTest_TestCaseReference audioTest18 =
+        { (SDLTest_TestCaseFp)audio_readWaveStream, "audio_readWaveStream", "Reads a WAVE file through a stream, in chunks and after seeking.", TEST_ENABLED };
+
+static const SDLTest_TestCaseReference audioTest19 =
+        { (SDLTest_TestCaseFp)audio_mixVoices, "audio_mixVoices", "Plays voices through a mixer attached to an audio device.", TEST_ENABLED };
+
+static const SDLTest_TestCaseReference audioTest20 =
+        { (SDLTest_TestCaseFp)audio_renderDiskOffline, "audio_renderDiskOffline", "Renders a set number of frames to a file with the offline disk driver.", TEST_ENABLED };
+
 /* Sequence of Audio test cases */
 static const SDLTest_TestCaseReference *audioTests[] =  {
     &audioTest1, &audioTest2, &audioTest3, &audioTest4, &audioTest5, &audioTest6,
     &audioTest7, &audioTest8, &audioTest9, &audioTest10, &audioTest11,
-    &audioTest12, &audioTest13, &audioTest14, &audioTest15, NULL
+    &audioTest12, &audioTest13, &audioTest14, &audioTest15, &audioTest16, &audioTest17, &audioTest18,
+    &audioTest19, &audioTest20, NULL
 };
 
 /* Audio test suite (global) */
@@ -73,6 +73,185 @@ events_pushPumpAndPollUserevent(void *arg)
 }
 
 
+/* Event filter that drops user events with an odd code */
+int _events_oddCodeFilter(void *userdata, SDL_Event *event)
+{
+   if (userdata != NULL) {
+      ++*(int *)userdata;
+   }
+   return (event->user.code % 2) == 0;
+}
+
+/**
+ * @brief Pushes a batch of events, some of which are filtered
+ *
+ * @sa http://wiki.libsdl.org/moin.cgi/SDL_PushEvents
+ */
+int
+events_pushEvents(void *arg)
+{
+   SDL_Event events[100];
+   int i, result, watched = 0, ordered;
+
+   SDL_FlushEvents(SDL_FIRSTEVENT, SDL_LASTEVENT);
+
+   SDL_zero(events);
+   for (i = 0; i < SDL_arraysize(events); ++i) {
+      events[i].type = SDL_USEREVENT;
+      events[i].user.code = i;
+   }
+
+   SDL_SetEventFilter(_events_oddCodeFilter, NULL);
+   SDL_AddEventWatch(_events_oddCodeFilter, &watched);
+   result = SDL_PushEvents(events, SDL_arraysize(events));
+   SDLTest_AssertPass("Call to SDL_PushEvents()");
+   SDL_DelEventWatch(_events_oddCodeFilter, &watched);
+   SDLTest_AssertCheck(result == 50, "Check result from SDL_PushEvents, expected: 50, got: %d", result);
+   SDLTest_AssertCheck(watched == 50, "Check that the watcher saw the queued events, expected: 50, got: %d", watched);
+
+   SDL_zero(events);
+   result = SDL_PeepEvents(events, SDL_arraysize(events), SDL_GETEVENT, SDL_USEREVENT, SDL_USEREVENT);
+   SDL_SetEventFilter(NULL, NULL);
+   SDLTest_AssertCheck(result == 50, "Check result from SDL_PeepEvents, expected: 50, got: %d", result);
+   ordered = 1;
+   for (i = 0; i < result; ++i) {
+      if (events[i].user.code != i * 2 || events[i].common.timestamp != events[0].common.timestamp) {
+         ordered = 0;
+      }
+   }
+   SDLTest_AssertCheck(ordered, "Check that the events were queued in order with the same timestamp");
+
+   return TEST_COMPLETED;
+}
+
+/**
+ * @brief Checks the nanosecond timestamp of a pushed event
+ *
+ * @sa http://wiki.libsdl.org/moin.cgi/SDL_GetEventTimestampNS
+ */
+int
+events_timestampNS(void *arg)
+{
+   SDL_Event event;
+   Uint64 before, after, ns;
+   int result;
+
+   SDL_FlushEvents(SDL_FIRSTEVENT, SDL_LASTEVENT);
+
+   SDL_zero(event);
+   event.type = SDL_USEREVENT;
+   before = (Uint64)SDL_GetTicks() * 1000000;
+   SDL_PushEvent(&event);
+   SDLTest_AssertPass("Call to SDL_PushEvent()");
+   after = ((Uint64)SDL_GetTicks() + 1) * 1000000;
+
+   SDL_zero(event);
+   result = SDL_PollEvent(&event);
+   SDLTest_AssertCheck(result == 1, "Check result from SDL_PollEvent, expected: 1, got: %d", result);
+
+   /* The event clock is lined up with the ticks to within a millisecond */
+   ns = SDL_GetEventTimestampNS(&event);
+   SDLTest_AssertPass("Call to SDL_GetEventTimestampNS()");
+   SDLTest_AssertCheck(ns + 1000000 >= before && ns <= after,
+                       "Check that the timestamp is within [%llu, %llu], got: %llu",
+                       (unsigned long long)(before - SDL_min(before, 1000000)),
+                       (unsigned long long)after, (unsigned long long)ns);
+
+   return TEST_COMPLETED;
+}
+
+/* Event watcher counting the events it sees in its userdata */
+int _events_countingWatcher(void *userdata, SDL_Event *event)
+{
+   SDL_AtomicAdd((SDL_atomic_t *)userdata, 1);
+   return 1;
+}
+
+#define _EVENTS_PUSH_THREADS 2
+#define _EVENTS_PUSHES_PER_THREAD 20000
+#define _EVENTS_STEADY_WATCHERS 4
+#define _EVENTS_CHURNING_WATCHERS 32
+
+static SDL_atomic_t _pushThreadsRunning;
+
+static int
+_events_pushThread(void *arg)
+{
+   SDL_Event event;
+   int i;
+
+   SDL_zero(event);
+   event.type = SDL_USEREVENT;
+   for (i = 0; i < _EVENTS_PUSHES_PER_THREAD; ++i) {
+      SDL_PushEvent(&event);
+   }
+   SDL_AtomicAdd(&_pushThreadsRunning, -1);
+   return 0;
+}
+
+/**
+ * @brief Adds and deletes event watchers while other threads push events
+ *
+ * @sa http://wiki.libsdl.org/moin.cgi/SDL_AddEventWatch
+ * @sa http://wiki.libsdl.org/moin.cgi/SDL_DelEventWatch
+ */
+int
+events_concurrentEventWatch(void *arg)
+{
+   SDL_atomic_t steady[_EVENTS_STEADY_WATCHERS];
+   SDL_atomic_t churning[_EVENTS_CHURNING_WATCHERS];
+   SDL_Thread *threads[_EVENTS_PUSH_THREADS];
+   int i, correct, rounds = 0;
+
+   SDL_FlushEvents(SDL_FIRSTEVENT, SDL_LASTEVENT);
+
+   for (i = 0; i < _EVENTS_STEADY_WATCHERS; ++i) {
+      SDL_AtomicSet(&steady[i], 0);
+      SDL_AddEventWatch(_events_countingWatcher, &steady[i]);
+   }
+   for (i = 0; i < _EVENTS_CHURNING_WATCHERS; ++i) {
+      SDL_AtomicSet(&churning[i], 0);
+   }
+   SDLTest_AssertPass("Call to SDL_AddEventWatch() %d times", _EVENTS_STEADY_WATCHERS);
+
+   SDL_AtomicSet(&_pushThreadsRunning, _EVENTS_PUSH_THREADS);
+   for (i = 0; i < _EVENTS_PUSH_THREADS; ++i) {
+      threads[i] = SDL_CreateThread(_events_pushThread, "EventPusher", NULL);
+      SDLTest_AssertCheck(threads[i] != NULL, "Check that thread %d was created", i);
+      if (!threads[i]) {
+         SDL_AtomicAdd(&_pushThreadsRunning, -1);
+      }
+   }
+
+   /* Keep replacing the watcher list while the events go by */
+   while (SDL_AtomicGet(&_pushThreadsRunning) > 0 || rounds == 0) {
+      for (i = 0; i < _EVENTS_CHURNING_WATCHERS; ++i) {
+         SDL_AddEventWatch(_events_countingWatcher, &churning[i]);
+      }
+      for (i = 0; i < _EVENTS_CHURNING_WATCHERS; ++i) {
+         SDL_DelEventWatch(_events_countingWatcher, &churning[i]);
+      }
+      ++rounds;
+   }
+   for (i = 0; i < _EVENTS_PUSH_THREADS; ++i) {
+      SDL_WaitThread(threads[i], NULL);
+   }
+   SDLTest_AssertPass("Added and deleted %d watchers %d times while pushing events", _EVENTS_CHURNING_WATCHERS, rounds);
+
+   correct = 1;
+   for (i = 0; i < _EVENTS_STEADY_WATCHERS; ++i) {
+      SDL_DelEventWatch(_events_countingWatcher, &steady[i]);
+      if (SDL_AtomicGet(&steady[i]) != _EVENTS_PUSH_THREADS * _EVENTS_PUSHES_PER_THREAD) {
+         correct = 0;
+      }
+   }
+   SDLTest_AssertCheck(correct, "Check that the steady watchers saw every event, expected: %d each, got: %d", _EVENTS_PUSH_THREADS * _EVENTS_PUSHES_PER_THREAD, SDL_AtomicGet(&steady[0]));
+
+   SDL_FlushEvents(SDL_FIRSTEVENT, SDL_LASTEVENT);
+
+   return TEST_COMPLETED;
+}
+
 /**
  * @brief Adds and deletes an event watch function with NULL userdata
  *
@@ -174,6 +353,227 @@ events_addDelEventWatchWithUserdata(void *arg)
    return TEST_COMPLETED;
 }
 
+/**
+ * @brief Peeks, gets and flushes ranges of event types spanning several categories
+ *
+ * @sa http://wiki.libsdl.org/moin.cgi/SDL_PeepEvents
+ * @sa http://wiki.libsdl.org/moin.cgi/SDL_FlushEvents
+ */
+int
+events_peepEventRanges(void *arg)
+{
+   const Uint32 types[3] = { SDL_USEREVENT, SDL_USEREVENT + 1, SDL_USEREVENT + 0x100 };
+   SDL_Event events[32];
+   SDL_Event event;
+   int i, result, ordered;
+
+   SDL_FlushEvents(SDL_FIRSTEVENT, SDL_LASTEVENT);
+   SDLTest_AssertPass("Call to SDL_FlushEvents()");
+
+   /* Interleave events of two neighbouring types and one further away */
+   SDL_zero(event);
+   for (i = 0; i < 30; ++i) {
+      event.type = types[i % 3];
+      event.user.code = i;
+      SDL_PushEvent(&event);
+   }
+   SDLTest_AssertPass("Call to SDL_PushEvent() 30 times");
+
+   result = SDL_PeepEvents(events, SDL_arraysize(events), SDL_PEEKEVENT, types[0], types[1]);
+   SDLTest_AssertCheck(result == 20, "Check result from SDL_PeepEvents, expected: 20, got: %d", result);
+   ordered = 1;
+   for (i = 1; i < result; ++i) {
+      if (events[i].user.code <= events[i-1].user.code || events[i].type == types[2]) {
+         ordered = 0;
+      }
+   }
+   SDLTest_AssertCheck(ordered, "Check that the peeked events are in range and in order");
+
+   SDLTest_AssertCheck(SDL_HasEvent(types[2]), "Check that SDL_HasEvent() finds the far event type");
+   SDLTest_AssertCheck(!SDL_HasEvent(types[1] + 1), "Check that SDL_HasEvent() doesn't find an unused event type");
+
+   /* Take events from both categories, they must still come out in order */
+   result = SDL_PeepEvents(events, SDL_arraysize(events), SDL_GETEVENT, types[1], types[2]);
+   SDLTest_AssertCheck(result == 20, "Check result from SDL_PeepEvents, expected: 20, got: %d", result);
+   ordered = 1;
+   for (i = 0; i < result; ++i) {
+      if (events[i].user.code != (i / 2) * 3 + 1 + (i % 2)) {
+         ordered = 0;
+      }
+   }
+   SDLTest_AssertCheck(ordered, "Check that the events of both categories come out in order");
+
+   result = SDL_PeepEvents(NULL, 0, SDL_PEEKEVENT, SDL_FIRSTEVENT, SDL_LASTEVENT);
+   SDLTest_AssertCheck(result == 1, "Check that the first event type is still queued");
+
+   SDL_FlushEvent(types[0]);
+   SDLTest_AssertPass("Call to SDL_FlushEvent()");
+   result = SDL_PeepEvents(events, SDL_arraysize(events), SDL_PEEKEVENT, SDL_FIRSTEVENT, SDL_LASTEVENT);
+   SDLTest_AssertCheck(result == 0, "Check result from SDL_PeepEvents after flushing, expected: 0, got: %d", result);
+
+   return TEST_COMPLETED;
+}
+
+/**
+ * @brief Checks that motion events are merged while SDL_HINT_EVENT_COALESCING is set
+ *
+ * @sa http://wiki.libsdl.org/moin.cgi/SDL_GetCoalescedEventCount
+ */
+int
+events_coalesceMotion(void *arg)
+{
+   SDL_Event events[8];
+   SDL_Event event;
+   Uint32 coalesced;
+   int i, result;
+
+   SDL_FlushEvents(SDL_FIRSTEVENT, SDL_LASTEVENT);
+   SDL_SetHint(SDL_HINT_EVENT_COALESCING, "1");
+   SDLTest_AssertPass("Call to SDL_SetHint(SDL_HINT_EVENT_COALESCING, \"1\")");
+   coalesced = SDL_GetCoalescedEventCount(SDL_MOUSEMOTION);
+
+   /* Two windows' worth of motion, then a button, then more motion */
+   SDL_zero(event);
+   event.type = SDL_MOUSEMOTION;
+   for (i = 0; i < 6; ++i) {
+      event.motion.windowID = 1 + (i % 2);
+      event.motion.x = i;
+      event.motion.xrel = 1;
+      SDL_PushEvent(&event);
+   }
+   event.type = SDL_MOUSEBUTTONDOWN;
+   SDL_PushEvent(&event);
+   event.type = SDL_MOUSEMOTION;
+   event.motion.windowID = 1;
+   event.motion.x = 10;
+   event.motion.xrel = 1;
+   SDL_PushEvent(&event);
+   SDLTest_AssertPass("Call to SDL_PushEvent() 8 times");
+
+   result = SDL_PeepEvents(events, SDL_arraysize(events), SDL_GETEVENT, SDL_FIRSTEVENT, SDL_LASTEVENT);
+   SDLTest_AssertCheck(result == 4, "Check result from SDL_PeepEvents, expected: 4, got: %d", result);
+   if (result == 4) {
+      SDLTest_AssertCheck(events[0].motion.windowID == 1 && events[0].motion.x == 4 && events[0].motion.xrel == 3,
+                          "Check first window's motion, expected: x=4 xrel=3, got: x=%d xrel=%d", events[0].motion.x, events[0].motion.xrel);
+      SDLTest_AssertCheck(events[1].motion.windowID == 2 && events[1].motion.x == 5 && events[1].motion.xrel == 3,
+                          "Check second window's motion, expected: x=5 xrel=3, got: x=%d xrel=%d", events[1].motion.x, events[1].motion.xrel);
+      SDLTest_AssertCheck(events[2].type == SDL_MOUSEBUTTONDOWN, "Check that the button event stays in place");
+      SDLTest_AssertCheck(events[3].type == SDL_MOUSEMOTION && events[3].motion.xrel == 1, "Check that motion isn't merged across the button event");
+   }
+   coalesced = SDL_GetCoalescedEventCount(SDL_MOUSEMOTION) - coalesced;
+   SDLTest_AssertCheck(coalesced == 4, "Check SDL_GetCoalescedEventCount(), expected: 4, got: %u", (unsigned) coalesced);
+
+   SDL_SetHint(SDL_HINT_EVENT_COALESCING, "0");
+   SDLTest_AssertPass("Call to SDL_SetHint(SDL_HINT_EVENT_COALESCING, \"0\")");
+
+   return TEST_COMPLETED;
+}
+
+/* Pushes a figure eight as finger events, starting with a finger down */
+void
+_events_pushStroke(SDL_TouchID touchId)
+{
+   SDL_Event event;
+   float x, y;
+   int i;
+
+   SDL_zero(event);
+   event.tfinger.touchId = touchId;
+   event.tfinger.pressure = 1.0f;
+   for (i = 0; i <= 32; ++i) {
+      const double t = 2 * M_PI * i / 32;
+      x = 0.5f + 0.3f * (float)SDL_sin(t);
+      y = 0.5f + 0.2f * (float)SDL_sin(2 * t);
+      event.tfinger.type = (i == 0) ? SDL_FINGERDOWN : SDL_FINGERMOTION;
+      event.tfinger.dx = x - event.tfinger.x;
+      event.tfinger.dy = y - event.tfinger.y;
+      event.tfinger.x = x;
+      event.tfinger.y = y;
+      SDL_PushEvent(&event);
+   }
+   event.tfinger.type = SDL_FINGERUP;
+   SDL_PushEvent(&event);
+}
+
+/* Returns the first gesture event of the given type, or 0 */
+Uint32
+_events_getGesture(Uint32 type, SDL_GestureID *gestureId, float *error)
+{
+   SDL_Event event;
+
+   while (SDL_PollEvent(&event)) {
+      if (event.type == type) {
+         *gestureId = event.dgesture.gestureId;
+         *error = event.dgesture.error;
+         SDL_FlushEvents(SDL_FIRSTEVENT, SDL_LASTEVENT);
+         return type;
+      }
+   }
+   return 0;
+}
+
+/**
+ * @brief Saves a recorded gesture template twice and loads both copies into another touch
+ *
+ * @sa http://wiki.libsdl.org/moin.cgi/SDL_SaveDollarTemplate
+ * @sa http://wiki.libsdl.org/moin.cgi/SDL_LoadDollarTemplates
+ */
+int
+events_dollarTemplateRoundTrip(void *arg)
+{
+   const SDL_TouchID recordTouch = SDLTest_RandomIntegerInRange(0x10000, 0x1FFFF);
+   const SDL_TouchID loadTouch = recordTouch + 0x10000;
+   Uint8 data[2048];
+   SDL_RWops *rw;
+   SDL_GestureID recorded = -1, gestureId = -1;
+   float error = 0.0f, recordedError = 0.0f;
+   Uint32 type;
+   int size, result;
+
+   SDL_FlushEvents(SDL_FIRSTEVENT, SDL_LASTEVENT);
+
+   /* The first stroke makes the touch known to the gestures */
+   _events_pushStroke(recordTouch);
+   SDL_FlushEvents(SDL_FIRSTEVENT, SDL_LASTEVENT);
+   result = SDL_RecordGesture(recordTouch);
+   SDLTest_AssertCheck(result == 1, "Check result from SDL_RecordGesture(), expected: 1, got: %d", result);
+   _events_pushStroke(recordTouch);
+   type = _events_getGesture(SDL_DOLLARRECORD, &recorded, &error);
+   SDLTest_AssertCheck(type == SDL_DOLLARRECORD && recorded != -1, "Check that the stroke was recorded");
+
+   _events_pushStroke(recordTouch);
+   type = _events_getGesture(SDL_DOLLARGESTURE, &gestureId, &recordedError);
+   SDLTest_AssertCheck(type == SDL_DOLLARGESTURE && gestureId == recorded, "Check that the stroke is recognized on the recording touch");
+
+   /* Each save writes a block of its own */
+   rw = SDL_RWFromMem(data, sizeof(data));
+   SDLTest_AssertCheck(rw != NULL, "Call to SDL_RWFromMem()");
+   if (rw == NULL) {
+      return TEST_ABORTED;
+   }
+   result = SDL_SaveDollarTemplate(recorded, rw);
+   SDLTest_AssertCheck(result == 1, "Check result from first SDL_SaveDollarTemplate(), expected: 1, got: %d", result);
+   result = SDL_SaveDollarTemplate(recorded, rw);
+   SDLTest_AssertCheck(result == 1, "Check result from second SDL_SaveDollarTemplate(), expected: 1, got: %d", result);
+   size = (int)SDL_RWtell(rw);
+   SDL_RWclose(rw);
+
+   _events_pushStroke(loadTouch);
+   SDL_FlushEvents(SDL_FIRSTEVENT, SDL_LASTEVENT);
+   rw = SDL_RWFromConstMem(data, size);
+   result = SDL_LoadDollarTemplates(loadTouch, rw);
+   SDLTest_AssertCheck(result == 2, "Check result from SDL_LoadDollarTemplates(), expected: 2, got: %d", result);
+   SDL_RWclose(rw);
+
+   /* The loaded points have to be the recorded ones to match as closely */
+   _events_pushStroke(loadTouch);
+   type = _events_getGesture(SDL_DOLLARGESTURE, &gestureId, &error);
+   SDLTest_AssertCheck(type == SDL_DOLLARGESTURE && gestureId == recorded, "Check that the stroke is recognized as the loaded template");
+   SDLTest_AssertCheck(error == recordedError, "Check the error of the match, expected: %f, got: %f", recordedError, error);
+
+   return TEST_COMPLETED;
+}
+
 
 /* ================= Test References ================== */
 
@@ -187,9 +587,27 @@ static const SDLTest_TestCaseReference eventsTest2 =
 static const SDLTest_TestCaseReference eventsTest3 =
         { (SDLTest_TestCaseFp)events_addDelEventWatchWithUserdata, "events_addDelEventWatchWithUserdata", "Adds and deletes an event watch function with userdata", TEST_ENABLED };
 
+static const SDLTest_TestCaseReference eventsTest4 =
+        { (SDLTest_TestCaseFp)events_peepEventRanges, "events_peepEventRanges", "Peeks, gets and flushes ranges of event types", TEST_ENABLED };
+
+static const SDLTest_TestCaseReference eventsTest5 =
+        { (SDLTest_TestCaseFp)events_coalesceMotion, "events_coalesceMotion", "Merges motion events while SDL_HINT_EVENT_COALESCING is set", TEST_ENABLED };
+
+static const SDLTest_TestCaseReference eventsTest6 =
+        { (SDLTest_TestCaseFp)events_pushEvents, "events_pushEvents", "Pushes a batch of events, some of which are filtered", TEST_ENABLED };
+
+static const SDLTest_TestCaseReference eventsTest7 =
+        { (SDLTest_TestCaseFp)events_timestampNS, "events_timestampNS", "Checks the nanosecond timestamp of a pushed event", TEST_ENABLED };
+
+static const SDLTest_TestCaseReference eventsTest8 =
+        { (SDLTest_TestCaseFp)events_concurrentEventWatch, "events_concurrentEventWatch", "Adds and deletes event watchers while other threads push events", TEST_ENABLED };
+
+static const SDLTest_TestCaseReference eventsTest9 =
+        { (SDLTest_TestCaseFp)events_dollarTemplateRoundTrip, "events_dollarTemplateRoundTrip", "Saves a gesture template twice and loads it into another touch", TEST_ENABLED };
+
 /* Sequence of Events test cases */
 static const SDLTest_TestCaseReference *eventsTests[] =  {
-    &eventsTest1, &eventsTest2, &eventsTest3, NULL
+    &eventsTest1, &eventsTest2, &eventsTest3, &eventsTest4, &eventsTest5, &eventsTest6, &eventsTest7, &eventsTest8, &eventsTest9, NULL
 };
 
 /* Events test suite (global) */
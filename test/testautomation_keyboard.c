@@ -39,6 +39,55 @@ keyboard_getKeyboardState(void *arg)
    return TEST_COMPLETED;
 }
 
+/**
+ * @brief Check call to SDL_GetKeyboardSnapshot against SDL_GetKeyboardState and SDL_GetModState.
+ */
+int
+keyboard_getKeyboardSnapshot(void *arg)
+{
+   Uint8 snapshot[SDL_NUM_SCANCODES];
+   const Uint8 *state;
+   SDL_Keymod mod, originalMod;
+   int numkeys, result;
+
+   originalMod = SDL_GetModState();
+   SDL_SetModState(KMOD_LSHIFT | KMOD_CAPS);
+   SDLTest_AssertPass("Call to SDL_SetModState(KMOD_LSHIFT | KMOD_CAPS)");
+
+   /* Copy everything */
+   SDL_memset(snapshot, 0xFF, sizeof(snapshot));
+   mod = KMOD_NONE;
+   state = SDL_GetKeyboardState(&numkeys);
+   result = SDL_GetKeyboardSnapshot(snapshot, SDL_arraysize(snapshot), &mod);
+   SDLTest_AssertPass("Call to SDL_GetKeyboardSnapshot(snapshot, %i, &mod)", (int)SDL_arraysize(snapshot));
+   SDLTest_AssertCheck(result == numkeys, "Validate return value, expected: %i, got: %i", numkeys, result);
+   SDLTest_AssertCheck(SDL_memcmp(snapshot, state, numkeys) == 0, "Validate that the snapshot matches SDL_GetKeyboardState()");
+   SDLTest_AssertCheck(mod == (KMOD_LSHIFT | KMOD_CAPS), "Validate modifiers, expected: 0x%.4x, got: 0x%.4x", KMOD_LSHIFT | KMOD_CAPS, mod);
+
+   /* Copy part of the keys */
+   SDL_memset(snapshot, 0xFF, sizeof(snapshot));
+   result = SDL_GetKeyboardSnapshot(snapshot, 4, NULL);
+   SDLTest_AssertPass("Call to SDL_GetKeyboardSnapshot(snapshot, 4, NULL)");
+   SDLTest_AssertCheck(result == 4, "Validate return value, expected: 4, got: %i", result);
+   SDLTest_AssertCheck(snapshot[4] == 0xFF, "Validate that only 4 key states were copied");
+
+   /* Only the modifiers */
+   SDL_SetModState(KMOD_NONE);
+   mod = KMOD_CAPS;
+   result = SDL_GetKeyboardSnapshot(NULL, 0, &mod);
+   SDLTest_AssertPass("Call to SDL_GetKeyboardSnapshot(NULL, 0, &mod)");
+   SDLTest_AssertCheck(result == 0, "Validate return value, expected: 0, got: %i", result);
+   SDLTest_AssertCheck(mod == KMOD_NONE, "Validate modifiers, expected: 0x%.4x, got: 0x%.4x", KMOD_NONE, mod);
+
+   /* Invalid parameters */
+   result = SDL_GetKeyboardSnapshot(NULL, 4, NULL);
+   SDLTest_AssertPass("Call to SDL_GetKeyboardSnapshot(NULL, 4, NULL)");
+   SDLTest_AssertCheck(result == -1, "Validate return value, expected: -1, got: %i", result);
+
+   SDL_SetModState(originalMod);
+   return TEST_COMPLETED;
+}
+
 /**
  * @brief Check call to SDL_GetKeyboardFocus
  *
@@ -697,11 +746,14 @@ static const SDLTest_TestCaseReference keyboardTest13 =
 static const SDLTest_TestCaseReference keyboardTest14 =
         { (SDLTest_TestCaseFp)keyboard_getScancodeNameNegative, "keyboard_getScancodeNameNegative", "Check call to SDL_GetScancodeName with invalid data", TEST_ENABLED };
 
+static const SDLTest_TestCaseReference keyboardTest15 =
+        { (SDLTest_TestCaseFp)keyboard_getKeyboardSnapshot, "keyboard_getKeyboardSnapshot", "Check call to SDL_GetKeyboardSnapshot", TEST_ENABLED };
+
 /* Sequence of Keyboard test cases */
 static const SDLTest_TestCaseReference *keyboardTests[] =  {
     &keyboardTest1, &keyboardTest2, &keyboardTest3, &keyboardTest4, &keyboardTest5, &keyboardTest6,
     &keyboardTest7, &keyboardTest8, &keyboardTest9, &keyboardTest10, &keyboardTest11, &keyboardTest12,
-    &keyboardTest13, &keyboardTest14, NULL
+    &keyboardTest13, &keyboardTest14, &keyboardTest15, NULL
 };
 
 /* Keyboard test suite (global) */
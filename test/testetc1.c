@@ -0,0 +1,153 @@
+/*
+  Copyright (C) 1997-2014 Sam Lantinga <slouken@libsdl.org>
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely.
+*/
+
+/* Host-side check of the ETC1 codec used by the 3DS renderer.
+   Built together with ../src/render/3ds/SDL_etc1.c, see Makefile.in */
+
+#include "SDL.h"
+#include "../src/render/3ds/SDL_etc1.h"
+
+#define IMAGE_W 64
+#define IMAGE_H 64
+#define PITCH   (IMAGE_W * 4)
+
+static void
+FillImage(Uint8 *rgba, int pattern)
+{
+    Uint32 seed = 0x12345678;
+    int x, y;
+
+    for (y = 0; y < IMAGE_H; y++) {
+        for (x = 0; x < IMAGE_W; x++) {
+            Uint8 *px = &rgba[y * PITCH + x * 4];
+            switch (pattern) {
+            case 0:     /* smooth gradients */
+                px[0] = (Uint8)(x * 4);
+                px[1] = (Uint8)(y * 4);
+                px[2] = (Uint8)((x + y) * 2);
+                px[3] = (Uint8)(255 - x * 4);
+                break;
+            case 1:     /* hard edges, channels changing independently
+                           (the worst case for ETC1's shared modifiers) */
+                px[0] = ((x / 3 + y / 5) & 1) ? 230 : 20;
+                px[1] = (y & 8) ? 200 : 40;
+                px[2] = (x & 4) ? 255 : 0;
+                px[3] = (x & 16) ? 255 : 0;
+                break;
+            default:    /* noise */
+                seed = seed * 1103515245 + 12345;
+                px[0] = (Uint8)(seed >> 16);
+                seed = seed * 1103515245 + 12345;
+                px[1] = (Uint8)(seed >> 16);
+                seed = seed * 1103515245 + 12345;
+                px[2] = (Uint8)(seed >> 16);
+                seed = seed * 1103515245 + 12345;
+                px[3] = (Uint8)(seed >> 16);
+                break;
+            }
+        }
+    }
+}
+
+static double
+PSNR(const Uint8 *a, const Uint8 *b, int channels)
+{
+    double mse = 0.0;
+    int i, c;
+
+    for (i = 0; i < IMAGE_W * IMAGE_H; i++) {
+        for (c = 0; c < channels; c++) {
+            const int d = a[i * 4 + c] - b[i * 4 + c];
+            mse += d * d;
+        }
+    }
+    mse /= (double)(IMAGE_W * IMAGE_H * channels);
+    if (mse == 0.0) {
+        return 99.0;
+    }
+    return 10.0 * SDL_log(255.0 * 255.0 / mse) / SDL_log(10.0);
+}
+
+/* Encode, decode and compare; also check that flipping a block matches
+   flipping its decoded pixels */
+static int
+CheckImage(const Uint8 *rgba, int alpha, double min_psnr, const char *name)
+{
+    Uint8 decoded[IMAGE_H * PITCH];
+    int bx, by, mismatches = 0;
+    double psnr;
+
+    for (by = 0; by < IMAGE_H; by += 4) {
+        for (bx = 0; bx < IMAGE_W; bx += 4) {
+            const Uint8 *src = &rgba[by * PITCH + bx * 4];
+            Uint8 *dst = &decoded[by * PITCH + bx * 4];
+            Uint8 block[SDL_ETC1A4_BLOCK_SIZE];
+            Uint8 plain[4 * 16], flipped[4 * 16];
+            int y;
+
+            if (alpha) {
+                SDL_ETC1A4_EncodeBlock(src, PITCH, block);
+                SDL_ETC1A4_DecodeBlock(block, dst, PITCH);
+                SDL_ETC1A4_DecodeBlock(block, plain, 16);
+                SDL_ETC1A4_FlipBlock(block);
+                SDL_ETC1A4_DecodeBlock(block, flipped, 16);
+            } else {
+                SDL_ETC1_EncodeBlock(src, PITCH, block);
+                SDL_ETC1_DecodeBlock(block, dst, PITCH);
+                SDL_ETC1_DecodeBlock(block, plain, 16);
+                SDL_ETC1_FlipBlock(block);
+                SDL_ETC1_DecodeBlock(block, flipped, 16);
+            }
+            for (y = 0; y < 4; y++) {
+                if (SDL_memcmp(&plain[y * 16], &flipped[(3 - y) * 16], 16) != 0) {
+                    mismatches++;   /* re-encoded, not an exact flip */
+                    break;
+                }
+            }
+        }
+    }
+
+    psnr = PSNR(rgba, decoded, alpha ? 4 : 3);
+    SDL_Log("%-10s %-6s PSNR %5.1f dB, %d inexact flips\n",
+            name, alpha ? "ETC1A4" : "ETC1", psnr, mismatches);
+    if (psnr < min_psnr) {
+        SDL_Log("FAILED: %s PSNR below %.1f dB\n", name, min_psnr);
+        return 1;
+    }
+    if (mismatches > (IMAGE_W * IMAGE_H / 16) / 4) {
+        SDL_Log("FAILED: %s has too many inexact flips\n", name);
+        return 1;
+    }
+    return 0;
+}
+
+int
+main(int argc, char *argv[])
+{
+    static Uint8 image[IMAGE_H * PITCH];
+    int failed = 0;
+
+    /* Enable standard application logging */
+    SDL_LogSetPriority(SDL_LOG_CATEGORY_APPLICATION, SDL_LOG_PRIORITY_INFO);
+
+    FillImage(image, 0);
+    failed += CheckImage(image, 0, 35.0, "gradient");
+    failed += CheckImage(image, 1, 30.0, "gradient");
+    FillImage(image, 1);
+    failed += CheckImage(image, 0, 15.0, "edges");
+    failed += CheckImage(image, 1, 15.0, "edges");
+    FillImage(image, 2);
+    failed += CheckImage(image, 0, 10.0, "noise");
+
+    SDL_Log("%s\n", failed ? "FAILED" : "All tests passed");
+    return failed ? 1 : 0;
+}
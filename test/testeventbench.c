@@ -0,0 +1,206 @@
+/*
+  Copyright (C) 1997-2014 Sam Lantinga <slouken@libsdl.org>
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely.
+*/
+
+/* Measure event queue throughput with several threads pushing events,
+   one at a time or with SDL_PushEvents(), while the main thread takes them
+   out, and check that the events of each thread come out in the order
+   they went in. Event watchers can be added to measure what they cost. */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "SDL.h"
+
+#define MAX_PRODUCERS   8
+#define DEFAULT_EVENTS  200000
+#define MAX_BATCH       256
+
+typedef struct
+{
+    int id;
+    int num_events;
+    int retries;
+} Producer;
+
+static SDL_atomic_t go;
+static int batch_size = 1;
+
+static int
+NullWatcher(void *userdata, SDL_Event *event)
+{
+    return 1;
+}
+
+static int
+ProducerThread(void *arg)
+{
+    Producer *producer = (Producer *) arg;
+    SDL_Event event;
+    SDL_Event batch[MAX_BATCH];
+    int i, j, count, pushed;
+
+    while (!SDL_AtomicGet(&go)) {
+        SDL_Delay(0);
+    }
+
+    SDL_zero(event);
+    event.type = SDL_USEREVENT;
+    event.user.code = producer->id;
+    if (batch_size == 1) {
+        for (i = 0; i < producer->num_events; ++i) {
+            event.user.data1 = (void *)(size_t)i;
+            while (SDL_PushEvent(&event) <= 0) {
+                /* Queue full, let the consumer catch up */
+                ++producer->retries;
+                SDL_Delay(0);
+            }
+        }
+        return 0;
+    }
+
+    for (i = 0; i < producer->num_events; i += count) {
+        count = SDL_min(batch_size, producer->num_events - i);
+        for (j = 0; j < count; ++j) {
+            batch[j] = event;
+            batch[j].user.data1 = (void *)(size_t)(i + j);
+        }
+        for (j = 0; j < count; j += pushed) {
+            pushed = SDL_PushEvents(&batch[j], count - j);
+            if (pushed <= 0) {
+                ++producer->retries;
+                SDL_Delay(0);
+                pushed = 0;
+            }
+        }
+    }
+    return 0;
+}
+
+static int
+RunBenchmark(int num_producers, int num_events)
+{
+    SDL_Thread *threads[MAX_PRODUCERS];
+    Producer producers[MAX_PRODUCERS];
+    int next[MAX_PRODUCERS];
+    SDL_Event events[256];
+    int total = num_producers * num_events;
+    int received = 0;
+    int retries = 0;
+    int errors = 0;
+    Uint64 start, elapsed;
+    double seconds;
+    int i, n;
+
+    SDL_AtomicSet(&go, 0);
+    for (i = 0; i < num_producers; ++i) {
+        producers[i].id = i;
+        producers[i].num_events = num_events;
+        producers[i].retries = 0;
+        next[i] = 0;
+        threads[i] = SDL_CreateThread(ProducerThread, "Producer", &producers[i]);
+        if (!threads[i]) {
+            SDL_Log("Couldn't create thread: %s\n", SDL_GetError());
+            return -1;
+        }
+    }
+
+    start = SDL_GetPerformanceCounter();
+    SDL_AtomicSet(&go, 1);
+
+    while (received < total) {
+        n = SDL_PeepEvents(events, SDL_arraysize(events), SDL_GETEVENT, SDL_USEREVENT, SDL_USEREVENT);
+        if (n < 0) {
+            SDL_Log("SDL_PeepEvents() failed: %s\n", SDL_GetError());
+            return -1;
+        }
+        for (i = 0; i < n; ++i) {
+            int id = events[i].user.code;
+            int seq = (int)(size_t)events[i].user.data1;
+            if (id < 0 || id >= num_producers || seq != next[id]) {
+                ++errors;
+            } else {
+                ++next[id];
+            }
+        }
+        received += n;
+    }
+
+    elapsed = SDL_GetPerformanceCounter() - start;
+    seconds = (double)elapsed / SDL_GetPerformanceFrequency();
+
+    for (i = 0; i < num_producers; ++i) {
+        SDL_WaitThread(threads[i], NULL);
+        retries += producers[i].retries;
+    }
+
+    SDL_Log("%d producer%s: %d events in %.3f s, %.2f Mevents/s, %d full queue retries%s\n",
+            num_producers, num_producers == 1 ? " " : "s", total, seconds,
+            total / seconds / 1000000.0, retries,
+            errors ? ", OUT OF ORDER" : "");
+
+    return errors ? -1 : 0;
+}
+
+int
+main(int argc, char *argv[])
+{
+    int num_events = DEFAULT_EVENTS;
+    int num_producers = 0;
+    int num_watchers = 0;
+    int status = 0;
+    int i;
+
+    /* Enable standard application logging */
+    SDL_LogSetPriority(SDL_LOG_CATEGORY_APPLICATION, SDL_LOG_PRIORITY_INFO);
+
+    for (i = 1; i < argc; ++i) {
+        if (SDL_strcmp(argv[i], "--producers") == 0 && argv[i+1]) {
+            num_producers = SDL_atoi(argv[++i]);
+        } else if (SDL_strcmp(argv[i], "--events") == 0 && argv[i+1]) {
+            num_events = SDL_atoi(argv[++i]);
+        } else if (SDL_strcmp(argv[i], "--batch") == 0 && argv[i+1]) {
+            batch_size = SDL_atoi(argv[++i]);
+        } else if (SDL_strcmp(argv[i], "--watchers") == 0 && argv[i+1]) {
+            num_watchers = SDL_atoi(argv[++i]);
+        } else {
+            SDL_Log("Usage: %s [--producers 1-%d] [--events N] [--batch 1-%d] [--watchers N]\n", argv[0], MAX_PRODUCERS, MAX_BATCH);
+            return 1;
+        }
+    }
+    if (num_producers < 0 || num_producers > MAX_PRODUCERS || num_events <= 0 ||
+        batch_size < 1 || batch_size > MAX_BATCH || num_watchers < 0) {
+        SDL_Log("Usage: %s [--producers 1-%d] [--events N] [--batch 1-%d] [--watchers N]\n", argv[0], MAX_PRODUCERS, MAX_BATCH);
+        return 1;
+    }
+
+    if (SDL_Init(SDL_INIT_EVENTS) < 0) {
+        SDL_Log("Couldn't initialize SDL: %s\n", SDL_GetError());
+        return 1;
+    }
+
+    for (i = 0; i < num_watchers; ++i) {
+        SDL_AddEventWatch(NullWatcher, (void *)(size_t)i);
+    }
+
+    if (num_producers) {
+        status = RunBenchmark(num_producers, num_events);
+    } else {
+        for (i = 1; i <= MAX_PRODUCERS && status == 0; i *= 2) {
+            status = RunBenchmark(i, num_events);
+        }
+    }
+
+    SDL_Quit();
+    return (status == 0) ? 0 : 1;
+}
+
+/* vi: set ts=4 sw=4 expandtab: */
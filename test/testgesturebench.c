@@ -0,0 +1,415 @@
+/*
+  Copyright (C) 1997-2014 Sam Lantinga <slouken@libsdl.org>
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely.
+*/
+
+/* Measure how long $1 gesture recognition takes with 10 to 1000 templates
+   loaded, on the event thread or with SDL_HINT_GESTURE_ASYNC, and how long
+   loading the templates takes, from the format SDL saves them in and from
+   the older one without a header. The loaded templates are saved again and
+   checked against the recorded ones.
+
+   The strokes are finger events pushed with SDL_PushEvent(), so this
+   doesn't need a touch screen. */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "SDL.h"
+
+#define NUM_POINTS      64  /* Points in a saved template */
+#define HEADER_SIZE     16  /* Magic, version, count and points, as Uint32 */
+#define TEMPLATE_SIZE   (8 + NUM_POINTS * 2 * sizeof(float))
+#define STROKE_POINTS   48  /* Finger motions in a stroke */
+#define DEFAULT_STROKES 200
+
+#define RECORD_TOUCH    1
+#define RELOAD_TOUCH    2
+#define LEGACY_TOUCH    3
+#define APPEND_TOUCH    4
+#define NUM_TOUCHES     4
+
+typedef struct
+{
+    float a, b, phase;
+} Shape;
+
+static float last_x, last_y;
+
+static int
+PushFinger(Uint32 type, SDL_TouchID touchId, float x, float y)
+{
+    SDL_Event event;
+
+    SDL_zero(event);
+    event.tfinger.type = type;
+    event.tfinger.touchId = touchId;
+    event.tfinger.fingerId = 0;
+    event.tfinger.x = x;
+    event.tfinger.y = y;
+    event.tfinger.dx = (type == SDL_FINGERMOTION) ? x - last_x : 0.0f;
+    event.tfinger.dy = (type == SDL_FINGERMOTION) ? y - last_y : 0.0f;
+    event.tfinger.pressure = 1.0f;
+    last_x = x;
+    last_y = y;
+    return SDL_PushEvent(&event);
+}
+
+/* The gestures start tracking a touch at its first finger down */
+static int
+AddTouch(SDL_TouchID touchId)
+{
+    if (PushFinger(SDL_FINGERDOWN, touchId, 0.5f, 0.5f) < 0 ||
+        PushFinger(SDL_FINGERUP, touchId, 0.5f, 0.5f) < 0) {
+        return -1;
+    }
+    SDL_FlushEvents(SDL_FINGERDOWN, SDL_FINGERUP);
+    return 0;
+}
+
+/* Lissajous curves, so strokes have something to match */
+static void
+ShapePoint(const Shape *shape, float t, float *x, float *y)
+{
+    *x = (float)SDL_sin(shape->a * t + shape->phase);
+    *y = (float)SDL_sin(shape->b * t);
+}
+
+static void
+RandomShape(Shape *shape)
+{
+    /* Different frequencies, so none of them is a straight line */
+    shape->a = 1.0f + (rand() % 4);
+    shape->b = shape->a + 1.0f + (rand() % 3);
+    shape->phase = (float)(rand() % 628) / 100.0f;
+}
+
+static void
+PushStroke(SDL_TouchID touchId, const Shape *shape)
+{
+    float x, y;
+    int i;
+
+    ShapePoint(shape, 0.0f, &x, &y);
+    PushFinger(SDL_FINGERDOWN, touchId, 0.5f + 0.3f * x, 0.5f + 0.3f * y);
+    for (i = 1; i <= STROKE_POINTS; ++i) {
+        ShapePoint(shape, (float)(2 * M_PI) * i / STROKE_POINTS, &x, &y);
+        PushFinger(SDL_FINGERMOTION, touchId, 0.5f + 0.3f * x, 0.5f + 0.3f * y);
+    }
+    PushFinger(SDL_FINGERUP, touchId, 0.5f + 0.3f * x, 0.5f + 0.3f * y);
+}
+
+/* Record a template for each shape, and return their gesture ids */
+static SDL_GestureID *
+RecordTemplates(const Shape *shapes, int num_templates)
+{
+    SDL_GestureID *ids;
+    SDL_Event event;
+    int i;
+
+    ids = (SDL_GestureID *)SDL_malloc(num_templates * sizeof(SDL_GestureID));
+    if (!ids) {
+        SDL_OutOfMemory();
+        return NULL;
+    }
+    for (i = 0; i < num_templates; ++i) {
+        SDL_bool recorded = SDL_FALSE;
+
+        SDL_RecordGesture(RECORD_TOUCH);
+        PushStroke(RECORD_TOUCH, &shapes[i]);
+        while (SDL_PollEvent(&event)) {
+            if (event.type == SDL_DOLLARRECORD && event.dgesture.gestureId != (SDL_GestureID)-1) {
+                ids[i] = event.dgesture.gestureId;
+                recorded = SDL_TRUE;
+            }
+        }
+        if (!recorded) {
+            SDL_SetError("Template %d wasn't recorded", i);
+            SDL_free(ids);
+            return NULL;
+        }
+    }
+    return ids;
+}
+
+/* Turn saved templates into the format without a header, x and y
+   interleaved */
+static Uint8 *
+MakeLegacyTemplates(const Uint8 *saved, int num_templates, size_t *size)
+{
+    const float *points = (const float *)(saved + HEADER_SIZE + num_templates * 8);
+    float *legacy;
+    int i, j;
+
+    *size = num_templates * NUM_POINTS * 2 * sizeof(float);
+    legacy = (float *)SDL_malloc(*size);
+    if (!legacy) {
+        SDL_OutOfMemory();
+        return NULL;
+    }
+    for (i = 0; i < num_templates; ++i) {
+        for (j = 0; j < NUM_POINTS; ++j) {
+            legacy[(i * NUM_POINTS + j) * 2 + 0] = points[j];
+            legacy[(i * NUM_POINTS + j) * 2 + 1] = points[NUM_POINTS + j];
+        }
+        points += 2 * NUM_POINTS;
+    }
+    return (Uint8 *)legacy;
+}
+
+/* Save each template as a block of its own, one after the other */
+static Uint8 *
+SaveTemplateBlocks(const SDL_GestureID *ids, int num_templates, size_t *size)
+{
+    Uint8 *data;
+    SDL_RWops *rw;
+    int i;
+
+    *size = num_templates * (HEADER_SIZE + TEMPLATE_SIZE);
+    data = (Uint8 *)SDL_malloc(*size);
+    rw = data ? SDL_RWFromMem(data, (int)*size) : NULL;
+    if (!rw) {
+        SDL_free(data);
+        return NULL;
+    }
+    for (i = 0; i < num_templates; ++i) {
+        if (SDL_SaveDollarTemplate(ids[i], rw) != 1) {
+            SDL_RWclose(rw);
+            SDL_free(data);
+            return NULL;
+        }
+    }
+    SDL_RWclose(rw);
+    return data;
+}
+
+/* Save the templates of every touch, and check that the ones loaded into
+   the other touches are the recorded ones */
+static int
+CheckTemplates(int num_templates)
+{
+    const int total = num_templates * NUM_TOUCHES;
+    const size_t points_size = NUM_POINTS * 2 * sizeof(float);
+    size_t size = HEADER_SIZE + total * TEMPLATE_SIZE;
+    Uint8 *data = (Uint8 *)SDL_malloc(size);
+    const Uint64 *ids;
+    const Uint8 *points;
+    SDL_RWops *rw;
+    int i, j, errors = 0;
+
+    rw = data ? SDL_RWFromMem(data, (int)size) : NULL;
+    if (!rw || SDL_SaveAllDollarTemplates(rw) != total) {
+        SDL_Log("Couldn't save templates: %s\n", SDL_GetError());
+        if (rw) {
+            SDL_RWclose(rw);
+        }
+        SDL_free(data);
+        return -1;
+    }
+    SDL_RWclose(rw);
+
+    ids = (const Uint64 *)(data + HEADER_SIZE);
+    points = (const Uint8 *)(ids + total);
+    for (i = 1; i < NUM_TOUCHES; ++i) {
+        for (j = 0; j < num_templates; ++j) {
+            const int k = i * num_templates + j;
+            if (ids[k] != ids[j] ||
+                SDL_memcmp(points + k * points_size, points + j * points_size, points_size) != 0) {
+                if (errors++ < 5) {
+                    SDL_Log("Template %d loaded into touch %d differs from the recorded one\n", j, i + 1);
+                }
+            }
+        }
+    }
+    SDL_free(data);
+    return errors ? -1 : 0;
+}
+
+/* Load templates into a new touch, and return how long it took */
+static int
+LoadTemplates(SDL_TouchID touchId, void *data, size_t size, double *seconds)
+{
+    SDL_RWops *src;
+    Uint64 start;
+    int loaded;
+
+    if (AddTouch(touchId) < 0) {
+        return -1;
+    }
+    src = SDL_RWFromMem(data, (int)size);
+    if (!src) {
+        return -1;
+    }
+    start = SDL_GetPerformanceCounter();
+    loaded = SDL_LoadDollarTemplates(touchId, src);
+    *seconds = (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+    SDL_RWclose(src);
+    return loaded;
+}
+
+static int
+RunBenchmark(int num_templates, int num_strokes)
+{
+    Shape *shapes = NULL;
+    SDL_GestureID *ids = NULL;
+    Uint8 *saved = NULL, *legacy = NULL, *blocks = NULL;
+    size_t saved_size, legacy_size, blocks_size;
+    SDL_RWops *rw;
+    SDL_Event event;
+    Uint64 start;
+    double seconds, load_seconds, legacy_seconds, blocks_seconds;
+    int recognized = 0, matched = 0;
+    int status = -1;
+    int i;
+
+    if (SDL_Init(SDL_INIT_EVENTS) < 0) {
+        SDL_Log("Couldn't initialize SDL: %s\n", SDL_GetError());
+        return -1;
+    }
+
+    shapes = (Shape *)SDL_malloc(num_templates * sizeof(Shape));
+    saved_size = HEADER_SIZE + num_templates * TEMPLATE_SIZE;
+    saved = (Uint8 *)SDL_malloc(saved_size);
+    if (!shapes || !saved) {
+        SDL_Log("Out of memory\n");
+        goto done;
+    }
+    for (i = 0; i < num_templates; ++i) {
+        RandomShape(&shapes[i]);
+    }
+    if (AddTouch(RECORD_TOUCH) < 0 ||
+        (ids = RecordTemplates(shapes, num_templates)) == NULL) {
+        SDL_Log("Couldn't record templates: %s\n", SDL_GetError());
+        goto done;
+    }
+
+    rw = SDL_RWFromMem(saved, (int)saved_size);
+    if (!rw || SDL_SaveAllDollarTemplates(rw) != num_templates) {
+        SDL_Log("Couldn't save templates: %s\n", SDL_GetError());
+        if (rw) {
+            SDL_RWclose(rw);
+        }
+        goto done;
+    }
+    SDL_RWclose(rw);
+    legacy = MakeLegacyTemplates(saved, num_templates, &legacy_size);
+    blocks = SaveTemplateBlocks(ids, num_templates, &blocks_size);
+    if (!legacy || !blocks ||
+        LoadTemplates(RELOAD_TOUCH, saved, saved_size, &load_seconds) != num_templates ||
+        LoadTemplates(LEGACY_TOUCH, legacy, legacy_size, &legacy_seconds) != num_templates ||
+        LoadTemplates(APPEND_TOUCH, blocks, blocks_size, &blocks_seconds) != num_templates) {
+        SDL_Log("Couldn't load templates: %s\n", SDL_GetError());
+        goto done;
+    }
+    if (CheckTemplates(num_templates) < 0) {
+        goto done;
+    }
+
+    start = SDL_GetPerformanceCounter();
+    for (i = 0; i < num_strokes; ++i) {
+        PushStroke(RECORD_TOUCH, &shapes[i % num_templates]);
+
+        /* Keep the queue from filling up */
+        while (SDL_PollEvent(&event)) {
+            if (event.type == SDL_DOLLARGESTURE) {
+                ++recognized;
+            }
+        }
+    }
+
+    /* Wait for the gestures still being recognized in the background */
+    while (recognized < num_strokes) {
+        if (!SDL_WaitEventTimeout(&event, 1000)) {
+            break;
+        }
+        if (event.type == SDL_DOLLARGESTURE) {
+            ++recognized;
+        }
+    }
+    seconds = (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+
+    /* Every stroke should find the template it was recorded as */
+    SDL_SetHint(SDL_HINT_GESTURE_ASYNC, "0");
+    for (i = 0; i < num_strokes && i < num_templates; ++i) {
+        PushStroke(RECORD_TOUCH, &shapes[i]);
+        while (SDL_PollEvent(&event)) {
+            if (event.type == SDL_DOLLARGESTURE && event.dgesture.gestureId == ids[i]) {
+                ++matched;
+            }
+        }
+    }
+
+    SDL_Log("%4d templates: loaded in %.3f us each, %.3f us each without a header, %.3f us each saved one by one\n",
+            num_templates, load_seconds * 1000000.0 / num_templates,
+            legacy_seconds * 1000000.0 / num_templates,
+            blocks_seconds * 1000000.0 / num_templates);
+    SDL_Log("%4d templates: %d strokes in %.3f s, %.1f us per stroke, %d recognized, %d of %d matched\n",
+            num_templates, num_strokes, seconds,
+            seconds * 1000000.0 / num_strokes, recognized,
+            matched, SDL_min(num_strokes, num_templates));
+
+    if (recognized == num_strokes && matched == SDL_min(num_strokes, num_templates)) {
+        status = 0;
+    }
+
+done:
+    SDL_free(blocks);
+    SDL_free(legacy);
+    SDL_free(saved);
+    SDL_free(ids);
+    SDL_free(shapes);
+    SDL_Quit();
+    return status;
+}
+
+int
+main(int argc, char *argv[])
+{
+    static const int template_counts[] = { 10, 30, 100, 300, 1000 };
+    const char *async = NULL;
+    int num_strokes = DEFAULT_STROKES;
+    int num_templates = 0;
+    int status = 0;
+    int i;
+
+    /* Enable standard application logging */
+    SDL_LogSetPriority(SDL_LOG_CATEGORY_APPLICATION, SDL_LOG_PRIORITY_INFO);
+
+    for (i = 1; i < argc; ++i) {
+        if (SDL_strcmp(argv[i], "--templates") == 0 && argv[i+1]) {
+            num_templates = SDL_atoi(argv[++i]);
+        } else if (SDL_strcmp(argv[i], "--strokes") == 0 && argv[i+1]) {
+            num_strokes = SDL_atoi(argv[++i]);
+        } else if (SDL_strcmp(argv[i], "--async") == 0) {
+            async = "1";
+        } else {
+            SDL_Log("Usage: %s [--templates N] [--strokes N] [--async]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (num_templates < 0 || num_strokes <= 0) {
+        SDL_Log("Usage: %s [--templates N] [--strokes N] [--async]\n", argv[0]);
+        return 1;
+    }
+
+    srand(0);
+    if (num_templates) {
+        SDL_SetHint(SDL_HINT_GESTURE_ASYNC, async);
+        status = RunBenchmark(num_templates, num_strokes);
+    } else {
+        for (i = 0; i < SDL_arraysize(template_counts) && status == 0; ++i) {
+            SDL_SetHint(SDL_HINT_GESTURE_ASYNC, async);
+            status = RunBenchmark(template_counts[i], num_strokes);
+        }
+    }
+    return (status == 0) ? 0 : 1;
+}
+
+/* vi: set ts=4 sw=4 expandtab: */
@@ -0,0 +1,234 @@
+/*
+  Copyright (C) 1997-2014 Sam Lantinga <slouken@libsdl.org>
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely.
+*/
+
+/* Check that SDL_MixAudioFormat() gives the same bits as mixing one sample
+   at a time in plain C, then measure how many samples per second it mixes
+   for each format, at full volume and below it. */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "SDL.h"
+
+#define NUM_SAMPLES     4096
+#define DEFAULT_SECONDS 0.25
+
+typedef void (*Reference) (void *dst, const void *src, int num, int volume);
+
+typedef struct
+{
+    const char *name;
+    SDL_AudioFormat format;
+    Reference reference;
+} MixFormat;
+
+static void
+MixS16(void *dst, const void *src, int num, int volume)
+{
+    int i;
+    for (i = 0; i < num; ++i) {
+        int sample = ((const Sint16 *) src)[i] * volume / SDL_MIX_MAXVOLUME;
+        sample += ((Sint16 *) dst)[i];
+        ((Sint16 *) dst)[i] = (Sint16) SDL_max(SDL_min(sample, 32767), -32768);
+    }
+}
+
+static void
+MixS32(void *dst, const void *src, int num, int volume)
+{
+    int i;
+    for (i = 0; i < num; ++i) {
+        Sint64 sample = (Sint64) ((const Sint32 *) src)[i] * volume / SDL_MIX_MAXVOLUME;
+        sample += ((Sint32 *) dst)[i];
+        sample = SDL_min(sample, (Sint64) 2147483647);
+        sample = SDL_max(sample, -(Sint64) 2147483647 - 1);
+        ((Sint32 *) dst)[i] = (Sint32) sample;
+    }
+}
+
+static void
+MixF32(void *dst, const void *src, int num, int volume)
+{
+    int i;
+    for (i = 0; i < num; ++i) {
+        float sample = ((const float *) src)[i];
+        double sum;
+        if (volume != SDL_MIX_MAXVOLUME) {
+            sample = (sample * (float) volume) * (1.0f / SDL_MIX_MAXVOLUME);
+        }
+        sum = (double) sample + (double) ((float *) dst)[i];
+        sum = SDL_min(sum, 3.402823466e+38F);
+        sum = SDL_max(sum, -3.402823466e+38F);
+        ((float *) dst)[i] = (float) sum;
+    }
+}
+
+static const MixFormat formats[] = {
+    { "S16SYS", AUDIO_S16SYS, MixS16 },
+    { "S32SYS", AUDIO_S32SYS, MixS32 },
+    { "F32SYS", AUDIO_F32SYS, MixF32 },
+};
+
+static const int volumes[] = { SDL_MIX_MAXVOLUME, 100, 64, 1 };
+
+/* Random samples, with full scale ones mixed in so the sums saturate.
+   Floats go out to a few times full scale, and with huge set, to near the
+   largest there are. Those are only mixed at full volume, since scaling
+   them overflows in float and not on the x87. */
+static void
+FillSamples(SDL_AudioFormat format, void *buf, int num, SDL_bool huge)
+{
+    int i;
+    for (i = 0; i < num; ++i) {
+        Uint32 bits = ((Uint32) rand() << 16) ^ (Uint32) rand();
+        if (SDL_AUDIO_ISFLOAT(format)) {
+            float value = (float) ((int) (bits % 8000001) - 4000000) / 1000000.0f;
+            if (huge && (bits >> 24) == 0) {
+                value = (bits & 1) ? -3.4e38f : 3.4e38f;
+            }
+            ((float *) buf)[i] = value;
+        } else {
+            if ((bits >> 28) == 0) {
+                bits = (bits & 1) ? 0x7FFFFFFF : 0x80000000;
+                if (SDL_AUDIO_BITSIZE(format) == 16) {
+                    bits >>= 16;
+                }
+            }
+            SDL_memcpy((Uint8 *) buf + i * (SDL_AUDIO_BITSIZE(format) / 8), &bits, SDL_AUDIO_BITSIZE(format) / 8);
+        }
+    }
+}
+
+/* On builds that do scalar float math on the x87, the samples left over
+   after the vectorized ones can round differently now and then, so floats
+   are allowed to be off by one in the last place of a sample of 4. */
+static int
+SamplesMatch(SDL_AudioFormat format, const void *a, const void *b, int num)
+{
+    int i;
+
+    if (!SDL_AUDIO_ISFLOAT(format)) {
+        return SDL_memcmp(a, b, num * (SDL_AUDIO_BITSIZE(format) / 8)) == 0;
+    }
+    for (i = 0; i < num; ++i) {
+        const float x = ((const float *) a)[i];
+        const float y = ((const float *) b)[i];
+        if (x != y && SDL_fabs(x - y) > 4.8e-7) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static int
+CheckFormat(const MixFormat *mix)
+{
+    static Uint32 src[NUM_SAMPLES], dst[NUM_SAMPLES], expected[NUM_SAMPLES];
+    const int size = SDL_AUDIO_BITSIZE(mix->format) / 8;
+    int i, num;
+
+    for (i = 0; i < SDL_arraysize(volumes); ++i) {
+        /* Every length up to a few vectors, to cover the leftover samples */
+        for (num = 0; num < 80; ++num) {
+            const SDL_bool huge = (volumes[i] == SDL_MIX_MAXVOLUME);
+            FillSamples(mix->format, src, num, huge);
+            FillSamples(mix->format, dst, num, huge);
+            SDL_memcpy(expected, dst, num * size);
+            mix->reference(expected, src, num, volumes[i]);
+
+            SDL_MixAudioFormat((Uint8 *) dst, (const Uint8 *) src, mix->format, num * size, volumes[i]);
+            if (!SamplesMatch(mix->format, dst, expected, num)) {
+                SDL_Log("%s: %d samples at volume %d don't match the C mixing\n",
+                        mix->name, num, volumes[i]);
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+/* Samples per second through SDL, and through the C mixing */
+static void
+MeasureFormat(const MixFormat *mix, int volume, double seconds)
+{
+    static Uint32 src[NUM_SAMPLES], dst[NUM_SAMPLES];
+    const int size = SDL_AUDIO_BITSIZE(mix->format) / 8;
+    const Uint64 frequency = SDL_GetPerformanceFrequency();
+    Uint64 start, elapsed;
+    Uint64 samples;
+    double mixed;
+
+    FillSamples(mix->format, src, NUM_SAMPLES, SDL_FALSE);
+    FillSamples(mix->format, dst, NUM_SAMPLES, SDL_FALSE);
+
+    samples = 0;
+    start = SDL_GetPerformanceCounter();
+    do {
+        SDL_MixAudioFormat((Uint8 *) dst, (const Uint8 *) src, mix->format, NUM_SAMPLES * size, volume);
+        samples += NUM_SAMPLES;
+        elapsed = SDL_GetPerformanceCounter() - start;
+    } while (elapsed < seconds * frequency);
+    mixed = samples / ((double) elapsed / frequency) / 1000000.0;
+
+    samples = 0;
+    start = SDL_GetPerformanceCounter();
+    do {
+        mix->reference(dst, src, NUM_SAMPLES, volume);
+        samples += NUM_SAMPLES;
+        elapsed = SDL_GetPerformanceCounter() - start;
+    } while (elapsed < seconds * frequency);
+
+    SDL_Log("%s volume %3d: %8.1f Msamples/s, %8.1f Msamples/s in C\n", mix->name, volume,
+            mixed, samples / ((double) elapsed / frequency) / 1000000.0);
+}
+
+int
+main(int argc, char *argv[])
+{
+    double seconds = DEFAULT_SECONDS;
+    int status = 0;
+    int i;
+
+    /* Enable standard application logging */
+    SDL_LogSetPriority(SDL_LOG_CATEGORY_APPLICATION, SDL_LOG_PRIORITY_INFO);
+
+    for (i = 1; i < argc; ++i) {
+        if (SDL_strcmp(argv[i], "--seconds") == 0 && argv[i+1]) {
+            seconds = SDL_atof(argv[++i]);
+        } else {
+            SDL_Log("Usage: %s [--seconds N]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (SDL_Init(0) < 0) {
+        SDL_Log("Couldn't initialize SDL: %s\n", SDL_GetError());
+        return 1;
+    }
+
+    SDL_Log("SSE2: %s, AVX2: %s\n", SDL_HasSSE2() ? "yes" : "no", SDL_HasAVX2() ? "yes" : "no");
+
+    srand(0);
+    for (i = 0; i < SDL_arraysize(formats); ++i) {
+        if (CheckFormat(&formats[i]) < 0) {
+            status = 1;
+            continue;
+        }
+        MeasureFormat(&formats[i], SDL_MIX_MAXVOLUME, seconds);
+        MeasureFormat(&formats[i], SDL_MIX_MAXVOLUME / 2, seconds);
+    }
+
+    SDL_Quit();
+    return status;
+}
+
+/* vi: set ts=4 sw=4 expandtab: */
@@ -0,0 +1,263 @@
+/*
+  Copyright (C) 1997-2014 Sam Lantinga <slouken@libsdl.org>
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely.
+*/
+
+/* Check that the voice mixer gives the same bits as adding the voices up
+   in plain C when they play at the device's rate, then measure what the
+   device callback costs with 1 to 512 voices, at the device's rate and
+   resampled with a pitch of their own.
+
+   The audio is rendered with the disk driver in its offline mode, so this
+   doesn't need a sound card and runs faster than realtime. */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "SDL.h"
+
+#define FREQ            48000
+#define SAMPLES         1024
+#define SOURCE_FRAMES   12000
+#define CHECK_VOICES    6
+#define MAX_VOICES      512
+#define DEFAULT_SECONDS 2
+
+/* Same constant as the converters in SDL */
+#define DIVBY32767 3.05185094759972e-05f
+
+static const char *outfile = "testmixerbench.raw";
+
+typedef struct
+{
+    int num_voices;
+    SDL_bool resample;
+    float gain[MAX_VOICES];
+    float pan[MAX_VOICES];
+} Mix;
+
+/* The mixer takes over the device's callback, so this never runs */
+static void SDLCALL
+SilenceCallback(void *userdata, Uint8 *stream, int len)
+{
+    SDL_memset(stream, 0, len);
+}
+
+/* Mono 16-bit noise, so every frame is different */
+static Sint16 *
+MakeSource(int frames)
+{
+    Sint16 *data = (Sint16 *) SDL_malloc(frames * sizeof (Sint16));
+    int i;
+
+    if (!data) {
+        return NULL;
+    }
+    for (i = 0; i < frames; ++i) {
+        data[i] = (Sint16) ((rand() % 65536) - 32768);
+    }
+    return data;
+}
+
+/* Play the mix into the output file, and return the device's stats */
+static int
+RenderMix(const Mix *mix, const Sint16 *data, int frames, SDL_AudioDeviceStats *stats)
+{
+    SDL_AudioSpec spec, source_spec;
+    SDL_AudioDeviceID dev;
+    char frames_hint[16];
+    int source, i;
+
+    SDL_snprintf(frames_hint, sizeof (frames_hint), "%d", frames);
+    SDL_SetHint(SDL_HINT_AUDIO_DISK_FRAMES, frames_hint);
+
+    SDL_zero(spec);
+    spec.freq = FREQ;
+    spec.format = AUDIO_S16SYS;
+    spec.channels = 2;
+    spec.samples = SAMPLES;
+    spec.callback = SilenceCallback;
+    dev = SDL_OpenAudioDevice(outfile, 0, &spec, NULL, 0);
+    if (!dev) {
+        SDL_Log("Couldn't open audio device: %s\n", SDL_GetError());
+        return -1;
+    }
+    if (SDL_AttachAudioMixer(dev, mix->num_voices) < 0) {
+        SDL_Log("Couldn't attach mixer: %s\n", SDL_GetError());
+        SDL_CloseAudioDevice(dev);
+        return -1;
+    }
+
+    SDL_zero(source_spec);
+    source_spec.freq = mix->resample ? 44100 : FREQ;
+    source_spec.format = AUDIO_S16SYS;
+    source_spec.channels = 1;
+    source = SDL_AddMixerSource(dev, &source_spec, (const Uint8 *) data, SOURCE_FRAMES * sizeof (Sint16));
+    if (source < 0) {
+        SDL_Log("Couldn't add source: %s\n", SDL_GetError());
+        SDL_CloseAudioDevice(dev);
+        return -1;
+    }
+    for (i = 0; i < mix->num_voices; ++i) {
+        int voice = SDL_PlayMixerVoice(dev, source, 1, mix->gain[i], mix->pan[i]);
+        if (voice < 0 ||
+            (mix->resample && SDL_SetMixerVoicePitch(dev, voice, 1.0f + (i % 16) * 0.01f) < 0)) {
+            SDL_Log("Couldn't play voice: %s\n", SDL_GetError());
+            SDL_CloseAudioDevice(dev);
+            return -1;
+        }
+    }
+
+    SDL_PauseAudioDevice(dev, 0);
+    while (SDL_GetAudioDeviceStatus(dev) != SDL_AUDIO_STOPPED) {
+        SDL_Delay(1);
+    }
+    SDL_GetAudioDeviceStats(dev, stats);
+    SDL_CloseAudioDevice(dev);
+    return 0;
+}
+
+static int
+CheckMix(const Sint16 *data)
+{
+    const int frames = SAMPLES * 8;
+    SDL_AudioDeviceStats stats;
+    Sint16 *output;
+    SDL_RWops *rw;
+    Mix mix;
+    int i, j, errors = 0;
+
+    mix.num_voices = CHECK_VOICES;
+    mix.resample = SDL_FALSE;
+    for (i = 0; i < CHECK_VOICES; ++i) {
+        /* Loud enough that the mix clips now and then */
+        mix.gain[i] = 0.1f + (rand() % 100) / 200.0f;
+        mix.pan[i] = (rand() % 201) / 100.0f - 1.0f;
+    }
+    if (RenderMix(&mix, data, frames, &stats) < 0) {
+        return -1;
+    }
+
+    output = (Sint16 *) SDL_malloc(frames * 2 * sizeof (Sint16));
+    rw = SDL_RWFromFile(outfile, "rb");
+    if (!output || !rw || SDL_RWread(rw, output, 2 * sizeof (Sint16), frames) != frames) {
+        SDL_Log("Couldn't read back %s\n", outfile);
+        if (rw) {
+            SDL_RWclose(rw);
+        }
+        SDL_free(output);
+        return -1;
+    }
+    SDL_RWclose(rw);
+
+    for (i = 0; i < frames; ++i) {
+        const float sample = data[i % SOURCE_FRAMES] * DIVBY32767;
+        float left = 0.0f, right = 0.0f;
+
+        for (j = 0; j < CHECK_VOICES; ++j) {
+            left += sample * (mix.gain[j] * SDL_min(1.0f, 1.0f - mix.pan[j]));
+            right += sample * (mix.gain[j] * SDL_min(1.0f, 1.0f + mix.pan[j]));
+        }
+        left = SDL_max(SDL_min(left, 1.0f), -1.0f);
+        right = SDL_max(SDL_min(right, 1.0f), -1.0f);
+        if (output[i * 2] != (Sint16) (left * 32767.0f) ||
+            output[i * 2 + 1] != (Sint16) (right * 32767.0f)) {
+            if (errors++ < 5) {
+                SDL_Log("Frame %d: mixed %d %d, expected %d %d\n", i,
+                        output[i * 2], output[i * 2 + 1],
+                        (Sint16) (left * 32767.0f), (Sint16) (right * 32767.0f));
+            }
+        }
+    }
+    SDL_free(output);
+
+    SDL_Log("%d voices at the device's rate: %s\n", CHECK_VOICES, errors ? "MISMATCH" : "ok");
+    return errors ? -1 : 0;
+}
+
+static void
+RunBenchmark(const Sint16 *data, int num_voices, SDL_bool resample, int seconds)
+{
+    SDL_AudioDeviceStats stats;
+    Mix mix;
+    int i;
+
+    mix.num_voices = num_voices;
+    mix.resample = resample;
+    for (i = 0; i < num_voices; ++i) {
+        mix.gain[i] = 1.0f / num_voices;
+        mix.pan[i] = (i % 3) * 0.5f - 0.5f;
+    }
+    if (RenderMix(&mix, data, FREQ * seconds, &stats) < 0) {
+        return;
+    }
+    SDL_Log("%3d voices%s: %5u us average, %5u us max per %u us buffer, %.2f us per voice\n",
+            num_voices, resample ? ", resampled" : "          ",
+            stats.callback_avg_us, stats.callback_max_us, stats.buffer_us,
+            (double) stats.callback_avg_us / num_voices);
+}
+
+int
+main(int argc, char *argv[])
+{
+    int seconds = DEFAULT_SECONDS;
+    Sint16 *data;
+    int status;
+    int i;
+
+    /* Enable standard application logging */
+    SDL_LogSetPriority(SDL_LOG_CATEGORY_APPLICATION, SDL_LOG_PRIORITY_INFO);
+
+    for (i = 1; i < argc; ++i) {
+        if (SDL_strcmp(argv[i], "--seconds") == 0 && argv[i+1]) {
+            seconds = SDL_atoi(argv[++i]);
+        } else if (SDL_strcmp(argv[i], "--output") == 0 && argv[i+1]) {
+            outfile = argv[++i];
+        } else {
+            SDL_Log("Usage: %s [--seconds N] [--output file]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (seconds <= 0) {
+        SDL_Log("Usage: %s [--seconds N] [--output file]\n", argv[0]);
+        return 1;
+    }
+
+    SDL_setenv("SDL_AUDIODRIVER", "disk", 1);
+    SDL_SetHint(SDL_HINT_AUDIO_DISK_OFFLINE, "1");
+    if (SDL_Init(SDL_INIT_AUDIO) < 0) {
+        SDL_Log("Couldn't initialize SDL: %s\n", SDL_GetError());
+        return 1;
+    }
+
+    srand(0);
+    data = MakeSource(SOURCE_FRAMES);
+    if (!data) {
+        SDL_Log("Out of memory\n");
+        SDL_Quit();
+        return 1;
+    }
+
+    status = CheckMix(data);
+    if (status == 0) {
+        for (i = 1; i <= MAX_VOICES; i *= 2) {
+            RunBenchmark(data, i, SDL_FALSE, seconds);
+        }
+        for (i = 1; i <= MAX_VOICES; i *= 2) {
+            RunBenchmark(data, i, SDL_TRUE, seconds);
+        }
+    }
+
+    SDL_free(data);
+    SDL_Quit();
+    return (status == 0) ? 0 : 1;
+}
+
+/* vi: set ts=4 sw=4 expandtab: */